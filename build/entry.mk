@@ -8,7 +8,7 @@
 # All actions we want to expose to the user.
 USER_ACTIONS:=\
 	3rdparty all app bindist clean createsubs dist install probe run \
-	staticbindist
+	staticbindist test
 
 # Mark all actions as logical targets.
 .PHONY: $(USER_ACTIONS)
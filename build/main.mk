@@ -63,7 +63,7 @@ endif
 # TODO: "dist" and "createsubs" are missing
 # TODO: more missing?
 # Logical targets which require dependency files.
-DEPEND_TARGETS:=all default install run bindist
+DEPEND_TARGETS:=all default install run bindist test
 # Logical targets which do not require dependency files.
 NODEPEND_TARGETS:=clean config probe 3rdparty run-3rdparty staticbindist
 # Mark all logical targets as such.
@@ -258,6 +258,7 @@ endif # goal requires dependencies
 SOURCE_DIRS:=$(sort $(shell find src -type d))
 
 SOURCES_FULL:=$(foreach dir,$(SOURCE_DIRS),$(sort $(wildcard $(dir)/*.cc)))
+TEST_SOURCES_FULL:=$(filter %Test.cc,$(SOURCES_FULL))
 SOURCES_FULL:=$(filter-out %Test.cc,$(SOURCES_FULL))
 SOURCES_FULL:=$(filter-out src/sound/generate%.cc,$(SOURCES_FULL))
 
@@ -308,6 +309,14 @@ DEPEND_FULL:=$(addsuffix .d,$(addprefix $(DEPEND_PATH)/,$(SOURCES)))
 OBJECTS_PATH:=$(BUILD_PATH)/obj
 OBJECTS_FULL:=$(addsuffix .o,$(addprefix $(OBJECTS_PATH)/,$(SOURCES)))
 
+# Each test has its own main(), it's linked against all other objects.
+TESTS:=$(TEST_SOURCES_FULL:$(SOURCES_PATH)/%.cc=%)
+TEST_PATH:=$(BUILD_PATH)/test
+TEST_DEPEND_FULL:=$(addsuffix .d,$(addprefix $(DEPEND_PATH)/,$(TESTS)))
+TEST_OBJECTS_FULL:=$(addsuffix .o,$(addprefix $(OBJECTS_PATH)/,$(TESTS)))
+TEST_BINARIES_FULL:=$(addsuffix $(EXEEXT),$(addprefix $(TEST_PATH)/,$(TESTS)))
+TEST_LIBRARY:=$(TEST_PATH)/libopenmsx.a
+
 ifneq ($(filter mingw%,$(OPENMSX_TARGET_OS)),)
 RESOURCE_SRC:=src/resource/openmsx.rc
 RESOURCE_OBJ:=$(OBJECTS_PATH)/resources.o
@@ -490,6 +499,9 @@ endif
 ifneq ($(filter $(DEPEND_TARGETS),$(MAKECMDGOALS)),)
   -include $(DEPEND_FULL)
 endif
+ifeq ($(MAKECMDGOALS),test)
+  -include $(TEST_DEPEND_FULL)
+endif
 
 # Clean up build tree of current flavour.
 clean:
@@ -517,8 +529,8 @@ endif
 
 # Compile and generate dependency files in one go.
 DEPEND_SUBST=$(patsubst $(SOURCES_PATH)/%.cc,$(DEPEND_PATH)/%.d,$<)
-$(OBJECTS_FULL): $(INIT_DUMMY_FILE)
-$(OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
+$(OBJECTS_FULL) $(TEST_OBJECTS_FULL): $(INIT_DUMMY_FILE)
+$(OBJECTS_FULL) $(TEST_OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
 	$(SUM) "Compiling $(patsubst $(SOURCES_PATH)/%,%,$<)..."
 	$(CMD)mkdir -p $(@D)
 	$(CMD)mkdir -p $(patsubst $(OBJECTS_PATH)%,$(DEPEND_PATH)%,$(@D))
@@ -529,7 +541,7 @@ $(OBJECTS_FULL): $(OBJECTS_PATH)/%.o: $(SOURCES_PATH)/%.cc $(DEPEND_PATH)/%.d
 # Generate dependencies that do not exist yet.
 # This is only in case some .d files have been deleted;
 # in normal operation this rule is never triggered.
-$(DEPEND_FULL):
+$(DEPEND_FULL) $(TEST_DEPEND_FULL):
 
 # Windows resources that are added to the executable.
 ifneq ($(filter mingw%,$(OPENMSX_TARGET_OS)),)
@@ -571,6 +583,42 @@ run: all
 	$(CMD)$(BINARY_FULL)
 
 
+# Tests
+# =====
+
+# The tests only pull the objects they need from this archive.
+$(TEST_LIBRARY): $(filter-out $(OBJECTS_PATH)/main.o,$(OBJECTS_FULL))
+	$(SUM) "Archiving $(notdir $@)..."
+	$(CMD)mkdir -p $(@D)
+	$(CMD)rm -f $@
+	$(CMD)$(AR) rcs $@ $^
+
+$(TEST_BINARIES_FULL): $(TEST_PATH)/%$(EXEEXT): $(OBJECTS_PATH)/%.o $(TEST_LIBRARY)
+	$(SUM) "Linking $(notdir $@)..."
+	$(CMD)mkdir -p $(@D)
+	$(CMD)+$(CXX) -o $@ $(CXXFLAGS) $^ $(LINK_FLAGS)
+
+# Arguments that keep the speed measurements short. YM2413Test compares
+# against recorded .wav files that are not part of the source tree, so it is
+# only built, not run.
+TEST_ARGS_BlipDeltasTest:=1
+TEST_ARGS_SoundSpeedTest:=1
+TEST_ARGS_ScalerSpeedTest:=2 0.1
+TEST_ARGS_ZMBVSpeedTest:=2 10
+TESTS_RUN:=$(filter-out sound/YM2413Test,$(TESTS))
+
+# Usage: $(call RUN_TEST,TEST)
+define RUN_TEST
+	$(SUM) "Running $(notdir $(1))..."
+	$(CMD)$(TEST_PATH)/$(1)$(EXEEXT) $(TEST_ARGS_$(notdir $(1)))
+
+endef
+
+# Build all tests and run them, stops at the first one that fails.
+test: $(TEST_BINARIES_FULL)
+	$(foreach test,$(TESTS_RUN),$(call RUN_TEST,$(test)))
+
+
 # Installation and Binary Packaging
 # =================================
 
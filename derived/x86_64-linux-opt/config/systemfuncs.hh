@@ -0,0 +1,5 @@
+// Automatically generated by build system.
+#define HAVE_FTRUNCATE 1
+#define HAVE_MMAP 1
+#define HAVE_NFTW 1
+#define HAVE_POSIX_MEMALIGN 1
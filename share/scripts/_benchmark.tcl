@@ -0,0 +1,155 @@
+namespace eval benchmark {
+
+# Helpers to measure the emulation speed (with throttle off) under different
+# circumstances. Each benchmark runs a series of measurements of a few
+# seconds (realtime) each, and prints the results when done.
+
+variable running false
+variable steps [list]
+variable results [list]
+variable old_throttle
+variable start_emutime
+variable start_realtime
+variable cleanup_cmd ""
+
+proc run_steps {steps_ duration} {
+	variable running
+	variable steps
+	variable results
+	variable old_throttle
+	if {$running} {
+		error "A benchmark is already running."
+	}
+	set running true
+	set steps $steps_
+	set results [list]
+	set old_throttle $::throttle
+	set ::throttle off
+	next_step $duration
+}
+
+proc next_step {duration} {
+	variable steps
+	variable start_emutime
+	variable start_realtime
+	variable cleanup_cmd
+	if {[llength $steps] == 0} {
+		finish
+		return
+	}
+	lassign [lindex $steps 0] name setup_cmd cleanup_cmd
+	eval $setup_cmd
+	set start_emutime  [machine_info time]
+	set start_realtime [openmsx_info realtime]
+	after realtime $duration [namespace code [list end_step $name $duration]]
+}
+
+proc end_step {name duration} {
+	variable steps
+	variable results
+	variable start_emutime
+	variable start_realtime
+	variable cleanup_cmd
+	set emu  [expr {[machine_info time]     - $start_emutime}]
+	set real [expr {[openmsx_info realtime] - $start_realtime}]
+	eval $cleanup_cmd
+	set speed [expr {$emu / $real}]
+	lappend results [format "%-40s %8.2fx realtime  %8.2f MHz Z80" \
+		$name $speed [expr {$speed * 3.579545}]]
+	set steps [lrange $steps 1 end]
+	next_step $duration
+}
+
+proc finish {} {
+	variable running
+	variable results
+	variable old_throttle
+	set ::throttle $old_throttle
+	set running false
+	foreach line $results {
+		puts $line
+	}
+}
+
+# benchmark_conditions
+
+set_help_text benchmark_conditions \
+{Measure the emulation speed (throttle off) with 0, 1 and 10 debug conditions
+active. The conditions are measured both in a form that can be evaluated
+natively (without the Tcl interpreter) and in a form that must go through
+Tcl (because it uses a variable). The conditions never trigger.
+
+Usage:
+  benchmark_conditions [<seconds-per-measurement>]
+}
+
+variable never 0x10000
+
+proc add_conditions {n condition} {
+	variable ids [list]
+	for {set i 0} {$i < $n} {incr i} {
+		lappend ids [debug set_condition $condition]
+	}
+}
+
+proc remove_conditions {} {
+	variable ids
+	foreach id $ids {
+		debug remove_condition $id
+	}
+}
+
+proc benchmark_conditions {{duration 3}} {
+	set native {[peek16 0xFFFE] == 0x1234 && [reg PC] == 0x0000}
+	set tcl    {[reg PC] == $::benchmark::never}
+	set steps [list [list "no conditions" "" ""]]
+	foreach n {1 10} {
+		lappend steps [list "$n native condition(s)" \
+			[namespace code [list add_conditions $n $native]] \
+			[namespace code remove_conditions]]
+		lappend steps [list "$n Tcl condition(s)" \
+			[namespace code [list add_conditions $n $tcl]] \
+			[namespace code remove_conditions]]
+	}
+	run_steps $steps $duration
+	return "Benchmark started, results will be printed in about [expr {5 * $duration}] seconds."
+}
+
+# benchmark_block_cache
+
+set_help_text benchmark_block_cache \
+{Measure the emulation speed (throttle off) of the CPU interpreter with and
+without the basic block cache (see the z80_block_cache and r800_block_cache
+settings). Because the same code is executed in both measurements, the ratio
+between the two speeds is also the ratio between the number of emulated
+instructions per second.
+
+Usage:
+  benchmark_block_cache [<seconds-per-measurement>]
+}
+
+proc set_block_cache {value} {
+	foreach setting {::z80_block_cache ::r800_block_cache} {
+		if {[info exists $setting]} {
+			set $setting $value
+		}
+	}
+}
+
+proc benchmark_block_cache {{duration 3}} {
+	set steps [list \
+		[list "interpreter" \
+			[namespace code [list set_block_cache false]] ""] \
+		[list "block cache" \
+			[namespace code [list set_block_cache true]] \
+			[namespace code [list set_block_cache $::z80_block_cache]]]]
+	run_steps $steps $duration
+	return "Benchmark started, results will be printed in about [expr {2 * $duration}] seconds."
+}
+
+namespace export benchmark_conditions
+namespace export benchmark_block_cache
+
+} ;# namespace benchmark
+
+namespace import benchmark::*
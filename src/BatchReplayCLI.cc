@@ -0,0 +1,198 @@
+#include "BatchReplayCLI.hh"
+#include "CommandLineParser.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "ReverseManager.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "Mixer.hh"
+#include "MSXMixer.hh"
+#include "ThreadPool.hh"
+#include "Thread.hh"
+#include "TclObject.hh"
+#include "MSXException.hh"
+#include "StringOp.hh"
+#include "outer.hh"
+#include "sha1.hh"
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <memory>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+struct BatchReplayCLI::Job
+{
+	explicit Job(const string& filename_)
+		: filename(filename_), endTime(EmuTime::zero)
+		, hasCommands(false) {}
+
+	string filename;
+	std::unique_ptr<MSXMotherBoard> board;
+	EmuTime endTime;
+	bool hasCommands;
+	vector<string> output;
+	string error;
+};
+
+BatchReplayCLI::BatchReplayCLI(CommandLineParser& parser_)
+	: parser(parser_)
+{
+	parser.registerOption("-batchreplay", *this);
+	parser.registerOption("-batchtime", timeOption);
+}
+
+void BatchReplayCLI::parseOption(const string& option, array_ref<string>& cmdLine)
+{
+	filenames.push_back(getArgument(option, cmdLine));
+}
+
+string_ref BatchReplayCLI::optionHelp() const
+{
+	return "Run replay without video and sound output as fast as possible, "
+	       "print hashes of the machine state and exit";
+}
+
+void BatchReplayCLI::TimeOption::parseOption(
+	const string& option, array_ref<string>& cmdLine)
+{
+	auto& cli = OUTER(BatchReplayCLI, timeOption);
+	for (auto& t : StringOp::split(getArgument(option, cmdLine), ',')) {
+		double seconds;
+		if (!StringOp::stringToDouble(t.str(), seconds) || (seconds < 0.0)) {
+			throw MSXException("Invalid time for -batchtime: " + t);
+		}
+		cli.times.push_back(EmuTime::zero + EmuDuration(seconds));
+	}
+	sort(begin(cli.times), end(cli.times));
+}
+
+string_ref BatchReplayCLI::TimeOption::optionHelp() const
+{
+	return "Comma separated list of times (in seconds) at which "
+	       "-batchreplay prints hashes";
+}
+
+// Hash the content of all debuggables with one of the given descriptions.
+static string hashDebuggables(Debugger& debugger,
+                              std::initializer_list<string_ref> descriptions)
+{
+	SHA1 sha1;
+	vector<uint8_t> buf;
+	for (auto& name : debugger.getDebuggableNames()) {
+		auto& debuggable = *debugger.findDebuggable(name);
+		if (std::find(begin(descriptions), end(descriptions),
+		              string_ref(debuggable.getDescription())) ==
+		    end(descriptions)) {
+			continue;
+		}
+		buf.resize(debuggable.getSize());
+		for (unsigned i = 0; i < buf.size(); ++i) {
+			buf[i] = debuggable.read(i);
+		}
+		sha1.update(buf.data(), buf.size());
+	}
+	return sha1.digest().toString();
+}
+
+static string getHashes(MSXMotherBoard& board)
+{
+	// Without a renderer there's no frame to hash, instead hash everything
+	// the frame is generated from (VRAM, VDP registers and palette).
+	auto& debugger = board.getDebugger();
+	StringOp::Builder result;
+	result << "ram=" << hashDebuggables(debugger, {"ram", "memory mapper"})
+	       << " vram=" << hashDebuggables(debugger,
+	                  {"VDP-screen-mode-independent view on the video RAM."})
+	       << " vdp=" << hashDebuggables(debugger,
+	                  {"VDP registers.", "V99x8 palette (RBG format)"});
+	return result;
+}
+
+void BatchReplayCLI::runJob(Job& job) const
+{
+	auto& board = *job.board;
+	try {
+		for (auto& t : times) {
+			string timeStr = StringOp::Builder() << (t - EmuTime::zero).toDouble();
+			if (t > job.endTime) {
+				throw MSXException("Replay ends before " + timeStr + 's');
+			}
+			board.fastForward(t, true);
+			job.output.push_back(
+				job.filename + ' ' + timeStr + ' ' + getHashes(board));
+		}
+		board.fastForward(job.endTime, true);
+		job.output.push_back(
+			job.filename + " end " + getHashes(board));
+	} catch (MSXException& e) {
+		job.error = e.getMessage();
+	}
+}
+
+int BatchReplayCLI::run()
+{
+	auto& reactor = parser.getReactor();
+
+	// No sound output, but don't save this in settings.xml.
+	auto& soundDriver = reactor.getMixer().getSoundDriverSetting();
+	soundDriver.setRestoreValue(soundDriver.getValue());
+	soundDriver.setDontSaveValue(TclObject("null"));
+	soundDriver.setEnum(Mixer::SND_NULL);
+
+	// Loading a replay creates new machines, that's only possible in the
+	// main thread.
+	vector<Job> jobs;
+	jobs.reserve(filenames.size()); // the tasks below hold references
+	for (auto& filename : filenames) {
+		jobs.emplace_back(filename);
+		auto& job = jobs.back();
+		try {
+			job.board = ReverseManager::loadBatchReplay(
+				reactor, filename, job.endTime, job.hasCommands);
+			job.board->getMSXMixer().mute();
+		} catch (MSXException& e) {
+			job.error = e.getMessage();
+		}
+	}
+
+	// Each replay runs on its own machine. Replaying commands executes Tcl
+	// code, those replays run in the main thread. Tcl code can access any
+	// machine, so they run before all others are started in parallel on
+	// the worker threads.
+	for (auto& job : jobs) {
+		if (job.board && job.hasCommands) runJob(job);
+	}
+	vector<std::shared_future<void>> futures;
+	for (auto& job : jobs) {
+		if (!job.board || job.hasCommands) continue;
+		futures.push_back(reactor.getThreadPool().enqueue([this, &job]() {
+			Thread::BackgroundEmulation backgroundEmulation;
+			runJob(job);
+		}));
+	}
+	for (auto& f : futures) {
+		f.wait(); // all tasks must be done before 'jobs' is destroyed
+	}
+	for (auto& f : futures) {
+		f.get(); // rethrows unexpected exceptions
+	}
+
+	int result = 0;
+	for (auto& job : jobs) {
+		for (auto& line : job.output) {
+			std::cout << line << '\n';
+		}
+		if (!job.error.empty()) {
+			std::cout << job.filename << " FAILED: " << job.error << '\n';
+			result = 1;
+		}
+	}
+	std::cout << std::flush;
+	return result;
+}
+
+} // namespace openmsx
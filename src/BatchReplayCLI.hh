@@ -0,0 +1,50 @@
+#ifndef BATCHREPLAYCLI_HH
+#define BATCHREPLAYCLI_HH
+
+#include "CLIOption.hh"
+#include "EmuTime.hh"
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class CommandLineParser;
+
+/** Headless batch mode to validate replays: each replay given with
+  * '-batchreplay' is emulated as fast as possible, without video or sound
+  * output, on its own machine (several replays run in parallel). At the
+  * times given with '-batchtime' and at the end of the replay a hash of the
+  * RAM, the VRAM and the VDP registers is printed.
+  */
+class BatchReplayCLI final : public CLIOption
+{
+public:
+	explicit BatchReplayCLI(CommandLineParser& commandLineParser);
+	void parseOption(const std::string& option,
+	                 array_ref<std::string>& cmdLine) override;
+	string_ref optionHelp() const override;
+
+	bool hasReplays() const { return !filenames.empty(); }
+
+	/** Run all replays, returns the exit code for the process: zero when
+	  * all replays could be run till the end. */
+	int run();
+
+private:
+	struct Job;
+	void runJob(Job& job) const;
+
+	struct TimeOption final : CLIOption {
+		void parseOption(const std::string& option,
+		                 array_ref<std::string>& cmdLine) override;
+		string_ref optionHelp() const override;
+	} timeOption;
+
+	CommandLineParser& parser;
+	std::vector<std::string> filenames;
+	std::vector<EmuTime> times; // sorted
+};
+
+} // namespace openmsx
+
+#endif
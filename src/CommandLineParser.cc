@@ -44,6 +44,7 @@ CommandLineParser::CommandLineParser(Reactor& reactor_)
 	, msxRomCLI(*this)
 	, cliExtension(*this)
 	, replayCLI(*this)
+	, batchReplayCLI(*this)
 	, saveStateCLI(*this)
 	, cassettePlayerCLI(*this)
 #if COMPONENT_LASERDISC
@@ -267,6 +268,9 @@ void CommandLineParser::parse(int argc, char** argv)
 	for (auto& p : options) {
 		p.second.option->parseDone();
 	}
+	if ((parseStatus != EXIT) && batchReplayCLI.hasReplays()) {
+		parseStatus = BATCH;
+	}
 	if (!cmdLine.empty() && (parseStatus != EXIT)) {
 		throw FatalError(
 			"Error parsing command line: " + cmdLine.front() + "\n" +
@@ -276,7 +280,8 @@ void CommandLineParser::parse(int argc, char** argv)
 
 bool CommandLineParser::isHiddenStartup() const
 {
-	return (parseStatus == CONTROL) || (parseStatus == TEST);
+	return (parseStatus == CONTROL) || (parseStatus == TEST) ||
+	       (parseStatus == BATCH);
 }
 
 CommandLineParser::ParseStatus CommandLineParser::getParseStatus() const
@@ -290,6 +295,12 @@ const CommandLineParser::Scripts& CommandLineParser::getStartupScripts() const
 	return scriptOption.scripts;
 }
 
+int CommandLineParser::runBatchReplays()
+{
+	assert(parseStatus == BATCH);
+	return batchReplayCLI.run();
+}
+
 MSXMotherBoard* CommandLineParser::getMotherBoard() const
 {
 	return reactor.getMotherBoard();
@@ -5,6 +5,7 @@
 #include "MSXRomCLI.hh"
 #include "CliExtension.hh"
 #include "ReplayCLI.hh"
+#include "BatchReplayCLI.hh"
 #include "SaveStateCLI.hh"
 #include "CassettePlayerCLI.hh"
 #include "DiskImageCLI.hh"
@@ -31,7 +32,7 @@ class Interpreter;
 class CommandLineParser
 {
 public:
-	enum ParseStatus { UNPARSED, RUN, CONTROL, TEST, EXIT };
+	enum ParseStatus { UNPARSED, RUN, CONTROL, TEST, BATCH, EXIT };
 	enum ParsePhase {
 		PHASE_BEFORE_INIT,       // --help, --version, -bash
 		PHASE_INIT,              // calls Reactor::init()
@@ -53,6 +54,12 @@ public:
 	using Scripts = std::vector<std::string>;
 	const Scripts& getStartupScripts() const;
 
+	/** Run the replays given with '-batchreplay' (only when the parse
+	  * status is BATCH). Returns the exit code for the process.
+	  */
+	int runBatchReplays();
+
+	Reactor& getReactor() const { return reactor; }
 	MSXMotherBoard* getMotherBoard() const;
 	GlobalCommandController& getGlobalCommandController() const;
 	Interpreter& getInterpreter() const;
@@ -134,6 +141,7 @@ private:
 	MSXRomCLI msxRomCLI;
 	CliExtension cliExtension;
 	ReplayCLI replayCLI;
+	BatchReplayCLI batchReplayCLI;
 	SaveStateCLI saveStateCLI;
 	CassettePlayerCLI cassettePlayerCLI;
 #if COMPONENT_LASERDISC
@@ -0,0 +1,121 @@
+#include "EmulationThread.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXMixer.hh"
+#include "ReverseManager.hh"
+#include "MSXException.hh"
+#include "Thread.hh"
+#include <algorithm>
+#include <chrono>
+
+namespace openmsx {
+
+// Amount of emulated time between two checks for a stop request or a lock
+// request from the main thread. Because the machine runs in fast-forward
+// mode this only takes a fraction of this time in real time.
+static const EmuDuration SLICE = EmuDuration::msec(5);
+
+// Fast-forward can run slightly past the requested time, so stop a bit
+// earlier in front of a replayed command.
+static const EmuDuration COMMAND_MARGIN = EmuDuration::msec(1);
+
+
+// class EmulationThread::Lock
+
+EmulationThread::Lock::Lock(std::shared_ptr<Shared> shared_)
+	: shared(std::move(shared_))
+{
+	++shared->waiting;
+	shared->mutex.lock();
+	--shared->waiting;
+}
+
+EmulationThread::Lock::Lock(Lock&& other) noexcept
+	: shared(std::move(other.shared))
+{
+}
+
+EmulationThread::Lock& EmulationThread::Lock::operator=(Lock&& other) noexcept
+{
+	unlock();
+	shared = std::move(other.shared);
+	return *this;
+}
+
+EmulationThread::Lock::~Lock()
+{
+	unlock();
+}
+
+void EmulationThread::Lock::unlock()
+{
+	if (shared) {
+		shared->mutex.unlock();
+		shared.reset();
+	}
+}
+
+
+// class EmulationThread
+
+EmulationThread::EmulationThread(MSXMotherBoard& motherBoard_)
+	: motherBoard(motherBoard_)
+	, shared(std::make_shared<Shared>())
+	, failed(false)
+	, stopRequested(false)
+{
+	// Sound of a machine in the background is not audible.
+	motherBoard.getMSXMixer().mute();
+	thread = std::thread([this]() { run(); });
+}
+
+EmulationThread::~EmulationThread()
+{
+	// The thread never blocks on the lock, so this works even if the
+	// current thread holds a lock.
+	stopRequested = true;
+	thread.join();
+	motherBoard.getMSXMixer().unmute();
+}
+
+void EmulationThread::run()
+{
+	Thread::BackgroundEmulation backgroundEmulation;
+	while (!stopRequested) {
+		if (!runSlice()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	}
+}
+
+bool EmulationThread::runSlice()
+{
+	// Give priority to the main thread: don't start a new slice when it
+	// is waiting for the lock.
+	if (shared->waiting || !shared->mutex.try_lock()) return false;
+	std::lock_guard<std::recursive_mutex> guard(shared->mutex, std::adopt_lock);
+
+	if (!motherBoard.isPowered()) return false;
+
+	EmuTime now = motherBoard.getCurrentTime();
+	EmuTime target = now + SLICE;
+	// Replaying a command executes Tcl code, that's only possible in the
+	// main thread. So the machine stalls until it's activated again.
+	EmuTime command = motherBoard.getReverseManager().getNextReplayedCommandTime();
+	if (command != EmuTime::infinity) {
+		if (command <= now + COMMAND_MARGIN) return false;
+		target = std::min(target, command - COMMAND_MARGIN);
+	}
+
+	try {
+		motherBoard.fastForward(target, true);
+	} catch (MSXException& e) {
+		// CliComm can only be used from the main thread, see
+		// MSXMotherBoard::startBackgroundEmulation().
+		error = e.getMessage();
+		failed = true;
+		stopRequested = true;
+	}
+	return true;
+}
+
+} // namespace openmsx
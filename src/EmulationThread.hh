@@ -0,0 +1,81 @@
+#ifndef EMULATIONTHREAD_HH
+#define EMULATIONTHREAD_HH
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+
+/** Emulates a (not active) MSX machine on its own thread, see
+  * MSXMotherBoard::setRunInBackground().
+  *
+  * The machine runs in fast-forward mode: as fast as possible, without sound
+  * and ignoring breakpoints, watchpoints and debug conditions. It doesn't
+  * interact with the rest of the application, see
+  * Thread::BackgroundEmulation.
+  *
+  * The main thread may only access the machine while it holds a Lock.
+  */
+class EmulationThread
+{
+	struct Shared {
+		Shared() : waiting(0) {}
+		std::recursive_mutex mutex;
+		std::atomic<unsigned> waiting;
+	};
+
+public:
+	/** As long as this object exists, the machine is not emulated. Locks
+	  * can be nested. A Lock can outlive the EmulationThread (and even
+	  * the MSXMotherBoard) that created it.
+	  */
+	class Lock
+	{
+	public:
+		Lock() = default;
+		explicit Lock(std::shared_ptr<Shared> shared);
+		Lock(Lock&& other) noexcept;
+		Lock& operator=(Lock&& other) noexcept;
+		~Lock();
+
+	private:
+		void unlock();
+
+		std::shared_ptr<Shared> shared;
+	};
+
+	explicit EmulationThread(MSXMotherBoard& motherBoard);
+	/** Stops emulation and waits for the thread to finish. Also works
+	  * when the current thread holds a Lock. */
+	~EmulationThread();
+
+	EmulationThread(const EmulationThread&) = delete;
+	EmulationThread& operator=(const EmulationThread&) = delete;
+
+	Lock lock() { return Lock(shared); }
+
+	/** Emulation stops when the machine throws an exception. The main
+	  * thread should then report getError() and delete this object. */
+	bool hasFailed() const { return failed; }
+	const std::string& getError() const { return error; }
+
+private:
+	void run();
+	bool runSlice();
+
+	MSXMotherBoard& motherBoard;
+	std::shared_ptr<Shared> shared;
+	std::string error; // only valid when 'failed' is set
+	std::atomic<bool> failed;
+	std::atomic<bool> stopRequested;
+	std::thread thread;
+};
+
+} // namespace openmsx
+
+#endif
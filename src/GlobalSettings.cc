@@ -43,6 +43,13 @@ GlobalSettings::GlobalSettings(GlobalCommandController& commandController_)
 			{"hq",   ResampledSoundDevice::RESAMPLE_HQ},
 			{"fast", ResampledSoundDevice::RESAMPLE_LQ},
 			{"blip", ResampledSoundDevice::RESAMPLE_BLIP}})
+	, reverseMemoryBudgetSetting(commandController, "reverse_memory_budget",
+		"maximum amount of memory (in MB) used for the reverse history, "
+		"0 means unlimited", 0, 0, 1024 * 1024)
+	, reverseSpillSetting(commandController, "reverse_spill_to_disk",
+		"when the reverse memory budget is reached, move the oldest "
+		"snapshots to a temporary file instead of dropping snapshots",
+		false)
 	, throttleManager(commandController)
 {
 	for (auto i : xrange(SDL_NumJoysticks())) {
@@ -50,6 +50,12 @@ public:
 	EnumSetting<ResampledSoundDevice::ResampleType>& getResampleSetting() {
 		return resampleSetting;
 	}
+	IntegerSetting& getReverseMemoryBudgetSetting() {
+		return reverseMemoryBudgetSetting;
+	}
+	BooleanSetting& getReverseSpillSetting() {
+		return reverseSpillSetting;
+	}
 	IntegerSetting& getJoyDeadzoneSetting(int i) {
 		return *deadzoneSettings[i];
 	}
@@ -71,6 +77,8 @@ private:
 	StringSetting  umrCallBackSetting;
 	StringSetting  invalidPsgDirectionsSetting;
 	EnumSetting<ResampledSoundDevice::ResampleType> resampleSetting;
+	IntegerSetting reverseMemoryBudgetSetting;
+	BooleanSetting reverseSpillSetting;
 	std::vector<std::unique_ptr<IntegerSetting>> deadzoneSettings;
 	ThrottleManager throttleManager;
 };
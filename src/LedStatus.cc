@@ -3,6 +3,7 @@
 #include "ReadOnlySetting.hh"
 #include "CommandController.hh"
 #include "Timer.hh"
+#include "Thread.hh"
 #include "memory.hh"
 
 namespace openmsx {
@@ -40,6 +41,7 @@ void LedStatus::setLed(Led led, bool status)
 {
 	if (ledValue[led] == status) return;
 	ledValue[led] = status;
+	if (!Thread::isMainThread()) return; // background emulation
 
 	// Some MSX programs generate tons of LED events (e.g. New Era uses
 	// the LEDs as a VU meter while playing samples). Without throttling
@@ -42,6 +42,7 @@
 #include "serialize.hh"
 #include "serialize_stl.hh"
 #include "ScopedAssign.hh"
+#include "Thread.hh"
 #include "memory.hh"
 #include "stl.hh"
 #include "unreachable.hh"
@@ -194,6 +195,7 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 	, powered(false)
 	, active(false)
 	, fastForwarding(false)
+	, runInBackground(false)
 {
 	slotManager = make_unique<CartridgeSlotManager>(*this);
 	reverseManager = make_unique<ReverseManager>(*this);
@@ -229,6 +231,7 @@ MSXMotherBoard::MSXMotherBoard(Reactor& reactor_)
 
 MSXMotherBoard::~MSXMotherBoard()
 {
+	emulationThread.reset();
 	powerSetting.detach(*settingObserver);
 	deleteMachine();
 
@@ -612,6 +615,10 @@ void MSXMotherBoard::powerDown()
 
 void MSXMotherBoard::activate(bool active_)
 {
+	if (active_) {
+		// the active machine is emulated by the main thread
+		emulationThread.reset();
+	}
 	active = active_;
 	auto event = std::make_shared<SimpleEvent>(
 		active ? OPENMSX_MACHINE_ACTIVATED : OPENMSX_MACHINE_DEACTIVATED);
@@ -621,6 +628,34 @@ void MSXMotherBoard::activate(bool active_)
 	}
 }
 
+void MSXMotherBoard::setRunInBackground(bool enabled)
+{
+	runInBackground = enabled;
+	if (!enabled) emulationThread.reset();
+}
+
+void MSXMotherBoard::startBackgroundEmulation()
+{
+	assert(Thread::isMainThread());
+	if (emulationThread && emulationThread->hasFailed()) {
+		auto error = emulationThread->getError();
+		emulationThread.reset();
+		runInBackground = false;
+		getMSXCliComm().printWarning(
+			"Stopped background emulation of machine " +
+			getMachineID() + ": " + error);
+	}
+	if (runInBackground && !active && powered && !emulationThread) {
+		emulationThread = make_unique<EmulationThread>(*this);
+	}
+}
+
+EmulationThread::Lock MSXMotherBoard::lockEmulation()
+{
+	return emulationThread ? emulationThread->lock()
+	                       : EmulationThread::Lock();
+}
+
 void MSXMotherBoard::exitCPULoopAsync()
 {
 	if (getMachineConfig()) {
@@ -2,6 +2,7 @@
 #define MSXMOTHERBOARD_HH
 
 #include "EmuTime.hh"
+#include "EmulationThread.hh"
 #include "VideoSourceSetting.hh"
 #include "hash_map.hh"
 #include "serialize_meta.hh"
@@ -94,6 +95,26 @@ public:
 	void activate(bool active);
 	bool isActive() const { return active; }
 	bool isFastForwarding() const { return fastForwarding; }
+	bool isPowered() const { return powered; }
+
+	/** Keep emulating this machine (on its own thread) while it's not the
+	  * active machine, see EmulationThread. The thread is (re)started by
+	  * startBackgroundEmulation() and stopped when the machine becomes
+	  * the active machine.
+	  */
+	void setRunInBackground(bool enabled);
+	bool getRunInBackground() const { return runInBackground; }
+	bool isRunningInBackground() const { return bool(emulationThread); }
+	/** Start the emulation thread if this machine should run in the
+	  * background. Should only be called from the main thread at a moment
+	  * it doesn't access this machine (and doesn't hold a lock for it).
+	  * When emulation in the background failed, this reports the error
+	  * and keeps the machine stopped. */
+	void startBackgroundEmulation();
+	/** Other threads may only access a machine that runs in the
+	  * background while they hold this lock. For other machines this
+	  * returns an empty lock. */
+	EmulationThread::Lock lockEmulation();
 
 	byte readIRQVector();
 
@@ -264,6 +285,10 @@ private:
 	bool powered;
 	bool active;
 	bool fastForwarding;
+	bool runInBackground;
+
+	// must be destroyed first, it still accesses the other members
+	std::unique_ptr<EmulationThread> emulationThread;
 };
 SERIALIZE_CLASS_VERSION(MSXMotherBoard, 4);
 
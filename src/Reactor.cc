@@ -35,6 +35,7 @@
 #include "FileOperations.hh"
 #include "ReadDir.hh"
 #include "Thread.hh"
+#include "ThreadPool.hh"
 #include "Timer.hh"
 #include "serialize.hh"
 #include "openmsx.hh"
@@ -126,6 +127,17 @@ private:
 	Reactor& reactor;
 };
 
+class BackgroundMachineCommand final : public Command
+{
+public:
+	BackgroundMachineCommand(CommandController& commandController, Reactor& reactor);
+	void execute(array_ref<TclObject> tokens, TclObject& result) override;
+	string help(const vector<string>& tokens) const override;
+	void tabCompletion(vector<string>& tokens) const override;
+private:
+	Reactor& reactor;
+};
+
 class StoreMachineCommand final : public Command
 {
 public:
@@ -186,6 +198,7 @@ Reactor::Reactor()
 
 void Reactor::init()
 {
+	threadPool = make_unique<ThreadPool>();
 	rtScheduler = make_unique<RTScheduler>();
 	eventDistributor = make_unique<EventDistributor>(*this);
 	globalCliComm = make_unique<GlobalCliComm>();
@@ -226,6 +239,8 @@ void Reactor::init()
 		*globalCommandController, *this);
 	activateMachineCommand = make_unique<ActivateMachineCommand>(
 		*globalCommandController, *this);
+	backgroundMachineCommand = make_unique<BackgroundMachineCommand>(
+		*globalCommandController, *this);
 	storeMachineCommand = make_unique<StoreMachineCommand>(
 		*globalCommandController, *this);
 	restoreMachineCommand = make_unique<RestoreMachineCommand>(
@@ -376,6 +391,7 @@ void Reactor::replaceBoard(MSXMotherBoard& oldBoard_, Board newBoard_)
 	if (it->get() == activeBoard) {
 		switchBoard(newBoard);
 	}
+	newBoard->setRunInBackground(oldBoard_.getRunInBackground());
 
 	// Remove (=delete) the old board.
 	// Note that we don't use the 'garbageBoards' mechanism as used in
@@ -457,6 +473,7 @@ void Reactor::deleteBoard(MSXMotherBoard* board)
 		// delete active board -> there is no active board anymore
 		switchBoard(nullptr);
 	}
+	board->setRunInBackground(false);
 	auto it = rfind_if_unguarded(boards,
 		[&](Boards::value_type& b) { return b.get() == board; });
 	auto board_ = move(*it);
@@ -470,6 +487,17 @@ void Reactor::deleteBoard(MSXMotherBoard* board)
 		make_shared<SimpleEvent>(OPENMSX_DELETE_BOARDS));
 }
 
+void Reactor::lockBackgroundMachines()
+{
+	assert(Thread::isMainThread());
+	if (!backgroundLocks.empty()) return; // already locked
+	for (auto& b : boards) {
+		if (b->isRunningInBackground()) {
+			backgroundLocks.push_back(b->lockEmulation());
+		}
+	}
+}
+
 void Reactor::enterMainLoop()
 {
 	// Note: this method can get called from different threads
@@ -528,6 +556,12 @@ void Reactor::run(CommandLineParser& parser)
 	while (running) {
 		eventDistributor->deliverEvents();
 		assert(garbageBoards.empty());
+		// Only here the main thread doesn't access other machines, so
+		// it's safe to resume or (re)start emulation threads.
+		backgroundLocks.clear();
+		for (auto& b : boards) {
+			b->startBackgroundEmulation();
+		}
 		bool blocked = (blockedCounter > 0) || !activeBoard;
 		if (!blocked) blocked = !activeBoard->execute();
 		if (blocked) {
@@ -858,6 +892,50 @@ void ActivateMachineCommand::tabCompletion(vector<string>& tokens) const
 }
 
 
+// class BackgroundMachineCommand
+
+BackgroundMachineCommand::BackgroundMachineCommand(
+	CommandController& commandController_, Reactor& reactor_)
+	: Command(commandController_, "background_machine")
+	, reactor(reactor_)
+{
+}
+
+void BackgroundMachineCommand::execute(array_ref<TclObject> tokens,
+                                       TclObject& result)
+{
+	switch (tokens.size()) {
+	case 2:
+		break;
+	case 3: {
+		auto& board = reactor.getMachine(tokens[1].getString());
+		board.setRunInBackground(tokens[2].getBoolean(getInterpreter()));
+		break;
+	}
+	default:
+		throw SyntaxError();
+	}
+	auto& board = reactor.getMachine(tokens[1].getString());
+	result.setBoolean(board.getRunInBackground());
+}
+
+string BackgroundMachineCommand::help(const vector<string>& /*tokens*/) const
+{
+	return "background_machine <machineID> [<bool>]\n"
+	       "Query or change whether the given machine keeps running "
+	       "while it's not the active machine. Such a machine runs on "
+	       "its own thread, as fast as possible, without sound and "
+	       "without breakpoints, watchpoints or debug conditions.";
+}
+
+void BackgroundMachineCommand::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		completeString(tokens, reactor.getMachineIDs());
+	}
+}
+
+
 // class StoreMachineCommand
 
 StoreMachineCommand::StoreMachineCommand(
@@ -3,6 +3,7 @@
 
 #include "Observer.hh"
 #include "EventListener.hh"
+#include "EmulationThread.hh"
 #include "string_ref.hh"
 #include "openmsx.hh"
 #include <string>
@@ -43,18 +44,24 @@ class CreateMachineCommand;
 class DeleteMachineCommand;
 class ListMachinesCommand;
 class ActivateMachineCommand;
+class BackgroundMachineCommand;
 class StoreMachineCommand;
 class RestoreMachineCommand;
 class AviRecorder;
 class ConfigInfo;
 class RealTimeInfo;
+class ThreadPool;
 template <typename T> class EnumSetting;
 
 /**
  * Contains the main loop of openMSX.
  * openMSX is almost single threaded: the main thread does most of the work,
  * we create additional threads only if we need blocking calls for
- * communicating with peripherals.
+ * communicating with peripherals. (And there's a pool of worker threads that
+ * can be used to offload self-contained work, like compressing reverse
+ * snapshots, from the main thread. And machines that should keep running
+ * while they're not the active machine each get their own thread, see
+ * EmulationThread).
  * This class serializes all incoming requests so they can be handled by the
  * main thread.
  */
@@ -84,6 +91,7 @@ public:
 	EnumSetting<int>& getMachineSetting() { return *machineSetting; }
 	RomDatabase& getSoftwareDatabase() { return *softwareDatabase; }
 	FilePool& getFilePool() { return *filePool; }
+	ThreadPool& getThreadPool() { return *threadPool; }
 
 	void switchMachine(const std::string& machine);
 	MSXMotherBoard* getMotherBoard() const;
@@ -105,6 +113,12 @@ public:
 	Board createEmptyMotherBoard();
 	void replaceBoard(MSXMotherBoard& oldBoard, Board newBoard); // for reverse
 
+	/** Pause all machines that run in the background. Needed before the
+	  * main thread can access any other machine than the active machine
+	  * (e.g. before it executes Tcl code). They stay paused until the main
+	  * loop resumes them, so calling this again is cheap. */
+	void lockBackgroundMachines();
+
 private:
 	using Boards = std::vector<Board>;
 
@@ -126,6 +140,9 @@ private:
 	std::mutex mbMutex; // this should come first, because it's still used by
 	                    // the destructors of the unique_ptr below
 
+	// Outlives all boards, those may still have work queued on it.
+	std::unique_ptr<ThreadPool> threadPool;
+
 	// note: order of unique_ptr's is important
 	std::unique_ptr<RTScheduler> rtScheduler;
 	std::unique_ptr<EventDistributor> eventDistributor;
@@ -158,6 +175,7 @@ private:
 	std::unique_ptr<DeleteMachineCommand> deleteMachineCommand;
 	std::unique_ptr<ListMachinesCommand> listMachinesCommand;
 	std::unique_ptr<ActivateMachineCommand> activateMachineCommand;
+	std::unique_ptr<BackgroundMachineCommand> backgroundMachineCommand;
 	std::unique_ptr<StoreMachineCommand> storeMachineCommand;
 	std::unique_ptr<RestoreMachineCommand> restoreMachineCommand;
 	std::unique_ptr<AviRecorder> aviRecordCommand;
@@ -176,6 +194,8 @@ private:
 	Boards boards; // unordered
 	Boards garbageBoards;
 	MSXMotherBoard* activeBoard; // either nullptr or a board inside 'boards'
+	// see lockBackgroundMachines()
+	std::vector<EmulationThread::Lock> backgroundLocks;
 
 	int blockedCounter;
 	bool paused;
@@ -195,6 +215,7 @@ private:
 	friend class DeleteMachineCommand;
 	friend class ListMachinesCommand;
 	friend class ActivateMachineCommand;
+	friend class BackgroundMachineCommand;
 	friend class StoreMachineCommand;
 	friend class RestoreMachineCommand;
 };
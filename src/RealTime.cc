@@ -143,11 +143,20 @@ int RealTime::signalEvent(const std::shared_ptr<const Event>& event)
 
 void RealTime::update(const Setting& /*setting*/)
 {
-	resync();
+	updateActive();
 }
 
 void RealTime::update(const ThrottleManager& /*throttleManager*/)
 {
+	updateActive();
+}
+
+void RealTime::updateActive()
+{
+	// Only the active machine synchronizes with real time. Other machines
+	// can be emulated by another thread at this moment (see
+	// Thread::BackgroundEmulation), they resync when they're activated.
+	if (!motherBoard.isActive()) return;
 	resync();
 }
 
@@ -66,6 +66,7 @@ private:
 	void update(const Setting& setting) override;
 	// Observer<ThrottleManager>
 	void update(const ThrottleManager& throttleManager) override;
+	void updateActive();
 
 	void internalSync(EmuTime::param time, bool allowSleep);
 
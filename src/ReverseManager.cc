@@ -17,12 +17,25 @@
 #include "Display.hh"
 #include "Reactor.hh"
 #include "CommandException.hh"
+#include "GlobalSettings.hh"
+#include "RecordedCommand.hh"
+#include "ThreadPool.hh"
+#include "Thread.hh"
+#include "File.hh"
+#include "FileException.hh"
 #include "MemBuffer.hh"
 #include "StringOp.hh"
 #include "serialize.hh"
 #include "serialize_stl.hh"
+#include "snappy.hh"
+#include "memory.hh"
 #include "xrange.hh"
+#include <algorithm>
+#include <chrono>
 #include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <cassert>
 #include <cmath>
 
@@ -45,6 +58,14 @@ static const EmuDuration MIN_PARTITION_LENGTH = EmuDuration(60.0);
 // Max distance of one before last snapshot before the end time in replay file (in seconds)
 static const EmuDuration MAX_DIST_1_BEFORE_LAST_SNAPSHOT = EmuDuration(30.0);
 
+// Min length of the part of a 'reverse goto' that must be re-emulated, and
+// min length of other gaps in the history, before these other gaps are
+// re-emulated in the background (see class Regenerator).
+static const EmuDuration MIN_REGENERATE_GAP = EmuDuration(10.0);
+
+// Time between two snapshots taken in the background (in seconds)
+static const EmuDuration REGENERATE_PERIOD = EmuDuration(5.0);
+
 static const char* const REPLAY_DIR = "replays";
 
 // A replay is a struct that contains a vector of motherboards and an MSX event
@@ -99,12 +120,360 @@ struct Replay
 SERIALIZE_CLASS_VERSION(Replay, 4);
 
 
+// class SpillFile
+
+// Snapshots that don't fit in the memory budget can be moved to a temporary
+// file. Each spilled snapshot is stored as a full (snappy compressed) copy of
+// all its blocks, so it doesn't depend on other (possibly dropped) snapshots.
+// The file only grows, the space of dropped snapshots is not reused. It's
+// deleted together with the history.
+//
+// Collecting the blocks (this may have to wait for their deltas), compressing
+// and writing is done on the worker threads of the thread pool. Till then the
+// SpillEntry keeps the data of the snapshot in memory.
+class ReverseManager::SpillFile
+{
+public:
+	explicit SpillFile(ThreadPool& pool);
+	/** Waits till all snapshots are written. */
+	~SpillFile();
+
+	void store(ReverseChunk& chunk);
+	/** Waits when the snapshot isn't written yet. */
+	void load(const ReverseChunk& chunk, MemBuffer<uint8_t>& savestate,
+	          std::vector<shared_ptr<DeltaBlock>>& deltaBlocks);
+	size_t getSize() const;
+
+	/** Memory that will be freed once the snapshots that are being
+	  * written are done (an estimate). */
+	size_t getPendingMemory() const { return pendingMemory; }
+
+	/** Throws when writing a snapshot failed (since the previous call).
+	  * The data of that snapshot stays in memory. */
+	void checkErrors();
+
+private:
+	void write(SpillEntry& entry, size_t savestateSize);
+
+	ThreadPool& pool;
+	string filename;
+	File file;
+	mutable std::mutex mutex; // for 'file' and 'size'
+	size_t size;
+	std::atomic<size_t> pendingMemory;
+	vector<std::shared_future<void>> pending;
+};
+
+struct ReverseManager::SpillEntry
+{
+	SpillEntry() : offset(0), size(0) {}
+
+	// Location in the file, only valid when 'written' is ready (and
+	// didn't throw).
+	std::shared_future<void> written;
+	size_t offset;
+	size_t size;
+
+	// The data of the snapshot, till it's written.
+	MemBuffer<uint8_t> savestate;
+	vector<shared_ptr<DeltaBlock>> deltaBlocks;
+	MemoryCharge savestateCharge;
+};
+
+ReverseManager::SpillFile::SpillFile(ThreadPool& pool_)
+	: pool(pool_), size(0), pendingMemory(0)
+{
+	string dir = FileOperations::getTempDir() +
+	             FileOperations::nativePathSeparator + "openmsx";
+	FileOperations::mkdirp(dir);
+	if (!FileOperations::openUniqueFile(dir, filename)) {
+		throw FileException("Couldn't create temp file");
+	}
+	file = File(filename, "rb+");
+}
+
+ReverseManager::SpillFile::~SpillFile()
+{
+	// the tasks still reference this object
+	for (auto& future : pending) {
+		future.wait();
+	}
+	file.close();
+	FileOperations::unlink(filename);
+}
+
+size_t ReverseManager::SpillFile::getSize() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return size;
+}
+
+static void appendCompressed(vector<uint8_t>& buf, const uint8_t* data, size_t len)
+{
+	size_t pos = buf.size();
+	size_t dstLen = snappy::maxCompressedLength(len);
+	buf.resize(pos + 2 * sizeof(size_t) + dstLen);
+	snappy::compress(reinterpret_cast<const char*>(data), len,
+	                 reinterpret_cast<char*>(&buf[pos + 2 * sizeof(size_t)]),
+	                 dstLen);
+	memcpy(&buf[pos], &len, sizeof(size_t));
+	memcpy(&buf[pos + sizeof(size_t)], &dstLen, sizeof(size_t));
+	buf.resize(pos + 2 * sizeof(size_t) + dstLen);
+}
+
+static MemBuffer<uint8_t> loadCompressed(const uint8_t*& p, size_t& len)
+{
+	size_t srcLen;
+	memcpy(&len,    p,                  sizeof(size_t));
+	memcpy(&srcLen, p + sizeof(size_t), sizeof(size_t));
+	p += 2 * sizeof(size_t);
+	MemBuffer<uint8_t> result(len);
+	snappy::uncompress(reinterpret_cast<const char*>(p), srcLen,
+	                   reinterpret_cast<char*>(result.data()), len);
+	p += srcLen;
+	return result;
+}
+
+void ReverseManager::SpillFile::store(ReverseChunk& chunk)
+{
+	assert(!chunk.isSpilled());
+	// The blocks that are only used by this snapshot are freed once it's
+	// written (other blocks are shared with other snapshots).
+	size_t estimate = chunk.size;
+	for (auto& block : chunk.deltaBlocks) {
+		if (block.use_count() == 1) estimate += block->getMemoryUsage();
+	}
+
+	auto entry = std::make_shared<SpillEntry>();
+	entry->savestate = std::move(chunk.savestate);
+	entry->deltaBlocks = std::move(chunk.deltaBlocks);
+	entry->savestateCharge = std::move(chunk.savestateCharge);
+	chunk.savestate = MemBuffer<uint8_t>();
+	vector<shared_ptr<DeltaBlock>>().swap(chunk.deltaBlocks);
+	chunk.spilled = entry;
+
+	pendingMemory += estimate;
+	size_t savestateSize = chunk.size;
+	entry->written = pool.enqueue([this, entry, savestateSize, estimate]() mutable {
+		// The future (stored in the entry) keeps the task alive, so
+		// don't keep the entry alive from here.
+		try {
+			write(*entry, savestateSize);
+		} catch (...) {
+			pendingMemory -= estimate;
+			entry = nullptr;
+			throw;
+		}
+		pendingMemory -= estimate;
+		entry = nullptr;
+	});
+	pending.push_back(entry->written);
+}
+
+void ReverseManager::SpillFile::write(SpillEntry& entry, size_t savestateSize)
+{
+	vector<uint8_t> buf;
+	appendCompressed(buf, entry.savestate.data(), savestateSize);
+	size_t num = entry.deltaBlocks.size();
+	buf.insert(end(buf), reinterpret_cast<const uint8_t*>(&num),
+	           reinterpret_cast<const uint8_t*>(&num) + sizeof(num));
+	for (auto& block : entry.deltaBlocks) {
+		// The background work of these blocks was queued before this
+		// task, so waiting for it cannot deadlock.
+		size_t len = block->getDataSize();
+		MemBuffer<uint8_t> tmp(len);
+		block->apply(tmp.data(), len);
+		appendCompressed(buf, tmp.data(), len);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		file.seek(size);
+		file.write(buf.data(), buf.size());
+		entry.offset = size;
+		entry.size = buf.size();
+		size += buf.size();
+	}
+
+	entry.savestate = MemBuffer<uint8_t>();
+	vector<shared_ptr<DeltaBlock>>().swap(entry.deltaBlocks);
+	entry.savestateCharge.reset();
+}
+
+void ReverseManager::SpillFile::checkErrors()
+{
+	auto it = std::partition(begin(pending), end(pending),
+		[](const std::shared_future<void>& future) {
+			return future.wait_for(std::chrono::seconds(0)) !=
+			       std::future_status::ready; });
+	vector<std::shared_future<void>> done(it, end(pending));
+	pending.erase(it, end(pending));
+	for (auto& future : done) {
+		future.get(); // possibly rethrows
+	}
+}
+
+void ReverseManager::SpillFile::load(
+	const ReverseChunk& chunk, MemBuffer<uint8_t>& savestate,
+	vector<shared_ptr<DeltaBlock>>& deltaBlocks)
+{
+	assert(chunk.isSpilled());
+	auto& entry = *chunk.spilled;
+	try {
+		entry.written.get();
+	} catch (MSXException&) {
+		// writing failed, the data is still in memory
+		savestate = MemBuffer<uint8_t>(chunk.size);
+		memcpy(savestate.data(), entry.savestate.data(), chunk.size);
+		deltaBlocks = entry.deltaBlocks;
+		return;
+	}
+
+	MemBuffer<uint8_t> buf(entry.size);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		file.seek(entry.offset);
+		file.read(buf.data(), entry.size);
+	}
+
+	const uint8_t* p = buf.data();
+	size_t len;
+	savestate = loadCompressed(p, len);
+	assert(len == chunk.size);
+	size_t num;
+	memcpy(&num, p, sizeof(num));
+	p += sizeof(num);
+	deltaBlocks.clear();
+	for (size_t i = 0; i < num; ++i) {
+		auto data = loadCompressed(p, len);
+		deltaBlocks.push_back(std::make_shared<DeltaBlockCopy>(
+			data.data(), len));
+	}
+	assert(p == buf.data() + entry.size);
+}
+
+// class Regenerator
+
+// 'reverse goto' has to re-emulate from the closest earlier snapshot up to the
+// target time, that's inherently sequential. But while that's going on, idle
+// cores can re-emulate other long gaps in the history (each on its own
+// temporary machine) and take snapshots there. These snapshots are added to
+// the history afterwards, so that later jumps into those gaps are fast.
+class ReverseManager::Regenerator
+{
+public:
+	Regenerator(Reactor::Board board, EmuTime::param endTime);
+	~Regenerator();
+
+	void start(ThreadPool& pool);
+	/** Stop (if still running) and return the snapshots taken so far. */
+	vector<ReverseChunk>& finish();
+
+private:
+	void run();
+
+	Reactor::Board board;
+	const EmuTime endTime;
+	vector<ReverseChunk> chunks;
+	std::shared_future<void> future;
+	std::atomic<bool> stopRequested;
+};
+
+ReverseManager::Regenerator::Regenerator(
+		Reactor::Board board_, EmuTime::param endTime_)
+	: board(move(board_)), endTime(endTime_), stopRequested(false)
+{
+	// Never let this machine interact with the host sound output.
+	board->getMSXMixer().mute();
+}
+
+ReverseManager::Regenerator::~Regenerator()
+{
+	// the task still references this object
+	stopRequested = true;
+	if (future.valid()) future.wait();
+}
+
+void ReverseManager::Regenerator::start(ThreadPool& pool)
+{
+	future = pool.enqueue([this]() { run(); });
+}
+
+vector<ReverseManager::ReverseChunk>& ReverseManager::Regenerator::finish()
+{
+	stopRequested = true;
+	try {
+		future.get();
+	} catch (MSXException&) {
+		// e.g. replaying an event failed, ignore the partial result
+		chunks.clear();
+	}
+	return chunks;
+}
+
+void ReverseManager::Regenerator::run()
+{
+	Thread::BackgroundEmulation backgroundEmulation;
+	auto& manager = board->getReverseManager();
+	EmuTime nextSnapshot = board->getCurrentTime() + REGENERATE_PERIOD;
+	while (!stopRequested && (nextSnapshot < endTime)) {
+		// small steps, so that a stop request is handled quickly
+		board->fastForward(std::min(nextSnapshot,
+			board->getCurrentTime() + EmuDuration(0.25)), true);
+		auto currentTime = board->getCurrentTime();
+		if (currentTime >= nextSnapshot) {
+			chunks.emplace_back();
+			manager.captureSnapshot(chunks.back(), currentTime);
+			nextSnapshot += REGENERATE_PERIOD;
+		}
+	}
+}
+
+
+// struct ReverseChunk
+
+size_t ReverseManager::ReverseChunk::getMemoryUsage(
+	std::unordered_set<const DeltaBlock*>& counted) const
+{
+	size_t result = isSpilled() ? 0 : size;
+	for (auto& b : deltaBlocks) {
+		// A diff also keeps its reference block alive, even if the
+		// snapshot that created that reference was already dropped.
+		for (const DeltaBlock* block = b.get(); block;
+		     block = block->getReference()) {
+			if (!counted.insert(block).second) break;
+			result += block->getMemoryUsage();
+		}
+	}
+	return result;
+}
+
+
 // struct ReverseHistory
 
+ReverseManager::ReverseHistory::ReverseHistory()
+	: memoryCounter(std::make_shared<std::atomic<size_t>>(0))
+{
+	lastDeltaBlocks.setMemoryCounter(memoryCounter);
+}
+
+ReverseManager::ReverseHistory::~ReverseHistory() = default;
+
 void ReverseManager::ReverseHistory::swap(ReverseHistory& other)
 {
 	std::swap(chunks, other.chunks);
 	std::swap(events, other.events);
+	std::swap(spillFile, other.spillFile);
+	// the memory counter goes together with the snapshots
+	std::swap(memoryCounter, other.memoryCounter);
+	lastDeltaBlocks.setMemoryCounter(memoryCounter);
+	other.lastDeltaBlocks.setMemoryCounter(other.memoryCounter);
+}
+
+void ReverseManager::ReverseHistory::shareMemoryCounter(ReverseHistory& other)
+{
+	other.memoryCounter = memoryCounter;
+	other.lastDeltaBlocks.setMemoryCounter(memoryCounter);
 }
 
 void ReverseManager::ReverseHistory::clear()
@@ -112,6 +481,7 @@ void ReverseManager::ReverseHistory::clear()
 	// clear() and free storage capacity
 	Chunks().swap(chunks);
 	Events().swap(events);
+	spillFile.reset();
 }
 
 
@@ -147,6 +517,8 @@ ReverseManager::ReverseManager(MSXMotherBoard& motherBoard_)
 	, reRecordCount(0)
 {
 	eventDistributor.registerEventListener(OPENMSX_TAKE_REVERSE_SNAPSHOT, *this);
+	history.lastDeltaBlocks.setThreadPool(
+		&motherBoard.getReactor().getThreadPool());
 
 	assert(!isCollecting());
 	assert(!isReplaying());
@@ -163,6 +535,15 @@ bool ReverseManager::isReplaying() const
 	return replayIndex != history.events.size();
 }
 
+EmuTime ReverseManager::getNextReplayedCommandTime() const
+{
+	auto& events = history.events;
+	auto it = std::find_if(begin(events) + replayIndex, end(events),
+		[](const shared_ptr<StateChange>& e) {
+			return dynamic_cast<const MSXCommandEvent*>(e.get()) != nullptr; });
+	return (it != end(events)) ? (*it)->getTime() : EmuTime::infinity;
+}
+
 void ReverseManager::start()
 {
 	if (!isCollecting()) {
@@ -246,6 +627,13 @@ void ReverseManager::status(TclObject& result) const
 	}
 	EmuTime le(isCollecting() && (lastEvent != history.events.rend()) ? (*lastEvent)->getTime() : EmuTime::zero);
 	result.addListElement((le - EmuTime::zero).toDouble());
+
+	result.addListElement("memory");
+	result.addListElement(double(history.getMemoryUsage()));
+
+	result.addListElement("spilled");
+	result.addListElement(double(history.spillFile
+		? history.spillFile->getSize() : 0));
 }
 
 void ReverseManager::debugInfo(TclObject& result) const
@@ -253,17 +641,39 @@ void ReverseManager::debugInfo(TclObject& result) const
 	// TODO this is useful during development, but for the end user this
 	// information means nothing. We should remove this later.
 	StringOp::Builder res;
+	std::unordered_set<const DeltaBlock*> counted;
 	size_t totalSize = 0;
+	uint64_t totalCapture = 0;
+	uint64_t totalWork = 0;
+	unsigned numPending = 0;
+	unsigned numSpilled = 0;
 	for (auto& p : history.chunks) {
 		auto& chunk = p.second;
+		size_t size = chunk.getMemoryUsage(counted);
+		bool pending = std::any_of(begin(chunk.deltaBlocks), end(chunk.deltaBlocks),
+			[](const shared_ptr<DeltaBlock>& b) { return !b->isReady(); });
+		uint64_t work = chunk.workTime ? chunk.workTime->load() : 0;
 		res << p.first << ' '
 		    << (chunk.time - EmuTime::zero).toDouble() << ' '
 		    << ((chunk.time - EmuTime::zero).toDouble() / (getCurrentTime() - EmuTime::zero).toDouble()) * 100 << '%'
-		    << " (" << chunk.size << ')'
-		    << " (next event index: " << chunk.eventCount << ")\n";
-		totalSize += chunk.size;
+		    << " (" << size << (chunk.isSpilled() ? ", spilled" : "") << ')'
+		    << " (next event index: " << chunk.eventCount << ')'
+		    << " (capture: " << chunk.captureTime << "us"
+		    << ", background: " << work << "us"
+		    << (pending ? ", pending" : "") << ")\n";
+		totalSize += size;
+		totalCapture += chunk.captureTime;
+		totalWork += work;
+		if (pending) ++numPending;
+		if (chunk.isSpilled()) ++numSpilled;
 	}
-	res << "total size: " << totalSize << '\n';
+	res << "total size: " << totalSize << '\n'
+	    << "spilled snapshots: " << numSpilled << " ("
+	    << (history.spillFile ? history.spillFile->getSize() : 0)
+	    << " bytes on disk)\n"
+	    << "total capture time: " << totalCapture << "us\n"
+	    << "total background time: " << totalWork << "us\n"
+	    << "pending snapshots: " << numPending << '\n';
 	result.setString(string(res));
 }
 
@@ -415,10 +825,7 @@ void ReverseManager::goTo(
 			// -- restore old snapshot --
 			newBoard_ = reactor.createEmptyMotherBoard();
 			newBoard = newBoard_.get();
-			MemInputArchive in(chunk.savestate.data(),
-					   chunk.size,
-					   chunk.deltaBlocks);
-			in.serialize("machine", *newBoard);
+			restoreSnapshot(hist, chunk, *newBoard);
 
 			if (eventDelay) {
 				// Handle all events that are scheduled, but not yet
@@ -448,6 +855,12 @@ void ReverseManager::goTo(
 			stop();
 		}
 
+		// Meanwhile re-emulate other long gaps in the history on the
+		// idle cores.
+		auto& newManager = newBoard->getReverseManager();
+		auto regenerators = newManager.startRegenerators(
+			newBoard->getCurrentTime(), preTarget);
+
 		// -- goto correct time within snapshot --
 		// Fast forward 2 frames before target time.
 		// If we're short on snapshots, create them at intervals that are
@@ -486,10 +899,11 @@ void ReverseManager::goTo(
 				// processing of hotkeys, which can cause things like the machine
 				// being deleted, causing a crash. TODO: find a better way to support
 				// live updates of the UI whilst being in a reverse action...
-				newBoard->getReverseManager().takeSnapshot(currentTimeNewBoard);
+				newManager.takeSnapshot(currentTimeNewBoard);
 				lastSnapshotTarget = nextSnapshotTarget;
 			}
 		}
+		newManager.finishRegenerators(regenerators);
 		// re-enable automatic snapshots
 		schedule(getCurrentTime());
 
@@ -596,10 +1010,7 @@ void ReverseManager::saveReplay(
 
 	// restore first snapshot to be able to serialize it to a file
 	auto initialBoard = reactor.createEmptyMotherBoard();
-	MemInputArchive in(begin(chunks)->second.savestate.data(),
-	                   begin(chunks)->second.size,
-			   begin(chunks)->second.deltaBlocks);
-	in.serialize("machine", *initialBoard);
+	restoreSnapshot(history, begin(chunks)->second, *initialBoard);
 	replay.motherBoards.push_back(move(initialBoard));
 
 	if (maxNofExtraSnapshots > 0) {
@@ -625,10 +1036,7 @@ void ReverseManager::saveReplay(
 				if (it != lastAddedIt) {
 					// this is a new one, add it to the list of snapshots
 					Reactor::Board board = reactor.createEmptyMotherBoard();
-					MemInputArchive in2(it->second.savestate.data(),
-							    it->second.size,
-							    it->second.deltaBlocks);
-					in2.serialize("machine", *board);
+					restoreSnapshot(history, it->second, *board);
 					replay.motherBoards.push_back(move(board));
 					lastAddedIt = it;
 				}
@@ -671,6 +1079,37 @@ void ReverseManager::saveReplay(
 	result.setString("Saved replay to " + filename);
 }
 
+static string resolveReplayFilename(const string& fileNameArg)
+{
+	auto context = userDataFileContext(REPLAY_DIR);
+	try {
+		// Try filename as typed by user.
+		return context.resolve(fileNameArg);
+	} catch (MSXException& /*e1*/) { try {
+		// Not found, try adding '.omr'.
+		return context.resolve(fileNameArg + ".omr");
+	} catch (MSXException& e2) { try {
+		// Again not found, try adding '.gz'.
+		// (this is for backwards compatibility).
+		return context.resolve(fileNameArg + ".gz");
+	} catch (MSXException& /*e3*/) {
+		// Show error message that includes the default extension.
+		throw e2;
+	}}}
+}
+
+static void loadReplayFile(const string& filename, Replay& replay)
+{
+	try {
+		XmlInputArchive in(filename);
+		in.serialize("replay", replay);
+	} catch (XMLException& e) {
+		throw CommandException("Cannot load replay, bad file format: " + e.getMessage());
+	} catch (MSXException& e) {
+		throw CommandException("Cannot load replay: " + e.getMessage());
+	}
+}
+
 void ReverseManager::loadReplay(
 	Interpreter& interp, array_ref<TclObject> tokens, TclObject& result)
 {
@@ -696,38 +1135,13 @@ void ReverseManager::loadReplay(
 
 	if (arguments.size() != 1) throw SyntaxError();
 
-	// resolve the filename
-	auto context = userDataFileContext(REPLAY_DIR);
-	string fileNameArg = arguments[0];
-	string filename;
-	try {
-		// Try filename as typed by user.
-		filename = context.resolve(fileNameArg);
-	} catch (MSXException& /*e1*/) { try {
-		// Not found, try adding '.omr'.
-		filename = context.resolve(fileNameArg + ".omr");
-	} catch (MSXException& e2) { try {
-		// Again not found, try adding '.gz'.
-		// (this is for backwards compatibility).
-		filename = context.resolve(fileNameArg + ".gz");
-	} catch (MSXException& /*e3*/) {
-		// Show error message that includes the default extension.
-		throw e2;
-	}}}
-
 	// restore replay
+	string filename = resolveReplayFilename(arguments[0]);
 	auto& reactor = motherBoard.getReactor();
 	Replay replay(reactor);
 	Events events;
 	replay.events = &events;
-	try {
-		XmlInputArchive in(filename);
-		in.serialize("replay", replay);
-	} catch (XMLException& e) {
-		throw CommandException("Cannot load replay, bad file format: " + e.getMessage());
-	} catch (MSXException& e) {
-		throw CommandException("Cannot load replay: " + e.getMessage());
-	}
+	loadReplayFile(filename, replay);
 
 	// get destination time index
 	auto destination = EmuTime::zero;
@@ -769,10 +1183,13 @@ void ReverseManager::loadReplay(
 		ReverseChunk newChunk;
 		newChunk.time = m->getCurrentTime();
 
+		newChunk.workTime = newHistory.lastDeltaBlocks.startWorkTimer();
 		MemOutputArchive out(newHistory.lastDeltaBlocks,
 		                     newChunk.deltaBlocks, false);
 		out.serialize("machine", *m);
 		newChunk.savestate = out.releaseBuffer(newChunk.size);
+		newChunk.savestateCharge = MemoryCharge(
+			newHistory.memoryCounter, newChunk.size);
 
 		// update replayIdx
 		// TODO: should we use <= instead??
@@ -795,6 +1212,38 @@ void ReverseManager::loadReplay(
 	result.setString("Loaded replay from " + filename);
 }
 
+std::unique_ptr<MSXMotherBoard> ReverseManager::loadBatchReplay(
+	Reactor& reactor, const string& fileNameArg,
+	EmuTime& endTime, bool& hasCommands)
+{
+	Replay replay(reactor);
+	Events events;
+	replay.events = &events;
+	loadReplayFile(resolveReplayFilename(fileNameArg), replay);
+
+	// Only the initial snapshot is needed, the in-between snapshots are
+	// only there to speed up jumping around in the replay.
+	assert(!replay.motherBoards.empty());
+	auto board = move(replay.motherBoards.front());
+
+	if (events.empty() ||
+	    !dynamic_cast<const EndLogEvent*>(events.back().get())) {
+		events.push_back(std::make_shared<EndLogEvent>(
+			replay.currentTime));
+	}
+	endTime = events.back()->getTime();
+	hasCommands = std::any_of(begin(events), end(events),
+		[](const shared_ptr<StateChange>& e) {
+			return dynamic_cast<const MSXCommandEvent*>(e.get()) != nullptr; });
+
+	unsigned replayIdx = 0;
+	while (events[replayIdx]->getTime() < board->getCurrentTime()) {
+		++replayIdx; // stops at EndLogEvent (at the latest)
+	}
+	board->getReverseManager().startBackgroundReplay(events, replayIdx);
+	return board;
+}
+
 void ReverseManager::transferHistory(ReverseHistory& oldHistory,
                                      unsigned oldEventCount)
 {
@@ -819,6 +1268,112 @@ void ReverseManager::transferHistory(ReverseHistory& oldHistory,
 	replayNextEvent();
 }
 
+// Used for the temporary machines of class Regenerator and for batch replays:
+// replay the given events, but don't take snapshots automatically (a
+// Regenerator takes them itself, outside the main thread).
+void ReverseManager::startBackgroundReplay(const Events& events,
+                                           unsigned eventIndex)
+{
+	assert(!isCollecting());
+	assert(history.chunks.empty());
+
+	history.events = events;
+	// Calculate deltas in the emulation thread, that's normally a worker
+	// thread already.
+	history.lastDeltaBlocks.setThreadPool(nullptr);
+
+	collecting = true;
+	motherBoard.getStateChangeDistributor().registerRecorder(*this);
+
+	replayIndex = eventIndex;
+	// replay log contains at least the EndLogEvent
+	assert(replayIndex < history.events.size());
+	replayNextEvent();
+}
+
+// Start re-emulating the long gaps in the history on the idle worker threads
+// (while the current thread re-emulates from 'from' to 'to'). Gaps closest to
+// 'to' are preferred, those are the most likely target of the next jump.
+ReverseManager::Regenerators ReverseManager::startRegenerators(
+	EmuTime::param from, EmuTime::param to)
+{
+	Regenerators result;
+	if ((to - from) < MIN_REGENERATE_GAP) return result;
+
+	auto& events = history.events;
+	// Only when replaying (the log ends with an EndLogEvent), otherwise
+	// there are no events after the last snapshot.
+	if (events.empty() ||
+	    !dynamic_cast<const EndLogEvent*>(events.back().get())) {
+		return result;
+	}
+
+	auto& reactor = motherBoard.getReactor();
+	auto& pool = reactor.getThreadPool();
+	// Keep one worker free for the deltas of the snapshots that are taken
+	// in the current thread.
+	unsigned maxNum = pool.getNumThreads() - 1;
+	if (maxNum == 0) return result;
+
+	vector<Chunks::iterator> gaps;
+	auto& chunks = history.chunks;
+	for (auto it = begin(chunks); std::next(it) != end(chunks); ++it) {
+		const auto& start = it->second;
+		const auto& stop  = std::next(it)->second;
+		if ((stop.time - start.time) < MIN_REGENERATE_GAP) continue;
+		// skip the gap that's re-emulated in the current thread
+		if ((start.time < to) && (from < stop.time)) continue;
+		// Replaying commands executes Tcl code, that's only possible
+		// in the main thread.
+		if (std::any_of(begin(events) + start.eventCount,
+		                begin(events) + stop.eventCount,
+		                [](const shared_ptr<StateChange>& e) {
+		                    return dynamic_cast<const MSXCommandEvent*>(
+		                               e.get()) != nullptr; })) {
+			continue;
+		}
+		gaps.push_back(it);
+	}
+	auto distance = [&](Chunks::iterator it) {
+		auto t = it->second.time;
+		return (t < to) ? (to - t) : (t - to);
+	};
+	std::sort(begin(gaps), end(gaps),
+		[&](Chunks::iterator x, Chunks::iterator y) {
+			return distance(x) < distance(y); });
+	if (gaps.size() > maxNum) gaps.resize(maxNum);
+
+	for (auto& it : gaps) {
+		auto board = reactor.createEmptyMotherBoard();
+		restoreSnapshot(history, it->second, *board);
+		auto& manager = board->getReverseManager();
+		manager.startBackgroundReplay(events, it->second.eventCount);
+		history.shareMemoryCounter(manager.history);
+		result.push_back(make_unique<Regenerator>(
+			move(board), std::next(it)->second.time));
+	}
+	for (auto& r : result) {
+		r->start(pool);
+	}
+	return result;
+}
+
+// Add the snapshots that were taken in the background to the history.
+void ReverseManager::finishRegenerators(Regenerators& regenerators)
+{
+	for (auto& r : regenerators) {
+		for (auto& chunk : r->finish()) {
+			unsigned seqNum = history.getNextSeqNum(chunk.time);
+			if (history.chunks.find(seqNum) != end(history.chunks)) {
+				continue;
+			}
+			history.chunks.emplace(seqNum, move(chunk));
+		}
+	}
+	regenerators.clear(); // delete the temporary machines
+	enforceMemoryBudget();
+}
+
 void ReverseManager::execNewSnapshot()
 {
 	// During record we should take regular snapshots, and 'now'
@@ -910,13 +1465,44 @@ void ReverseManager::takeSnapshot(EmuTime::param time)
 	// the same moment in time).
 
 	// actually create new snapshot
-	ReverseChunk& newChunk = history.chunks[seqNum];
-	newChunk.deltaBlocks.clear();
-	MemOutputArchive out(history.lastDeltaBlocks, newChunk.deltaBlocks, true);
+	captureSnapshot(history.chunks[seqNum], time);
+
+	enforceMemoryBudget();
+}
+
+void ReverseManager::captureSnapshot(ReverseChunk& chunk, EmuTime::param time)
+{
+	// Only the serialization itself (copying memory blocks) is done here,
+	// calculating deltas and compressing is done in the background.
+	auto start = Timer::getTime();
+	chunk.deltaBlocks.clear();
+	chunk.workTime = history.lastDeltaBlocks.startWorkTimer();
+	MemOutputArchive out(history.lastDeltaBlocks, chunk.deltaBlocks, true);
 	out.serialize("machine", motherBoard);
-	newChunk.time = time;
-	newChunk.savestate = out.releaseBuffer(newChunk.size);
-	newChunk.eventCount = replayIndex;
+	chunk.time = time;
+	chunk.savestate = out.releaseBuffer(chunk.size);
+	chunk.savestateCharge = MemoryCharge(history.memoryCounter, chunk.size);
+	chunk.eventCount = replayIndex;
+	chunk.captureTime = Timer::getTime() - start;
+	chunk.spilled.reset();
+}
+
+void ReverseManager::restoreSnapshot(
+	ReverseHistory& hist, const ReverseChunk& chunk, MSXMotherBoard& board)
+{
+	if (!chunk.isSpilled()) {
+		MemInputArchive in(chunk.savestate.data(), chunk.size,
+		                   chunk.deltaBlocks);
+		in.serialize("machine", board);
+	} else {
+		// page the snapshot back in (only temporarily)
+		assert(hist.spillFile);
+		MemBuffer<uint8_t> savestate;
+		vector<shared_ptr<DeltaBlock>> deltaBlocks;
+		hist.spillFile->load(chunk, savestate, deltaBlocks);
+		MemInputArchive in(savestate.data(), chunk.size, deltaBlocks);
+		in.serialize("machine", board);
+	}
 }
 
 void ReverseManager::replayNextEvent()
@@ -996,6 +1582,97 @@ void ReverseManager::dropOldSnapshots(unsigned count)
 	}
 }
 
+/* Should be called each time a new snapshot is added.
+ * When the history uses more memory than allowed by the
+ * 'reverse_memory_budget' setting, either the oldest snapshots are moved to
+ * the spill file (see 'reverse_spill_to_disk') or snapshots are dropped. The
+ * latter is done so that the remaining snapshots are (roughly) exponentially
+ * spaced in time, like dropOldSnapshots() does.
+ */
+void ReverseManager::enforceMemoryBudget()
+{
+	auto& settings = motherBoard.getReactor().getGlobalSettings();
+	size_t budget = size_t(settings.getReverseMemoryBudgetSetting().getInt())
+	              * 1024 * 1024;
+	if (budget == 0) return; // unlimited
+
+	// Snapshots that are still being written to the spill file will
+	// soon no longer use memory.
+	auto getMemoryUsage = [&]() {
+		size_t used = history.getMemoryUsage();
+		size_t pending = history.spillFile
+		               ? history.spillFile->getPendingMemory() : 0;
+		return used - std::min(used, pending);
+	};
+	auto& spillSetting = settings.getReverseSpillSetting();
+	while (getMemoryUsage() > budget) {
+		if (spillSetting.getBoolean()) {
+			try {
+				if (history.spillFile) {
+					history.spillFile->checkErrors();
+				}
+				if (spillOldestSnapshot()) continue;
+			} catch (MSXException& e) {
+				motherBoard.getMSXCliComm().printWarning(
+					"Couldn't move reverse snapshot to disk: " +
+					e.getMessage() +
+					" Disabled reverse_spill_to_disk.");
+				spillSetting.setBoolean(false);
+			}
+		}
+		if (!thinSnapshots()) break;
+	}
+}
+
+// Move the oldest snapshot that's still in memory to the spill file. The most
+// recent snapshot always stays in memory.
+bool ReverseManager::spillOldestSnapshot()
+{
+	auto& chunks = history.chunks;
+	assert(!chunks.empty());
+	auto last = std::prev(end(chunks));
+	auto it = find_if(begin(chunks), last,
+		[](Chunks::value_type& p) { return !p.second.isSpilled(); });
+	if (it == last) return false;
+
+	if (!history.spillFile) {
+		history.spillFile = make_unique<SpillFile>(
+			motherBoard.getReactor().getThreadPool());
+	}
+	history.spillFile->store(it->second);
+	return true;
+}
+
+// Drop one snapshot. Pick the one for which the gap it leaves, relative to
+// its age, is the smallest. Repeating this results in snapshots of which the
+// distance is proportional to their age. The first and the last snapshot are
+// never dropped.
+bool ReverseManager::thinSnapshots()
+{
+	auto& chunks = history.chunks;
+	if (chunks.size() <= 2) return false;
+
+	EmuTime now = chunks.rbegin()->second.time;
+	auto best = end(chunks);
+	double bestCost = std::numeric_limits<double>::max();
+	auto prev = begin(chunks);
+	for (auto it = std::next(prev); std::next(it) != end(chunks); prev = it++) {
+		// dropping a spilled snapshot doesn't free any memory
+		if (it->second.isSpilled()) continue;
+		auto next = std::next(it);
+		double gap = (next->second.time - prev->second.time).toDouble();
+		double age = (now - it->second.time).toDouble();
+		double cost = gap / std::max(age, SNAPSHOT_PERIOD);
+		if (cost < bestCost) {
+			bestCost = cost;
+			best = it;
+		}
+	}
+	if (best == end(chunks)) return false;
+	chunks.erase(best);
+	return true;
+}
+
 void ReverseManager::schedule(EmuTime::param time)
 {
 	syncNewSnapshot.setSyncPoint(time + EmuDuration(SNAPSHOT_PERIOD));
@@ -12,12 +12,15 @@
 #include "outer.hh"
 #include <vector>
 #include <map>
+#include <unordered_set>
+#include <atomic>
 #include <memory>
 #include <cstdint>
 
 namespace openmsx {
 
 class MSXMotherBoard;
+class Reactor;
 class Keyboard;
 class EventDelay;
 class EventDistributor;
@@ -50,31 +53,83 @@ public:
 		reRecordCount = count;
 	}
 
+	/** Load the given replay file and prepare the (initial) machine in it
+	  * to replay all recorded events while it's being emulated (e.g. via
+	  * MSXMotherBoard::fastForward()). Used by the batch replay mode.
+	  * @param endTime Is set to the time at which the replay ends.
+	  * @param hasCommands Is set when the replay contains commands. These
+	  *        can only be replayed in the main thread.
+	  */
+	static std::unique_ptr<MSXMotherBoard> loadBatchReplay(
+		Reactor& reactor, const std::string& filename,
+		EmuTime& endTime, bool& hasCommands);
+
+	/** The time of the next command that will be replayed, or
+	  * EmuTime::infinity when no more commands will be replayed. Replaying
+	  * a command executes Tcl code, so a machine that is emulated in the
+	  * background must stop before this time.
+	  */
+	EmuTime getNextReplayedCommandTime() const;
+
 private:
+	struct SpillEntry;
 	struct ReverseChunk {
-		ReverseChunk() : time(EmuTime::zero) {}
+		ReverseChunk()
+			: time(EmuTime::zero), captureTime(0) {}
 
 		EmuTime time;
 		std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
 		MemBuffer<uint8_t> savestate;
 		size_t size;
+		MemoryCharge savestateCharge; // 'size' while 'savestate' is used
 
 		// Number of recorded events (or replay index) when this
 		// snapshot was created. So when going back replay should
 		// start at this index.
 		unsigned eventCount;
+
+		// Time (in us) the emulation was stopped to take this
+		// snapshot, and time spent on calculating deltas and
+		// compressing in the background (only for 'reverse debug').
+		uint64_t captureTime;
+		std::shared_ptr<const std::atomic<uint64_t>> workTime;
+
+		// Location in the spill file. When spilled, 'savestate' and
+		// 'deltaBlocks' are empty (but 'size' is still valid).
+		std::shared_ptr<SpillEntry> spilled;
+		bool isSpilled() const { return spilled != nullptr; }
+
+		/** Number of bytes of memory used by this snapshot. Blocks
+		  * that are already in 'counted' are skipped (those are
+		  * shared with an other snapshot), the others are added. */
+		size_t getMemoryUsage(
+			std::unordered_set<const DeltaBlock*>& counted) const;
 	};
 	using Chunks = std::map<unsigned, ReverseChunk>;
 	using Events = std::vector<std::shared_ptr<StateChange>>;
 
+	class SpillFile;
+	class Regenerator;
+
 	struct ReverseHistory {
+		ReverseHistory();
+		~ReverseHistory();
 		void swap(ReverseHistory& other);
 		void clear();
 		unsigned getNextSeqNum(EmuTime::param time) const;
+		/** Number of bytes of memory used by the snapshots. */
+		size_t getMemoryUsage() const { return *memoryCounter; }
+		/** Snapshots taken by the other history are counted in this
+		  * history (they are moved to it later on). */
+		void shareMemoryCounter(ReverseHistory& other);
 
 		Chunks chunks;
 		Events events;
 		LastDeltaBlocks lastDeltaBlocks;
+		// The memory of the savestates and of all delta blocks that are
+		// still alive (these can be shared between snapshots).
+		MemoryCounter memoryCounter;
+		std::unique_ptr<SpillFile> spillFile; // created on demand
 	};
 
 	bool isCollecting() const { return collecting; }
@@ -99,9 +154,19 @@ private:
 	                     unsigned oldEventCount);
 	void transferState(MSXMotherBoard& newBoard);
 	void takeSnapshot(EmuTime::param time);
+	void captureSnapshot(ReverseChunk& chunk, EmuTime::param time);
+	void startBackgroundReplay(const Events& events, unsigned eventIndex);
+	using Regenerators = std::vector<std::unique_ptr<Regenerator>>;
+	Regenerators startRegenerators(EmuTime::param from, EmuTime::param to);
+	void finishRegenerators(Regenerators& regenerators);
+	void restoreSnapshot(ReverseHistory& hist, const ReverseChunk& chunk,
+	                     MSXMotherBoard& board);
 	void schedule(EmuTime::param time);
 	void replayNextEvent();
 	template<unsigned N> void dropOldSnapshots(unsigned count);
+	void enforceMemoryBudget();
+	bool spillOldestSnapshot();
+	bool thinSnapshots();
 
 	// Schedulable
 	struct SyncNewSnapshot : Schedulable {
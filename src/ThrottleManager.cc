@@ -1,4 +1,6 @@
 #include "ThrottleManager.hh"
+#include "Thread.hh"
+#include <cassert>
 
 namespace openmsx {
 
@@ -55,19 +57,26 @@ void ThrottleManager::update(const Setting& /*setting*/)
 LoadingIndicator::LoadingIndicator(ThrottleManager& throttleManager_)
 	: throttleManager(throttleManager_)
 	, isLoading(false)
+	, reported(false)
 {
 }
 
 LoadingIndicator::~LoadingIndicator()
 {
-	update(false);
+	assert(Thread::isMainThread() || !reported);
+	if (reported) {
+		throttleManager.indicateLoadingState(false);
+	}
 }
 
 void LoadingIndicator::update(bool newState)
 {
-	if (isLoading != newState) {
-		isLoading = newState;
-		throttleManager.indicateLoadingState(isLoading);
+	isLoading = newState;
+	if (!Thread::isMainThread()) return; // background emulation
+
+	if (reported != isLoading) {
+		reported = isLoading;
+		throttleManager.indicateLoadingState(reported);
 	}
 }
 
@@ -53,6 +53,10 @@ private:
 
 /**
  * Used by a device to indicate when it is loading.
+ * A machine that is emulated outside the main thread (see
+ * Thread::BackgroundEmulation) doesn't influence the ThrottleManager, its
+ * state is only passed on when the device updates it again from the main
+ * thread.
  */
 class LoadingIndicator
 {
@@ -68,6 +72,7 @@ public:
 private:
 	ThrottleManager& throttleManager;
 	bool isLoading;
+	bool reported; // value of isLoading as known by throttleManager
 };
 
 } // namespace openmsx
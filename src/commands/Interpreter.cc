@@ -5,9 +5,9 @@
 #include "CommandException.hh"
 #include "MSXCommandController.hh"
 #include "MSXMotherBoard.hh"
+#include "Reactor.hh"
 #include "Setting.hh"
 #include "InterpreterOutput.hh"
-#include "MSXCPUInterface.hh"
 #include "FileOperations.hh"
 #include "array_ref.hh"
 #include "stl.hh"
@@ -72,11 +72,14 @@ void Interpreter::init(const char* programName)
 	Tcl_FindExecutable(programName);
 }
 
-Interpreter::Interpreter(EventDistributor& eventDistributor_)
+Interpreter::Interpreter(EventDistributor& eventDistributor_, Reactor& reactor_)
 	: eventDistributor(eventDistributor_)
+	, reactor(reactor_)
 {
 	interp = Tcl_CreateInterp();
 	Tcl_Preserve(interp);
+	// see lockBackgroundMachines()
+	Tcl_SetAssocData(interp, "openmsx::Interpreter", nullptr, this);
 
 	// TODO need to investigate this: doesn't work on windows
 	/*
@@ -108,9 +111,6 @@ Interpreter::Interpreter(EventDistributor& eventDistributor_)
 
 Interpreter::~Interpreter()
 {
-	// see comment in MSXCPUInterface::cleanup()
-	MSXCPUInterface::cleanup();
-
 	if (!Tcl_InterpDeleted(interp)) {
 		Tcl_DeleteInterp(interp);
 	}
@@ -147,10 +147,22 @@ void Interpreter::unregisterCommand(Command& command)
 	Tcl_DeleteCommandFromToken(interp, static_cast<Tcl_Command>(command.getToken()));
 }
 
+// Tcl code (and so openMSX commands and settings) can access any machine. Also
+// the ones that are emulated by another thread, pause those. This happens
+// e.g. in breakpoint conditions or 'after time' callbacks of the active
+// machine, outside of EventDistributor::deliverEvents().
+void Interpreter::lockBackgroundMachines(Tcl_Interp* interp)
+{
+	auto* interpreter = static_cast<Interpreter*>(
+		Tcl_GetAssocData(interp, "openmsx::Interpreter", nullptr));
+	interpreter->reactor.lockBackgroundMachines();
+}
+
 int Interpreter::commandProc(ClientData clientData, Tcl_Interp* interp,
                            int objc, Tcl_Obj* const objv[])
 {
 	try {
+		lockBackgroundMachines(interp);
 		auto& command = *static_cast<Command*>(clientData);
 		auto tokens = make_array_ref(
 			reinterpret_cast<TclObject*>(const_cast<Tcl_Obj**>(objv)),
@@ -367,6 +379,7 @@ char* Interpreter::traceProc(ClientData clientData, Tcl_Interp* interp,
 		auto traceID = reinterpret_cast<uintptr_t>(clientData);
 		auto* variable = getTraceSetting(traceID);
 		if (!variable) return nullptr;
+		lockBackgroundMachines(interp);
 
 		const TclObject& part1Obj = variable->getFullNameObj();
 		assert(removeColonColon(part1) == removeColonColon(part1Obj.getString()));
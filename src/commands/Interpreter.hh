@@ -10,6 +10,7 @@
 namespace openmsx {
 
 class EventDistributor;
+class Reactor;
 class Command;
 class BaseSetting;
 class InterpreterOutput;
@@ -20,7 +21,7 @@ public:
 	Interpreter(const Interpreter&) = delete;
 	Interpreter& operator=(const Interpreter&) = delete;
 
-	explicit Interpreter(EventDistributor& eventDistributor);
+	Interpreter(EventDistributor& eventDistributor, Reactor& reactor);
 	~Interpreter();
 
 	void setOutput(InterpreterOutput* output_) { output = output_; }
@@ -59,8 +60,10 @@ private:
 	                       int objc, Tcl_Obj* const objv[]);
 	static char* traceProc(ClientData clientData, Tcl_Interp* interp,
 	                       const char* part1, const char* part2, int flags);
+	static void lockBackgroundMachines(Tcl_Interp* interp);
 
 	EventDistributor& eventDistributor;
+	Reactor& reactor;
 
 	static Tcl_ChannelType channelType;
 	Tcl_Interp* interp;
@@ -3,6 +3,7 @@
 #include "CliComm.hh"
 #include "CommandException.hh"
 #include "StringSetting.hh"
+#include "Thread.hh"
 #include "memory.hh"
 #include <iostream>
 
@@ -39,6 +40,7 @@ TclObject TclCallback::getValue() const
 
 TclObject TclCallback::execute()
 {
+	if (!Thread::isMainThread()) return TclObject(); // background emulation
 	const auto& callback = getValue();
 	if (callback.empty()) return TclObject();
 
@@ -49,6 +51,7 @@ TclObject TclCallback::execute()
 
 TclObject TclCallback::execute(int arg1)
 {
+	if (!Thread::isMainThread()) return TclObject(); // background emulation
 	const auto& callback = getValue();
 	if (callback.empty()) return TclObject();
 
@@ -60,6 +63,7 @@ TclObject TclCallback::execute(int arg1)
 
 TclObject TclCallback::execute(int arg1, int arg2)
 {
+	if (!Thread::isMainThread()) return TclObject(); // background emulation
 	const auto& callback = getValue();
 	if (callback.empty()) return TclObject();
 
@@ -72,6 +76,7 @@ TclObject TclCallback::execute(int arg1, int arg2)
 
 TclObject TclCallback::execute(int arg1, string_ref arg2)
 {
+	if (!Thread::isMainThread()) return TclObject(); // background emulation
 	const auto& callback = getValue();
 	if (callback.empty()) return TclObject();
 
@@ -84,6 +89,7 @@ TclObject TclCallback::execute(int arg1, string_ref arg2)
 
 TclObject TclCallback::execute(string_ref arg1, string_ref arg2)
 {
+	if (!Thread::isMainThread()) return TclObject(); // background emulation
 	const auto& callback = getValue();
 	if (callback.empty()) return TclObject();
 
@@ -0,0 +1,151 @@
+#include "BlockCache.hh"
+#include "memory.hh"
+#include <algorithm>
+
+namespace openmsx {
+
+static const uint16_t UNKNOWN  = 0xFFFF;
+static const uint16_t NO_BLOCK = 0xFFFE;
+
+// Limit the amount of work that's done without checking for sync points in
+// case the duration of a block is not yet known.
+static const unsigned MAX_OPS = 64;
+
+// When code in a cache line is often modified, the number of (outdated)
+// blocks keeps growing. Start over when there are too many.
+static const unsigned MAX_BLOCKS = 1024;
+
+
+BlockCache::Line::Line(const byte* source_)
+{
+	reset(source_);
+}
+
+void BlockCache::Line::reset(const byte* source_)
+{
+	source = source_;
+	std::fill(std::begin(index), std::end(index), UNKNOWN);
+	blocks.clear();
+}
+
+
+BlockCache::BlockCache() = default;
+BlockCache::~BlockCache() = default;
+
+BlockCache::Block* BlockCache::find(unsigned address, const byte* line)
+{
+	auto& l = lines[address >> CacheLine::BITS];
+	if (!l) {
+		l = make_unique<Line>(line);
+	} else if (l->source != line) {
+		// other memory became visible (e.g. mapper switch)
+		l->reset(line);
+	}
+
+	auto idx = l->index[address & CacheLine::LOW];
+	if (idx == NO_BLOCK) return nullptr;
+	if (idx != UNKNOWN) {
+		auto& block = l->blocks[idx];
+		if (std::equal(begin(block.code), end(block.code), &line[address])) {
+			return &block;
+		}
+		// memory was modified (e.g. self-modifying code), decode again
+	}
+	return decode(*l, address, line);
+}
+
+BlockCache::Block* BlockCache::decode(Line& l, unsigned address, const byte* line)
+{
+	unsigned low = address & CacheLine::LOW;
+	unsigned end = (address & CacheLine::HIGH) + CacheLine::SIZE;
+	Block block;
+	unsigned addr = address;
+	while (block.ops.size() < MAX_OPS) {
+		byte opcode = line[addr];
+		if (!isBlockOpcode(opcode)) break;
+		unsigned len = getLength(opcode);
+		if ((addr + len) > end) break; // don't cross cache lines
+		block.ops.push_back({opcode, 0});
+		addr += len;
+	}
+	if (block.ops.size() < 2) {
+		// not worth it, execute single instructions the normal way
+		l.index[low] = NO_BLOCK;
+		return nullptr;
+	}
+	if (l.blocks.size() >= MAX_BLOCKS) {
+		l.reset(l.source);
+	}
+	block.code.assign(&line[address], &line[addr]);
+	block.cycles = 0;
+	block.lastCycles = 0;
+	block.timed = false;
+	l.index[low] = uint16_t(l.blocks.size());
+	l.blocks.push_back(std::move(block));
+	return &l.blocks.back();
+}
+
+void BlockCache::setTimed(Block& block)
+{
+	int total = 0;
+	for (auto& op : block.ops) {
+		total += op.cycles;
+	}
+	block.cycles = total;
+	block.lastCycles = block.ops.back().cycles;
+	block.timed = true;
+}
+
+void BlockCache::invalidate(unsigned start, unsigned size)
+{
+	unsigned first = start / CacheLine::SIZE;
+	unsigned num = (size + CacheLine::SIZE - 1) / CacheLine::SIZE;
+	for (unsigned i = first; i < std::min(first + num, CacheLine::NUM); ++i) {
+		lines[i].reset();
+	}
+}
+
+void BlockCache::clear()
+{
+	invalidate(0x0000, 0x10000);
+}
+
+bool BlockCache::isBlockOpcode(byte op)
+{
+	unsigned r1 = (op >> 3) & 7;
+	unsigned r2 = op & 7;
+	if (op < 0x40) {
+		switch (op & 0x0F) {
+		case 0x01: case 0x03: case 0x09: case 0x0B:
+			return true; // ld ss,nn / inc ss / add hl,ss / dec ss
+		case 0x04: case 0x05: case 0x06:
+		case 0x0C: case 0x0D: case 0x0E:
+			return r1 != 6; // inc r / dec r / ld r,n (not (hl))
+		case 0x07: case 0x0F:
+			return true; // rlca rrca rla rra daa cpl scf ccf
+		case 0x00:
+			return op == 0x00; // nop
+		case 0x08:
+			return op == 0x08; // ex af,af'
+		default:
+			return false;
+		}
+	} else if (op < 0x80) {
+		return (op != 0x76) && (r1 != 6) && (r2 != 6); // ld r,r
+	} else if (op < 0xC0) {
+		return r2 != 6; // alu a,r
+	} else {
+		return (r2 == 6) || // alu a,n
+		       (op == 0xD9) || (op == 0xEB); // exx / ex de,hl
+	}
+}
+
+unsigned BlockCache::getLength(byte op)
+{
+	if ((op & 0xCF) == 0x01) return 3; // ld ss,nn
+	if ((op & 0xC7) == 0x06) return 2; // ld r,n
+	if ((op & 0xC7) == 0xC6) return 2; // alu a,n
+	return 1;
+}
+
+} // namespace openmsx
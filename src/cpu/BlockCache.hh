@@ -0,0 +1,86 @@
+#ifndef BLOCKCACHE_HH
+#define BLOCKCACHE_HH
+
+#include "CacheLine.hh"
+#include "openmsx.hh"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace openmsx {
+
+/** Cache of decoded basic blocks, used by CPUCore when the
+  * '<cpu>_block_cache' setting is enabled.
+  *
+  * A block is a run of (at least two) simple instructions: unprefixed
+  * instructions that only operate on registers (ld r,r / inc r / add a,n /
+  * ld hl,nn / ...). These instructions don't access memory (other than the
+  * instruction bytes) and don't change the control flow, so their duration
+  * is fixed. Once a block has been executed completely, CPUCore knows its
+  * total duration and can execute it without checking for sync points after
+  * every instruction.
+  *
+  * Blocks are keyed on the address and on the memory that's visible at that
+  * address (the CPU read cache line, so this depends on the slot and mapper
+  * configuration). Because memory can also be modified without the CPU
+  * noticing (e.g. via the debugger) the instruction bytes are compared each
+  * time a block is used. invalidateMemCache() only frees blocks that are
+  * unlikely to be used again.
+  */
+class BlockCache
+{
+public:
+	struct Op {
+		byte opcode;
+		byte cycles; // learned during the first complete execution
+	};
+	struct Block {
+		std::vector<Op> ops;
+		std::vector<byte> code; // instruction bytes, to detect modified memory
+		int cycles;     // total duration, only valid when 'timed'
+		int lastCycles; // duration of the last instruction
+		bool timed;
+	};
+
+	BlockCache();
+	~BlockCache();
+
+	/** Returns the block that starts at the given address, or nullptr if
+	  * there's no such block.
+	  * @param address The (16-bit) address of the first instruction.
+	  * @param line The CPU read cache line that contains this address
+	  *             (indexed with the full address, not nullptr).
+	  */
+	Block* find(unsigned address, const byte* line);
+
+	/** Should be called after all instructions of the block have been
+	  * executed and their duration was stored in the Op structures. */
+	static void setTimed(Block& block);
+
+	void invalidate(unsigned start, unsigned size);
+	void clear();
+
+	/** Can the given (main) opcode be part of a block? */
+	static bool isBlockOpcode(byte opcode);
+	/** Length in bytes of an instruction that starts with the given
+	  * opcode (only valid for block opcodes). */
+	static unsigned getLength(byte opcode);
+
+private:
+	struct Line {
+		explicit Line(const byte* source);
+		void reset(const byte* source);
+
+		const byte* source; // read cache line for which these blocks are valid
+		uint16_t index[CacheLine::SIZE]; // per address: UNKNOWN, NO_BLOCK or index in 'blocks'
+		std::vector<Block> blocks;
+	};
+
+	Block* decode(Line& l, unsigned address, const byte* line);
+
+	std::unique_ptr<Line> lines[CacheLine::NUM];
+};
+
+} // namespace openmsx
+
+#endif
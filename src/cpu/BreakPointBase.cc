@@ -1,4 +1,5 @@
 #include "BreakPointBase.hh"
+#include "CompiledCondition.hh"
 #include "CommandException.hh"
 #include "GlobalCliComm.hh"
 #include "ScopedAssign.hh"
@@ -7,10 +8,17 @@ namespace openmsx {
 
 BreakPointBase::BreakPointBase(TclObject command_, TclObject condition_)
 	: command(std::move(command_)), condition(std::move(condition_))
+	, compiled(CompiledCondition::compile(condition.getString()))
 	, executing(false)
 {
 }
 
+bool BreakPointBase::isKnownFalse(MSXMotherBoard& motherBoard) const
+{
+	bool result;
+	return compiled && compiled->evaluate(motherBoard, result) && !result;
+}
+
 bool BreakPointBase::isTrue(GlobalCliComm& cliComm, Interpreter& interp) const
 {
 	if (condition.getString().empty()) {
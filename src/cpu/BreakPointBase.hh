@@ -3,11 +3,14 @@
 
 #include "TclObject.hh"
 #include "string_ref.hh"
+#include <memory>
 
 namespace openmsx {
 
 class Interpreter;
 class GlobalCliComm;
+class MSXMotherBoard;
+class CompiledCondition;
 
 /** Base class for CPU break and watch points.
  */
@@ -21,6 +24,13 @@ public:
 
 	void checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp);
 
+	/** Cheap test that doesn't involve the Tcl interpreter. Returns true
+	  * when the condition could be compiled (see CompiledCondition) and
+	  * it currently evaluates to false. In all other cases the condition
+	  * must still be evaluated via checkAndExecute().
+	  */
+	bool isKnownFalse(MSXMotherBoard& motherBoard) const;
+
 protected:
 	// Note: we require GlobalCliComm here because breakpoint objects can
 	// be transfered to different MSX machines, and so the MSXCliComm
@@ -32,6 +42,7 @@ private:
 
 	TclObject command;
 	TclObject condition;
+	std::shared_ptr<const CompiledCondition> compiled; // can be nullptr
 	bool executing;
 };
 
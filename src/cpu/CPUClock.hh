@@ -113,6 +113,10 @@ protected:
 	inline bool limitReached() const {
 		return remaining < 0;
 	}
+	/** Would limitReached() return true after another 'ticks' cycles? */
+	inline bool limitReachedAfter(int ticks) const {
+		return (remaining - ticks) < 0;
+	}
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
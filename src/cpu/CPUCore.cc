@@ -160,6 +160,7 @@
 
 #include "CPUCore.hh"
 #include "MSXCPUInterface.hh"
+#include "CPUProfiler.hh"
 #include "Scheduler.hh"
 #include "MSXMotherBoard.hh"
 #include "CliComm.hh"
@@ -169,6 +170,7 @@
 #include "R800.hh"
 #include "Thread.hh"
 #include "endian.hh"
+#include "memory.hh"
 #include "likely.hh"
 #include "inline.hh"
 #include "unreachable.hh"
@@ -294,7 +296,7 @@ static void initTables()
 
 template<class T> CPUCore<T>::CPUCore(
 		MSXMotherBoard& motherboard_, const string& name,
-		const BooleanSetting& traceSetting_,
+		const BooleanSetting& traceSetting_, CPUProfiler& profiler_,
 		TclCallback& diHaltCallback_, EmuTime::param time)
 	: CPURegs(T::isR800())
 	, T(time, motherboard_.getScheduler())
@@ -302,6 +304,7 @@ template<class T> CPUCore<T>::CPUCore(
 	, scheduler(motherboard.getScheduler())
 	, interface(nullptr)
 	, traceSetting(traceSetting_)
+	, profiler(profiler_)
 	, diHaltCallback(diHaltCallback_)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
 	            "Non-zero if there are pending IRQs (thus CPU would enter "
@@ -320,10 +323,18 @@ template<class T> CPUCore<T>::CPUCore(
 		"custom " + name + " frequency (only valid when unlocked)",
 		T::CLOCK_FREQ, 1000000, 1000000000)
 	, freq(T::CLOCK_FREQ)
+	, blockCacheSetting(
+		motherboard.getCommandController(), name + "_block_cache",
+		"cache decoded blocks of simple " + name + " instructions "
+		"(experimental, no functional difference)",
+		false)
+	, blockCacheEnabled(false)
 	, NMIStatus(0)
 	, nmiEdge(false)
 	, exitLoop(false)
 	, tracingEnabled(traceSetting.getBoolean())
+	, profileTime(EmuTime::zero)
+	, profileSP(0)
 	, isTurboR(motherboard.isTurboR())
 {
 	static_assert(!std::is_polymorphic<CPUCore<T>>::value,
@@ -353,6 +364,7 @@ template<class T> void CPUCore<T>::invalidateMemCache(unsigned start, unsigned s
 	memset(&writeCacheLine [first], 0, num * sizeof(byte*)); //
 	memset(&readCacheTried [first], 0, num * sizeof(bool));  // FALSE
 	memset(&writeCacheTried[first], 0, num * sizeof(bool));  //
+	if (blockCache) blockCache->invalidate(start, size);
 }
 
 template<class T> void CPUCore<T>::doReset(EmuTime::param time)
@@ -426,7 +438,7 @@ template<class T> void CPUCore<T>::exitCPULoopAsync()
 }
 template<class T> void CPUCore<T>::exitCPULoopSync()
 {
-	assert(Thread::isMainThread());
+	assert(Thread::isEmulationThread());
 	exitLoop = true;
 	T::disableLimit();
 }
@@ -561,6 +573,15 @@ template<class T> void CPUCore<T>::update(const Setting& setting)
 		doSetFreq();
 	} else if (&setting == &traceSetting) {
 		tracingEnabled = traceSetting.getBoolean();
+	} else if (&setting == &blockCacheSetting) {
+		// Never delete the cache, this can be called while the CPU
+		// loop is running (e.g. from a Tcl callback).
+		blockCacheEnabled = blockCacheSetting.getBoolean();
+		if (blockCacheEnabled && !blockCache) {
+			blockCache = make_unique<BlockCache>();
+		} else if (blockCache) {
+			blockCache->clear();
+		}
 	}
 }
 
@@ -863,7 +884,220 @@ template<class T> inline void CPUCore<T>::irq2()
 	T::add(T::CC_IRQ2);
 }
 
-template<class T>
+// Executes one instruction of a BlockCache::Block. Only the opcodes accepted
+// by BlockCache::isBlockOpcode() are handled.
+template<class T> ALWAYS_INLINE II CPUCore<T>::executeBlockOp(byte opcode)
+{
+	switch (opcode) {
+	case 0x00: // nop
+	case 0x40: // ld r,r (same register)
+	case 0x49: // ld r,r (same register)
+	case 0x52: // ld r,r (same register)
+	case 0x5B: // ld r,r (same register)
+	case 0x64: // ld r,r (same register)
+	case 0x6D: // ld r,r (same register)
+	case 0x7F: // ld r,r (same register)
+		return nop();
+	case 0x01: return ld_SS_word<BC,0>();
+	case 0x03: return inc_SS<BC,0>();
+	case 0x04: return inc_R<B,0>();
+	case 0x05: return dec_R<B,0>();
+	case 0x06: return ld_R_byte<B,0>();
+	case 0x07: return rlca();
+	case 0x08: return ex_af_af();
+	case 0x09: return add_SS_TT<HL,BC,0>();
+	case 0x0B: return dec_SS<BC,0>();
+	case 0x0C: return inc_R<C,0>();
+	case 0x0D: return dec_R<C,0>();
+	case 0x0E: return ld_R_byte<C,0>();
+	case 0x0F: return rrca();
+	case 0x11: return ld_SS_word<DE,0>();
+	case 0x13: return inc_SS<DE,0>();
+	case 0x14: return inc_R<D,0>();
+	case 0x15: return dec_R<D,0>();
+	case 0x16: return ld_R_byte<D,0>();
+	case 0x17: return rla();
+	case 0x19: return add_SS_TT<HL,DE,0>();
+	case 0x1B: return dec_SS<DE,0>();
+	case 0x1C: return inc_R<E,0>();
+	case 0x1D: return dec_R<E,0>();
+	case 0x1E: return ld_R_byte<E,0>();
+	case 0x1F: return rra();
+	case 0x21: return ld_SS_word<HL,0>();
+	case 0x23: return inc_SS<HL,0>();
+	case 0x24: return inc_R<H,0>();
+	case 0x25: return dec_R<H,0>();
+	case 0x26: return ld_R_byte<H,0>();
+	case 0x27: return daa();
+	case 0x29: return add_SS_SS<HL,0>();
+	case 0x2B: return dec_SS<HL,0>();
+	case 0x2C: return inc_R<L,0>();
+	case 0x2D: return dec_R<L,0>();
+	case 0x2E: return ld_R_byte<L,0>();
+	case 0x2F: return cpl();
+	case 0x31: return ld_SS_word<SP,0>();
+	case 0x33: return inc_SS<SP,0>();
+	case 0x37: return scf();
+	case 0x39: return add_SS_TT<HL,SP,0>();
+	case 0x3B: return dec_SS<SP,0>();
+	case 0x3C: return inc_R<A,0>();
+	case 0x3D: return dec_R<A,0>();
+	case 0x3E: return ld_R_byte<A,0>();
+	case 0x3F: return ccf();
+	case 0x41: return ld_R_R<B,C,0>();
+	case 0x42: return ld_R_R<B,D,0>();
+	case 0x43: return ld_R_R<B,E,0>();
+	case 0x44: return ld_R_R<B,H,0>();
+	case 0x45: return ld_R_R<B,L,0>();
+	case 0x47: return ld_R_R<B,A,0>();
+	case 0x48: return ld_R_R<C,B,0>();
+	case 0x4A: return ld_R_R<C,D,0>();
+	case 0x4B: return ld_R_R<C,E,0>();
+	case 0x4C: return ld_R_R<C,H,0>();
+	case 0x4D: return ld_R_R<C,L,0>();
+	case 0x4F: return ld_R_R<C,A,0>();
+	case 0x50: return ld_R_R<D,B,0>();
+	case 0x51: return ld_R_R<D,C,0>();
+	case 0x53: return ld_R_R<D,E,0>();
+	case 0x54: return ld_R_R<D,H,0>();
+	case 0x55: return ld_R_R<D,L,0>();
+	case 0x57: return ld_R_R<D,A,0>();
+	case 0x58: return ld_R_R<E,B,0>();
+	case 0x59: return ld_R_R<E,C,0>();
+	case 0x5A: return ld_R_R<E,D,0>();
+	case 0x5C: return ld_R_R<E,H,0>();
+	case 0x5D: return ld_R_R<E,L,0>();
+	case 0x5F: return ld_R_R<E,A,0>();
+	case 0x60: return ld_R_R<H,B,0>();
+	case 0x61: return ld_R_R<H,C,0>();
+	case 0x62: return ld_R_R<H,D,0>();
+	case 0x63: return ld_R_R<H,E,0>();
+	case 0x65: return ld_R_R<H,L,0>();
+	case 0x67: return ld_R_R<H,A,0>();
+	case 0x68: return ld_R_R<L,B,0>();
+	case 0x69: return ld_R_R<L,C,0>();
+	case 0x6A: return ld_R_R<L,D,0>();
+	case 0x6B: return ld_R_R<L,E,0>();
+	case 0x6C: return ld_R_R<L,H,0>();
+	case 0x6F: return ld_R_R<L,A,0>();
+	case 0x78: return ld_R_R<A,B,0>();
+	case 0x79: return ld_R_R<A,C,0>();
+	case 0x7A: return ld_R_R<A,D,0>();
+	case 0x7B: return ld_R_R<A,E,0>();
+	case 0x7C: return ld_R_R<A,H,0>();
+	case 0x7D: return ld_R_R<A,L,0>();
+	case 0x80: return add_a_R<B,0>();
+	case 0x81: return add_a_R<C,0>();
+	case 0x82: return add_a_R<D,0>();
+	case 0x83: return add_a_R<E,0>();
+	case 0x84: return add_a_R<H,0>();
+	case 0x85: return add_a_R<L,0>();
+	case 0x87: return add_a_a();
+	case 0x88: return adc_a_R<B,0>();
+	case 0x89: return adc_a_R<C,0>();
+	case 0x8A: return adc_a_R<D,0>();
+	case 0x8B: return adc_a_R<E,0>();
+	case 0x8C: return adc_a_R<H,0>();
+	case 0x8D: return adc_a_R<L,0>();
+	case 0x8F: return adc_a_a();
+	case 0x90: return sub_R<B,0>();
+	case 0x91: return sub_R<C,0>();
+	case 0x92: return sub_R<D,0>();
+	case 0x93: return sub_R<E,0>();
+	case 0x94: return sub_R<H,0>();
+	case 0x95: return sub_R<L,0>();
+	case 0x97: return sub_a();
+	case 0x98: return sbc_a_R<B,0>();
+	case 0x99: return sbc_a_R<C,0>();
+	case 0x9A: return sbc_a_R<D,0>();
+	case 0x9B: return sbc_a_R<E,0>();
+	case 0x9C: return sbc_a_R<H,0>();
+	case 0x9D: return sbc_a_R<L,0>();
+	case 0x9F: return sbc_a_a();
+	case 0xA0: return and_R<B,0>();
+	case 0xA1: return and_R<C,0>();
+	case 0xA2: return and_R<D,0>();
+	case 0xA3: return and_R<E,0>();
+	case 0xA4: return and_R<H,0>();
+	case 0xA5: return and_R<L,0>();
+	case 0xA7: return and_a();
+	case 0xA8: return xor_R<B,0>();
+	case 0xA9: return xor_R<C,0>();
+	case 0xAA: return xor_R<D,0>();
+	case 0xAB: return xor_R<E,0>();
+	case 0xAC: return xor_R<H,0>();
+	case 0xAD: return xor_R<L,0>();
+	case 0xAF: return xor_a();
+	case 0xB0: return or_R<B,0>();
+	case 0xB1: return or_R<C,0>();
+	case 0xB2: return or_R<D,0>();
+	case 0xB3: return or_R<E,0>();
+	case 0xB4: return or_R<H,0>();
+	case 0xB5: return or_R<L,0>();
+	case 0xB7: return or_a();
+	case 0xB8: return cp_R<B,0>();
+	case 0xB9: return cp_R<C,0>();
+	case 0xBA: return cp_R<D,0>();
+	case 0xBB: return cp_R<E,0>();
+	case 0xBC: return cp_R<H,0>();
+	case 0xBD: return cp_R<L,0>();
+	case 0xBF: return cp_a();
+	case 0xC6: return add_a_byte();
+	case 0xCE: return adc_a_byte();
+	case 0xD6: return sub_byte();
+	case 0xD9: return exx();
+	case 0xDE: return sbc_a_byte();
+	case 0xE6: return and_byte();
+	case 0xEB: return ex_de_hl();
+	case 0xEE: return xor_byte();
+	case 0xF6: return or_byte();
+	case 0xFE: return cp_byte();
+	default:
+		UNREACHABLE; return nop();
+	}
+}
+
+template<class T> inline void CPUCore<T>::executeBlock()
+{
+	unsigned address = getPC();
+	const byte* line = readCacheLine[address >> CacheLine::BITS];
+	if (!line) return;
+	auto* block = blockCache->find(address, line);
+	if (!block) return;
+
+	if (block->timed && !T::isR800() &&
+	    !T::limitReachedAfter(block->cycles - block->lastCycles)) {
+		// The interpreter would execute the whole block before the
+		// next sync point, so no need to check in between.
+		for (auto& op : block->ops) {
+			II ii = executeBlockOp(op.opcode);
+			setPC(getPC() + ii.length);
+		}
+		T::add(block->cycles);
+		incR(byte(block->ops.size()));
+		return;
+	}
+
+	// Exactly the same steps as the interpreter. Also used to learn the
+	// duration of the instructions (and on R800 because of the refresh
+	// cycles that must be inserted between the instructions and the
+	// page-break and extra memory delays of the opcode fetch).
+	for (auto& op : block->ops) {
+		unsigned address = getPC();
+		T::template PRE_MEM<false, false>(address);
+		T::template POST_MEM<      false>(address);
+		incR(1);
+		II ii = executeBlockOp(op.opcode);
+		setPC(getPC() + ii.length);
+		T::add(ii.cycles);
+		T::R800Refresh(*this);
+		op.cycles = ii.cycles;
+		if (T::limitReached()) return;
+	}
+	BlockCache::setTimed(*block);
+}
+
+template<class T> template<bool BLOCKS>
 void CPUCore<T>::executeInstructions()
 {
 	checkNoCurrentFlags();
@@ -912,6 +1146,7 @@ void CPUCore<T>::executeInstructions()
 	T::add(ii.cycles); \
 	T::R800Refresh(*this); \
 	if (likely(!T::limitReached())) { \
+		if (BLOCKS) goto start; \
 		incR(1); \
 		unsigned address = getPC(); \
 		const byte* line = readCacheLine[address >> CacheLine::BITS]; \
@@ -973,9 +1208,11 @@ void CPUCore<T>::executeInstructions()
 
 #endif // USE_COMPUTED_GOTO
 
-#ifndef USE_COMPUTED_GOTO
 start:
-#endif
+	if (BLOCKS) {
+		executeBlock();
+		if (T::limitReached()) return;
+	}
 	unsigned ixy; // for dd_cb/fd_cb
 	byte opcodeMain = RDMEM_OPCODE<0>(T::CC_MAIN);
 	incR(1);
@@ -2463,12 +2700,18 @@ xx_cb: {
 template<class T> inline void CPUCore<T>::cpuTracePre()
 {
 	start_pc = getPC();
+	if (unlikely(profiler.isActive())) {
+		profilePre();
+	}
 }
 template<class T> inline void CPUCore<T>::cpuTracePost()
 {
 	if (unlikely(tracingEnabled)) {
 		cpuTracePost_slow();
 	}
+	if (unlikely(profiler.isActive())) {
+		profilePost();
+	}
 }
 template<class T> void CPUCore<T>::cpuTracePost_slow()
 {
@@ -2487,6 +2730,47 @@ template<class T> void CPUCore<T>::cpuTracePost_slow()
 	     << std::endl << std::dec;
 }
 
+template<class T> void CPUCore<T>::profilePre()
+{
+	profileTime = T::getTimeFast();
+	profileSP = getSP();
+	profileOpcode[0] = interface->peekMem(start_pc, profileTime);
+	if (profileOpcode[0] == 0xED) {
+		profileOpcode[1] = interface->peekMem(start_pc + 1, profileTime);
+	}
+}
+template<class T> void CPUCore<T>::profilePost()
+{
+	unsigned cycles = (T::getTimeFast() - profileTime).getTicksAt(freq);
+	profiler.instruction(start_pc, cycles);
+
+	// Only count a call or return when the stack pointer moved as
+	// expected, so conditional calls and returns that are not taken
+	// are ignored.
+	byte op = profileOpcode[0];
+	word sp = getSP();
+	if ((op == 0xCD) ||          // call nn
+	    ((op & 0xC7) == 0xC4) || // call cc,nn
+	    ((op & 0xC7) == 0xC7)) { // rst n
+		if (sp == word(profileSP - 2)) {
+			profiler.call(getPC(), sp);
+		}
+	} else if ((op == 0xC9) ||          // ret
+	           ((op & 0xC7) == 0xC0) || // ret cc
+	           ((op == 0xED) && ((profileOpcode[1] & 0xC7) == 0x45))) { // retn/reti
+		if (sp == word(profileSP + 2)) {
+			profiler.ret(profileSP);
+		}
+	}
+}
+template<class T> void CPUCore<T>::profileInterrupt(word sp)
+{
+	// the interrupt pushed the return address, like a call
+	if (getSP() == word(sp - 2)) {
+		profiler.call(getPC(), getSP());
+	}
+}
+
 template<class T> void CPUCore<T>::executeSlow()
 {
 	if (unlikely(false && nmiEdge)) {
@@ -2517,6 +2801,7 @@ template<class T> void CPUCore<T>::executeSlow()
 			setF(getF() & ~V_FLAG);
 		}
 		IRQAccept.signal();
+		word sp = getSP();
 		switch (getIM()) {
 			case 0: irq0();
 				break;
@@ -2527,6 +2812,9 @@ template<class T> void CPUCore<T>::executeSlow()
 			default:
 				UNREACHABLE;
 		}
+		if (unlikely(profiler.isActive())) {
+			profileInterrupt(sp);
+		}
 	} else if (unlikely(getHALT())) {
 		// in halt mode
 		incR(T::advanceHalt(T::haltStates(), scheduler.getNext()));
@@ -2534,7 +2822,7 @@ template<class T> void CPUCore<T>::executeSlow()
 	} else {
 		cpuTracePre();
 		assert(T::limitReached()); // we want only one instruction
-		executeInstructions();
+		executeInstructions<false>();
 		endInstruction();
 
 		if (T::isR800()) {
@@ -2594,8 +2882,9 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 	// deciding between executeFast() and executeSlow() (because a
 	// SyncPoint could set an IRQ and then we must choose executeSlow())
 	if (fastForward ||
-	    (!interface->anyBreakPoints() && !tracingEnabled)) {
-		// fast path, no breakpoints, no tracing
+	    (!interface->anyBreakPoints() && !tracingEnabled &&
+	     !profiler.isActive())) {
+		// fast path, no breakpoints, no tracing, no profiling
 		while (!needExitCPULoop()) {
 			if (slowInstructions) {
 				--slowInstructions;
@@ -2606,7 +2895,11 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 					T::enableLimit(); // does CPUClock::sync()
 					if (likely(!T::limitReached())) {
 						// multiple instructions
-						executeInstructions();
+						if (blockCacheEnabled) {
+							executeInstructions<true>();
+						} else {
+							executeInstructions<false>();
+						}
 						// note: pipeline only shifted one
 						// step for multiple instructions
 						endInstruction();
@@ -2625,7 +2918,7 @@ template<class T> void CPUCore<T>::execute2(bool fastForward)
 			if (slowInstructions == 0) {
 				cpuTracePre();
 				assert(T::limitReached()); // only one instruction
-				executeInstructions();
+				executeInstructions<false>();
 				endInstruction();
 				cpuTracePost();
 			} else {
@@ -2,6 +2,7 @@
 #define CPUCORE_HH
 
 #include "CPURegs.hh"
+#include "BlockCache.hh"
 #include "CacheLine.hh"
 #include "Probe.hh"
 #include "EmuTime.hh"
@@ -17,6 +18,7 @@
 namespace openmsx {
 
 class MSXCPUInterface;
+class CPUProfiler;
 class Scheduler;
 class MSXMotherBoard;
 class TclCallback;
@@ -45,7 +47,7 @@ class CPUCore final : public CPUBase, public CPURegs, public CPU_POLICY
 {
 public:
 	CPUCore(MSXMotherBoard& motherboard, const std::string& name,
-	        const BooleanSetting& traceSetting,
+	        const BooleanSetting& traceSetting, CPUProfiler& profiler,
 	        TclCallback& diHaltCallback, EmuTime::param time);
 
 	void setInterface(MSXCPUInterface* interf) { interface = interf; }
@@ -133,6 +135,7 @@ private:
 	MSXCPUInterface* interface;
 
 	const BooleanSetting& traceSetting;
+	CPUProfiler& profiler;
 	TclCallback& diHaltCallback;
 
 	Probe<int> IRQStatus;
@@ -143,6 +146,11 @@ private:
 	IntegerSetting freqValue;
 	unsigned freq;
 
+	// basic block cache, only created when first enabled
+	BooleanSetting blockCacheSetting;
+	std::unique_ptr<BlockCache> blockCache;
+	bool blockCacheEnabled;
+
 	// state machine variables
 	int slowInstructions;
 	int NMIStatus;
@@ -159,6 +167,11 @@ private:
 	/** In sync with traceSetting.getBoolean(). */
 	bool tracingEnabled;
 
+	// state at the start of the current instruction, only for profiling
+	EmuTime profileTime;
+	word profileSP;
+	byte profileOpcode[2];
+
 	/** 'normal' Z80 and Z80 in a turboR behave slightly different */
 	const bool isTurboR;
 
@@ -166,6 +179,9 @@ private:
 	inline void cpuTracePre();
 	inline void cpuTracePost();
 	void cpuTracePost_slow();
+	void profilePre();
+	void profilePost();
+	void profileInterrupt(word sp);
 
 	inline byte READ_PORT(unsigned port, unsigned cc);
 	inline void WRITE_PORT(unsigned port, byte value, unsigned cc);
@@ -208,7 +224,9 @@ private:
 	template<bool PRE_PB, bool POST_PB>
 	inline void WR_WORD_rev (unsigned address, unsigned value, unsigned cc);
 
-	void executeInstructions();
+	template<bool BLOCKS> void executeInstructions();
+	inline void executeBlock();
+	inline II executeBlockOp(byte opcode);
 	inline void nmi();
 	inline void irq0();
 	inline void irq1();
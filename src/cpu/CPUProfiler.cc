@@ -0,0 +1,221 @@
+#include "CPUProfiler.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXMemoryMapper.hh"
+#include "Debugger.hh"
+#include "Debuggable.hh"
+#include "TclObject.hh"
+#include "StringOp.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <iterator>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+// Calls that never return (e.g. because the stack pointer is reinitialized)
+// are cleaned up when the stack is reused. This is only a safety net.
+static const unsigned MAX_DEPTH = 1024;
+
+
+CPUProfiler::Page::Page(unsigned key_)
+	: key(key_), counters(0x4000, Counter{0, 0})
+{
+}
+
+
+CPUProfiler::CPUProfiler(MSXMotherBoard& motherBoard_)
+	: motherBoard(motherBoard_)
+	, totalCycles(0)
+	, active(false)
+{
+	invalidate(0x0000, 0x10000);
+}
+
+CPUProfiler::~CPUProfiler() = default;
+
+void CPUProfiler::start()
+{
+	clear();
+	active = true;
+}
+
+void CPUProfiler::stop()
+{
+	active = false;
+}
+
+void CPUProfiler::clear()
+{
+	invalidate(0x0000, 0x10000);
+	pages.clear();
+	stack.clear();
+	edges.clear();
+	totalCycles = 0;
+}
+
+void CPUProfiler::invalidate(unsigned start, unsigned size)
+{
+	unsigned first = start / CacheLine::SIZE;
+	unsigned num = (size + CacheLine::SIZE - 1) / CacheLine::SIZE;
+	std::fill_n(&cache[first], std::min(num, CacheLine::NUM - first), nullptr);
+}
+
+unsigned CPUProfiler::getPageKey(unsigned address) const
+{
+	auto& interface = motherBoard.getCPUInterface();
+	unsigned page = address >> 14;
+	unsigned ps = interface.getPrimarySlot(page);
+	bool expanded = interface.isExpanded(ps);
+	unsigned ss = expanded ? interface.getSecondarySlot(page) : 0;
+
+	// Same as the 'pc_in_slot' script: the segment of a memory mapper or
+	// else the block of a ROM mapper.
+	unsigned segment = 0;
+	auto& device = interface.getVisibleMSXDevice(page);
+	if (auto* mapper = dynamic_cast<MSXMemoryMapper*>(&device)) {
+		segment = mapper->getSelectedSegment(page);
+	} else if (auto* blocks = motherBoard.getDebugger().findDebuggable(
+	                                 device.getName() + " romblocks")) {
+		segment = blocks->read(address);
+	}
+	return (expanded << 12) | (ps << 10) | (ss << 8) | (segment & 0xFF);
+}
+
+CPUProfiler::Page* CPUProfiler::lookup(unsigned address)
+{
+	unsigned key = (getPageKey(address) << 2) | (address >> 14);
+	auto& page = pages[key];
+	if (!page) page = make_unique<Page>(key);
+	cache[address >> CacheLine::BITS] = page.get();
+	return page.get();
+}
+
+CPUProfiler::Location CPUProfiler::getLocation(unsigned address)
+{
+	Page* page = cache[address >> CacheLine::BITS];
+	if (!page) page = lookup(address);
+	return ((page->key >> 2) << 16) | address;
+}
+
+void CPUProfiler::call(unsigned target, unsigned sp)
+{
+	// frames at or above the new return address were abandoned
+	while (!stack.empty() && (stack.back().sp <= sp)) {
+		endFrame();
+	}
+	if (stack.size() == MAX_DEPTH) {
+		stack.erase(stack.begin());
+	}
+	stack.push_back(Frame{getLocation(target), sp, totalCycles});
+}
+
+void CPUProfiler::ret(unsigned sp)
+{
+	while (!stack.empty() && (stack.back().sp < sp)) {
+		endFrame();
+	}
+	if (!stack.empty() && (stack.back().sp == sp)) {
+		endFrame();
+	}
+	// else: not a return from a call that we've seen (e.g. 'push hl; ret')
+}
+
+void CPUProfiler::endFrame()
+{
+	Frame frame = stack.back();
+	stack.pop_back();
+	Location caller = stack.empty() ? TOP_LEVEL : stack.back().callee;
+	auto& edge = edges[std::make_pair(caller, frame.callee)];
+	++edge.calls;
+	edge.cycles += totalCycles - frame.startCycles;
+}
+
+vector<CPUProfiler::Entry> CPUProfiler::getEntries() const
+{
+	vector<Entry> result;
+	for (auto& p : pages) {
+		auto& page = *p.second;
+		unsigned base = ((page.key >> 2) << 16) | ((page.key & 3) << 14);
+		for (unsigned i = 0; i < 0x4000; ++i) {
+			auto& counter = page.counters[i];
+			if (counter.count) {
+				result.push_back(Entry{base | i, counter});
+			}
+		}
+	}
+	return result;
+}
+
+TclObject CPUProfiler::formatLocation(Location location)
+{
+	TclObject result;
+	bool expanded = (location >> 28) & 1;
+	result.addListElement(int((location >> 26) & 3));
+	if (expanded) {
+		result.addListElement(int((location >> 24) & 3));
+	} else {
+		result.addListElement("X");
+	}
+	result.addListElement(int((location >> 16) & 0xFF));
+	result.addListElement(int(location & 0xFFFF));
+	return result;
+}
+
+static void addCounters(TclObject& result, const TclObject& location,
+                        uint64_t count, uint64_t cycles)
+{
+	TclObject line;
+	line.addListElement(location);
+	line.addListElement(StringOp::toString(count));
+	line.addListElement(StringOp::toString(cycles));
+	result.addListElement(line);
+}
+
+void CPUProfiler::dump(TclObject& result) const
+{
+	for (auto& e : getEntries()) {
+		addCounters(result, formatLocation(e.location),
+		            e.counter.count, e.counter.cycles);
+	}
+}
+
+void CPUProfiler::top(TclObject& result, unsigned n, bool byCount) const
+{
+	auto entries = getEntries();
+	n = std::min<unsigned>(n, entries.size());
+	auto middle = entries.begin() + n;
+	if (byCount) {
+		std::partial_sort(entries.begin(), middle, entries.end(),
+			[](const Entry& x, const Entry& y) {
+				return x.counter.count > y.counter.count; });
+	} else {
+		std::partial_sort(entries.begin(), middle, entries.end(),
+			[](const Entry& x, const Entry& y) {
+				return x.counter.cycles > y.counter.cycles; });
+	}
+	for (auto it = entries.begin(); it != middle; ++it) {
+		addCounters(result, formatLocation(it->location),
+		            it->counter.count, it->counter.cycles);
+	}
+}
+
+void CPUProfiler::callGraph(TclObject& result) const
+{
+	for (auto& e : edges) {
+		TclObject line;
+		if (e.first.first == TOP_LEVEL) {
+			line.addListElement("");
+		} else {
+			line.addListElement(formatLocation(e.first.first));
+		}
+		line.addListElement(formatLocation(e.first.second));
+		line.addListElement(StringOp::toString(e.second.calls));
+		line.addListElement(StringOp::toString(e.second.cycles));
+		result.addListElement(line);
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,124 @@
+#ifndef CPUPROFILER_HH
+#define CPUPROFILER_HH
+
+#include "CacheLine.hh"
+#include "openmsx.hh"
+#include "likely.hh"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class TclObject;
+
+/** Collects the number of executed instructions and the number of CPU
+  * cycles spent per instruction address, see 'debug profile'.
+  *
+  * An address is identified by the selected (primary and secondary) slot,
+  * the selected segment (memory mapper or ROM mapper block, 0 if the
+  * device has no mapper) and the value of the program counter. The
+  * counters are stored in flat arrays, one per 16kB page of such a
+  * slot/segment combination. Looking up this array is only done when the
+  * memory layout changed (see invalidate()), so the cost per instruction
+  * is a table lookup and two additions.
+  *
+  * CALL/RST/RET instructions and interrupts are tracked on a shadow stack
+  * to also collect the number of calls and the inclusive duration per
+  * (caller, callee) pair.
+  */
+class CPUProfiler
+{
+public:
+	/** Identifies an instruction address: slot, segment and PC. */
+	using Location = uint32_t;
+	static const Location TOP_LEVEL = 0xFFFFFFFF;
+
+	explicit CPUProfiler(MSXMotherBoard& motherBoard);
+	~CPUProfiler();
+
+	CPUProfiler(const CPUProfiler&) = delete;
+	CPUProfiler& operator=(const CPUProfiler&) = delete;
+
+	/** Start collecting. Previously collected results are discarded. */
+	void start();
+	/** Stop collecting, the results remain available. */
+	void stop();
+	/** Discard all results. */
+	void clear();
+	bool isActive() const { return active; }
+
+	/** Forget the cached mapping from address to counters, should be
+	  * called whenever the memory layout in this range changes. */
+	void invalidate(unsigned start, unsigned size);
+
+	/** An instruction at the given address was executed. */
+	inline void instruction(unsigned pc, unsigned cycles) {
+		Page* page = cache[pc >> CacheLine::BITS];
+		if (unlikely(!page)) page = lookup(pc);
+		auto& counter = page->counters[pc & 0x3FFF];
+		++counter.count;
+		counter.cycles += cycles;
+		totalCycles += cycles;
+	}
+	/** A CALL, RST or interrupt jumped to 'target', after the return
+	  * address was pushed to 'sp'. */
+	void call(unsigned target, unsigned sp);
+	/** A RET instruction popped the return address from 'sp'. */
+	void ret(unsigned sp);
+
+	/** All addresses with at least one executed instruction, see
+	  * 'help debug profile' for the format. */
+	void dump(TclObject& result) const;
+	/** The 'n' addresses with the highest number of cycles (or the
+	  * highest number of executed instructions when 'byCount' is set). */
+	void top(TclObject& result, unsigned n, bool byCount) const;
+	/** All (caller, callee) pairs. */
+	void callGraph(TclObject& result) const;
+
+private:
+	struct Counter {
+		uint64_t count;
+		uint64_t cycles;
+	};
+	struct Page {
+		explicit Page(unsigned key);
+		const unsigned key; // slot, segment and page, see getPageKey()
+		std::vector<Counter> counters; // indexed by pc & 0x3FFF
+	};
+	struct Frame {
+		Location callee;
+		unsigned sp;
+		uint64_t startCycles;
+	};
+	struct Edge {
+		uint64_t calls;
+		uint64_t cycles;
+	};
+	struct Entry {
+		Location location;
+		Counter counter;
+	};
+
+	Page* lookup(unsigned address);
+	unsigned getPageKey(unsigned address) const;
+	Location getLocation(unsigned address);
+	void endFrame();
+	std::vector<Entry> getEntries() const;
+	static TclObject formatLocation(Location location);
+
+	MSXMotherBoard& motherBoard;
+	std::map<unsigned, std::unique_ptr<Page>> pages;
+	Page* cache[CacheLine::NUM];
+	std::vector<Frame> stack;
+	std::map<std::pair<Location, Location>, Edge> edges;
+	uint64_t totalCycles;
+	bool active;
+};
+
+} // namespace openmsx
+
+#endif
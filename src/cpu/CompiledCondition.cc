@@ -0,0 +1,580 @@
+#include "CompiledCondition.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "CPURegs.hh"
+#include "StringOp.hh"
+#include "unreachable.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using std::vector;
+
+namespace openmsx {
+
+namespace {
+
+// Thrown when the expression uses something we don't (want to) support.
+// The caller will then fall back to full Tcl evaluation.
+struct Unsupported {};
+
+// Same register names and numbering as the 'reg' Tcl proc (and thus also as
+// the "CPU regs" debuggable).
+static const char* const REG8_NAMES[] = {
+	"A",   "F",   "B",   "C",   "D",   "E",   "H",   "L",
+	"A2",  "F2",  "B2",  "C2",  "D2",  "E2",  "H2",  "L2",
+	"IXH", "IXL", "IYH", "IYL", "PCH", "PCL", "SPH", "SPL",
+	"I",   "R",   "IM",  "IFF",
+};
+static const char* const REG16_NAMES[] = {
+	"AF",  "BC",  "DE",  "HL",  "AF2", "BC2", "DE2", "HL2",
+	"IX",  "IY",  "PC",  "SP",
+};
+
+static inline bool isSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+// Marker for the 'X' (=don't care) argument of pc_in_slot.
+static const int SLOT_ANY = 0xFF;
+
+class Parser
+{
+public:
+	explicit Parser(string_ref str_)
+		: str(str_), pos(0), depth(0), maxDepth(0) {}
+
+	vector<CompiledCondition::Instr> parse()
+	{
+		parseLogicalOr();
+		skipSpace();
+		if (pos != str.size()) throw Unsupported();
+		assert(depth == 1);
+		return std::move(code);
+	}
+
+private:
+	using Instr = CompiledCondition::Instr;
+	using OpCode = CompiledCondition::OpCode;
+
+	void skipSpace()
+	{
+		while ((pos < str.size()) && isSpace(str[pos])) ++pos;
+	}
+
+	// Returns the (longest) operator at the current position, or an
+	// empty string if there is none.
+	string_ref peekOperator()
+	{
+		skipSpace();
+		static const char* const OPERATORS[] = {
+			"||", "&&", "==", "!=", "<=", ">=", "<<", ">>", "**",
+			"|", "&", "^", "<", ">", "+", "-", "*", "/", "%",
+			"!", "~",
+		};
+		string_ref rest = str.substr(pos);
+		for (auto& op : OPERATORS) {
+			if (rest.starts_with(op)) return op;
+		}
+		return string_ref();
+	}
+
+	bool acceptOperator(string_ref op)
+	{
+		string_ref next = peekOperator();
+		if (next != op) return false;
+		pos += op.size();
+		return true;
+	}
+
+	void emit(OpCode op, int64_t arg = 0)
+	{
+		// keep track of the required stack size
+		switch (op) {
+		case CompiledCondition::PUSH:
+		case CompiledCondition::REG8:
+		case CompiledCondition::REG16:
+		case CompiledCondition::IN_SLOT:
+			++depth;
+			break;
+		case CompiledCondition::PEEK:
+		case CompiledCondition::PEEK16:
+		case CompiledCondition::NEG:
+		case CompiledCondition::BITNOT:
+		case CompiledCondition::LNOT:
+		case CompiledCondition::BOOL:
+			break;
+		case CompiledCondition::JUMP_IF_FALSE:
+		case CompiledCondition::JUMP_IF_TRUE:
+			// pops when the jump is not taken, the depth at
+			// the jump target is restored in patchJump()
+			--depth;
+			break;
+		default:
+			// binary operators
+			--depth;
+			break;
+		}
+		maxDepth = std::max(maxDepth, depth);
+		if (maxDepth > CompiledCondition::MAX_STACK) throw Unsupported();
+		code.push_back(Instr{op, arg});
+	}
+
+	void patchJump(size_t jumpIdx)
+	{
+		code[jumpIdx].arg = code.size();
+	}
+
+	// Operator precedence follows the Tcl 'expr' command (from low to high):
+	//   ||   &&   |   ^   &   == !=   < > <= >=   << >>   + -   * / %
+	//   unary - + ~ !
+	void parseLogicalOr()
+	{
+		parseLogicalAnd();
+		while (acceptOperator("||")) {
+			size_t jump = code.size();
+			emit(CompiledCondition::JUMP_IF_TRUE);
+			parseLogicalAnd();
+			emit(CompiledCondition::BOOL);
+			patchJump(jump);
+		}
+	}
+	void parseLogicalAnd()
+	{
+		parseBitOr();
+		while (acceptOperator("&&")) {
+			size_t jump = code.size();
+			emit(CompiledCondition::JUMP_IF_FALSE);
+			parseBitOr();
+			emit(CompiledCondition::BOOL);
+			patchJump(jump);
+		}
+	}
+	void parseBitOr()
+	{
+		parseBitXor();
+		while (acceptOperator("|")) {
+			parseBitXor(); emit(CompiledCondition::OR);
+		}
+	}
+	void parseBitXor()
+	{
+		parseBitAnd();
+		while (acceptOperator("^")) {
+			parseBitAnd(); emit(CompiledCondition::XOR);
+		}
+	}
+	void parseBitAnd()
+	{
+		parseEquality();
+		while (acceptOperator("&")) {
+			parseEquality(); emit(CompiledCondition::AND);
+		}
+	}
+	void parseEquality()
+	{
+		parseRelational();
+		while (true) {
+			if (acceptOperator("==")) {
+				parseRelational(); emit(CompiledCondition::EQ);
+			} else if (acceptOperator("!=")) {
+				parseRelational(); emit(CompiledCondition::NE);
+			} else {
+				break;
+			}
+		}
+	}
+	void parseRelational()
+	{
+		parseShift();
+		while (true) {
+			if (acceptOperator("<=")) {
+				parseShift(); emit(CompiledCondition::LE);
+			} else if (acceptOperator(">=")) {
+				parseShift(); emit(CompiledCondition::GE);
+			} else if (acceptOperator("<")) {
+				parseShift(); emit(CompiledCondition::LT);
+			} else if (acceptOperator(">")) {
+				parseShift(); emit(CompiledCondition::GT);
+			} else {
+				break;
+			}
+		}
+	}
+	void parseShift()
+	{
+		parseAdditive();
+		while (true) {
+			if (acceptOperator("<<")) {
+				parseAdditive(); emit(CompiledCondition::SHL);
+			} else if (acceptOperator(">>")) {
+				parseAdditive(); emit(CompiledCondition::SHR);
+			} else {
+				break;
+			}
+		}
+	}
+	void parseAdditive()
+	{
+		parseMultiplicative();
+		while (true) {
+			if (acceptOperator("+")) {
+				parseMultiplicative(); emit(CompiledCondition::ADD);
+			} else if (acceptOperator("-")) {
+				parseMultiplicative(); emit(CompiledCondition::SUB);
+			} else {
+				break;
+			}
+		}
+	}
+	void parseMultiplicative()
+	{
+		parseUnary();
+		while (true) {
+			if (acceptOperator("*")) {
+				parseUnary(); emit(CompiledCondition::MUL);
+			} else if (acceptOperator("/")) {
+				parseUnary(); emit(CompiledCondition::DIV);
+			} else if (acceptOperator("%")) {
+				parseUnary(); emit(CompiledCondition::MOD);
+			} else {
+				break;
+			}
+		}
+	}
+	void parseUnary()
+	{
+		if (acceptOperator("-")) {
+			parseUnary(); emit(CompiledCondition::NEG);
+		} else if (acceptOperator("+")) {
+			parseUnary();
+		} else if (acceptOperator("~")) {
+			parseUnary(); emit(CompiledCondition::BITNOT);
+		} else if (acceptOperator("!")) {
+			parseUnary(); emit(CompiledCondition::LNOT);
+		} else {
+			parsePrimary();
+		}
+	}
+	void parsePrimary()
+	{
+		skipSpace();
+		if (pos == str.size()) throw Unsupported();
+		char c = str[pos];
+		if (c == '(') {
+			++pos;
+			parseLogicalOr();
+			skipSpace();
+			if ((pos == str.size()) || (str[pos] != ')')) {
+				throw Unsupported();
+			}
+			++pos;
+		} else if (c == '[') {
+			++pos;
+			parseCommand();
+		} else if (('0' <= c) && (c <= '9')) {
+			emit(CompiledCondition::PUSH, parseNumber(parseBareWord()));
+		} else {
+			// variables, strings, functions, ...
+			throw Unsupported();
+		}
+	}
+
+	// Characters that end a bare word, both in an expression and in a
+	// command argument list.
+	static bool isWordEnd(char c)
+	{
+		return isSpace(c) || (strchr("[](){}\"$;|&^<>=!+-*/%~", c) != nullptr);
+	}
+
+	string_ref parseBareWord()
+	{
+		skipSpace();
+		auto begin = pos;
+		while ((pos < str.size()) && !isWordEnd(str[pos])) ++pos;
+		return str.substr(begin, pos - begin);
+	}
+
+	static int64_t parseNumber(string_ref s)
+	{
+		// Only accept integer formats that have the same meaning in all
+		// Tcl versions: no octal with a leading zero, no floats.
+		if (s.empty()) throw Unsupported();
+		unsigned base = 10;
+		if ((s.size() > 2) && (s[0] == '0')) {
+			switch (s[1]) {
+			case 'x': case 'X': base = 16; break;
+			case 'b': case 'B': base =  2; break;
+			case 'o': case 'O': base =  8; break;
+			default: throw Unsupported();
+			}
+			s.remove_prefix(2);
+		} else if ((s.size() > 1) && (s[0] == '0')) {
+			throw Unsupported();
+		}
+		int64_t result = 0;
+		for (char c : s) {
+			unsigned digit;
+			if      (('0' <= c) && (c <= '9')) digit = c - '0';
+			else if (('a' <= c) && (c <= 'f')) digit = c - 'a' + 10;
+			else if (('A' <= c) && (c <= 'F')) digit = c - 'A' + 10;
+			else throw Unsupported();
+			if (digit >= base) throw Unsupported();
+			result = result * base + digit;
+			if (result > 0xFFFFFFFFLL) throw Unsupported();
+		}
+		return result;
+	}
+
+	// A single argument of a command: either a literal integer or a
+	// nested command.
+	void parseArgument()
+	{
+		skipSpace();
+		if ((pos < str.size()) && (str[pos] == '[')) {
+			++pos;
+			parseCommand();
+		} else {
+			emit(CompiledCondition::PUSH, parseNumber(parseBareWord()));
+		}
+	}
+
+	int parseSlotArgument()
+	{
+		string_ref w = parseBareWord();
+		if (w == "X") return SLOT_ANY;
+		int64_t slot = parseNumber(w);
+		if (slot > 3) throw Unsupported();
+		return int(slot);
+	}
+
+	bool atCommandEnd()
+	{
+		skipSpace();
+		if (pos == str.size()) throw Unsupported();
+		if (str[pos] != ']') return false;
+		++pos;
+		return true;
+	}
+
+	void parseOptionalMemory()
+	{
+		if (atCommandEnd()) return;
+		string_ref debuggable = parseBareWord();
+		if ((debuggable != "memory") || !atCommandEnd()) {
+			throw Unsupported();
+		}
+	}
+
+	void parseCommand()
+	{
+		string_ref name = parseBareWord();
+		if (name == "reg") {
+			string_ref reg = parseBareWord();
+			if (!atCommandEnd()) throw Unsupported();
+			StringOp::casecmp cmp;
+			auto it8 = std::find_if(std::begin(REG8_NAMES), std::end(REG8_NAMES),
+				[&](const char* r) { return cmp(reg, r); });
+			if (it8 != std::end(REG8_NAMES)) {
+				emit(CompiledCondition::REG8, it8 - std::begin(REG8_NAMES));
+				return;
+			}
+			auto it16 = std::find_if(std::begin(REG16_NAMES), std::end(REG16_NAMES),
+				[&](const char* r) { return cmp(reg, r); });
+			if (it16 != std::end(REG16_NAMES)) {
+				emit(CompiledCondition::REG16, 2 * (it16 - std::begin(REG16_NAMES)));
+				return;
+			}
+			throw Unsupported();
+		} else if ((name == "peek") || (name == "peek8") || (name == "peek_u8")) {
+			parseArgument();
+			emit(CompiledCondition::PEEK);
+			parseOptionalMemory();
+		} else if ((name == "peek16") || (name == "peek16_LE") || (name == "peek_u16")) {
+			parseArgument();
+			emit(CompiledCondition::PEEK16);
+			parseOptionalMemory();
+		} else if (name == "pc_in_slot") {
+			// Only the primary and secondary slot, checking the
+			// mapper segment is left to Tcl.
+			int ps = parseSlotArgument();
+			int ss = SLOT_ANY;
+			if (!atCommandEnd()) {
+				ss = parseSlotArgument();
+				if (!atCommandEnd()) throw Unsupported();
+			}
+			emit(CompiledCondition::IN_SLOT, ps | (ss << 8));
+		} else {
+			throw Unsupported();
+		}
+	}
+
+	string_ref str;
+	string_ref::size_type pos;
+	vector<Instr> code;
+	unsigned depth;
+	unsigned maxDepth;
+};
+
+} // namespace
+
+
+std::unique_ptr<CompiledCondition> CompiledCondition::compile(string_ref expression)
+{
+	try {
+		Parser parser(expression);
+		return std::unique_ptr<CompiledCondition>(
+			new CompiledCondition(parser.parse()));
+	} catch (Unsupported&) {
+		return nullptr;
+	}
+}
+
+CompiledCondition::CompiledCondition(vector<Instr> code_)
+	: code(std::move(code_))
+{
+}
+
+// Tcl integer division rounds towards negative infinity and the remainder
+// has the same sign as the divisor.
+static int64_t floorDiv(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	if (((a % b) != 0) && ((a < 0) != (b < 0))) --q;
+	return q;
+}
+static int64_t floorMod(int64_t a, int64_t b)
+{
+	int64_t r = a % b;
+	if ((r != 0) && ((r < 0) != (b < 0))) r += b;
+	return r;
+}
+
+// Results that don't fit in 32 bit are rare in conditions, we leave those
+// (and the Tcl big-integer semantics) to the interpreter.
+static inline bool isSmall(int64_t x)
+{
+	return (-0x80000000LL <= x) && (x <= 0xFFFFFFFFLL);
+}
+
+bool CompiledCondition::evaluate(MSXMotherBoard& motherBoard, bool& result) const
+{
+	MSXCPU& cpu = motherBoard.getCPU();
+	MSXCPUInterface& interface = motherBoard.getCPUInterface();
+
+	int64_t stack[MAX_STACK];
+	int64_t* sp = stack; // points to first free position
+	size_t n = code.size();
+	for (size_t ip = 0; ip < n; ++ip) {
+		const Instr& instr = code[ip];
+		switch (instr.op) {
+		case PUSH:
+			*sp++ = instr.arg;
+			break;
+		case REG8:
+			*sp++ = cpu.peekRegister(unsigned(instr.arg));
+			break;
+		case REG16:
+			*sp++ = 256 * cpu.peekRegister(unsigned(instr.arg + 0)) +
+			              cpu.peekRegister(unsigned(instr.arg + 1));
+			break;
+		case PEEK: {
+			int64_t addr = sp[-1];
+			if ((addr < 0) || (addr > 0xFFFF)) return false;
+			sp[-1] = interface.peekMem(addr, motherBoard.getCurrentTime());
+			break;
+		}
+		case PEEK16: {
+			int64_t addr = sp[-1];
+			if ((addr < 0) || (addr > 0xFFFE)) return false;
+			EmuTime::param time = motherBoard.getCurrentTime();
+			sp[-1] =       interface.peekMem(addr + 0, time) +
+			         256 * interface.peekMem(addr + 1, time);
+			break;
+		}
+		case IN_SLOT: {
+			int ps = instr.arg & 0xFF;
+			int ss = instr.arg >> 8;
+			int page = cpu.getRegisters().getPC() >> 14;
+			int pcPs = interface.getPrimarySlot(page);
+			bool in = true;
+			if ((ps != SLOT_ANY) && (pcPs != ps)) {
+				in = false;
+			} else if ((ss != SLOT_ANY) && interface.isExpanded(pcPs) &&
+			           (interface.getSecondarySlot(page) != ss)) {
+				in = false;
+			}
+			*sp++ = in;
+			break;
+		}
+		case NEG:    sp[-1] = -sp[-1]; break;
+		case BITNOT: sp[-1] = ~sp[-1]; break;
+		case LNOT:   sp[-1] = !sp[-1]; break;
+		case BOOL:   sp[-1] = sp[-1] != 0; break;
+		case JUMP_IF_FALSE:
+			if (sp[-1] == 0) {
+				ip = instr.arg - 1; // keep 0 on the stack
+			} else {
+				--sp;
+			}
+			break;
+		case JUMP_IF_TRUE:
+			if (sp[-1] != 0) {
+				sp[-1] = 1;
+				ip = instr.arg - 1;
+			} else {
+				--sp;
+			}
+			break;
+		default: {
+			// binary operators
+			--sp;
+			int64_t a = sp[-1];
+			int64_t b = sp[0];
+			int64_t& r = sp[-1];
+			switch (instr.op) {
+			case MUL:
+				if (!isSmall(a) || !isSmall(b)) return false;
+				r = a * b;
+				break;
+			case DIV:
+				if (b == 0) return false;
+				r = floorDiv(a, b);
+				break;
+			case MOD:
+				if (b == 0) return false;
+				r = floorMod(a, b);
+				break;
+			case ADD: r = a + b; break;
+			case SUB: r = a - b; break;
+			case SHL:
+				if ((b < 0) || (b >= 32) || !isSmall(a)) return false;
+				r = a * (int64_t(1) << b);
+				break;
+			case SHR:
+				if ((b < 0) || (b >= 32)) return false;
+				r = a >> b;
+				break;
+			case LT:  r = a <  b; break;
+			case GT:  r = a >  b; break;
+			case LE:  r = a <= b; break;
+			case GE:  r = a >= b; break;
+			case EQ:  r = a == b; break;
+			case NE:  r = a != b; break;
+			case AND: r = a & b; break;
+			case XOR: r = a ^ b; break;
+			case OR:  r = a | b; break;
+			default: UNREACHABLE;
+			}
+			if (!isSmall(r)) return false;
+		}
+		}
+	}
+	assert(sp == (stack + 1));
+	result = stack[0] != 0;
+	return true;
+}
+
+} // namespace openmsx
@@ -0,0 +1,71 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include "string_ref.hh"
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+
+/** Native version of a (Tcl) debug condition.
+ *
+ * Conditions of breakpoints and of 'debug set_condition' are Tcl expressions
+ * that (potentially) get evaluated after every emulated instruction. Going
+ * through the Tcl interpreter for that is very slow. Though most conditions
+ * only use a small subset of Tcl: integer arithmetic, comparisons, boolean
+ * operators and the 'reg', 'peek', 'peek16' and 'pc_in_slot' procs. Such
+ * expressions are translated to a small stack based bytecode that can be
+ * evaluated without the interpreter.
+ *
+ * This is only used as a filter: a condition that (natively) evaluates to
+ * false doesn't need to be evaluated by Tcl anymore. In all other cases
+ * (unsupported expression, evaluation error, condition is true) the
+ * original Tcl code still has the final word.
+ */
+class CompiledCondition
+{
+public:
+	/** Try to compile the given Tcl expression.
+	  * @return The compiled condition or nullptr when the expression uses
+	  *         something outside the supported subset.
+	  */
+	static std::unique_ptr<CompiledCondition> compile(string_ref expression);
+
+	/** Evaluate this condition for the given machine.
+	  * @param motherBoard The machine whose CPU registers, memory and
+	  *                    slot selection are used.
+	  * @param result Output parameter, only written on success.
+	  * @return false in case of an evaluation error (e.g. division by
+	  *         zero or peek outside the address range). The Tcl
+	  *         evaluation should then be used to obtain the correct
+	  *         result (and error message).
+	  */
+	bool evaluate(MSXMotherBoard& motherBoard, bool& result) const;
+
+	enum OpCode : uint8_t {
+		PUSH, REG8, REG16, PEEK, PEEK16, IN_SLOT,
+		NEG, BITNOT, LNOT,
+		MUL, DIV, MOD, ADD, SUB, SHL, SHR,
+		LT, GT, LE, GE, EQ, NE,
+		AND, XOR, OR, BOOL,
+		JUMP_IF_FALSE, JUMP_IF_TRUE, // for short-circuit '&&' and '||'
+	};
+	struct Instr {
+		OpCode op;
+		int64_t arg;
+	};
+
+	static const unsigned MAX_STACK = 16;
+
+private:
+	explicit CompiledCondition(std::vector<Instr> code);
+
+	std::vector<Instr> code;
+};
+
+} // namespace openmsx
+
+#endif
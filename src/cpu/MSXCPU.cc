@@ -23,15 +23,16 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 	, traceSetting(
 		motherboard.getCommandController(), "cputrace",
 		"CPU tracing on/off", false, Setting::DONT_SAVE)
+	, profiler(motherboard)
 	, diHaltCallback(
 		motherboard.getCommandController(), "di_halt_callback",
 		"Tcl proc called when the CPU executed a DI/HALT sequence")
 	, z80(make_unique<CPUCore<Z80TYPE>>(
-		motherboard, "z80", traceSetting,
+		motherboard, "z80", traceSetting, profiler,
 		diHaltCallback, EmuTime::zero))
 	, r800(motherboard.isTurboR()
 		? make_unique<CPUCore<R800TYPE>>(
-			motherboard, "r800", traceSetting,
+			motherboard, "r800", traceSetting, profiler,
 			diHaltCallback, EmuTime::zero)
 		: nullptr)
 	, timeInfo(motherboard.getMachineInfoCommand())
@@ -52,9 +53,11 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 
 	z80->freqLocked.attach(*this);
 	z80->freqValue.attach(*this);
+	z80->blockCacheSetting.attach(*this);
 	if (r800) {
 		r800->freqLocked.attach(*this);
 		r800->freqValue.attach(*this);
+		r800->blockCacheSetting.attach(*this);
 	}
 }
 
@@ -63,9 +66,11 @@ MSXCPU::~MSXCPU()
 	traceSetting.detach(*this);
 	z80->freqLocked.detach(*this);
 	z80->freqValue.detach(*this);
+	z80->blockCacheSetting.detach(*this);
 	if (r800) {
 		r800->freqLocked.detach(*this);
 		r800->freqValue.detach(*this);
+		r800->blockCacheSetting.detach(*this);
 	}
 	motherboard.getScheduler().setCPU(nullptr);
 	motherboard.getDebugger() .setCPU(nullptr);
@@ -148,6 +153,7 @@ void MSXCPU::invalidateMemCache(word start, unsigned size)
 {
 	z80Active ? z80 ->invalidateMemCache(start, size)
 	          : r800->invalidateMemCache(start, size);
+	profiler.invalidate(start, size);
 }
 
 void MSXCPU::raiseIRQ()
@@ -209,6 +215,44 @@ CPURegs& MSXCPU::getRegisters()
 	}
 }
 
+byte MSXCPU::peekRegister(unsigned address)
+{
+	const CPURegs& regs = getRegisters();
+	switch (address) {
+	case  0: return regs.getA();
+	case  1: return regs.getF();
+	case  2: return regs.getB();
+	case  3: return regs.getC();
+	case  4: return regs.getD();
+	case  5: return regs.getE();
+	case  6: return regs.getH();
+	case  7: return regs.getL();
+	case  8: return regs.getA2();
+	case  9: return regs.getF2();
+	case 10: return regs.getB2();
+	case 11: return regs.getC2();
+	case 12: return regs.getD2();
+	case 13: return regs.getE2();
+	case 14: return regs.getH2();
+	case 15: return regs.getL2();
+	case 16: return regs.getIXh();
+	case 17: return regs.getIXl();
+	case 18: return regs.getIYh();
+	case 19: return regs.getIYl();
+	case 20: return regs.getPCh();
+	case 21: return regs.getPCl();
+	case 22: return regs.getSPh();
+	case 23: return regs.getSPl();
+	case 24: return regs.getI();
+	case 25: return regs.getR();
+	case 26: return regs.getIM();
+	case 27: return 1 *  regs.getIFF1() +
+	                2 *  regs.getIFF2() +
+	                4 * (regs.getIFF1() && !regs.prevWasEI());
+	default: UNREACHABLE; return 0;
+	}
+}
+
 void MSXCPU::update(const Setting& setting)
 {
 	          z80 ->update(setting);
@@ -310,40 +354,7 @@ MSXCPU::Debuggable::Debuggable(MSXMotherBoard& motherboard_)
 byte MSXCPU::Debuggable::read(unsigned address)
 {
 	auto& cpu = OUTER(MSXCPU, debuggable);
-	const CPURegs& regs = cpu.getRegisters();
-	switch (address) {
-	case  0: return regs.getA();
-	case  1: return regs.getF();
-	case  2: return regs.getB();
-	case  3: return regs.getC();
-	case  4: return regs.getD();
-	case  5: return regs.getE();
-	case  6: return regs.getH();
-	case  7: return regs.getL();
-	case  8: return regs.getA2();
-	case  9: return regs.getF2();
-	case 10: return regs.getB2();
-	case 11: return regs.getC2();
-	case 12: return regs.getD2();
-	case 13: return regs.getE2();
-	case 14: return regs.getH2();
-	case 15: return regs.getL2();
-	case 16: return regs.getIXh();
-	case 17: return regs.getIXl();
-	case 18: return regs.getIYh();
-	case 19: return regs.getIYl();
-	case 20: return regs.getPCh();
-	case 21: return regs.getPCl();
-	case 22: return regs.getSPh();
-	case 23: return regs.getSPl();
-	case 24: return regs.getI();
-	case 25: return regs.getR();
-	case 26: return regs.getIM();
-	case 27: return 1 *  regs.getIFF1() +
-	                2 *  regs.getIFF2() +
-	                4 * (regs.getIFF1() && !regs.prevWasEI());
-	default: UNREACHABLE; return 0;
-	}
+	return cpu.peekRegister(address);
 }
 
 void MSXCPU::Debuggable::write(unsigned address, byte value)
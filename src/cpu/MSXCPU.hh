@@ -5,6 +5,7 @@
 #include "SimpleDebuggable.hh"
 #include "Observer.hh"
 #include "BooleanSetting.hh"
+#include "CPUProfiler.hh"
 #include "EmuTime.hh"
 #include "TclCallback.hh"
 #include "serialize_meta.hh"
@@ -115,6 +116,14 @@ public:
 
 	CPURegs& getRegisters();
 
+	/** Read a register, by its position in the "CPU regs" debuggable
+	  * (so e.g. 0 -> A, 20 -> PCH, 27 -> IFF1/2).
+	  */
+	byte peekRegister(unsigned address);
+
+	/** See 'debug profile'. */
+	CPUProfiler& getProfiler() { return profiler; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -135,6 +144,7 @@ private:
 
 	MSXMotherBoard& motherboard;
 	BooleanSetting traceSetting;
+	CPUProfiler profiler;
 	TclCallback diHaltCallback;
 	const std::unique_ptr<CPUCore<Z80TYPE>> z80;
 	const std::unique_ptr<CPUCore<R800TYPE>> r800; // can be nullptr
@@ -42,9 +42,6 @@ namespace openmsx {
 bool MSXCPUInterface::breaked = false;
 bool MSXCPUInterface::continued = false;
 bool MSXCPUInterface::step = false;
-MSXCPUInterface::BreakPoints MSXCPUInterface::breakPoints;
-//TODO watchpoints
-MSXCPUInterface::Conditions  MSXCPUInterface::conditions;
 
 static std::unique_ptr<ReadOnlySetting> breakedSetting;
 static unsigned breakedSettingCount = 0;
@@ -717,6 +714,16 @@ void MSXCPUInterface::checkBreakPoints(
 	          BreakPoints::const_iterator> range,
 	MSXMotherBoard& motherBoard)
 {
+	// Usually all (compiled) conditions evaluate to false. Check for that
+	// first, so that we can avoid the copies below and the Tcl interpreter.
+	auto knownFalse = [&](const BreakPointBase& b) {
+		return b.isKnownFalse(motherBoard);
+	};
+	if (std::all_of(range.first, range.second, knownFalse) &&
+	    std::all_of(begin(conditions), end(conditions), knownFalse)) {
+		return;
+	}
+
 	// create copy for the case that breakpoint/condition removes itself
 	//  - keeps object alive by holding a shared_ptr to it
 	//  - avoids iterating over a changing collection
@@ -724,10 +731,12 @@ void MSXCPUInterface::checkBreakPoints(
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
 	for (auto& p : bpCopy) {
+		if (knownFalse(p)) continue;
 		p.checkAndExecute(globalCliComm, interp);
 	}
 	auto condCopy = conditions;
 	for (auto& c : condCopy) {
+		if (knownFalse(c)) continue;
 		c.checkAndExecute(globalCliComm, interp);
 	}
 }
@@ -834,6 +843,8 @@ void MSXCPUInterface::updateMemWatch(WatchPoint::Type type)
 	for (unsigned i = 0; i < CacheLine::NUM; ++i) {
 		watchSet[i].reset();
 	}
+	WatchPoints typeWatches; // in creation order
+	vector<unsigned> bounds;
 	for (auto& w : watchPoints) {
 		if (w->getType() == type) {
 			unsigned beginAddr = w->getBeginAddress();
@@ -844,8 +855,41 @@ void MSXCPUInterface::updateMemWatch(WatchPoint::Type type)
 				watchSet[addr >> CacheLine::BITS].set(
 				         addr  & CacheLine::LOW);
 			}
+			typeWatches.push_back(w);
+			bounds.push_back(beginAddr);
+			bounds.push_back(endAddr + 1);
+		}
+	}
+
+	// (Re)build the address -> watchpoints index. Between two successive
+	// begin/end boundaries the set of covering watchpoints doesn't change.
+	auto& index = (type == WatchPoint::READ_MEM) ? readWatchIndex
+	                                             : writeWatchIndex;
+	index.lookup.clear();
+	index.sets.clear();
+	if (!typeWatches.empty()) {
+		sort(begin(bounds), end(bounds));
+		bounds.erase(unique(begin(bounds), end(bounds)), end(bounds));
+		index.lookup.assign(0x10000, 0);
+		index.sets.emplace_back(); // index 0: not watched
+		for (unsigned i = 0; (i + 1) < bounds.size(); ++i) {
+			unsigned first = bounds[i];
+			unsigned last  = bounds[i + 1]; // exclusive
+			WatchPoints covering;
+			for (auto& w : typeWatches) {
+				if ((w->getBeginAddress() <= first) &&
+				    (w->getEndAddress()   >= first)) {
+					covering.push_back(w);
+				}
+			}
+			if (covering.empty()) continue;
+			unsigned setIdx = unsigned(index.sets.size());
+			index.sets.push_back(std::move(covering));
+			std::fill(begin(index.lookup) + first,
+			          begin(index.lookup) + last, setIdx);
 		}
 	}
+
 	for (unsigned i = 0; i < CacheLine::NUM; ++i) {
 		if (readWatchSet [i].any()) {
 			disallowReadCache [i] |=  MEMORY_WATCH_BIT;
@@ -867,6 +911,17 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 	assert(!watchPoints.empty());
 	if (isFastForward()) return;
 
+	auto& index = (type == WatchPoint::READ_MEM) ? readWatchIndex
+	                                             : writeWatchIndex;
+	assert(address < index.lookup.size());
+	// Copy only the watchpoints for this address (a watchpoint may
+	// remove itself when executed).
+	auto wpCopy = index.sets[index.lookup[address]];
+	auto knownFalse = [&](const shared_ptr<WatchPoint>& w) {
+		return w->isKnownFalse(motherBoard);
+	};
+	if (std::all_of(begin(wpCopy), end(wpCopy), knownFalse)) return;
+
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
 	interp.setVariable(TclObject("wp_last_address"),
@@ -876,13 +931,9 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 		                   TclObject(int(value)));
 	}
 
-	auto wpCopy = watchPoints;
 	for (auto& w : wpCopy) {
-		if ((w->getBeginAddress() <= address) &&
-		    (w->getEndAddress()   >= address) &&
-		    (w->getType()         == type)) {
-			w->checkAndExecute(globalCliComm, interp);
-		}
+		if (knownFalse(w)) continue;
+		w->checkAndExecute(globalCliComm, interp);
 	}
 
 	interp.unsetVariable("wp_last_address");
@@ -932,17 +983,6 @@ void MSXCPUInterface::doContinue2()
 	reactor.unblock();
 }
 
-void MSXCPUInterface::cleanup()
-{
-	// before the Tcl interpreter is destroyed, we must delete all
-	// TclObjects. Breakpoints and conditions contain such objects
-	// for the condition and action.
-	// TODO it would be nicer if breakpoints and conditions were not
-	//      global objects.
-	breakPoints.clear();
-	conditions.clear();
-}
-
 
 // class MemoryDebug
 
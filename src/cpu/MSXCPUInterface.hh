@@ -203,14 +203,21 @@ public:
 	void unsetExpanded(int ps);
 	void testUnsetExpanded(int ps, std::vector<MSXDevice*> allowed) const;
 	inline bool isExpanded(int ps) const { return expanded[ps] != 0; }
+	/** The primary/secondary slot that is currently selected in the
+	  * given page. The secondary slot is only meaningful when the
+	  * primary slot is expanded. */
+	inline int getPrimarySlot  (int page) const { return primarySlotState  [page]; }
+	inline int getSecondarySlot(int page) const { return secondarySlotState[page]; }
+	/** The device that's currently visible in the given page. */
+	MSXDevice& getVisibleMSXDevice(int page) const { return *visibleDevices[page]; }
 	void changeExpanded(bool isExpanded);
 
 	DummyDevice& getDummyDevice() { return *dummyDevice; }
 
-	static void insertBreakPoint(const BreakPoint& bp);
-	static void removeBreakPoint(const BreakPoint& bp);
+	void insertBreakPoint(const BreakPoint& bp);
+	void removeBreakPoint(const BreakPoint& bp);
 	using BreakPoints = std::vector<BreakPoint>;
-	static const BreakPoints& getBreakPoints() { return breakPoints; }
+	const BreakPoints& getBreakPoints() const { return breakPoints; }
 
 	void setWatchPoint(const std::shared_ptr<WatchPoint>& watchPoint);
 	void removeWatchPoint(std::shared_ptr<WatchPoint> watchPoint);
@@ -218,10 +225,10 @@ public:
 	using WatchPoints = std::vector<std::shared_ptr<WatchPoint>>;
 	const WatchPoints& getWatchPoints() const { return watchPoints; }
 
-	static void setCondition(const DebugCondition& cond);
-	static void removeCondition(const DebugCondition& cond);
+	void setCondition(const DebugCondition& cond);
+	void removeCondition(const DebugCondition& cond);
 	using Conditions = std::vector<DebugCondition>;
-	static const Conditions& getConditions() { return conditions; }
+	const Conditions& getConditions() const { return conditions; }
 
 	static bool isBreaked() { return breaked; }
 	void doBreak();
@@ -235,11 +242,11 @@ public:
 	static void setContinue(bool x) { continued = x; }
 
 	// breakpoint methods used by CPUCore
-	static bool anyBreakPoints()
+	bool anyBreakPoints() const
 	{
 		return !breakPoints.empty() || !conditions.empty();
 	}
-	static bool checkBreakPoints(unsigned pc, MSXMotherBoard& motherBoard)
+	bool checkBreakPoints(unsigned pc, MSXMotherBoard& motherBoard)
 	{
 		auto range = equal_range(begin(breakPoints), end(breakPoints),
 		                         pc, CompareBreakpoints());
@@ -252,9 +259,6 @@ public:
 		return isBreaked();
 	}
 
-	// cleanup global variables
-	static void cleanup();
-
 	// In fast-forward mode, breakpoints, watchpoints and conditions should
 	// not trigger.
 	void setFastForward(bool fastForward_) { fastForward = fastForward_; }
@@ -280,7 +284,7 @@ private:
 	                    int ps, int ss, int base, int size);
 
 
-	static void checkBreakPoints(std::pair<BreakPoints::const_iterator,
+	void checkBreakPoints(std::pair<BreakPoints::const_iterator,
 	                                       BreakPoints::const_iterator> range,
 	                             MSXMotherBoard& motherBoard);
 
@@ -373,6 +377,21 @@ private:
 	std::bitset<CacheLine::SIZE> readWatchSet [CacheLine::NUM];
 	std::bitset<CacheLine::SIZE> writeWatchSet[CacheLine::NUM];
 
+	/** Per address lookup of the memory watchpoints that cover it.
+	  * The watched address range is split in intervals that are each
+	  * covered by the same set of watchpoints. 'lookup' maps every
+	  * address to the index of its set in 'sets' (index 0 is the empty
+	  * set). So finding the watchpoints for a watched byte is O(1),
+	  * instead of a scan over all watchpoints. Both vectors are empty
+	  * when there are no memory watchpoints of that type.
+	  */
+	struct WatchIndex {
+		std::vector<unsigned> lookup;
+		std::vector<WatchPoints> sets;
+	};
+	WatchIndex readWatchIndex;
+	WatchIndex writeWatchIndex;
+
 	struct GlobalWriteInfo {
 		MSXDevice* device;
 		word addr;
@@ -395,9 +414,9 @@ private:
 	bool fastForward; // no need to serialize
 
 	//  All CPUs (Z80 and R800) of all MSX machines share this state.
-	static BreakPoints breakPoints; // sorted on address
-	WatchPoints watchPoints; // ordered in creation order,  TODO must also be static
-	static Conditions conditions; // ordered in creation order
+	BreakPoints breakPoints; // sorted on address
+	WatchPoints watchPoints; // ordered in creation order
+	Conditions conditions; // ordered in creation order
 	static bool breaked;
 	static bool continued;
 	static bool step;
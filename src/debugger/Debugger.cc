@@ -5,6 +5,7 @@
 #include "Reactor.hh"
 #include "MSXCPU.hh"
 #include "MSXCPUInterface.hh"
+#include "CPUProfiler.hh"
 #include "BreakPoint.hh"
 #include "DebugCondition.hh"
 #include "MSXWatchIODevice.hh"
@@ -16,6 +17,7 @@
 #include "stl.hh"
 #include "unreachable.hh"
 #include "memory.hh"
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -62,6 +64,16 @@ Debuggable* Debugger::findDebuggable(string_ref name)
 	return (it != end(debuggables)) ? it->second : nullptr;
 }
 
+vector<string> Debugger::getDebuggableNames() const
+{
+	vector<string> result;
+	for (auto& name : keys(debuggables)) {
+		result.push_back(name);
+	}
+	sort(begin(result), end(result));
+	return result;
+}
+
 Debuggable& Debugger::getDebuggable(string_ref name)
 {
 	Debuggable* result = findDebuggable(name);
@@ -183,8 +195,17 @@ void Debugger::transfer(Debugger& other)
 		}
 	}
 
-	// Breakpoints and conditions are (currently) global, so no need to
-	// copy those.
+	// Copy breakpoints and conditions to new machine.
+	auto& interface = motherBoard.getCPUInterface();
+	auto& otherInterface = other.motherBoard.getCPUInterface();
+	assert(interface.getBreakPoints().empty());
+	for (auto& bp : otherInterface.getBreakPoints()) {
+		interface.insertBreakPoint(bp);
+	}
+	assert(interface.getConditions().empty());
+	for (auto& c : otherInterface.getConditions()) {
+		interface.setCondition(c);
+	}
 }
 
 
@@ -272,6 +293,8 @@ void Debugger::Cmd::execute(
 		listConditions(tokens, result);
 	} else if (subCmd == "probe") {
 		probe(tokens, result);
+	} else if (subCmd == "profile") {
+		profile(tokens, result);
 	} else {
 		throw SyntaxError();
 	}
@@ -755,6 +778,48 @@ void Debugger::Cmd::probeListBreakPoints(
 	result.setString(res);
 }
 
+void Debugger::Cmd::profile(array_ref<TclObject> tokens, TclObject& result)
+{
+	if (tokens.size() < 3) {
+		throw CommandException("Missing argument");
+	}
+	auto& cpu = *debugger().cpu;
+	auto& profiler = cpu.getProfiler();
+	string_ref subCmd = tokens[2].getString();
+	if (subCmd == "start") {
+		profiler.start();
+		// profiling only happens in the slow CPU loop
+		cpu.exitCPULoopSync();
+	} else if (subCmd == "stop") {
+		profiler.stop();
+	} else if (subCmd == "clear") {
+		profiler.clear();
+	} else if (subCmd == "active") {
+		result.setBoolean(profiler.isActive());
+	} else if (subCmd == "dump") {
+		profiler.dump(result);
+	} else if (subCmd == "top") {
+		unsigned n = 10;
+		bool byCount = false;
+		for (unsigned i = 3; i < tokens.size(); ++i) {
+			if (tokens[i] == "-count") {
+				byCount = true;
+			} else {
+				int num = tokens[i].getInt(getInterpreter());
+				if (num <= 0) {
+					throw CommandException("Expected a positive number");
+				}
+				n = num;
+			}
+		}
+		profiler.top(result, n, byCount);
+	} else if (subCmd == "callgraph") {
+		profiler.callGraph(result);
+	} else {
+		throw SyntaxError();
+	}
+}
+
 string Debugger::Cmd::help(const vector<string>& tokens) const
 {
 	static const string generalHelp =
@@ -777,6 +842,7 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    remove_condition  remove a certain condition\n"
 		"    list_conditions   list the active conditions\n"
 		"    probe             probe related subcommands\n"
+		"    profile           profile the executed instructions\n"
 		"    cont              continue execution after break\n"
 		"    step              execute one instruction\n"
 		"    break             break CPU at current position\n"
@@ -896,6 +962,10 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"breakpoints. So only use them when you don't care about "
 		"simulation speed (when you're debugging this is usually not "
 		"a problem).\n"
+		"  Conditions that only use integers, the usual arithmetic, "
+		"comparison and boolean operators and the 'reg', 'peek', "
+		"'peek16' and 'pc_in_slot <ps> [<ss>]' procs are evaluated "
+		"without going through Tcl, that's a lot faster.\n"
 		"  See 'help debug set_bp' for more details.\n";
 	static const string removeCondHelp =
 		"debug remove_condition <id>\n"
@@ -915,6 +985,29 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		"    set_bp <probe> [<cond>] [<cmd>]  set a breakpoint on the given probe\n"
 		"    remove_bp <id>                   remove the given breakpoint\n"
 		"    list_bp                          returns a list of breakpoints that are set on probes\n";
+	static const string profileHelp =
+		"debug profile <subcommand> [<arguments>]\n"
+		"  Counts the executed instructions and the CPU cycles spent per "
+		"instruction address. Possible subcommands are:\n"
+		"    start                   discard previous results and start profiling\n"
+		"    stop                    stop profiling, results remain available\n"
+		"    clear                   discard the results\n"
+		"    active                  returns whether profiling is active\n"
+		"    dump                    returns the results for all addresses\n"
+		"    top [<n>] [-count]      returns the <n> (default 10) addresses with the most cycles (or instructions)\n"
+		"    callgraph               returns the results per (caller, callee) pair\n"
+		"  An address is a list {<ps> <ss> <segment> <pc>}. <ss> is X for a "
+		"not expanded slot, <segment> is the selected memory mapper "
+		"segment or ROM mapper block (0 if there's no mapper).\n"
+		"  'dump' and 'top' return a list of {<address> <instructions> "
+		"<cycles>} elements.\n"
+		"  'callgraph' returns a list of {<caller> <callee> <calls> <cycles>} "
+		"elements, where <cycles> is the total duration of the calls "
+		"(including nested calls). Calls are CALL and RST instructions and "
+		"interrupts, <caller> is the entry point of the calling routine or "
+		"empty if that routine wasn't called while profiling.\n"
+		"  While profiling the CPU runs somewhat slower (similar to having a "
+		"breakpoint). Nothing is profiled in fast-forward mode.\n";
 	static const string contHelp =
 		"debug cont\n"
 		"  Continue execution after CPU was breaked.\n";
@@ -980,6 +1073,8 @@ string Debugger::Cmd::help(const vector<string>& tokens) const
 		return listCondHelp;
 	} else if (tokens[1] == "probe") {
 		return probeHelp;
+	} else if (tokens[1] == "profile") {
+		return profileHelp;
 	} else if (tokens[1] == "cont") {
 		return contHelp;
 	} else if (tokens[1] == "step") {
@@ -1036,7 +1131,7 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 	static const char* const otherCmds[] = {
 		"disasm", "set_bp", "remove_bp", "set_watchpoint",
 		"remove_watchpoint", "set_condition", "remove_condition",
-		"probe",
+		"probe", "profile",
 	};
 	switch (tokens.size()) {
 	case 2: {
@@ -1074,6 +1169,12 @@ void Debugger::Cmd::tabCompletion(vector<string>& tokens) const
 					"remove_bp", "list_bp",
 				};
 				completeString(tokens, subCmds);
+			} else if (tokens[1] == "profile") {
+				static const char* const subCmds[] = {
+					"start", "stop", "clear", "active", "dump",
+					"top", "callgraph",
+				};
+				completeString(tokens, subCmds);
 			}
 		}
 		break;
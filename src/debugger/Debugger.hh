@@ -31,6 +31,8 @@ public:
 	void registerDebuggable   (std::string name, Debuggable& interface);
 	void unregisterDebuggable (string_ref name, Debuggable& interface);
 	Debuggable* findDebuggable(string_ref name);
+	/** Names of all registered debuggables (sorted). */
+	std::vector<std::string> getDebuggableNames() const;
 
 	void registerProbe  (ProbeBase& probe);
 	void unregisterProbe(ProbeBase& probe);
@@ -99,6 +101,7 @@ private:
 		void probeSetBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeRemoveBreakPoint(array_ref<TclObject> tokens, TclObject& result);
 		void probeListBreakPoints(array_ref<TclObject> tokens, TclObject& result);
+		void profile(array_ref<TclObject> tokens, TclObject& result);
 	} cmd;
 
 	struct NameFromProbe {
@@ -68,6 +68,9 @@ enum EventType
 	OPENMSX_MIDI_IN_COREMIDI_VIRTUAL_EVENT,
 	OPENMSX_RS232_TESTER_EVENT,
 
+	/** Sent when a 'record convert' job has finished. */
+	OPENMSX_RECORD_CONVERT_EVENT,
+
 	NUM_EVENT_TYPES // must be last
 };
 
@@ -79,6 +79,9 @@ void EventDistributor::deliverEvents()
 {
 	assert(Thread::isMainThread());
 
+	// Events (and the commands they trigger) can access any machine.
+	reactor.lockBackgroundMachines();
+
 	reactor.getInputEventGenerator().poll();
 	reactor.getInterpreter().poll();
 	reactor.getRTScheduler().execute();
@@ -60,7 +60,11 @@ void GlobalCliComm::setAllowExternalCommands()
 
 void GlobalCliComm::log(LogLevel level, string_ref message)
 {
-	assert(Thread::isMainThread());
+	if (!Thread::isMainThread()) {
+		// Machine emulated in the background, nobody is watching.
+		assert(Thread::isEmulationThread());
+		return;
+	}
 
 	if (delivering) {
 		// Don't allow recursive calls, this would hang while trying to
@@ -89,6 +93,10 @@ void GlobalCliComm::log(LogLevel level, string_ref message)
 void GlobalCliComm::update(UpdateType type, string_ref name, string_ref value)
 {
 	assert(type < NUM_UPDATES);
+	if (!Thread::isMainThread()) {
+		assert(Thread::isEmulationThread());
+		return;
+	}
 	auto it = prevValues[type].find(name);
 	if (it != end(prevValues[type])) {
 		if (it->second == value) {
@@ -104,7 +112,10 @@ void GlobalCliComm::update(UpdateType type, string_ref name, string_ref value)
 void GlobalCliComm::updateHelper(UpdateType type, string_ref machine,
                                  string_ref name, string_ref value)
 {
-	assert(Thread::isMainThread());
+	if (!Thread::isMainThread()) {
+		assert(Thread::isEmulationThread());
+		return;
+	}
 	std::lock_guard<std::mutex> lock(mutex);
 	for (auto& l : listeners) {
 		l->update(type, machine, name, value);
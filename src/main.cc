@@ -145,7 +145,9 @@ static int main(int argc, char **argv)
 				// 'ext gfx9000'.
 				reactor.getEventDistributor().deliverEvents();
 			}
-			if (parseStatus != CommandLineParser::TEST) {
+			if (parseStatus == CommandLineParser::BATCH) {
+				err = parser.runBatchReplays();
+			} else if (parseStatus != CommandLineParser::TEST) {
 				CliServer cliServer(reactor.getCommandController(),
 				                    reactor.getEventDistributor(),
 				                    reactor.getGlobalCliComm());
@@ -4,6 +4,7 @@
 #include "DeviceConfig.hh"
 #include "GlobalSettings.hh"
 #include "StringSetting.hh"
+#include "serialize.hh"
 #include "likely.hh"
 #include <cassert>
 
@@ -24,6 +25,9 @@ CheckedRam::CheckedRam(const DeviceConfig& config, const std::string& name,
 	, msxcpu(config.getMotherBoard().getCPU())
 	, umrCallback(config.getGlobalSettings().getUMRCallBackSetting())
 {
+	static_assert(DirtyPages::SIZE == CacheLine::SIZE,
+	              "pages are marked dirty per write cache line");
+	ram.setDirtyTracking(true);
 	umrCallback.getSetting().attach(*this);
 	init();
 }
@@ -52,8 +56,13 @@ const byte* CheckedRam::getReadCacheLine(unsigned addr) const
 
 byte* CheckedRam::getWriteCacheLine(unsigned addr) const
 {
-	return (completely_initialized_cacheline[addr >> CacheLine::BITS])
-	     ? const_cast<byte*>(&ram[addr]) : nullptr;
+	if (!completely_initialized_cacheline[addr >> CacheLine::BITS]) {
+		return nullptr;
+	}
+	// All writes via this cache line (till the CPU cache is invalidated,
+	// see serialize()) end up in this page.
+	const_cast<Ram&>(ram).markDirty(addr);
+	return const_cast<byte*>(&ram[addr]);
 }
 
 void CheckedRam::write(unsigned addr, const byte value)
@@ -67,6 +76,7 @@ void CheckedRam::write(unsigned addr, const byte value)
 			                          CacheLine::SIZE);
 		}
 	}
+	ram.markDirty(addr);
 	ram[addr] = value;
 }
 
@@ -102,4 +112,17 @@ void CheckedRam::update(const Setting& setting)
 	init();
 }
 
+template<typename Archive>
+void CheckedRam::serialize(Archive& ar, unsigned version)
+{
+	ram.serialize(ar, version);
+	if (ar.isReverseSnapshot()) {
+		// Dirty pages were just cleared, but the CPU may still hold
+		// write cache lines into this ram. Force it to request them
+		// again, that marks the pages dirty.
+		msxcpu.invalidateMemCache(0, 0x10000);
+	}
+}
+INSTANTIATE_SERIALIZE_METHODS(CheckedRam);
+
 } // namespace openmsx
@@ -45,13 +45,15 @@ public:
 	 * Give access to the unchecked Ram. No problem to use it, but there
 	 * will just be no checking done! Keep in mind that you should use this
 	 * consistently, so that the initialized-administration will be always
-	 * up to date!
+	 * up to date! The same goes for dirty page tracking (see DirtyPages):
+	 * writes via this reference must be marked with Ram::markDirty().
 	 */
 	Ram& getUncheckedRam() { return ram; }
 
-	// TODO
-	//template<typename Archive>
-	//void serialize(Archive& ar, unsigned version);
+	// Same format as the Ram class. The initialized-administration is
+	// not stored (it's only a debugging aid), loading keeps it as is.
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
 
 private:
 	void init();
@@ -5,7 +5,6 @@
 #include "MSXException.hh"
 #include "serialize.hh"
 #include "memory.hh"
-#include "Ram.hh" // because we serialize Ram instead of CheckedRam
 
 namespace openmsx {
 
@@ -54,6 +53,11 @@ unsigned MSXMemoryMapper::calcAddress(word address) const
 	return (page << 14) | (address & 0x3FFF);
 }
 
+unsigned MSXMemoryMapper::getSelectedSegment(byte page) const
+{
+	return calcAddress(page << 14) >> 14;
+}
+
 byte MSXMemoryMapper::peekMem(word address, EmuTime::param /*time*/) const
 {
 	return checkedRam.peek(calcAddress(address));
@@ -83,8 +87,7 @@ template<typename Archive>
 void MSXMemoryMapper::serialize(Archive& ar, unsigned /*version*/)
 {
 	ar.template serializeBase<MSXDevice>(*this);
-	// TODO ar.serialize("checkedRam", checkedRam);
-	ar.serialize("ram", checkedRam.getUncheckedRam());
+	ar.serialize("ram", checkedRam);
 }
 INSTANTIATE_SERIALIZE_METHODS(MSXMemoryMapper);
 REGISTER_MSXDEVICE(MSXMemoryMapper, "MemoryMapper");
@@ -22,6 +22,11 @@ public:
 	byte* getWriteCacheLine(word start) const override;
 	byte peekMem(word address, EmuTime::param time) const override;
 
+	/** The segment that's currently visible in the given page (taking
+	  * into account that unused bits of the mapper registers are
+	  * ignored). */
+	unsigned getSelectedSegment(byte page) const;
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
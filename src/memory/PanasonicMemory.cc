@@ -36,7 +36,7 @@ PanasonicMemory::~PanasonicMemory() = default;
 
 void PanasonicMemory::registerRam(Ram& ram_)
 {
-	ram = &ram_[0];
+	ram = &ram_;
 	ramSize = ram_.getSize();
 }
 
@@ -52,7 +52,7 @@ const byte* PanasonicMemory::getRomBlock(unsigned block)
 		unsigned offset = (block & 0x03) * 0x2000;
 		unsigned ramOffset = (block < 0x30) ? ramSize - 0x10000 :
 		                                      ramSize - 0x08000;
-		return ram + ramOffset + offset;
+		return &(*ram)[ramOffset + offset];
 	} else {
 		unsigned offset = block * 0x2000;
 		if (offset >= rom->getSize()) {
@@ -84,15 +84,25 @@ const byte* PanasonicMemory::getRomRange(unsigned first, unsigned last)
 	return &(*rom)[start];
 }
 
-byte* PanasonicMemory::getRamBlock(unsigned block)
+unsigned PanasonicMemory::getRamOffset(unsigned block) const
 {
-	if (!ram) return nullptr;
-
 	unsigned offset = block * 0x2000;
 	if (offset >= ramSize) {
 		offset &= ramSize - 1;
 	}
-	return ram + offset;
+	return offset;
+}
+
+byte* PanasonicMemory::getRamBlock(unsigned block)
+{
+	if (!ram) return nullptr;
+	return &(*ram)[getRamOffset(block)];
+}
+
+void PanasonicMemory::markRamDirty(unsigned block, unsigned offset)
+{
+	assert(ram);
+	ram->markDirty(getRamOffset(block) + offset);
 }
 
 void PanasonicMemory::setDRAM(bool dram_)
@@ -20,6 +20,7 @@ public:
 	/**
 	 * Pass reference of the actual Ram block for use in DRAM mode and RAM
 	 * access via the ROM mapper. Note that this is always unchecked Ram!
+	 * Dirty page tracking stays enabled, see markRamDirty().
 	 */
 	void registerRam(Ram& ram);
 	const byte* getRomBlock(unsigned block);
@@ -29,15 +30,22 @@ public:
 	 * when accessing Ram in DRAM mode or via the ROM mapper!
 	 */
 	byte* getRamBlock(unsigned block);
+	/**
+	 * Writes via getRamBlock() must be marked (per page, see DirtyPages),
+	 * otherwise reverse snapshots miss them.
+	 */
+	void markRamDirty(unsigned block, unsigned offset);
 	unsigned getRamSize() const { return ramSize; }
 	void setDRAM(bool dram);
 	bool isWritable(unsigned address) const;
 
 private:
+	unsigned getRamOffset(unsigned block) const;
+
 	MSXCPU& msxcpu;
 
 	const std::unique_ptr<Rom> rom; // can be nullptr
-	byte* ram;
+	Ram* ram;
 	unsigned ramSize;
 	bool dram;
 };
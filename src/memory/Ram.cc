@@ -32,6 +32,7 @@ Ram::Ram(const DeviceConfig& config, const string& name,
 	: xml(*config.getXML())
 	, ram(size_)
 	, size(size_)
+	, dirty(size_)
 	, debuggable(make_unique<RamDebuggable>(
 		config.getMotherBoard(), name, description, *this))
 {
@@ -42,6 +43,7 @@ Ram::Ram(const DeviceConfig& config, unsigned size_)
 	: xml(*config.getXML())
 	, ram(size_)
 	, size(size_)
+	, dirty(size_)
 {
 	clear();
 }
@@ -50,6 +52,7 @@ Ram::~Ram() = default;
 
 void Ram::clear(byte c)
 {
+	dirty.markAll();
 	if (const XMLElement* init = xml.findChild("initialContent")) {
 		// get pattern (and decode)
 		const string& encoding = init->getAttribute("encoding");
@@ -108,6 +111,7 @@ byte RamDebuggable::read(unsigned address)
 
 void RamDebuggable::write(unsigned address, byte value)
 {
+	ram.markDirty(address);
 	ram[address] = value;
 }
 
@@ -115,7 +119,8 @@ void RamDebuggable::write(unsigned address, byte value)
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
 {
-	ar.serialize_blob("ram", ram.data(), size);
+	ar.serialize_blob("ram", ram.data(), size, dirty);
+	if (ar.isReverseSnapshot()) dirty.clear();
 }
 INSTANTIATE_SERIALIZE_METHODS(Ram);
 
@@ -2,6 +2,7 @@
 #define RAM_HH
 
 #include "MemBuffer.hh"
+#include "DirtyPages.hh"
 #include "openmsx.hh"
 #include <string>
 #include <memory>
@@ -37,6 +38,16 @@ public:
 	const std::string& getName() const;
 	void clear(byte c = 0xff);
 
+	/** Dirty page tracking (for reverse snapshots), see DirtyPages.
+	  * Should only be enabled by a wrapper class that marks all writes
+	  * it does via operator[] (e.g. TrackedRam, CheckedRam, VDPVRAM).
+	  * The debuggable and clear() are handled by this class.
+	  */
+	void setDirtyTracking(bool enabled) { dirty.setTracking(enabled); }
+	void markDirty(unsigned addr) { dirty.mark(addr); }
+	void markAllDirty() { dirty.markAll(); }
+	DirtyPages& getDirtyPages() { return dirty; }
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -44,6 +55,7 @@ private:
 	const XMLElement& xml;
 	MemBuffer<byte> ram;
 	unsigned size; // must come before debuggable
+	DirtyPages dirty;
 	const std::unique_ptr<RamDebuggable> debuggable; // can be nullptr
 };
 
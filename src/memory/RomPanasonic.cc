@@ -122,6 +122,8 @@ void RomPanasonic::writeMem(word address, byte value, EmuTime::param /*time*/)
 			sram->write((block * 0x2000) | (address & 0x1FFF), value);
 		} else if (RAM_BASE <= selectedBank) {
 			// RAM
+			panasonicMem.markRamDirty(selectedBank - RAM_BASE,
+			                          address & 0x1FFF);
 			const_cast<byte*>(bankPtr[region])[address & 0x1FFF] = value;
 		}
 	}
@@ -140,7 +142,10 @@ byte* RomPanasonic::getWriteCacheLine(word address) const
 			// SRAM
 			return nullptr;
 		} else if (RAM_BASE <= selectedBank) {
-			// RAM
+			// RAM, all writes via this cache line end up in this
+			// page (see CheckedRam::getWriteCacheLine())
+			panasonicMem.markRamDirty(selectedBank - RAM_BASE,
+			                          address & 0x1FFF);
 			return const_cast<byte*>(&bankPtr[region][address & 0x1FFF]);
 		} else {
 			return unmappedWrite;
@@ -7,6 +7,7 @@
 #include "Reactor.hh"
 #include "CliComm.hh"
 #include "serialize.hh"
+#include "Thread.hh"
 #include "openmsx.hh"
 #include "vla.hh"
 #include "memory.hh"
@@ -57,7 +58,7 @@ SRAM::~SRAM()
 
 void SRAM::write(unsigned addr, byte value)
 {
-	if (!isPendingRT()) {
+	if (Thread::isMainThread() && !isPendingRT()) {
 		scheduleRT(5000000); // sync to disk after 5s
 	}
 	assert(addr < getSize());
@@ -66,7 +67,7 @@ void SRAM::write(unsigned addr, byte value)
 
 void SRAM::memset(unsigned addr, byte c, unsigned size)
 {
-	if (!isPendingRT()) {
+	if (Thread::isMainThread() && !isPendingRT()) {
 		scheduleRT(5000000); // sync to disk after 5s
 	}
 	assert((addr + size) <= getSize());
@@ -4,14 +4,12 @@
 namespace openmsx {
 
 template<typename Archive>
-void TrackedRam::serialize(Archive& ar, unsigned /*version*/)
+void TrackedRam::serialize(Archive& ar, unsigned version)
 {
 	// Note: This is the exact same serialization format as the Ram class.
 	//  This allows to change from Ram to TrackedRam without having to
 	//  increase the class serialization version (of the user).
-	bool diff = writeSinceLastReverseSnapshot || !ar.isReverseSnapshot();
-	ar.serialize_blob("ram", &ram[0], getSize(), diff);
-	if (ar.isReverseSnapshot()) writeSinceLastReverseSnapshot = false;
+	ram.serialize(ar, version);
 }
 INSTANTIATE_SERIALIZE_METHODS(TrackedRam);
 
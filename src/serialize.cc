@@ -6,6 +6,7 @@
 #include "ConfigException.hh"
 #include "XMLException.hh"
 #include "DeltaBlock.hh"
+#include "DirtyPages.hh"
 #include "MemBuffer.hh"
 #include "StringOp.hh"
 #include "FileOperations.hh"
@@ -108,6 +109,13 @@ void OutputArchiveBase<Derived>::serialize_blob(
 	this->self().endTag(tag);
 }
 
+template<typename Derived>
+void OutputArchiveBase<Derived>::serialize_blob(
+	const char* tag, const void* data, size_t len, const DirtyPages& /*dirty*/)
+{
+	this->self().serialize_blob(tag, data, len);
+}
+
 template class OutputArchiveBase<MemOutputArchive>;
 template class OutputArchiveBase<XmlOutputArchive>;
 
@@ -167,6 +175,14 @@ void InputArchiveBase<Derived>::serialize_blob(
 	}
 }
 
+template<typename Derived>
+void InputArchiveBase<Derived>::serialize_blob(
+	const char* tag, void* data, size_t len, DirtyPages& dirty)
+{
+	this->self().serialize_blob(tag, data, len);
+	dirty.markAll();
+}
+
 template class InputArchiveBase<MemInputArchive>;
 template class InputArchiveBase<XmlInputArchive>;
 
@@ -233,6 +249,25 @@ void MemOutputArchive::serialize_blob(const char*, const void* data, size_t len,
 
 }
 
+void MemOutputArchive::serialize_blob(const char* tag, const void* data,
+                                      size_t len, const DirtyPages& dirty)
+{
+	// Pages that were not written since the previous reverse snapshot are
+	// still equal to that snapshot, only the dirty pages need to be
+	// compared (see DeltaBlockDiff). Outside reverse snapshots the dirty
+	// information has no meaning.
+	if (!reverseSnapshot || !dirty.isTracking() || (len <= SMALL_SIZE)) {
+		serialize_blob(tag, data, len);
+		return;
+	}
+	unsigned deltaBlockIdx = unsigned(deltaBlocks.size());
+	save(deltaBlockIdx); // see comment below in MemInputArchive
+	auto* p = static_cast<const uint8_t*>(data);
+	deltaBlocks.push_back(dirty.any()
+		? lastDeltaBlocks.createNew(data, p, len, &dirty)
+		: lastDeltaBlocks.createNullDiff(data, p, len));
+}
+
 void MemInputArchive::serialize_blob(const char*, void* data, size_t len, bool /*diff*/)
 {
 	if (len > SMALL_SIZE) {
@@ -252,6 +287,13 @@ void MemInputArchive::serialize_blob(const char*, void* data, size_t len, bool /
 	}
 }
 
+void MemInputArchive::serialize_blob(const char* tag, void* data, size_t len,
+                                     DirtyPages& dirty)
+{
+	serialize_blob(tag, data, len);
+	dirty.markAll();
+}
+
 ////
 
 XmlOutputArchive::XmlOutputArchive(const string& filename)
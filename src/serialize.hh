@@ -22,6 +22,7 @@ namespace openmsx {
 
 class LastDeltaBlocks;
 class DeltaBlock;
+class DirtyPages;
 
 template<typename T> struct SerializeClassVersion;
 
@@ -439,6 +440,10 @@ public:
 	// the resulting string. But memory archives will memcpy the blob.
 	void serialize_blob(const char* tag, const void* data, size_t len,
 	                    bool diff = true);
+	// Same, but for a blob with dirty page tracking. Only reverse
+	// snapshots make use of that information.
+	void serialize_blob(const char* tag, const void* data, size_t len,
+	                    const DirtyPages& dirty);
 
 	template<typename T> void serialize(const char* tag, const T& t)
 	{
@@ -534,6 +539,9 @@ public:
 	}
 	void serialize_blob(const char* tag, void* data, size_t len,
 	                    bool diff = true);
+	// Same, the loaded blob is marked as dirty.
+	void serialize_blob(const char* tag, void* data, size_t len,
+	                    DirtyPages& dirty);
 
 	template<typename T>
 	void serialize(const char* tag, T& t)
@@ -624,6 +632,8 @@ public:
 	void save(const std::string& s);
 	void serialize_blob(const char*, const void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char*, const void* data, size_t len,
+	                    const DirtyPages& dirty);
 
 	void beginSection()
 	{
@@ -692,6 +702,8 @@ public:
 	string_ref loadStr();
 	void serialize_blob(const char*, void* data, size_t len,
 	                    bool diff = true);
+	void serialize_blob(const char*, void* data, size_t len,
+	                    DirtyPages& dirty);
 
 	void skipSection(bool skip)
 	{
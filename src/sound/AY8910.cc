@@ -10,6 +10,7 @@
 
 #include "AY8910.hh"
 #include "AY8910Periphery.hh"
+#include "BlipDeltas.hh"
 #include "DeviceConfig.hh"
 #include "GlobalSettings.hh"
 #include "MSXException.hh"
@@ -688,18 +689,79 @@ static void addFill(int*& buf, int val, unsigned num)
 	} while (--num);
 }
 
-void AY8910::generateChannels(int** bufs, unsigned length)
+// The two ways generate() can output the level of a channel:
+// - SampleOutput adds it to every sample of a buffer,
+// - DeltaOutput only reports when it changes (see generateChannelDeltas()).
+class AY8910::SampleOutput
+{
+public:
+	explicit SampleOutput(int*& buf_) : buf(buf_), ptr(buf_) {}
+	bool isEnabled() const { return buf != nullptr; }
+	void disable() { buf = nullptr; }
+	void fill(int val, unsigned num) { addFill(ptr, val, num); }
+private:
+	int*& buf;
+	int* ptr;
+};
+
+class AY8910::DeltaOutput
+{
+public:
+	explicit DeltaOutput(BlipDeltas& deltas_)
+		: deltas(deltas_), time(0), last(0), enabled(true) {}
+	bool isEnabled() const { return enabled; }
+	void disable() { enabled = false; }
+	void fill(int val, unsigned num)
+	{
+		if (val != last) {
+			deltas.addDelta(time, val - last);
+			last = val;
+		}
+		time += num;
+	}
+private:
+	BlipDeltas& deltas;
+	unsigned time;
+	int last;
+	bool enabled;
+};
+
+inline bool AY8910::isChannelSilent(unsigned chan) const
+{
+	// A channel with volume 0 is silent, no matter what the tone and noise
+	// generators do.
+	return amplitude.followsEnvelope(chan)
+	     ? (!envelope.isChanging() && (envelope.getVolume() == 0))
+	     : (amplitude.getVolume(chan) == 0);
+}
+
+bool AY8910::isSilent() const
+{
+	return isChannelSilent(0) && isChannelSilent(1) && isChannelSilent(2);
+}
+
+void AY8910::skipChannels(unsigned length)
+{
+	// Same as generateChannels() when all channels are silent: only
+	// advance the generators.
+	for (auto& t : tone) {
+		t.advance(length);
+	}
+	noise.advance(length);
+	if (envelope.isChanging()) {
+		envelope.advance(length);
+	}
+}
+
+template<typename Output>
+void AY8910::generate(Output* outputs, unsigned length)
 {
 	// Disable channels with volume 0: since the sample value doesn't matter,
 	// we can use the fastest path.
 	unsigned chanEnable = regs[AY_ENABLE];
 	for (unsigned chan = 0; chan < 3; ++chan) {
-		if ((!amplitude.followsEnvelope(chan) &&
-		     (amplitude.getVolume(chan) == 0)) ||
-		    (amplitude.followsEnvelope(chan) &&
-		     !envelope.isChanging() &&
-		     (envelope.getVolume() == 0))) {
-			bufs[chan] = nullptr;
+		if (isChannelSilent(chan)) {
+			outputs[chan].disable();
 			tone[chan].advance(length);
 			chanEnable |= 0x09 << chan;
 		}
@@ -723,8 +785,8 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 	Envelope initialEnvelope = envelope;
 	NoiseGenerator initialNoise = noise;
 	for (unsigned chan = 0; chan < 3; ++chan, chanEnable >>= 1) {
-		int* buf = bufs[chan];
-		if (!buf) continue;
+		Output& out = outputs[chan];
+		if (!out.isEnabled()) continue;
 		ToneGenerator& t = tone[chan];
 		if (envelope.isChanging() && amplitude.followsEnvelope(chan)) {
 			envelopeUpdated = true;
@@ -737,14 +799,14 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned nextT = t.getNextEventTime();
 				while ((nextT <= remaining) || (nextE <= remaining)) {
 					if (nextT < nextE) {
-						addFill(buf, val, nextT);
+						out.fill(val, nextT);
 						remaining -= nextT;
 						nextE -= nextT;
 						envelope.advanceFast(nextT);
 						t.doNextEvent(*this);
 						nextT = t.getNextEventTime();
 					} else if (nextE < nextT) {
-						addFill(buf, val, nextE);
+						out.fill(val, nextE);
 						remaining -= nextE;
 						nextT -= nextE;
 						t.advanceFast(nextE);
@@ -752,7 +814,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 						nextE = envelope.getNextEventTime();
 					} else {
 						assert(nextT == nextE);
-						addFill(buf, val, nextT);
+						out.fill(val, nextT);
 						remaining -= nextT;
 						t.doNextEvent(*this);
 						nextT = t.getNextEventTime();
@@ -763,7 +825,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					t.advanceFast(remaining);
 					envelope.advanceFast(remaining);
 				}
@@ -774,7 +836,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned remaining = length;
 				unsigned next = envelope.getNextEventTime();
 				while (next <= remaining) {
-					addFill(buf, val, next);
+					out.fill(val, next);
 					remaining -= next;
 					envelope.doNextEvent();
 					val = envelope.getVolume();
@@ -782,7 +844,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					envelope.advanceFast(remaining);
 				}
 				t.advance(length);
@@ -797,7 +859,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned nextE = envelope.getNextEventTime();
 				unsigned next = std::min(std::min(nextT, nextN), nextE);
 				while (next <= remaining) {
-					addFill(buf, val, next);
+					out.fill(val, next);
 					remaining -= next;
 					nextT -= next;
 					nextN -= next;
@@ -825,7 +887,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					t.advanceFast(remaining);
 					noise.advanceFast(remaining);
 					envelope.advanceFast(remaining);
@@ -840,14 +902,14 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned nextN = noise.getNextEventTime();
 				while ((nextN <= remaining) || (nextE <= remaining)) {
 					if (nextN < nextE) {
-						addFill(buf, val, nextN);
+						out.fill(val, nextN);
 						remaining -= nextN;
 						nextE -= nextN;
 						envelope.advanceFast(nextN);
 						noise.doNextEvent();
 						nextN = noise.getNextEventTime();
 					} else if (nextE < nextN) {
-						addFill(buf, val, nextE);
+						out.fill(val, nextE);
 						remaining -= nextE;
 						nextN -= nextE;
 						noise.advanceFast(nextE);
@@ -855,7 +917,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 						nextE = envelope.getNextEventTime();
 					} else {
 						assert(nextN == nextE);
-						addFill(buf, val, nextN);
+						out.fill(val, nextN);
 						remaining -= nextN;
 						noise.doNextEvent();
 						nextN = noise.getNextEventTime();
@@ -866,7 +928,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					noise.advanceFast(remaining);
 					envelope.advanceFast(remaining);
 				}
@@ -883,7 +945,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned remaining = length;
 				unsigned next = t.getNextEventTime();
 				while (next <= remaining) {
-					addFill(buf, val, next);
+					out.fill(val, next);
 					val ^= volume;
 					remaining -= next;
 					t.doNextEvent(*this);
@@ -891,13 +953,13 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					t.advanceFast(remaining);
 				}
 
 			} else if ((chanEnable & 0x09) == 0x09) {
 				// no noise, channel disabled: always 1.
-				addFill(buf, volume, length);
+				out.fill(volume, length);
 				t.advance(length);
 
 			} else if ((chanEnable & 0x09) == 0x00) {
@@ -910,7 +972,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned nextT = t.getNextEventTime();
 				while ((nextN <= remaining) || (nextT <= remaining)) {
 					if (nextT < nextN) {
-						addFill(buf, val2, nextT);
+						out.fill(val2, nextT);
 						remaining -= nextT;
 						nextN -= nextT;
 						noise.advanceFast(nextT);
@@ -919,7 +981,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 						val1 ^= volume;
 						val2 = val1 * noise.getOutput();
 					} else if (nextN < nextT) {
-						addFill(buf, val2, nextN);
+						out.fill(val2, nextN);
 						remaining -= nextN;
 						nextT -= nextN;
 						t.advanceFast(nextN);
@@ -928,7 +990,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 						val2 = val1 * noise.getOutput();
 					} else {
 						assert(nextT == nextN);
-						addFill(buf, val2, nextT);
+						out.fill(val2, nextT);
 						remaining -= nextT;
 						t.doNextEvent(*this);
 						nextT = t.getNextEventTime();
@@ -940,7 +1002,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val2, remaining);
+					out.fill(val2, remaining);
 					t.advanceFast(remaining);
 					noise.advanceFast(remaining);
 				}
@@ -952,7 +1014,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				unsigned val = noise.getOutput() * volume;
 				unsigned next = noise.getNextEventTime();
 				while (next <= remaining) {
-					addFill(buf, val, next);
+					out.fill(val, next);
 					remaining -= next;
 					noise.doNextEvent();
 					val = noise.getOutput() * volume;
@@ -960,7 +1022,7 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 				}
 				if (remaining) {
 					// last interval (without events)
-					addFill(buf, val, remaining);
+					out.fill(val, remaining);
 					noise.advanceFast(remaining);
 				}
 				t.advance(length);
@@ -974,6 +1036,23 @@ void AY8910::generateChannels(int** bufs, unsigned length)
 	}
 }
 
+void AY8910::generateChannels(int** bufs, unsigned length)
+{
+	SampleOutput outputs[3] = {
+		SampleOutput(bufs[0]), SampleOutput(bufs[1]), SampleOutput(bufs[2])
+	};
+	generate(outputs, length);
+}
+
+bool AY8910::generateChannelDeltas(BlipDeltas& deltas, unsigned length)
+{
+	DeltaOutput outputs[3] = {
+		DeltaOutput(deltas), DeltaOutput(deltas), DeltaOutput(deltas)
+	};
+	generate(outputs, length);
+	return true;
+}
+
 void AY8910::update(const Setting& setting)
 {
 	if ((&setting == &vibratoPercent) ||
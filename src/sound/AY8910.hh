@@ -153,7 +153,17 @@ private:
 	};
 
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
+	bool generateChannelDeltas(BlipDeltas& deltas, unsigned num) override;
+	void skipChannels(unsigned num) override;
+
+	class SampleOutput;
+	class DeltaOutput;
+	template<typename Output>
+	void generate(Output* outputs, unsigned length);
+
+	inline bool isChannelSilent(unsigned chan) const;
 
 	// Observer<Setting>
 	void update(const Setting& setting) override;
@@ -0,0 +1,71 @@
+#ifndef BLIPDELTAS_HH
+#define BLIPDELTAS_HH
+
+#include "BlipBuffer.hh"
+#include "FixedPoint.hh"
+
+namespace openmsx {
+
+/** Passes the changes in the output level of a sound device to a
+  * BlipBuffer. The device tells at which of its own (input) samples the
+  * level changes, this class converts that to a time in output samples.
+  * Used by ResampleBlip for devices that implement
+  * SoundDevice::generateChannelDeltas().
+  */
+class BlipDeltas
+{
+public:
+	using FP = FixedPoint<16>;
+
+	/** @param blip_ The buffer that receives the changes.
+	  * @param pos1_ Time of the first input sample, in output samples.
+	  * @param step_ Duration of one input sample, in output samples.
+	  * @param lastLevel Output level at the end of the previous block.
+	  */
+	BlipDeltas(BlipBuffer& blip_, FP pos1_, FP step_, int lastLevel)
+		: blip(blip_), pos1(pos1_), step(step_)
+		, startDelta(-lastLevel), level(0)
+	{
+	}
+
+	/** Starting from input sample 'time' (counted from the start of the
+	  * block) the output level changes by 'delta'. In each block the
+	  * changes are relative to silence, so at time 0 the device must
+	  * report its complete initial output level.
+	  */
+	void addDelta(unsigned time, int delta)
+	{
+		level += delta;
+		if (time == 0) {
+			// Typically the level doesn't change at the start of
+			// the block, combine these so that they cancel out.
+			startDelta += delta;
+		} else {
+			blip.addDelta(BlipBuffer::TimeIndex(pos1 + step * time),
+			              delta);
+		}
+	}
+
+	/** Must be called after all changes of the block were added.
+	  * @result The output level at the end of the block.
+	  */
+	int flush()
+	{
+		if (startDelta) {
+			blip.addDelta(BlipBuffer::TimeIndex(pos1), startDelta);
+			startDelta = 0;
+		}
+		return level;
+	}
+
+private:
+	BlipBuffer& blip;
+	const FP pos1;
+	const FP step;
+	int startDelta;
+	int level;
+};
+
+} // namespace openmsx
+
+#endif
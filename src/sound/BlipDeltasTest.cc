@@ -0,0 +1,150 @@
+// Checks that passing the output changes of a sound device to a BlipBuffer
+// via BlipDeltas gives exactly the same sound as generating all samples and
+// scanning them for changes (like ResampleBlip does for devices without
+// SoundDevice::generateChannelDeltas()). Also measures both approaches for
+// a PSG-like device: a few square waves with a low frequency compared to
+// the sample rate.
+//
+// Usage: BlipDeltasTest [<seconds>]
+
+#include "BlipBuffer.hh"
+#include "BlipDeltas.hh"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+using FP = BlipDeltas::FP;
+
+static const unsigned INPUT_RATE = 111861; // like AY8910
+static const unsigned OUTPUT_RATE = 44100;
+static const unsigned BLOCK = INPUT_RATE / 60; // input samples per mixer call
+static const unsigned CHANNELS = 3;
+
+// A square wave generator, counts in input samples.
+struct Tone
+{
+	unsigned period; // half period, 0 means silent
+	unsigned count;
+	int volume;
+	bool high;
+};
+
+static void generateSamples(Tone* tones, int* buf, unsigned num)
+{
+	for (unsigned i = 0; i < num; ++i) buf[i] = 0;
+	for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+		auto& t = tones[ch];
+		for (unsigned i = 0; i < num; ++i) {
+			if (t.high) buf[i] += t.volume;
+			if (t.period && (++t.count == t.period)) {
+				t.count = 0;
+				t.high = !t.high;
+			}
+		}
+	}
+}
+
+static void generateDeltas(Tone* tones, BlipDeltas& deltas, unsigned num)
+{
+	for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+		auto& t = tones[ch];
+		if (t.high) deltas.addDelta(0, t.volume);
+		if (!t.period) continue;
+		unsigned i = t.period - t.count;
+		for (; i < num; i += t.period) {
+			t.high = !t.high;
+			deltas.addDelta(i, t.high ? t.volume : -t.volume);
+		}
+		if (i == num) t.high = !t.high;
+		t.count = num - (i - t.period);
+		if (t.count == t.period) t.count = 0;
+	}
+}
+
+// Like ResampleBlip::generateSamples(), for a single channel.
+static int scanSamples(BlipBuffer& blip, const int* buf, unsigned num,
+                       FP pos, FP step, int last)
+{
+	for (unsigned i = 0; i < num; ++i) {
+		int delta = buf[i] - last;
+		if (delta) {
+			last = buf[i];
+			blip.addDelta(BlipBuffer::TimeIndex(pos), delta);
+		}
+		pos += step;
+	}
+	return last;
+}
+
+static void randomize(minstd_rand& random, Tone* tones)
+{
+	for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+		auto& t = tones[ch];
+		if ((random() % 4) == 0) {
+			t.period = (random() % 8) ? (8 + random() % 500) : 0;
+			t.count = 0;
+		}
+		if ((random() % 3) == 0) {
+			t.volume = int(random() % 16) * 1000;
+		}
+	}
+}
+
+static double run(bool useDeltas, unsigned seconds, vector<int>& output)
+{
+	minstd_rand random(1234);
+	Tone tones[CHANNELS] = {};
+	BlipBuffer blip;
+	vector<int> buf(BLOCK);
+	int out[OUTPUT_RATE / 10];
+	const FP step = FP::roundRatioDown(OUTPUT_RATE, INPUT_RATE);
+	FP pos(0); // time of the next input sample, in output samples
+	int last = 0;
+	output.clear();
+	double total = 0.0;
+	for (unsigned b = 0; b < seconds * 60; ++b) {
+		randomize(random, tones);
+		auto start = chrono::high_resolution_clock::now();
+		if (useDeltas) {
+			BlipDeltas deltas(blip, pos, step, last);
+			generateDeltas(tones, deltas, BLOCK);
+			last = deltas.flush();
+		} else {
+			generateSamples(tones, buf.data(), BLOCK);
+			last = scanSamples(blip, buf.data(), BLOCK, pos, step, last);
+		}
+		pos += step * int(BLOCK);
+		unsigned num = pos.toInt();
+		pos -= FP(num);
+		if (!blip.readSamples<1>(out, num)) {
+			for (unsigned i = 0; i < num; ++i) out[i] = 0;
+		}
+		auto stop = chrono::high_resolution_clock::now();
+		total += chrono::duration<double>(stop - start).count();
+		output.insert(output.end(), out, out + num);
+	}
+	return total;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned seconds = (argc > 1) ? atoi(argv[1]) : 60;
+	vector<int> ref, out;
+	double t0 = run(false, seconds, ref);
+	double t1 = run(true,  seconds, out);
+	cout << seconds << "s of sound, generate samples: " << fixed
+	     << setprecision(2) << t0 * 1000 << "ms, pass changes: "
+	     << t1 * 1000 << "ms (" << t0 / t1 << "x)" << endl;
+	if (out != ref) {
+		cout << "FAILED: output differs" << endl;
+		return 1;
+	}
+	cout << "All tests passed." << endl;
+	return 0;
+}
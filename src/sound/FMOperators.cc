@@ -0,0 +1,95 @@
+#include "FMOperators.hh"
+#include "HostCPU.hh"
+#include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace openmsx {
+namespace FMOperators {
+
+#if HAVE_AVX2_DISPATCH
+TARGET_AVX2 static void advancePhasesAVX2(
+	int* cnt, const int* incr, unsigned num)
+{
+	for (unsigned i = 0; i < num; i += 8) {
+		auto c = _mm256_loadu_si256(reinterpret_cast<__m256i*>(cnt + i));
+		auto d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(incr + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(cnt + i),
+		                    _mm256_add_epi32(c, d));
+	}
+}
+
+TARGET_AVX2 static uint64_t findEnvelopeStepsAVX2(
+	const unsigned* egMask, unsigned egCnt, unsigned num)
+{
+	auto cnt = _mm256_set1_epi32(egCnt);
+	auto zero = _mm256_setzero_si256();
+	uint64_t result = 0;
+	for (unsigned i = 0; i < num; i += 8) {
+		auto m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(egMask + i));
+		auto due = _mm256_cmpeq_epi32(_mm256_and_si256(m, cnt), zero);
+		unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(due));
+		result |= uint64_t(bits) << i;
+	}
+	return result;
+}
+#endif
+
+void advancePhases(int* cnt, const int* incr, unsigned num)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		advancePhasesAVX2(cnt, incr, num);
+		return;
+	}
+#endif
+#ifdef __SSE2__
+	for (unsigned i = 0; i < num; i += 4) {
+		auto c = _mm_loadu_si128(reinterpret_cast<__m128i*>(cnt + i));
+		auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(incr + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(cnt + i),
+		                 _mm_add_epi32(c, d));
+	}
+#else
+	for (unsigned i = 0; i < num; ++i) {
+		// unsigned arithmetic, signed overflow is undefined
+		cnt[i] = int(unsigned(cnt[i]) + unsigned(incr[i]));
+	}
+#endif
+}
+
+uint64_t findEnvelopeSteps(const unsigned* egMask, unsigned egCnt, unsigned num)
+{
+	assert(num <= 64);
+	uint64_t result = 0;
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		result = findEnvelopeStepsAVX2(egMask, egCnt, num);
+	} else
+#endif
+	{
+#ifdef __SSE2__
+		auto cnt = _mm_set1_epi32(egCnt);
+		auto zero = _mm_setzero_si128();
+		for (unsigned i = 0; i < num; i += 4) {
+			auto m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(egMask + i));
+			auto due = _mm_cmpeq_epi32(_mm_and_si128(m, cnt), zero);
+			unsigned bits = _mm_movemask_ps(_mm_castsi128_ps(due));
+			result |= uint64_t(bits) << i;
+		}
+#else
+		for (unsigned i = 0; i < num; ++i) {
+			if (!(egCnt & egMask[i])) result |= uint64_t(1) << i;
+		}
+#endif
+	}
+	// drop the bits of the padding elements
+	return (num == 64) ? result : (result & ((uint64_t(1) << num) - 1));
+}
+
+} // namespace FMOperators
+} // namespace openmsx
@@ -0,0 +1,34 @@
+#ifndef FMOPERATORS_HH
+#define FMOPERATORS_HH
+
+#include <cstdint>
+
+// Helper functions for FM sound chips that keep the phase and envelope
+// generator state of their operators in structure-of-arrays form. They
+// update 4 (SSE2) or 8 (AVX2, see HostCPU) operators at once.
+//
+// The arrays must have room for 'num' rounded up to a multiple of 8
+// elements; the elements beyond 'num' are ignored (but advancePhases() may
+// change them).
+
+namespace openmsx {
+namespace FMOperators {
+
+	/** Advance the phase generators of 'num' operators:
+	  *   cnt[i] += incr[i]
+	  * The counters wrap around on overflow.
+	  */
+	void advancePhases(int* cnt, const int* incr, unsigned num);
+
+	/** Find the envelope generators that must be updated for the given
+	  * value of the envelope counter: bit 'i' of the result is set iff
+	  *   (egCnt & egMask[i]) == 0
+	  * 'num' can be at most 64.
+	  */
+	uint64_t findEnvelopeSteps(const unsigned* egMask, unsigned egCnt,
+	                           unsigned num);
+
+} // namespace FMOperators
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,85 @@
+// Tests the two per-sample loops that YMF262 hands to FMOperators:
+// advancePhases() must wrap each phase counter modulo 2^32, and
+// findEnvelopeSteps() must set bit i exactly when (egCnt & egMask[i]) == 0.
+// Uses YMF262-like masks and operator counts from 1 to 64, so that the
+// tails after the last full AVX2 vector are covered too.
+//
+// Usage: FMOperatorsTest
+
+#include "FMOperators.hh"
+#include "HostCPU.hh"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+static const unsigned MAX_OPS = 64;
+
+static int testPhases(minstd_rand& random, unsigned num, bool avx2)
+{
+	vector<int> cnt(MAX_OPS), incr(MAX_OPS);
+	for (auto& c : cnt)  c = int(random() << 1);
+	for (auto& i : incr) i = int(random() & 0xFFFFF);
+	auto ref = cnt;
+	for (unsigned i = 0; i < num; ++i) {
+		ref[i] = int(unsigned(ref[i]) + unsigned(incr[i]));
+	}
+	FMOperators::advancePhases(cnt.data(), incr.data(), num);
+	for (unsigned i = 0; i < num; ++i) {
+		if (cnt[i] != ref[i]) {
+			cout << "FAILED: advancePhases, num=" << num
+			     << (avx2 ? " avx2" : "") << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int testEnvelopes(minstd_rand& random, unsigned num, bool avx2)
+{
+	vector<unsigned> egMask(MAX_OPS);
+	for (auto& m : egMask) {
+		// like the YMF262 masks: (1 << shift) - 1, or all ones
+		unsigned shift = random() % 14;
+		m = (shift == 13) ? ~0u : (1u << shift) - 1;
+	}
+	for (unsigned egCnt : { 0u, 1u, 0x1000u, unsigned(random()), ~0u }) {
+		uint64_t ref = 0;
+		for (unsigned i = 0; i < num; ++i) {
+			if (!(egCnt & egMask[i])) ref |= uint64_t(1) << i;
+		}
+		auto steps = FMOperators::findEnvelopeSteps(egMask.data(), egCnt, num);
+		if (steps != ref) {
+			cout << "FAILED: findEnvelopeSteps, num=" << num
+			     << " egCnt=" << egCnt << (avx2 ? " avx2" : "") << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int main()
+{
+	HostCPU::setAVX2(true);
+	if (!HostCPU::hasAVX2()) {
+		cout << "This CPU doesn't support AVX2, only testing the "
+		        "other code paths." << endl;
+	}
+	int errors = 0;
+	minstd_rand random(42);
+	for (unsigned iter = 0; iter < 100; ++iter) {
+		for (unsigned num = 1; num <= MAX_OPS; ++num) {
+			for (bool avx2 : {false, true}) {
+				HostCPU::setAVX2(avx2);
+				if (avx2 && !HostCPU::hasAVX2()) continue;
+				errors += testPhases(random, num, avx2);
+				errors += testEnvelopes(random, num, avx2);
+			}
+		}
+	}
+	if (errors == 0) cout << "All tests passed." << endl;
+	return errors ? 1 : 0;
+}
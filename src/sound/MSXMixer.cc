@@ -2,6 +2,8 @@
 #include "Mixer.hh"
 #include "SoundDevice.hh"
 #include "MSXMotherBoard.hh"
+#include "ThreadPool.hh"
+#include "Thread.hh"
 #include "MSXCommandController.hh"
 #include "TclObject.hh"
 #include "ThrottleManager.hh"
@@ -44,11 +46,13 @@ MSXMixer::MSXMixer(Mixer& mixer_, MSXMotherBoard& motherBoard_,
 	, commandController(motherBoard.getMSXCommandController())
 	, masterVolume(mixer.getMasterVolume())
 	, speedSetting(globalSettings.getSpeedSetting())
+	, parallelSoundSetting(mixer.getParallelSoundSetting())
 	, throttleManager(globalSettings.getThrottleManager())
 	, prevTime(getCurrentTime(), 44100)
 	, soundDeviceInfo(commandController.getMachineInfoCommand())
 	, recorder(nullptr)
 	, synchronousCounter(0)
+	, skipSilence(true)
 {
 	hostSampleRate = 44100;
 	fragmentSize = 0;
@@ -488,33 +492,81 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 	static const unsigned HAS_STEREO_FLAG = 2;
 	unsigned usedBuffers = 0;
 
+	// Let the sound devices produce their output. Normally each device
+	// generates its output right before it gets mixed. When there are
+	// enough samples to make it worthwhile, all devices first generate
+	// their output in parallel, each in its own buffer. This works because
+	// the devices don't share any state. The mixing below always happens
+	// sequentially and in the same order, so the result is exactly the
+	// same in both cases. Silent devices need almost no time (see
+	// SoundDevice::isSilent()), so they don't count.
+	unsigned numDevices = unsigned(infos.size());
+	unsigned pitch = (2 * samples + 3 + 3) & ~3; // align for SSE access
+	bool parallel = (numDevices > 1) &&
+	                (samples >= MIN_PARALLEL_SAMPLES) &&
+	                parallelSoundSetting.getBoolean() &&
+	                Thread::isMainThread() &&
+	                (count_if(begin(infos), end(infos),
+	                          [](const SoundDeviceInfo& info) {
+	                              return !info.device->isSilent(); }) > 1);
+	if (parallel) {
+		deviceBuffers.resize(pitch * numDevices);
+		deviceHasOutput.resize(numDevices);
+		mixer.getSoundThreadPool().parallelFor(
+			numDevices, [&](unsigned i) {
+				deviceHasOutput[i] = infos[i].device->updateBuffer(
+					samples, &deviceBuffers[pitch * i], time);
+			});
+	}
+	// Get the output of the i-th device, either by generating it now in
+	// 'buf' or by returning the already generated buffer. Returns nullptr
+	// when the output is silent.
+	auto getOutput = [&](unsigned i, int32_t* buf) -> const int32_t* {
+		if (parallel) {
+			return deviceHasOutput[i] ? &deviceBuffers[pitch * i] : nullptr;
+		}
+		return infos[i].device->updateBuffer(samples, buf, time)
+		     ? buf : nullptr;
+	};
+	// Like getOutput(), but the output always ends up in 'buf'.
+	auto getOutputIn = [&](unsigned i, int32_t* buf) {
+		const int32_t* out = getOutput(i, buf);
+		if (!out) return false;
+		if (out != buf) {
+			unsigned num = (infos[i].device->isStereo() ? 2 : 1) * samples;
+			memcpy(buf, out, num * sizeof(int32_t));
+		}
+		return true;
+	};
+
 	// FIXME: The Infos should be ordered such that all the mono
 	// devices are handled first
-	for (auto& info : infos) {
+	for (unsigned i = 0; i < numDevices; ++i) {
+		auto& info = infos[i];
 		SoundDevice& device = *info.device;
 		int l1 = info.left1;
 		int r1 = info.right1;
 		if (!device.isStereo()) {
 			if (l1 == r1) {
 				if (!(usedBuffers & HAS_MONO_FLAG)) {
-					if (device.updateBuffer(samples, monoBuf, time)) {
+					if (getOutputIn(i, monoBuf)) {
 						usedBuffers |= HAS_MONO_FLAG;
 						mul(monoBuf, samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(monoBuf, tmpBuf, samples, l1);
+					if (auto* in = getOutput(i, tmpBuf)) {
+						mulAcc(monoBuf, in, samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (getOutputIn(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulExpand(stereoBuf, samples, l1, r1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulExpandAcc(stereoBuf, tmpBuf, samples, l1, r1);
+					if (auto* in = getOutput(i, tmpBuf)) {
+						mulExpandAcc(stereoBuf, in, samples, l1, r1);
 					}
 				}
 			}
@@ -525,24 +577,24 @@ void MSXMixer::generate(int16_t* output, EmuTime::param time, unsigned samples)
 				assert(l2 == 0);
 				assert(r1 == 0);
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (getOutputIn(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mul(stereoBuf, 2 * samples, l1);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulAcc(stereoBuf, tmpBuf, 2 * samples, l1);
+					if (auto* in = getOutput(i, tmpBuf)) {
+						mulAcc(stereoBuf, in, 2 * samples, l1);
 					}
 				}
 			} else {
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					if (device.updateBuffer(samples, stereoBuf, time)) {
+					if (getOutputIn(i, stereoBuf)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulMix2(stereoBuf, samples, l1, l2, r1, r2);
 					}
 				} else {
-					if (device.updateBuffer(samples, tmpBuf, time)) {
-						mulMix2Acc(stereoBuf, tmpBuf, samples, l1, l2, r1, r2);
+					if (auto* in = getOutput(i, tmpBuf)) {
+						mulMix2Acc(stereoBuf, in, samples, l1, l2, r1, r2);
 					}
 				}
 			}
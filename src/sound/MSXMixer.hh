@@ -6,6 +6,7 @@
 #include "InfoTopic.hh"
 #include "EmuTime.hh"
 #include "DynamicClock.hh"
+#include "MemBuffer.hh"
 #include <cstdint>
 #include <vector>
 #include <memory>
@@ -102,6 +103,13 @@ public:
 
 	SoundDevice* findDevice(string_ref name) const;
 
+	/** Silent devices are skipped while mixing (see
+	  * SoundDevice::isSilent()). Only turned off to measure how much
+	  * that saves (SoundSpeedTest).
+	  */
+	void setSkipSilence(bool enabled) { skipSilence = enabled; }
+	bool getSkipSilence() const { return skipSilence; }
+
 	void reInit();
 
 private:
@@ -124,6 +132,11 @@ private:
 	void reschedule2();
 	void generate(int16_t* buffer, EmuTime::param time, unsigned samples);
 
+	/** Below this number of samples the sound devices are never
+	  * generated in parallel, the overhead would be bigger than the gain.
+	  */
+	static const unsigned MIN_PARALLEL_SAMPLES = 128;
+
 	// Schedulable
 	void executeUntil(EmuTime::param time) override;
 
@@ -147,6 +160,7 @@ private:
 
 	IntegerSetting& masterVolume;
 	IntegerSetting& speedSetting;
+	BooleanSetting& parallelSoundSetting;
 	ThrottleManager& throttleManager;
 
 	DynamicClock prevTime;
@@ -163,7 +177,13 @@ private:
 	unsigned synchronousCounter;
 
 	unsigned muteCount;
+	bool skipSilence;
 	int32_t tl0, tr0; // internal DC-filter state
+
+	// output of the individual sound devices (only used when they are
+	// generated in parallel, see generate())
+	MemBuffer<int32_t, SSE2_ALIGNMENT> deviceBuffers;
+	std::vector<char> deviceHasOutput;
 };
 
 } // namespace openmsx
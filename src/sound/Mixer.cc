@@ -5,12 +5,16 @@
 #include "CommandController.hh"
 #include "CliComm.hh"
 #include "MSXException.hh"
+#include "ThreadPool.hh"
+#include "Thread.hh"
 #include "memory.hh"
 #include "stl.hh"
 #include "unreachable.hh"
 #include "components.hh"
 #include "build-info.hh"
+#include <algorithm>
 #include <cassert>
+#include <thread>
 
 namespace openmsx {
 
@@ -22,6 +26,10 @@ static const int defaultsamples = 2560;
 static const int defaultsamples = 1024;
 #endif
 
+// The main thread also generates sound, and usually only a few sound devices
+// are not silent.
+static const unsigned MAX_SOUND_THREADS = 3;
+
 static EnumSetting<Mixer::SoundDriverType>::Map getSoundDriverMap()
 {
 	EnumSetting<Mixer::SoundDriverType>::Map soundDriverMap = {
@@ -49,6 +57,10 @@ Mixer::Mixer(Reactor& reactor_, CommandController& commandController_)
 	, samplesSetting(
 		commandController, "samples",
 		"mixer samples", defaultsamples, 64, 8192)
+	, parallelSoundSetting(
+		commandController, "parallel_sound",
+		"generate the sound of different sound chips in parallel",
+		true)
 	, muteCount(0)
 {
 	muteSetting       .attach(*this);
@@ -73,6 +85,18 @@ Mixer::~Mixer()
 	muteSetting       .detach(*this);
 }
 
+ThreadPool& Mixer::getSoundThreadPool()
+{
+	assert(Thread::isMainThread());
+	if (!soundThreadPool) {
+		unsigned num = std::min(
+			std::max(2u, std::thread::hardware_concurrency()) - 1,
+			MAX_SOUND_THREADS);
+		soundThreadPool = make_unique<ThreadPool>(num);
+	}
+	return *soundThreadPool;
+}
+
 void Mixer::reloadDriver()
 {
 	// Destroy old driver before attempting to create a new one. Though
@@ -14,6 +14,7 @@ class SoundDriver;
 class Reactor;
 class CommandController;
 class MSXMixer;
+class ThreadPool;
 
 class Mixer final : private Observer<Setting>
 {
@@ -46,6 +47,15 @@ public:
 	void uploadBuffer(MSXMixer& msxMixer, int16_t* buffer, unsigned len);
 
 	IntegerSetting& getMasterVolume() { return masterVolume; }
+	BooleanSetting& getParallelSoundSetting() { return parallelSoundSetting; }
+	/** Worker threads for the parallel sound generation in MSXMixer, only
+	  * to be used from the main thread. Not shared with other work (like
+	  * Reactor::getThreadPool()), so that the sound devices don't have to
+	  * wait behind long running tasks. Created on first use. */
+	ThreadPool& getSoundThreadPool();
+	EnumSetting<SoundDriverType>& getSoundDriverSetting() {
+		return soundDriverSetting;
+	}
 
 private:
 	void reloadDriver();
@@ -57,6 +67,7 @@ private:
 	std::vector<MSXMixer*> msxMixers; // unordered
 
 	std::unique_ptr<SoundDriver> driver;
+	std::unique_ptr<ThreadPool> soundThreadPool;
 	Reactor& reactor;
 	CommandController& commandController;
 
@@ -65,6 +76,7 @@ private:
 	IntegerSetting masterVolume;
 	IntegerSetting frequencySetting;
 	IntegerSetting samplesSetting;
+	BooleanSetting parallelSoundSetting;
 
 	int muteCount;
 };
@@ -1,5 +1,6 @@
 #include "ResampleBlip.hh"
 #include "ResampledSoundDevice.hh"
+#include "BlipDeltas.hh"
 #include "likely.hh"
 #include "vla.hh"
 #include <algorithm>
@@ -19,59 +20,80 @@ ResampleBlip<CHANNELS>::ResampleBlip(
 	for (auto& l : lastInput) l = 0;
 }
 
+template <unsigned CHANNELS>
+bool ResampleBlip<CHANNELS>::generateDeltas(EmuTime::param emu1, unsigned emuNum)
+{
+	FP pos1;
+	hostClock.getTicksTill(emu1, pos1);
+	BlipDeltas deltas(blip[0], pos1, step, lastInput[0]);
+	if (!input.generateInputDeltas(deltas, emuNum)) return false;
+	lastInput[0] = deltas.flush();
+	return true;
+}
+
+template <unsigned CHANNELS>
+void ResampleBlip<CHANNELS>::generateSamples(EmuTime::param emu1, unsigned emuNum)
+{
+	// 3 extra for padding, CHANNELS extra for sentinel
+	// Clang will produce a link error if the length expression is put
+	// inside the macro.
+	const unsigned len = emuNum * CHANNELS + std::max(3u, CHANNELS);
+	VLA_SSE_ALIGNED(int, buf, len);
+	if (input.generateInput(buf, emuNum)) {
+		FP pos1;
+		hostClock.getTicksTill(emu1, pos1);
+		for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+			// In case of PSG (and to a lesser degree SCC) it happens
+			// very often that two consecutive samples have the same
+			// value. We can benefit from this by setting a sentinel
+			// at the end of the buffer and move the end-of-loop test
+			// into the 'samples differ' branch.
+			assert(emuNum > 0);
+			buf[CHANNELS * emuNum + ch] =
+				buf[CHANNELS * (emuNum - 1) + ch] + 1;
+			FP pos = pos1;
+			int last = lastInput[ch]; // local var is slightly faster
+			for (unsigned i = 0; /**/; ++i) {
+				int delta = buf[CHANNELS * i + ch] - last;
+				if (unlikely(delta != 0)) {
+					if (i == emuNum) {
+						break;
+					}
+					last = buf[CHANNELS * i + ch];
+					blip[ch].addDelta(
+						BlipBuffer::TimeIndex(pos),
+						delta);
+				}
+				pos += step;
+			}
+			lastInput[ch] = last;
+		}
+	} else {
+		// input all zero
+		BlipBuffer::TimeIndex pos;
+		hostClock.getTicksTill(emu1, pos);
+		for (unsigned ch = 0; ch < CHANNELS; ++ch) {
+			if (lastInput[ch] != 0) {
+				int delta = -lastInput[ch];
+				lastInput[ch] = 0;
+				blip[ch].addDelta(pos, delta);
+			}
+		}
+	}
+}
+
 template <unsigned CHANNELS>
 bool ResampleBlip<CHANNELS>::generateOutput(int* dataOut, unsigned hostNum,
                                             EmuTime::param time)
 {
 	unsigned emuNum = emuClock.getTicksTill(time);
 	if (emuNum > 0) {
-		// 3 extra for padding, CHANNELS extra for sentinel
-		// Clang will produce a link error if the length expression is put
-		// inside the macro.
-		const unsigned len = emuNum * CHANNELS + std::max(3u, CHANNELS);
-		VLA_SSE_ALIGNED(int, buf, len);
 		EmuTime emu1 = emuClock.getFastAdd(1); // time of 1st emu-sample
 		assert(emu1 > hostClock.getTime());
-		if (input.generateInput(buf, emuNum)) {
-			FP pos1;
-			hostClock.getTicksTill(emu1, pos1);
-			for (unsigned ch = 0; ch < CHANNELS; ++ch) {
-				// In case of PSG (and to a lesser degree SCC) it happens
-				// very often that two consecutive samples have the same
-				// value. We can benefit from this by setting a sentinel
-				// at the end of the buffer and move the end-of-loop test
-				// into the 'samples differ' branch.
-				assert(emuNum > 0);
-				buf[CHANNELS * emuNum + ch] =
-					buf[CHANNELS * (emuNum - 1) + ch] + 1;
-				FP pos = pos1;
-				int last = lastInput[ch]; // local var is slightly faster
-				for (unsigned i = 0; /**/; ++i) {
-					int delta = buf[CHANNELS * i + ch] - last;
-					if (unlikely(delta != 0)) {
-						if (i == emuNum) {
-							break;
-						}
-						last = buf[CHANNELS * i + ch];
-						blip[ch].addDelta(
-							BlipBuffer::TimeIndex(pos),
-							delta);
-					}
-					pos += step;
-				}
-				lastInput[ch] = last;
-			}
-		} else {
-			// input all zero
-			BlipBuffer::TimeIndex pos;
-			hostClock.getTicksTill(emu1, pos);
-			for (unsigned ch = 0; ch < CHANNELS; ++ch) {
-				if (lastInput[ch] != 0) {
-					int delta = -lastInput[ch];
-					lastInput[ch] = 0;
-					blip[ch].addDelta(pos, delta);
-				}
-			}
+		// Devices that can directly report the changes in their output
+		// don't have to generate (and scan) all their samples.
+		if (!((CHANNELS == 1) && generateDeltas(emu1, emuNum))) {
+			generateSamples(emu1, emuNum);
 		}
 		emuClock += emuNum;
 		assert(emuClock.getTime() <= time);
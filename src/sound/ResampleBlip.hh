@@ -20,6 +20,9 @@ public:
 	                    EmuTime::param time) override;
 
 private:
+	bool generateDeltas(EmuTime::param emu1, unsigned emuNum);
+	void generateSamples(EmuTime::param emu1, unsigned emuNum);
+
 	BlipBuffer blip[CHANNELS];
 	ResampledSoundDevice& input;
 	const DynamicClock& hostClock; // time of the last host-sample,
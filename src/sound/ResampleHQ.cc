@@ -12,6 +12,7 @@
 #include "ResampleHQ.hh"
 #include "ResampledSoundDevice.hh"
 #include "FixedPoint.hh"
+#include "HostCPU.hh"
 #include "MemBuffer.hh"
 #include "countof.hh"
 #include "likely.hh"
@@ -27,6 +28,9 @@
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -60,6 +64,7 @@ private:
 	~ResampleCoeffs();
 
 	Table calcTable(double ratio, int16_t* permute, unsigned& filterLen);
+	void dropUnused();
 
 	struct Element {
 		double ratio;
@@ -71,9 +76,16 @@ private:
 	std::vector<Element> cache; // typically 1-4 entries -> unsorted vector
 };
 
+// Tables that are no longer used are kept (up to this total size), they're
+// often needed again soon. E.g. when toggling fast-forward or changing the
+// speed setting back, recalculating them takes a few milliseconds for each
+// input sample rate.
+static const size_t MAX_UNUSED_SIZE = 16 * 1024 * 1024; // in bytes
+
 ResampleCoeffs::~ResampleCoeffs()
 {
-	assert(cache.empty());
+	assert(std::all_of(begin(cache), end(cache),
+		[](const Element& e) { return e.count == 0; }));
 }
 
 ResampleCoeffs& ResampleCoeffs::instance()
@@ -111,7 +123,26 @@ void ResampleCoeffs::releaseCoeffs(double ratio)
 		[=](const Element& e) { return e.ratio == ratio; });
 	it->count--;
 	if (it->count == 0) {
-		move_pop_back(cache, it);
+		// Move to the end, so that the unused tables are ordered
+		// from least to most recently used.
+		std::rotate(it, it + 1, end(cache));
+		dropUnused();
+	}
+}
+
+void ResampleCoeffs::dropUnused()
+{
+	size_t unusedSize = 0;
+	for (auto& e : cache) {
+		if (e.count == 0) {
+			unusedSize += HALF_TAB_LEN * e.filterLen * sizeof(float);
+		}
+	}
+	while (unusedSize > MAX_UNUSED_SIZE) {
+		auto it = find_if_unguarded(cache,
+			[](const Element& e) { return e.count == 0; });
+		unusedSize -= HALF_TAB_LEN * it->filterLen * sizeof(float);
+		cache.erase(it);
 	}
 }
 
@@ -529,23 +560,209 @@ static inline void calcSseStereo(const float* buf_, const float* tab_, size_t le
 
 #endif
 
-template <unsigned CHANNELS>
-void ResampleHQ<CHANNELS>::calcOutput(
-	float pos, int* __restrict output)
+#if HAVE_AVX2_DISPATCH
+// Like calcSseMono() and calcSseStereo(), but these calculate two output
+// samples at once (they use different input samples and table rows). The two
+// independent dot products keep more (fused) multiply-adds in flight.
+//
+// A reversed row is read from lower to higher addresses, the order of the
+// elements is reversed with a permute. For the 2nd half of the table 'tab'
+// points to the end of the row, see ResampleHQ::getTable().
+
+TARGET_AVX2 static inline __m128 hsum(__m256 a, __m256 b)
 {
-	assert((filterLen & 3) == 0);
+	__m256 s = _mm256_add_ps(a, b);
+	return _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+}
+
+TARGET_AVX2 static void calcAvx2Mono(
+	const float* buf1, const float* tab1, bool rev1,
+	const float* buf2, const float* tab2, bool rev2,
+	size_t len, int* out1, int* out2)
+{
+	assert((len % 4) == 0);
+
+	const __m256i fwd = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i rev = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+	__m256i perm1 = rev1 ? rev : fwd;
+	__m256i perm2 = rev2 ? rev : fwd;
+	ptrdiff_t step1 = rev1 ? -8 : 8;
+	ptrdiff_t step2 = rev2 ? -8 : 8;
+	if (rev1) tab1 -= 8;
+	if (rev2) tab2 -= 8;
+
+	__m256 a1 = _mm256_setzero_ps();
+	__m256 b1 = _mm256_setzero_ps();
+	__m256 a2 = _mm256_setzero_ps();
+	__m256 b2 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (/**/; (i + 16) <= len; i += 16) {
+		__m256 t1a = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab1), perm1);
+		__m256 t1b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab1 + step1), perm1);
+		__m256 t2a = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab2), perm2);
+		__m256 t2b = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab2 + step2), perm2);
+		a1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + i + 0), t1a, a1);
+		b1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + i + 8), t1b, b1);
+		a2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + i + 0), t2a, a2);
+		b2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + i + 8), t2b, b2);
+		tab1 += 2 * step1;
+		tab2 += 2 * step2;
+	}
+	if (len & 8) {
+		__m256 t1 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab1), perm1);
+		__m256 t2 = _mm256_permutevar8x32_ps(_mm256_loadu_ps(tab2), perm2);
+		a1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + i), t1, a1);
+		a2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + i), t2, a2);
+		tab1 += step1;
+		tab2 += step2;
+		i += 8;
+	}
+	__m128 s1 = hsum(a1, b1);
+	__m128 s2 = hsum(a2, b2);
+	if (len & 4) {
+		// last 4 elements, reversed rows: the upper half of the last 8
+		__m128 t1 = rev1 ? _mm_shuffle_ps(_mm_loadu_ps(tab1 + 4), _mm_loadu_ps(tab1 + 4), 0x1B)
+		                 : _mm_loadu_ps(tab1);
+		__m128 t2 = rev2 ? _mm_shuffle_ps(_mm_loadu_ps(tab2 + 4), _mm_loadu_ps(tab2 + 4), 0x1B)
+		                 : _mm_loadu_ps(tab2);
+		s1 = _mm_fmadd_ps(_mm_loadu_ps(buf1 + i), t1, s1);
+		s2 = _mm_fmadd_ps(_mm_loadu_ps(buf2 + i), t2, s2);
+	}
+
+	// both horizontal sums at once
+	__m128 s = _mm_add_ps(_mm_unpacklo_ps(s1, s2), _mm_unpackhi_ps(s1, s2));
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	__m128i si = _mm_cvtps_epi32(s);
+	*out1 = _mm_cvtsi128_si32(si);
+	*out2 = _mm_cvtsi128_si32(_mm_shuffle_epi32(si, 0x55));
+}
+
+TARGET_AVX2 static void calcAvx2Stereo(
+	const float* buf1, const float* tab1, bool rev1,
+	const float* buf2, const float* tab2, bool rev2,
+	size_t len, int* out1, int* out2)
+{
+	assert((len % 4) == 0);
+
+	// 4 elements of the row, each one for a left and a right sample
+	const __m256i fwd = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+	const __m256i rev = _mm256_setr_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+	__m256i perm1 = rev1 ? rev : fwd;
+	__m256i perm2 = rev2 ? rev : fwd;
+	ptrdiff_t step1 = rev1 ? -4 : 4;
+	ptrdiff_t step2 = rev2 ? -4 : 4;
+	if (rev1) tab1 -= 4;
+	if (rev2) tab2 -= 4;
+
+	__m256 a1 = _mm256_setzero_ps();
+	__m256 b1 = _mm256_setzero_ps();
+	__m256 a2 = _mm256_setzero_ps();
+	__m256 b2 = _mm256_setzero_ps();
+	size_t i = 0;
+	for (/**/; (i + 8) <= len; i += 8) {
+		__m256 t1a = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab1)), perm1);
+		__m256 t1b = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab1 + step1)), perm1);
+		__m256 t2a = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab2)), perm2);
+		__m256 t2b = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab2 + step2)), perm2);
+		a1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + 2 * i + 0), t1a, a1);
+		b1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + 2 * i + 8), t1b, b1);
+		a2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + 2 * i + 0), t2a, a2);
+		b2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + 2 * i + 8), t2b, b2);
+		tab1 += 2 * step1;
+		tab2 += 2 * step2;
+	}
+	if (len & 4) {
+		__m256 t1 = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab1)), perm1);
+		__m256 t2 = _mm256_permutevar8x32_ps(_mm256_broadcast_ps(
+			reinterpret_cast<const __m128*>(tab2)), perm2);
+		a1 = _mm256_fmadd_ps(_mm256_loadu_ps(buf1 + 2 * i), t1, a1);
+		a2 = _mm256_fmadd_ps(_mm256_loadu_ps(buf2 + 2 * i), t2, a2);
+	}
 
+	// left/right pairs: add the two halves of each sum, then both sums
+	__m128 s1 = hsum(a1, b1);
+	__m128 s2 = hsum(a2, b2);
+	__m128 s = _mm_add_ps(_mm_movelh_ps(s1, s2), _mm_movehl_ps(s2, s1));
+	__m128i si = _mm_cvtps_epi32(s);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(out1), si);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(out2), _mm_unpackhi_epi64(si, si));
+}
+#endif
+
+template <unsigned CHANNELS>
+inline const float* ResampleHQ<CHANNELS>::getBuffer(float pos) const
+{
 	int bufIdx = int(pos) + bufStart;
 	assert((bufIdx + filterLen) <= bufEnd);
-	bufIdx *= CHANNELS;
-	const float* buf = &buffer[bufIdx];
+	return &buffer[bufIdx * CHANNELS];
+}
 
+template <unsigned CHANNELS>
+inline const float* ResampleHQ<CHANNELS>::getTable(float pos, bool& reverse) const
+{
 	int t = unsigned(int(pos * TAB_LEN + 0.5f)) % TAB_LEN;
-	if (!(t & HALF_TAB_LEN)) {
+	reverse = (t & HALF_TAB_LEN) != 0;
+	if (!reverse) {
 		// first half, begin of row 't'
-		t = permute[t];
-		const float* tab = &table[t * filterLen];
+		return &table[permute[t] * filterLen];
+	} else {
+		// 2nd half, end of row 'TAB_LEN - 1 - t'
+		return &table[(permute[TAB_LEN - 1 - t] + 1) * filterLen];
+	}
+}
 
+template <unsigned CHANNELS>
+void ResampleHQ<CHANNELS>::calcOutputs(
+	float pos, int* __restrict output, unsigned num)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		auto calc = (CHANNELS == 1) ? calcAvx2Mono : calcAvx2Stereo;
+		unsigned i = 0;
+		for (/**/; (i + 2) <= num; i += 2) {
+			float pos2 = pos + ratio;
+			bool rev1, rev2;
+			const float* tab1 = getTable(pos,  rev1);
+			const float* tab2 = getTable(pos2, rev2);
+			calc(getBuffer(pos),  tab1, rev1,
+			     getBuffer(pos2), tab2, rev2, filterLen,
+			     &output[(i + 0) * CHANNELS],
+			     &output[(i + 1) * CHANNELS]);
+			pos = pos2 + ratio;
+		}
+		if (i < num) {
+			// odd number of samples, calculate the last one twice
+			int dummy[CHANNELS];
+			bool rev;
+			const float* buf = getBuffer(pos);
+			const float* tab = getTable(pos, rev);
+			calc(buf, tab, rev, buf, tab, rev, filterLen,
+			     &output[i * CHANNELS], dummy);
+		}
+		return;
+	}
+#endif
+	for (unsigned i = 0; i < num; ++i) {
+		calcOutput(pos, &output[i * CHANNELS]);
+		pos += ratio;
+	}
+}
+
+template <unsigned CHANNELS>
+void ResampleHQ<CHANNELS>::calcOutput(
+	float pos, int* __restrict output)
+{
+	assert((filterLen & 3) == 0);
+
+	const float* buf = getBuffer(pos);
+	bool reverse;
+	const float* tab = getTable(pos, reverse);
+	if (!reverse) {
 #ifdef __SSE2__
 		if (CHANNELS == 1) {
 			calcSseMono  <false>(buf, tab, filterLen, output);
@@ -571,10 +788,6 @@ void ResampleHQ<CHANNELS>::calcOutput(
 			++buf;
 		}
 	} else {
-		// 2nd half, end of row 'TAB_LEN - 1 - t'
-		t = permute[TAB_LEN - 1 - t];
-		const float* tab = &table[(t + 1) * filterLen];
-
 #ifdef __SSE2__
 		if (CHANNELS == 1) {
 			calcSseMono  <true>(buf, tab, filterLen, output);
@@ -651,6 +864,13 @@ bool ResampleHQ<CHANNELS>::generateOutput(
 	int* __restrict dataOut, unsigned hostNum, EmuTime::param time)
 {
 	unsigned emuNum = emuClock.getTicksTill(time);
+	if ((nonzeroSamples == 0) && input.skipInput(emuNum)) {
+		// All samples in the buffer are zero and the input stays
+		// silent, so the output is all zero as well. The buffer
+		// already contains enough zeros for the next call.
+		emuClock += emuNum;
+		return false;
+	}
 	if (emuNum > 0) {
 		prepareData(emuNum);
 	}
@@ -662,10 +882,7 @@ bool ResampleHQ<CHANNELS>::generateOutput(
 		assert(host1 > emuClock.getTime());
 		float pos = emuClock.getTicksTillDouble(host1);
 		assert(pos <= (ratio + 2));
-		for (unsigned i = 0; i < hostNum; ++i) {
-			calcOutput(pos, &dataOut[i * CHANNELS]);
-			pos += ratio;
-		}
+		calcOutputs(pos, dataOut, hostNum);
 	}
 	emuClock += emuNum;
 	bufStart += emuNum;
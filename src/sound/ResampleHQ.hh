@@ -22,7 +22,10 @@ public:
 	                    EmuTime::param time) override;
 
 private:
+	void calcOutputs(float pos, int* output, unsigned num);
 	void calcOutput(float pos, int* output);
+	const float* getBuffer(float pos) const;
+	const float* getTable(float pos, bool& reverse) const;
 	void prepareData(unsigned emuNum);
 
 	ResampledSoundDevice& input;
@@ -8,10 +8,11 @@
 
 namespace openmsx {
 
-// 16-byte aligned buffer of ints (shared among all instances of this resampler)
-static std::vector<int> bufferStorage; // (possibly) unaligned storage
-static unsigned bufferSize = 0; // usable buffer size (aligned portion)
-static int* bufferInt = nullptr; // pointer to aligned sub-buffer
+// 16-byte aligned buffer of ints (shared among all instances of this resampler
+// that run on the same thread)
+static thread_local std::vector<int> bufferStorage; // (possibly) unaligned storage
+static thread_local unsigned bufferSize = 0; // usable buffer size (aligned portion)
+static thread_local int* bufferInt = nullptr; // pointer to aligned sub-buffer
 
 ////
 
@@ -50,6 +51,15 @@ bool ResampleLQ<CHANNELS>::fetchData(EmuTime::param time, unsigned& valid)
 	unsigned emuNum = emuClock.getTicksTill(time);
 	valid = 2 + emuNum;
 
+	int last = 0;
+	for (auto& l : lastInput) last |= l;
+	if ((last == 0) && input.skipInput(emuNum)) {
+		// Old input was all zero and the input stays silent, so the
+		// resampled output will be all zero as well.
+		emuClock += emuNum;
+		return false;
+	}
+
 	unsigned required = emuNum + 4;
 	if (unlikely(required > bufferSize)) {
 		// grow buffer (3 extra to be able to align)
@@ -71,8 +81,6 @@ bool ResampleLQ<CHANNELS>::fetchData(EmuTime::param time, unsigned& valid)
 
 	if (!input.generateInput(&buffer[2 * CHANNELS], emuNum)) {
 		// New input is all zero
-		int last = 0;
-		for (auto& l : lastInput) last |= l;
 		if (last == 0) {
 			// Old input was also all zero, then the resampled
 			// output will be all zero as well.
@@ -45,6 +45,16 @@ bool ResampledSoundDevice::generateInput(int* buffer, unsigned num)
 	return mixChannels(buffer, num);
 }
 
+bool ResampledSoundDevice::generateInputDeltas(BlipDeltas& deltas, unsigned num)
+{
+	return mixChannelDeltas(deltas, num);
+}
+
+bool ResampledSoundDevice::skipInput(unsigned num)
+{
+	return skipSilence(num);
+}
+
 
 void ResampledSoundDevice::update(const Setting& setting)
 {
@@ -23,6 +23,20 @@ public:
 	  */
 	bool generateInput(int* buffer, unsigned num);
 
+	/** Like generateInput(), but reports the changes in the output level
+	  * instead of generating samples.
+	  * @result false iff this isn't possible for this device (right now),
+	  *         see SoundDevice::mixChannelDeltas()
+	  */
+	bool generateInputDeltas(BlipDeltas& deltas, unsigned num);
+
+	/** Skip 'num' input samples, only possible when this device is
+	  * silent. The resampler should then produce silence as well.
+	  * @result true iff the input was skipped
+	  * @see SoundDevice::isSilent()
+	  */
+	bool skipInput(unsigned num);
+
 protected:
 	ResampledSoundDevice(MSXMotherBoard& motherBoard, string_ref name,
 	                     string_ref description, unsigned channels,
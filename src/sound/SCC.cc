@@ -97,6 +97,7 @@
 //-----------------------------------------------------------------------------
 
 #include "SCC.hh"
+#include "BlipDeltas.hh"
 #include "DeviceConfig.hh"
 #include "serialize.hh"
 #include "likely.hh"
@@ -464,6 +465,25 @@ void SCC::setDeformRegHelper(byte value)
 	}
 }
 
+bool SCC::isSilent() const
+{
+	unsigned enable = ch_enable;
+	for (unsigned i = 0; i < 5; ++i, enable >>= 1) {
+		if ((enable & 1) && (volume[i] || out[i])) return false;
+	}
+	return true;
+}
+
+inline void SCC::skipChannel(unsigned i, unsigned num)
+{
+	// Update phase counter.
+	unsigned newCount = count[i] + num * incr[i];
+	count[i] = newCount % (period[i] + 1);
+	pos[i] = (pos[i] + newCount / (period[i] + 1)) % 32;
+	// Channel stays off until next waveform index.
+	out[i] = 0;
+}
+
 void SCC::generateChannels(int** bufs, unsigned num)
 {
 	unsigned enable = ch_enable;
@@ -532,13 +552,76 @@ void SCC::generateChannels(int** bufs, unsigned num)
 #endif
 		} else {
 			bufs[i] = nullptr; // channel muted
-			// Update phase counter.
-			unsigned newCount = count[i] + num * incr[i];
-			count[i] = newCount % (period[i] + 1);
-			pos[i] = (pos[i] + newCount / (period[i] + 1)) % 32;
-			// Channel stays off until next waveform index.
-			out[i] = 0;
+			skipChannel(i, num);
+		}
+	}
+}
+
+bool SCC::generateChannelDeltas(BlipDeltas& deltas, unsigned num)
+{
+	// Passing a change to the BlipBuffer is a lot more expensive than
+	// generating a sample. For high frequencies the waveform steps more
+	// than once per sample, then generating samples is faster.
+	unsigned steps = 0;
+	unsigned enable = ch_enable;
+	for (unsigned i = 0; i < 5; ++i, enable >>= 1) {
+		if ((enable & 1) && (volume[i] || out[i])) {
+			steps += (num * incr[i]) / (period[i] + 1);
+		}
+	}
+	if (steps > num) return false;
+
+	enable = ch_enable;
+	for (unsigned i = 0; i < 5; ++i, enable >>= 1) {
+		if (!((enable & 1) && (volume[i] || out[i]))) {
+			skipChannel(i, num); // channel muted
+			continue;
 		}
+		// Same as generateChannels(), but instead of stepping through
+		// all samples, directly jump to the next step in the waveform.
+		int out2 = out[i];
+		unsigned count2 = count[i];
+		unsigned pos2 = pos[i];
+		unsigned incr2 = incr[i];
+		unsigned period2 = period[i] + 1;
+		if (out2) deltas.addDelta(0, out2);
+		unsigned j = 0;
+		while (true) {
+			// number of samples till the next step
+			unsigned n;
+			if (count2 >= period2) {
+				n = 1;
+			} else if (incr2 == 0) {
+				break;
+			} else {
+				n = (period2 - count2 + incr2 - 1) / incr2;
+			}
+			if (n > (num - j)) break;
+			j += n;
+			count2 += n * incr2;
+			do {
+				count2 -= period2;
+				pos2 = (pos2 + 1) % 32;
+			} while (count2 >= period2);
+			int newOut = volAdjustedWave[i][pos2];
+			if ((newOut != out2) && (j < num)) {
+				deltas.addDelta(j, newOut - out2);
+			}
+			out2 = newOut;
+		}
+		count2 += (num - j) * incr2;
+		out[i] = out2;
+		count[i] = count2;
+		pos[i] = pos2;
+	}
+	return true;
+}
+
+void SCC::skipChannels(unsigned num)
+{
+	// all channels are muted
+	for (unsigned i = 0; i < 5; ++i) {
+		skipChannel(i, num);
 	}
 }
 
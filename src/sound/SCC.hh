@@ -31,8 +31,12 @@ public:
 private:
 	// SoundDevice
 	int getAmplificationFactor() const override;
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
+	bool generateChannelDeltas(BlipDeltas& deltas, unsigned num) override;
+	void skipChannels(unsigned num) override;
 
+	inline void skipChannel(unsigned channel, unsigned num);
 	inline int adjust(signed char wav, byte vol);
 	byte readWave(unsigned channel, unsigned address, EmuTime::param time) const;
 	void writeWave(unsigned channel, unsigned offset, byte value);
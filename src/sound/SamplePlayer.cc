@@ -111,6 +111,11 @@ inline int SamplePlayer::getSample(unsigned idx)
 	     :  static_cast<const int16_t*>(sampBuf)[idx];
 }
 
+bool SamplePlayer::isSilent() const
+{
+	return !isPlaying();
+}
+
 void SamplePlayer::generateChannels(int** bufs, unsigned num)
 {
 	// Single channel device: replace content of bufs[0] (not add to it).
@@ -50,6 +50,7 @@ private:
 	void doRepeat();
 
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 
 	std::vector<WavData> samples;
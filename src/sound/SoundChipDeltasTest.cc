@@ -0,0 +1,254 @@
+// Like BlipDeltasTest, but for the real PSG (AY8910) and SCC: plays the same
+// register writes on two instances of each chip, one passes its samples to
+// the BlipBuffer (like ResampleBlip::generateSamples()), the other passes the
+// changes in its output via SoundDevice::generateChannelDeltas().
+//
+// Both chips step their generators the same way in both cases, so the sound
+// must be exactly the same. This also checks that each chip really passed
+// (most of) its output as changes.
+//
+// This needs a (headless) openMSX environment to create the devices in.
+//
+// Usage: SoundChipDeltasTest [<seconds>]
+
+#include "AY8910.hh"
+#include "AY8910Periphery.hh"
+#include "SCC.hh"
+#include "BlipBuffer.hh"
+#include "BlipDeltas.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXMixer.hh"
+#include "Mixer.hh"
+#include "HardwareConfig.hh"
+#include "DeviceConfig.hh"
+#include "XMLElement.hh"
+#include "EnumSetting.hh"
+#include "TclObject.hh"
+#include "MSXException.hh"
+#include "Thread.hh"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+using FP = BlipDeltas::FP;
+
+static const unsigned INPUT_RATE = 111861; // 3579545 / 32, both chips
+static const unsigned OUTPUT_RATE = 44100;
+static const unsigned BLOCK = INPUT_RATE / 60; // input samples per mixer call
+
+using Writer = function<void (minstd_rand&, unsigned frame)>;
+
+// Like ResampleBlip::generateSamples().
+static void generateSamples(ResampledSoundDevice& device, BlipBuffer& blip,
+                            vector<int>& buf, FP pos, FP step, int& last)
+{
+	if (!device.generateInput(buf.data(), BLOCK)) {
+		// input all zero
+		if (last) {
+			blip.addDelta(BlipBuffer::TimeIndex(pos), -last);
+			last = 0;
+		}
+		return;
+	}
+	for (unsigned i = 0; i < BLOCK; ++i) {
+		int delta = buf[i] - last;
+		if (delta) {
+			last = buf[i];
+			blip.addDelta(BlipBuffer::TimeIndex(pos), delta);
+		}
+		pos += step;
+	}
+}
+
+// Plays 'seconds' of sound, before each block 'write' changes some registers.
+// Returns the number of blocks that were passed as changes.
+static unsigned run(ResampledSoundDevice& device, const Writer& write,
+                    bool useDeltas, unsigned seconds, vector<int>& output)
+{
+	minstd_rand random(1234);
+	BlipBuffer blip;
+	vector<int> buf(BLOCK + 3); // generateInput() may write 3 extra
+	int out[OUTPUT_RATE / 10];
+	const FP step = FP::roundRatioDown(OUTPUT_RATE, INPUT_RATE);
+	FP pos(0); // time of the next input sample, in output samples
+	int last = 0;
+	unsigned deltaBlocks = 0;
+	output.clear();
+	for (unsigned b = 0; b < seconds * 60; ++b) {
+		write(random, b);
+		bool done = false;
+		if (useDeltas) {
+			BlipDeltas deltas(blip, pos, step, last);
+			if (device.generateInputDeltas(deltas, BLOCK)) {
+				last = deltas.flush();
+				++deltaBlocks;
+				done = true;
+			}
+		}
+		if (!done) {
+			generateSamples(device, blip, buf, pos, step, last);
+		}
+		pos += step * int(BLOCK);
+		unsigned num = pos.toInt();
+		pos -= FP(num);
+		if (!blip.readSamples<1>(out, num)) {
+			for (unsigned i = 0; i < num; ++i) out[i] = 0;
+		}
+		output.insert(output.end(), out, out + num);
+	}
+	return deltaBlocks;
+}
+
+// Something like a replayer: every frame changes some tone periods and
+// volumes, sometimes also the mixer, noise and envelope registers.
+static void writePSG(AY8910& psg, minstd_rand& random, unsigned frame)
+{
+	EmuTime::param time = EmuTime::zero;
+	unsigned scene = (frame / 600) % 4;
+	for (unsigned ch = 0; ch < 3; ++ch) {
+		if ((random() % 4) == 0) {
+			unsigned period = 30 + random() % 900;
+			psg.writeRegister(2 * ch + 0, byte(period), time);
+			psg.writeRegister(2 * ch + 1, byte(period >> 8), time);
+		}
+		if ((random() % 3) == 0) {
+			byte vol = (scene == 3) ? 0
+			         : ((random() % 8) == 0) ? 0x10 // envelope
+			         : byte(random() % 16);
+			psg.writeRegister(8 + ch, vol, time);
+		}
+	}
+	if ((frame % 30) == 0) {
+		byte enable = (scene == 1) ? (random() & 0x3F) : 0x38;
+		psg.writeRegister( 7, 0x80 | enable, time);
+		psg.writeRegister( 6, byte(random() & 0x1F), time);
+		psg.writeRegister(11, byte(random()), time);
+		psg.writeRegister(12, byte(random() % 8), time);
+		psg.writeRegister(13, byte(random() & 0x0F), time);
+	}
+}
+
+// Also with some high frequencies, those are passed as samples.
+static void writeSCC(SCC& scc, minstd_rand& random, unsigned frame)
+{
+	EmuTime::param time = EmuTime::zero;
+	unsigned scene = (frame / 600) % 4;
+	if ((frame % 120) == 0) {
+		for (unsigned ch = 0; ch < 4; ++ch) {
+			for (unsigned p = 0; p < 32; ++p) {
+				byte v = (ch == 0) ? byte((p < 16) ? 0x7F : 0x80)
+				       : (ch == 1) ? byte(p * 8 - 128)
+				       : byte(random());
+				scc.writeMem(32 * ch + p, v, time);
+			}
+		}
+	}
+	for (unsigned ch = 0; ch < 5; ++ch) {
+		if ((random() % 4) == 0) {
+			unsigned period = (scene == 2) ? (9 + random() % 40)
+			                               : (40 + random() % 1200);
+			scc.writeMem(0x80 + 2 * ch + 0, byte(period), time);
+			scc.writeMem(0x80 + 2 * ch + 1, byte(period >> 8), time);
+		}
+		if ((random() % 3) == 0) {
+			byte vol = (scene == 3) ? 0 : byte(random() % 16);
+			scc.writeMem(0x8A + ch, vol, time);
+		}
+	}
+	if ((frame % 60) == 0) {
+		byte enable = (scene == 3) ? 0 : byte(0x10 | random());
+		scc.writeMem(0x8F, enable, time);
+	}
+}
+
+static bool check(const string& name, unsigned seconds,
+                  ResampledSoundDevice& ref, ResampledSoundDevice& dut,
+                  const Writer& writeRef, const Writer& writeDut)
+{
+	vector<int> refOut, dutOut;
+	run(ref, writeRef, false, seconds, refOut);
+	unsigned deltaBlocks = run(dut, writeDut, true, seconds, dutOut);
+
+	unsigned differ = 0;
+	int maxDiff = 0;
+	for (size_t i = 0; i < refOut.size(); ++i) {
+		int d = abs(refOut[i] - dutOut[i]);
+		if (d) ++differ;
+		maxDiff = max(maxDiff, d);
+	}
+	cout << name << ": " << deltaBlocks << " of " << seconds * 60
+	     << " blocks passed as changes" << endl;
+	if (differ) {
+		cout << "FAILED: " << name << " output differs in " << differ
+		     << " of " << refOut.size() << " samples (max "
+		     << maxDiff << ")" << endl;
+		return false;
+	}
+	if (deltaBlocks < (seconds * 60) / 2) {
+		cout << "FAILED: " << name << " passed too few changes" << endl;
+		return false;
+	}
+	return true;
+}
+
+class NoPeriphery final : public AY8910Periphery {};
+
+static XMLElement createConfig(const string& name)
+{
+	XMLElement config(name);
+	auto& sound = config.addChild("sound");
+	sound.addChild("volume", "21000");
+	return config;
+}
+
+int main(int argc, char** argv)
+{
+	unsigned seconds = (argc > 1) ? atoi(argv[1]) : 60;
+	bool ok = true;
+	try {
+		Thread::setMainThread();
+		Reactor reactor;
+		reactor.init();
+		auto& soundDriver = reactor.getMixer().getSoundDriverSetting();
+		soundDriver.setDontSaveValue(TclObject("null"));
+		soundDriver.setEnum(Mixer::SND_NULL);
+
+		auto board = reactor.createEmptyMotherBoard();
+		board->getMSXMixer().mute();
+		HardwareConfig hwConf(*board, "SoundChipDeltasTest");
+
+		// All register writes happen at time zero, the mixer never
+		// generates sound itself.
+		EmuTime::param time = EmuTime::zero;
+		XMLElement psgXML = createConfig("PSG");
+		DeviceConfig psgConfig(hwConf, psgXML);
+		NoPeriphery periphery;
+		AY8910 psg1("PSG1", periphery, psgConfig, time);
+		AY8910 psg2("PSG2", periphery, psgConfig, time);
+		ok &= check("PSG", seconds, psg1, psg2,
+			[&](minstd_rand& r, unsigned f) { writePSG(psg1, r, f); },
+			[&](minstd_rand& r, unsigned f) { writePSG(psg2, r, f); });
+
+		XMLElement sccXML = createConfig("SCC");
+		DeviceConfig sccConfig(hwConf, sccXML);
+		SCC scc1("SCC1", sccConfig, time, SCC::SCC_Real);
+		SCC scc2("SCC2", sccConfig, time, SCC::SCC_Real);
+		ok &= check("SCC", seconds, scc1, scc2,
+			[&](minstd_rand& r, unsigned f) { writeSCC(scc1, r, f); },
+			[&](minstd_rand& r, unsigned f) { writeSCC(scc2, r, f); });
+	} catch (MSXException& e) {
+		cout << "FAILED: " << e.getMessage() << endl;
+		return 1;
+	}
+	if (!ok) return 1;
+	cout << "All tests passed." << endl;
+	return 0;
+}
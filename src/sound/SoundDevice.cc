@@ -17,8 +17,10 @@ using std::string;
 
 namespace openmsx {
 
-static MemBuffer<int, SSE2_ALIGNMENT> mixBuffer;
-static unsigned mixBufferSize = 0;
+// One buffer per thread: MSXMixer may generate several sound devices in
+// parallel.
+static thread_local MemBuffer<int, SSE2_ALIGNMENT> mixBuffer;
+static thread_local unsigned mixBufferSize = 0;
 
 static void allocateMixBuffer(unsigned size)
 {
@@ -125,6 +127,29 @@ void SoundDevice::updateStream(EmuTime::param time)
 	mixer.updateStream(time);
 }
 
+bool SoundDevice::isSilent() const
+{
+	return false;
+}
+
+void SoundDevice::skipChannels(unsigned /*num*/)
+{
+}
+
+bool SoundDevice::generateChannelDeltas(BlipDeltas& /*deltas*/, unsigned /*num*/)
+{
+	return false;
+}
+
+bool SoundDevice::skipSilence(unsigned num)
+{
+	if (numRecordChannels || !mixer.getSkipSilence() || !isSilent()) {
+		return false;
+	}
+	skipChannels(num);
+	return true;
+}
+
 void SoundDevice::recordChannel(unsigned channel, const Filename& filename)
 {
 	assert(channel < numChannels);
@@ -165,6 +190,7 @@ bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 	assert((uintptr_t(dataOut) & 15) == 0); // must be 16-byte aligned
 #endif
 	if (samples == 0) return true;
+	if (skipSilence(samples)) return false;
 	unsigned outputStereo = isStereo() ? 2 : 1;
 
 	MemoryOps::MemSet<unsigned> mset;
@@ -310,6 +336,17 @@ bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 	return true;
 }
 
+bool SoundDevice::mixChannelDeltas(BlipDeltas& deltas, unsigned samples)
+{
+	if (isStereo() || numRecordChannels) return false;
+	for (unsigned i = 0; i < numChannels; ++i) {
+		if (channelMuted[i]) return false;
+	}
+	// when silent there are no changes (the output level becomes zero)
+	if (skipSilence(samples)) return true;
+	return generateChannelDeltas(deltas, samples);
+}
+
 const DynamicClock& SoundDevice::getHostSampleClock() const
 {
 	return mixer.getHostSampleClock();
@@ -9,6 +9,7 @@ namespace openmsx {
 
 class MSXMixer;
 class DeviceConfig;
+class BlipDeltas;
 class Wav16Writer;
 class Filename;
 class DynamicClock;
@@ -107,6 +108,16 @@ public: // Will be called by Mixer:
 	virtual bool updateBuffer(unsigned length, int* buffer,
 	                          EmuTime::param time) = 0;
 
+	/** Is the output of this device silent, and is it guaranteed to stay
+	  * silent until the state of the device changes (e.g. because of a
+	  * register write)?
+	  * When this returns true, generateChannels() would produce no
+	  * output, so it isn't called. Instead skipChannels() is called.
+	  * This method is called for each block of samples, so it should be
+	  * cheap to calculate. The default implementation returns false.
+	  */
+	virtual bool isSilent() const;
+
 protected:
 	/** Abstract method to generate the actual sound data.
 	  * @param buffers An array of pointer to buffers. Each buffer must
@@ -123,6 +134,35 @@ protected:
 	  */
 	virtual void generateChannels(int** buffers, unsigned num) = 0;
 
+	/** Called instead of generateChannels() when isSilent() returns true.
+	  * @param num The number of samples.
+	  *
+	  * This method should bring the device in the same state as
+	  * generateChannels() would have done (e.g. advance free running
+	  * counters), but without generating any output. The default
+	  * implementation does nothing.
+	  */
+	virtual void skipChannels(unsigned num);
+
+	/** Alternative for generateChannels(), for devices with piecewise
+	  * constant output (square waves). Instead of producing samples, it
+	  * reports the changes in the output level of the channels.
+	  * @param deltas Receives the changes, see BlipDeltas::addDelta().
+	  *               The changes of all channels are added together.
+	  * @param num The number of samples.
+	  * @result false iff this device doesn't support this (at the
+	  *         moment), then the state of the device must not be
+	  *         changed and generateChannels() is used instead. The
+	  *         default implementation returns false.
+	  */
+	virtual bool generateChannelDeltas(BlipDeltas& deltas, unsigned num);
+
+	/** When the device is silent (see isSilent()) and none of its
+	  * channels are being recorded, skip 'num' samples.
+	  * @result true iff the samples were skipped
+	  */
+	bool skipSilence(unsigned num);
+
 	/** Calls generateChannels() and combines the output to a single
 	  * channel.
 	  * @param dataOut Output buffer, must be big enough to hold
@@ -137,6 +177,14 @@ protected:
 	  */
 	bool mixChannels(int* dataOut, unsigned num);
 
+	/** Like mixChannels(), but reports the changes in the combined output
+	  * (see generateChannelDeltas()). Only possible for mono output
+	  * without muted or recorded channels.
+	  * @result false iff this wasn't possible, then mixChannels() must be
+	  *         used instead.
+	  */
+	bool mixChannelDeltas(BlipDeltas& deltas, unsigned num);
+
 	/** See MSXMixer::getHostSampleClock(). */
 	const DynamicClock& getHostSampleClock() const;
 	double getEffectiveSpeed() const;
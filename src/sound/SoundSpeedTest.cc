@@ -0,0 +1,365 @@
+// Measures the time needed to generate the sound of a few YM2413 chips for
+// typical combinations of idle and active chips, with and without skipping
+// silent chips (see SoundDevice::isSilent()). Also checks that skipping
+// silent chips doesn't change the generated sound.
+//
+// Then does the same for a PSG, an SCC and an FM chip together (like an MSX
+// with an SCC cartridge and MSX-MUSIC), this time through MSXMixer, so that
+// resampling and mixing are included. The mixed sound isn't accessible
+// there, so that part only measures the time (SoundChipDeltasTest and the
+// YM2413 part above check the generated sound).
+//
+// This needs a (headless) openMSX environment to create the devices in.
+//
+// Usage: SoundSpeedTest [<seconds>]
+
+#include "YM2413Okazaki.hh"
+#include "YM2413Burczynski.hh"
+#include "AY8910.hh"
+#include "AY8910Periphery.hh"
+#include "SCC.hh"
+#include "YM2413.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXMixer.hh"
+#include "Mixer.hh"
+#include "HardwareConfig.hh"
+#include "DeviceConfig.hh"
+#include "XMLElement.hh"
+#include "EnumSetting.hh"
+#include "BooleanSetting.hh"
+#include "TclObject.hh"
+#include "MSXException.hh"
+#include "Thread.hh"
+#include "memory.hh"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+static const unsigned CHIPS = 4;
+static const unsigned CHANNELS = 9 + 5;
+static const unsigned SAMPLE_RATE = YM2413Core::CLOCK_FREQ / 72;
+static const unsigned BLOCK = 512; // samples per mixer call
+
+// Playing pattern of a single chip: play notes for 'on' samples, then be
+// silent for 'off' samples, repeat. When 'off' is zero the chip plays all
+// the time, when 'on' is zero it's never used.
+struct Pattern
+{
+	unsigned on;
+	unsigned off;
+};
+
+struct Mix
+{
+	const char* name;
+	Pattern chips[CHIPS];
+};
+
+static const unsigned S = SAMPLE_RATE; // one second
+static const Mix mixes[] = {
+	// e.g. FM-PAC, MSX-MUSIC, ... all present but not used
+	{ "all idle",       { {0, 1}, {0, 1}, {0, 1}, {0, 1} } },
+	// a game that uses only one of the sound chips
+	{ "one active",     { {1, 0}, {0, 1}, {0, 1}, {0, 1} } },
+	// music on one chip, occasional sound effects on the others
+	{ "music + sfx",    { {1, 0}, {S / 4, 3 * S}, {S / 2, 4 * S}, {0, 1} } },
+	// music that uses all chips
+	{ "all active",     { {1, 0}, {1, 0}, {1, 0}, {1, 0} } },
+};
+
+static bool isPlaying(const Pattern& p, unsigned time)
+{
+	if (p.on == 0) return false;
+	if (p.off == 0) return true;
+	return (time % (p.on + p.off)) < p.on;
+}
+
+// 'write(reg, value)' writes a YM2413 register.
+template<typename Write> static void keyOn(Write write, unsigned n)
+{
+	// a chord on a few channels, different instruments
+	for (unsigned ch = 0; ch < 4; ++ch) {
+		write(0x30 + ch, byte(((ch + n) % 15 + 1) << 4));
+		write(0x10 + ch, byte(0x80 + 0x20 * ch));
+		write(0x20 + ch, byte(0x14 + (n & 1)));
+	}
+	// and some drums
+	write(0x0E, byte(0x20 | (1 << (n % 5))));
+}
+
+template<typename Write> static void keyOff(Write write)
+{
+	for (unsigned ch = 0; ch < 4; ++ch) {
+		write(0x20 + ch, 0x04);
+	}
+	write(0x0E, 0x20);
+}
+
+// Like SoundDevice::mixChannels(): generate all channels and add them
+// together in 'out'. Returns false when the output is silent.
+static bool generate(YM2413Core& core, int* out, bool skipSilent)
+{
+	if (skipSilent && core.isSilent()) {
+		core.skipChannels(BLOCK);
+		return false;
+	}
+	static int buffers[CHANNELS][BLOCK];
+	int* bufs[CHANNELS];
+	for (unsigned i = 0; i < CHANNELS; ++i) {
+		for (auto& s : buffers[i]) s = 0;
+		bufs[i] = buffers[i];
+	}
+	core.generateChannels(bufs, BLOCK);
+	bool result = false;
+	for (unsigned i = 0; i < CHANNELS; ++i) {
+		if (!bufs[i]) continue;
+		result = true;
+		for (unsigned j = 0; j < BLOCK; ++j) {
+			out[j] += bufs[i][j];
+		}
+	}
+	return result;
+}
+
+template<typename Core>
+static double run(const Mix& mix, unsigned seconds, bool skipSilent,
+                  vector<int>& output)
+{
+	vector<unique_ptr<YM2413Core>> cores;
+	for (unsigned c = 0; c < CHIPS; ++c) {
+		cores.push_back(make_unique<Core>());
+	}
+	bool playing[CHIPS] = {};
+	unsigned notes[CHIPS] = {};
+
+	unsigned blocks = seconds * SAMPLE_RATE / BLOCK;
+	output.assign(blocks * BLOCK, 0);
+	double total = 0.0;
+	for (unsigned b = 0; b < blocks; ++b) {
+		unsigned time = b * BLOCK;
+		for (unsigned c = 0; c < CHIPS; ++c) {
+			auto& core = *cores[c];
+			auto write = [&](byte reg, byte value) {
+				core.writeReg(reg, value);
+			};
+			bool p = isPlaying(mix.chips[c], time);
+			if (p && !playing[c]) {
+				keyOn(write, notes[c]++);
+			} else if (!p && playing[c]) {
+				keyOff(write);
+			}
+			playing[c] = p;
+		}
+		int* out = &output[time];
+		auto start = chrono::high_resolution_clock::now();
+		for (auto& core : cores) {
+			generate(*core, out, skipSilent);
+		}
+		auto stop = chrono::high_resolution_clock::now();
+		total += chrono::duration<double>(stop - start).count();
+	}
+	return total;
+}
+
+template<typename Core>
+static int test(const char* coreName, unsigned seconds)
+{
+	cout << coreName << ", " << CHIPS << " chips, " << seconds
+	     << "s of sound:" << endl;
+	int errors = 0;
+	for (auto& mix : mixes) {
+		vector<int> ref, out;
+		double t0 = run<Core>(mix, seconds, false, ref);
+		double t1 = run<Core>(mix, seconds, true,  out);
+		cout << "  " << left << setw(14) << mix.name << right
+		     << fixed << setprecision(2)
+		     << setw(9) << t0 * 1000 << "ms"
+		     << setw(9) << t1 * 1000 << "ms"
+		     << setw(8) << t0 / t1 << "x";
+		if (out != ref) {
+			cout << "  FAILED: output differs";
+			++errors;
+		}
+		cout << endl;
+	}
+	return errors;
+}
+
+// PSG + SCC + FM through MSXMixer. Here the patterns are in frames (1/60s).
+
+struct MachineMix
+{
+	const char* name;
+	Pattern psg, scc, fm;
+};
+
+static const unsigned FPS = 60;
+static const unsigned F = FPS; // one second
+static const MachineMix machineMixes[] = {
+	// e.g. an MSX1 game on a machine with SCC and MSX-MUSIC
+	{ "all idle",       {0, 1}, {0, 1}, {0, 1} },
+	// an MSX1 game, only uses the PSG
+	{ "PSG only",       {1, 0}, {0, 1}, {0, 1} },
+	// FM music, sound effects on the PSG
+	{ "FM + PSG sfx",   {F / 4, 3 * F}, {0, 1}, {1, 0} },
+	// music that uses all chips
+	{ "all active",     {1, 0}, {1, 0}, {1, 0} },
+};
+
+static void psgKeyOn(AY8910& psg, unsigned n, EmuTime::param time)
+{
+	for (unsigned ch = 0; ch < 3; ++ch) {
+		unsigned period = 100 + 150 * ((ch + n) % 5);
+		psg.writeRegister(2 * ch + 0, byte(period), time);
+		psg.writeRegister(2 * ch + 1, byte(period >> 8), time);
+		psg.writeRegister(8 + ch, byte(15 - 2 * ch), time);
+	}
+	psg.writeRegister(7, (n & 1) ? 0xB0 : 0xB8, time); // sometimes noise
+	psg.writeRegister(6, byte(n & 0x1F), time);
+}
+
+static void psgKeyOff(AY8910& psg, EmuTime::param time)
+{
+	for (unsigned ch = 0; ch < 3; ++ch) {
+		psg.writeRegister(8 + ch, 0, time);
+	}
+}
+
+static void sccKeyOn(SCC& scc, unsigned n, EmuTime::param time)
+{
+	for (unsigned ch = 0; ch < 5; ++ch) {
+		unsigned period = 200 + 100 * ((ch + n) % 7);
+		scc.writeMem(0x80 + 2 * ch + 0, byte(period), time);
+		scc.writeMem(0x80 + 2 * ch + 1, byte(period >> 8), time);
+		scc.writeMem(0x8A + ch, byte(15 - ch), time);
+	}
+	scc.writeMem(0x8F, 0x1F, time);
+}
+
+static void sccKeyOff(SCC& scc, EmuTime::param time)
+{
+	scc.writeMem(0x8F, 0x00, time);
+}
+
+class NoPeriphery final : public AY8910Periphery {};
+
+static XMLElement createConfig(const string& name)
+{
+	XMLElement config(name);
+	auto& sound = config.addChild("sound");
+	sound.addChild("volume", "21000");
+	return config;
+}
+
+// Creates the chips, plays 'seconds' of sound and returns the time spent in
+// MSXMixer::updateStream(). The mixer only moves forward in time, so 'time'
+// continues where the previous run stopped.
+static double runMachine(MSXMotherBoard& board, HardwareConfig& hwConf,
+                         const MachineMix& mix, unsigned seconds,
+                         bool skipSilent, EmuTime& time)
+{
+	auto& mixer = board.getMSXMixer();
+	mixer.setSkipSilence(skipSilent);
+
+	XMLElement psgXML = createConfig("PSG");
+	DeviceConfig psgConfig(hwConf, psgXML);
+	NoPeriphery periphery;
+	AY8910 psg("PSG", periphery, psgConfig, time);
+	XMLElement sccXML = createConfig("SCC");
+	DeviceConfig sccConfig(hwConf, sccXML);
+	SCC scc("SCC", sccConfig, time, SCC::SCC_Real);
+	XMLElement fmXML = createConfig("MSX-MUSIC");
+	DeviceConfig fmConfig(hwConf, fmXML);
+	YM2413 fm("MSX-MUSIC", fmConfig);
+
+	for (unsigned ch = 0; ch < 4; ++ch) {
+		for (unsigned p = 0; p < 32; ++p) {
+			byte v = (ch & 1) ? byte(p * 8 - 128)
+			                  : byte((p < 16) ? 0x7F : 0x80);
+			scc.writeMem(32 * ch + p, v, time);
+		}
+	}
+	auto writeFM = [&](byte reg, byte value) {
+		fm.writeReg(reg, value, time);
+	};
+
+	bool playing[3] = {};
+	unsigned notes[3] = {};
+	const EmuDuration frame(1.0 / FPS);
+	double total = 0.0;
+	for (unsigned f = 0; f < seconds * FPS; ++f) {
+		bool p = isPlaying(mix.psg, f);
+		if (p && !playing[0]) psgKeyOn(psg, notes[0]++, time);
+		if (!p && playing[0]) psgKeyOff(psg, time);
+		playing[0] = p;
+		p = isPlaying(mix.scc, f);
+		if (p && !playing[1]) sccKeyOn(scc, notes[1]++, time);
+		if (!p && playing[1]) sccKeyOff(scc, time);
+		playing[1] = p;
+		p = isPlaying(mix.fm, f);
+		if (p && !playing[2]) keyOn(writeFM, notes[2]++);
+		if (!p && playing[2]) keyOff(writeFM);
+		playing[2] = p;
+
+		time += frame;
+		auto start = chrono::high_resolution_clock::now();
+		mixer.updateStream(time);
+		auto stop = chrono::high_resolution_clock::now();
+		total += chrono::duration<double>(stop - start).count();
+	}
+	return total;
+}
+
+static void testMachine(unsigned seconds)
+{
+	Reactor reactor;
+	reactor.init();
+	auto& soundDriver = reactor.getMixer().getSoundDriverSetting();
+	soundDriver.setDontSaveValue(TclObject("null"));
+	soundDriver.setEnum(Mixer::SND_NULL);
+	// measure the work itself, not how it's spread over threads
+	reactor.getMixer().getParallelSoundSetting().setBoolean(false);
+
+	auto board = reactor.createEmptyMotherBoard();
+	board->getMSXMixer().mute();
+	HardwareConfig hwConf(*board, "SoundSpeedTest");
+
+	cout << "PSG + SCC + YM2413 via MSXMixer, " << seconds
+	     << "s of sound:" << endl;
+	EmuTime time = EmuTime::zero;
+	for (auto& mix : machineMixes) {
+		double t0 = runMachine(*board, hwConf, mix, seconds, false, time);
+		double t1 = runMachine(*board, hwConf, mix, seconds, true,  time);
+		cout << "  " << left << setw(14) << mix.name << right
+		     << fixed << setprecision(2)
+		     << setw(9) << t0 * 1000 << "ms"
+		     << setw(9) << t1 * 1000 << "ms"
+		     << setw(8) << t0 / t1 << "x" << endl;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned seconds = (argc > 1) ? atoi(argv[1]) : 20;
+	cout << "Times without and with skipping silent chips." << endl;
+	int errors = 0;
+	errors += test<YM2413Okazaki::YM2413>("YM2413 Okazaki", seconds);
+	errors += test<YM2413Burczynski::YM2413>("YM2413 Burczynski", seconds);
+	try {
+		Thread::setMainThread();
+		testMachine(seconds);
+	} catch (MSXException& e) {
+		cout << "FAILED: " << e.getMessage() << endl;
+		return 1;
+	}
+	return errors ? 1 : 0;
+}
@@ -233,6 +233,11 @@ int VLM5030::parseFrame()
 }
 
 // decode and buffering data
+bool VLM5030::isSilent() const
+{
+	return phase == PH_IDLE;
+}
+
 void VLM5030::generateChannels(int** bufs, unsigned length)
 {
 	// Single channel device: replace content of bufs[0] (not add to it).
@@ -37,6 +37,7 @@ private:
 	void setST (bool pin);
 
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 	int getAmplificationFactor() const override;
 
@@ -74,6 +74,7 @@ public:
 private:
 	// SoundDevice
 	int getAmplificationFactor() const override;
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 
 	inline void keyOn_BD();
@@ -89,8 +90,6 @@ private:
 	inline void setRythmMode(int data);
 	void update_key_status();
 
-	bool checkMuteHelper();
-
 	void changeStatusMask(byte newMask);
 
 	void callback(byte flag) override;
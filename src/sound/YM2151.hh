@@ -118,6 +118,7 @@ private:
 	void setConnect(YM2151Operator* om1, int cha, int v);
 
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 
 	void callback(byte flag) override;
@@ -143,8 +144,6 @@ private:
 	void advanceEG();
 	void advance();
 
-	bool checkMuteHelper();
-
 	IRQHelper irq;
 
 	// Timers (see EmuTimer class for details about timing)
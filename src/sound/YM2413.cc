@@ -68,11 +68,21 @@ void YM2413::writeReg(byte reg, byte value, EmuTime::param time)
 	core->writeReg(reg, value);
 }
 
+bool YM2413::isSilent() const
+{
+	return core->isSilent();
+}
+
 void YM2413::generateChannels(int** bufs, unsigned num)
 {
 	core->generateChannels(bufs, num);
 }
 
+void YM2413::skipChannels(unsigned num)
+{
+	core->skipChannels(num);
+}
+
 int YM2413::getAmplificationFactor() const
 {
 	return core->getAmplificationFactor();
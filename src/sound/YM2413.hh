@@ -26,7 +26,9 @@ public:
 
 private:
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
+	void skipChannels(unsigned num) override;
 	int getAmplificationFactor() const override;
 
 	const std::unique_ptr<YM2413Core> core;
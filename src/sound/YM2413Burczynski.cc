@@ -1210,6 +1210,31 @@ void YM2413::generateChannels(int* bufs[9 + 5], unsigned num)
 	}
 }
 
+bool YM2413::isSilent() const
+{
+	// Only when idle for a while, see generateChannels().
+	if (idleSamples <= (CLOCK_FREQ / (72 * 5))) return false;
+
+	const int numMelodicChannels = isRhythm() ? 6 : 9;
+	for (int ch = 0; ch < numMelodicChannels; ++ch) {
+		if (channels[ch].car.isActive()) return false;
+	}
+	if (isRhythm()) {
+		for (int ch = 6; ch < 9; ++ch) {
+			if (channels[ch].car.isActive()) return false;
+		}
+		if (channels[7].mod.isActive()) return false;
+		if (channels[8].mod.isActive()) return false;
+	}
+	return true;
+}
+
+void YM2413::skipChannels(unsigned /*num*/)
+{
+	// After being idle for a while, generateChannels() doesn't update
+	// the internal state anymore.
+}
+
 void YM2413::writeReg(byte r, byte v)
 {
 	byte old = reg[r];
@@ -234,6 +234,8 @@ private:
 	void writeReg(byte reg, byte value) override;
 	byte peekReg(byte reg) const override;
 	void generateChannels(int* bufs[9 + 5], unsigned num) override;
+	bool isSilent() const override;
+	void skipChannels(unsigned num) override;
 	int getAmplificationFactor() const override;
 
 	/** Reset operator parameters.
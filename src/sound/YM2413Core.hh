@@ -95,6 +95,19 @@ public:
 	 */
 	virtual void generateChannels(int* bufs[11], unsigned num) = 0;
 
+	/** Returns true when all channels are silent and will stay silent
+	 * until the next register write. In that case generateChannels()
+	 * would produce no output at all, and skipChannels() can be called
+	 * instead (see also SoundDevice::isSilent()).
+	 */
+	virtual bool isSilent() const = 0;
+
+	/** Only allowed when isSilent() returns true. Has the same effect as
+	 * calling generateChannels(), but doesn't produce output. This is
+	 * typically much faster.
+	 */
+	virtual void skipChannels(unsigned num) = 0;
+
 	/** Returns normalization factor.
 	 * The output of the generateChannels() method should still be
 	 * amplified (=multiplied) with this factor to get a consistent volume
@@ -1085,6 +1085,32 @@ void YM2413::generateChannels(int* bufs[9 + 5], unsigned num)
 	}
 }
 
+bool YM2413::isSilent() const
+{
+	unsigned m = isRhythm() ? 6 : 9;
+	for (unsigned i = 0; i < m; ++i) {
+		if (channels[i].car.isActive()) return false;
+	}
+	if (isRhythm()) {
+		if (channels[6].car.isActive() ||
+		    channels[7].car.isActive() ||
+		    channels[8].car.isActive() ||
+		    channels[7].mod.isActive() ||
+		    channels[8].mod.isActive()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void YM2413::skipChannels(unsigned num)
+{
+	// With all channels inactive, generateChannels() only updates the
+	// AM and PM units.
+	pm_phase += num;
+	am_phase = (am_phase + num) % (LFO_AM_TAB_ELEMENTS * 64);
+}
+
 void YM2413::writeReg(byte r, byte data)
 {
 	assert(r < 0x40);
@@ -39,6 +39,7 @@
 
 #include "YMF262.hh"
 #include "DeviceConfig.hh"
+#include "FMOperators.hh"
 #include "MSXMotherBoard.hh"
 #include "Math.hh"
 #include "outer.hh"
@@ -373,11 +374,6 @@ static const signed char lfo_pm_table[8 * 8 * 2] = {
 	7, 3, 0,-3,-7,-3, 0, 3  // LFO PM depth = 1
 };
 
-// TODO clean this up
-static int phase_modulation;  // phase modulation input (SLOT 2)
-static int phase_modulation2; // phase modulation input (SLOT 3
-                              // in 4 operator channels)
-
 
 YMF262::Slot::Slot()
 	: Cnt(0), Incr(0)
@@ -503,17 +499,72 @@ void YMF262::Slot::advanceEnvelopeGenerator(unsigned egCnt)
 	}
 }
 
-void YMF262::Slot::advancePhaseGenerator(Channel& ch, unsigned lfo_pm)
+// The envelope generator only changes when (eg_cnt & mask) == 0, this
+// returns that mask for the current state. For the states that never change
+// it returns all ones, that still matches when eg_cnt wraps to zero, but then
+// advanceEnvelopeGenerator() simply does nothing.
+unsigned YMF262::Slot::getEnvelopeMask() const
+{
+	switch (state) {
+	case EG_ATTACK:  return eg_m_ar;
+	case EG_DECAY:   return eg_m_dr;
+	case EG_SUSTAIN: return eg_type ? ~0u : eg_m_rr;
+	case EG_RELEASE: return eg_m_rr;
+	default:         return ~0u;
+	}
+}
+
+// returns the raw value to add to Cnt for each sample
+int YMF262::Slot::getPhaseIncrement(const Channel& ch, unsigned lfo_pm) const
 {
 	if (vib) {
 		// LFO phase modulation active
 		unsigned block_fnum = ch.block_fnum;
 		unsigned fnum_lfo   = (block_fnum & 0x0380) >> 7;
 		int lfo_fn_table_index_offset = lfo_pm_table[lfo_pm + 16 * fnum_lfo];
-		Cnt += fnumToIncrement(block_fnum + lfo_fn_table_index_offset) * mul;
+		return (fnumToIncrement(block_fnum + lfo_fn_table_index_offset) * mul).getRawValue();
 	} else {
 		// LFO phase modulation disabled for this operator
-		Cnt += Incr;
+		return Incr.getRawValue();
+	}
+}
+
+// integer part of a phase counter in opCnt[]
+static inline int toPhase(int cnt)
+{
+	return YMF262::FreqIndex::create(cnt).toInt();
+}
+
+// copy the state of the operators to opCnt[], opIncr[] and opEgMask[]
+void YMF262::loadOperators()
+{
+	opLfoPm = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
+	for (unsigned i = 0; i < NUM_OPS; ++i) {
+		auto& ch = channel[i / 2];
+		auto& op = ch.slot[i % 2];
+		opCnt[i]    = op.Cnt.getRawValue();
+		opIncr[i]   = op.getPhaseIncrement(ch, opLfoPm);
+		opEgMask[i] = op.getEnvelopeMask();
+	}
+}
+
+// copy the phase counters back to the Slot objects
+void YMF262::storeOperators()
+{
+	for (unsigned i = 0; i < NUM_OPS; ++i) {
+		channel[i / 2].slot[i % 2].Cnt = FreqIndex::create(opCnt[i]);
+	}
+}
+
+// recalculate the phase increments that depend on the LFO PM value
+void YMF262::updateVibrato()
+{
+	for (unsigned i = 0; i < NUM_OPS; ++i) {
+		auto& ch = channel[i / 2];
+		auto& op = ch.slot[i % 2];
+		if (op.vib) {
+			opIncr[i] = op.getPhaseIncrement(ch, opLfoPm);
+		}
 	}
 }
 
@@ -524,14 +575,23 @@ void YMF262::advance()
 	// 1 level takes 1024 samples
 	lfo_pm_cnt.addQuantum();
 	unsigned lfo_pm = (lfo_pm_cnt.toInt() & 7) | lfo_pm_depth_range;
+	if (lfo_pm != opLfoPm) {
+		opLfoPm = lfo_pm;
+		updateVibrato();
+	}
 
+	// Usually only a few envelope generators change on a given sample,
+	// only those need to be updated.
 	++eg_cnt;
-	for (auto& ch : channel) {
-		for (auto& op : ch.slot) {
-			op.advanceEnvelopeGenerator(eg_cnt);
-			op.advancePhaseGenerator(ch, lfo_pm);
-		}
+	uint64_t steps = FMOperators::findEnvelopeSteps(opEgMask, eg_cnt, NUM_OPS);
+	while (steps) {
+		unsigned i = Math::countTrailingZeros(steps);
+		steps &= steps - 1;
+		auto& op = channel[i / 2].slot[i % 2];
+		op.advanceEnvelopeGenerator(eg_cnt);
+		opEgMask[i] = op.getEnvelopeMask();
 	}
+	FMOperators::advancePhases(opCnt, opIncr, NUM_OPS);
 
 	// The Noise Generator of the YM3812 is 23-bit shift register.
 	// Period is equal to 2^23-2 samples.
@@ -568,7 +628,9 @@ inline int YMF262::Slot::op_calc(unsigned phase, unsigned lfo_am) const
 
 // calculate output of a standard 2 operator channel
 // (or 1st part of a 4-op channel)
-void YMF262::Channel::chan_calc(unsigned lfo_am)
+void YMF262::Channel::chan_calc(
+	unsigned lfo_am, const int* cnt,
+	int& phase_modulation, int& phase_modulation2)
 {
 	// !! something is wrong with this, it caused bug
 	// !!    [2823673] moonsound 4 operator FM fail
@@ -599,15 +661,17 @@ void YMF262::Channel::chan_calc(unsigned lfo_am)
 		? mod.op1_out[0] + mod.op1_out[1]
 		: 0;
 	mod.op1_out[0] = mod.op1_out[1];
-	mod.op1_out[1] = mod.op_calc(mod.Cnt.toInt() + (out >> mod.fb_shift), lfo_am);
+	mod.op1_out[1] = mod.op_calc(toPhase(cnt[MOD]) + (out >> mod.fb_shift), lfo_am);
 	*mod.connect += mod.op1_out[1];
 
 	auto& car = slot[CAR];
-	*car.connect += car.op_calc(car.Cnt.toInt() + phase_modulation, lfo_am);
+	*car.connect += car.op_calc(toPhase(cnt[CAR]) + phase_modulation, lfo_am);
 }
 
 // calculate output of a 2nd part of 4-op channel
-void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
+void YMF262::Channel::chan_calc_ext(
+	unsigned lfo_am, const int* cnt,
+	int& phase_modulation, int& phase_modulation2)
 {
 	// !! see remark in chan_cal(), something is wrong with this
 	// !! optimization disabled for now
@@ -622,10 +686,10 @@ void YMF262::Channel::chan_calc_ext(unsigned lfo_am)
 	phase_modulation = 0;
 
 	auto& mod = slot[MOD];
-	*mod.connect += mod.op_calc(mod.Cnt.toInt() + phase_modulation2, lfo_am);
+	*mod.connect += mod.op_calc(toPhase(cnt[MOD]) + phase_modulation2, lfo_am);
 
 	auto& car = slot[CAR];
-	*car.connect += car.op_calc(car.Cnt.toInt() + phase_modulation, lfo_am);
+	*car.connect += car.op_calc(toPhase(cnt[CAR]) + phase_modulation, lfo_am);
 }
 
 // operators used in the rhythm sounds generation process:
@@ -670,7 +734,7 @@ inline int YMF262::genPhaseHighHat()
 	// phase = 34 or 2d0 (based on noise)
 
 	// base frequency derived from operator 1 in channel 7
-	int op71phase = channel[7].slot[MOD].Cnt.toInt();
+	int op71phase = toPhase(opCnt[2 * 7 + MOD]);
 	bool bit7 = (op71phase & 0x80) != 0;
 	bool bit3 = (op71phase & 0x08) != 0;
 	bool bit2 = (op71phase & 0x04) != 0;
@@ -680,7 +744,7 @@ inline int YMF262::genPhaseHighHat()
 	unsigned phase = res1 ? (0x200 | (0xd0 >> 2)) : 0xd0;
 
 	// enable gate based on frequency of operator 2 in channel 8
-	int op82phase = channel[8].slot[CAR].Cnt.toInt();
+	int op82phase = toPhase(opCnt[2 * 8 + CAR]);
 	bool bit5e= (op82phase & 0x20) != 0;
 	bool bit3e= (op82phase & 0x08) != 0;
 	bool res2 = (bit3e ^ bit5e);
@@ -711,7 +775,7 @@ inline int YMF262::genPhaseSnare()
 	// verified on real YM3812
 	// base frequency derived from operator 1 in channel 7
 	// noise bit XOR'es phase by 0x100
-	return ((channel[7].slot[MOD].Cnt.toInt() & 0x100) + 0x100)
+	return ((toPhase(opCnt[2 * 7 + MOD]) & 0x100) + 0x100)
 	     ^ ((noise_rng & 1) << 8);
 }
 
@@ -721,12 +785,12 @@ inline int YMF262::genPhaseCymbal()
 	// enable gate based on frequency of operator 2 in channel 8
 	//  NOTE: YM2413_2 uses bit5 | bit3, this core uses bit5 ^ bit3
 	//        most likely only one of the two is correct
-	int op82phase = channel[8].slot[CAR].Cnt.toInt();
+	int op82phase = toPhase(opCnt[2 * 8 + CAR]);
 	if ((op82phase ^ (op82phase << 2)) & 0x20) { // bit5 ^ bit3
 		return 0x300;
 	} else {
 		// base frequency derived from operator 1 in channel 7
-		int op71phase = channel[7].slot[MOD].Cnt.toInt();
+		int op71phase = toPhase(opCnt[2 * 7 + MOD]);
 		bool bit7 = (op71phase & 0x80) != 0;
 		bool bit3 = (op71phase & 0x08) != 0;
 		bool bit2 = (op71phase & 0x04) != 0;
@@ -748,9 +812,9 @@ void YMF262::chan_calc_rhythm(unsigned lfo_am)
 	int out = mod6.fb_shift ? mod6.op1_out[0] + mod6.op1_out[1] : 0;
 	mod6.op1_out[0] = mod6.op1_out[1];
 	int pm = mod6.CON ? 0 : mod6.op1_out[0];
-	mod6.op1_out[1] = mod6.op_calc(mod6.Cnt.toInt() + (out >> mod6.fb_shift), lfo_am);
+	mod6.op1_out[1] = mod6.op_calc(toPhase(opCnt[2 * 6 + MOD]) + (out >> mod6.fb_shift), lfo_am);
 	auto& car6 = channel[6].slot[CAR];
-	chanout[6] += 2 * car6.op_calc(car6.Cnt.toInt() + pm, lfo_am);
+	chanout[6] += 2 * car6.op_calc(toPhase(opCnt[2 * 6 + CAR]) + pm, lfo_am);
 
 	// Phase generation is based on:
 	// HH  (13) channel 7->slot 1 combined with channel 8->slot 2
@@ -770,7 +834,7 @@ void YMF262::chan_calc_rhythm(unsigned lfo_am)
 	auto& car7 = channel[7].slot[CAR];
 	chanout[7] += 2 * car7.op_calc(genPhaseSnare(),   lfo_am);
 	auto& mod8 = channel[8].slot[MOD];
-	chanout[8] += 2 * mod8.op_calc(mod8.Cnt.toInt(),  lfo_am);
+	chanout[8] += 2 * mod8.op_calc(toPhase(opCnt[2 * 8 + MOD]),  lfo_am);
 	auto& car8 = channel[8].slot[CAR];
 	chanout[8] += 2 * car8.op_calc(genPhaseCymbal(),  lfo_am);
 }
@@ -1458,6 +1522,9 @@ YMF262::YMF262(const std::string& name_,
 	// avoid (harmless) UMR in serialize()
 	memset(chanout, 0, sizeof(chanout));
 	memset(reg, 0, sizeof(reg));
+	memset(opCnt, 0, sizeof(opCnt));
+	memset(opIncr, 0, sizeof(opIncr));
+	memset(opEgMask, 0, sizeof(opEgMask));
 
 	init_tables();
 
@@ -1488,7 +1555,7 @@ byte YMF262::peekStatus() const
 	return status | status2;
 }
 
-bool YMF262::checkMuteHelper()
+bool YMF262::isSilent() const
 {
 	// TODO this doesn't always mute when possible
 	for (auto& ch : channel) {
@@ -1512,7 +1579,7 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 {
 	// TODO implement per-channel mute (instead of all-or-nothing)
 	// TODO output rhythm on separate channels?
-	if (checkMuteHelper()) {
+	if (isSilent()) {
 		// TODO update internal state, even if muted
 		for (int i = 0; i < 18; ++i) {
 			bufs[i] = nullptr;
@@ -1522,6 +1589,7 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 
 	bool rhythmEnabled = (rhythm & 0x20) != 0;
 
+	loadOperators();
 	for (unsigned j = 0; j < num; ++j) {
 		// Amplitude modulation: 27 output levels (triangle waveform);
 		// 1 level takes one of: 192, 256 or 448 samples
@@ -1543,32 +1611,36 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 			for (int i = 0; i < 3; ++i) {
 				auto& ch0 = channel[k + i + 0];
 				auto& ch3 = channel[k + i + 3];
+				const int* cnt0 = &opCnt[2 * (k + i + 0)];
+				const int* cnt3 = &opCnt[2 * (k + i + 3)];
 				// extended 4op ch#0 part 1 or 2op ch#0
-				ch0.chan_calc(lfo_am);
+				ch0.chan_calc(lfo_am, cnt0, phase_modulation, phase_modulation2);
 				if (ch0.extended) {
 					// extended 4op ch#0 part 2
-					ch3.chan_calc_ext(lfo_am);
+					ch3.chan_calc_ext(lfo_am, cnt3, phase_modulation, phase_modulation2);
 				} else {
 					// standard 2op ch#3
-					ch3.chan_calc(lfo_am);
+					ch3.chan_calc(lfo_am, cnt3, phase_modulation, phase_modulation2);
 				}
 			}
 		}
 
 		// channels 6,7,8 rhythm or 2op mode
 		if (!rhythmEnabled) {
-			channel[6].chan_calc(lfo_am);
-			channel[7].chan_calc(lfo_am);
-			channel[8].chan_calc(lfo_am);
+			for (int i = 6; i <= 8; ++i) {
+				channel[i].chan_calc(lfo_am, &opCnt[2 * i],
+				                     phase_modulation, phase_modulation2);
+			}
 		} else {
 			// Rhythm part
 			chan_calc_rhythm(lfo_am);
 		}
 
 		// channels 15,16,17 are fixed 2-operator channels only
-		channel[15].chan_calc(lfo_am);
-		channel[16].chan_calc(lfo_am);
-		channel[17].chan_calc(lfo_am);
+		for (int i = 15; i <= 17; ++i) {
+			channel[i].chan_calc(lfo_am, &opCnt[2 * i],
+			                     phase_modulation, phase_modulation2);
+		}
 
 		for (int i = 0; i < 18; ++i) {
 			bufs[i][2 * j + 0] += chanout[i] & pan[4 * i + 0];
@@ -1579,6 +1651,7 @@ void YMF262::generateChannels(int** bufs, unsigned num)
 
 		advance();
 	}
+	storeOperators();
 }
 
 
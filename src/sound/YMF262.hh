@@ -52,7 +52,8 @@ private:
 		inline void FM_KEYON(byte key_set);
 		inline void FM_KEYOFF(byte key_clr);
 		inline void advanceEnvelopeGenerator(unsigned eg_cnt);
-		inline void advancePhaseGenerator(Channel& ch, unsigned lfo_pm);
+		inline unsigned getEnvelopeMask() const;
+		inline int getPhaseIncrement(const Channel& ch, unsigned lfo_pm) const;
 		void update_ar_dr();
 		void update_rr();
 		void calc_fc(const Channel& ch);
@@ -113,8 +114,10 @@ private:
 	class Channel {
 	public:
 		Channel();
-		void chan_calc(unsigned lfo_am);
-		void chan_calc_ext(unsigned lfo_am);
+		void chan_calc(unsigned lfo_am, const int* cnt,
+		               int& phase_modulation, int& phase_modulation2);
+		void chan_calc_ext(unsigned lfo_am, const int* cnt,
+		                   int& phase_modulation, int& phase_modulation2);
 
 		template<typename Archive>
 		void serialize(Archive& ar, unsigned version);
@@ -141,6 +144,7 @@ private:
 
 	// SoundDevice
 	int getAmplificationFactor() const override;
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 
 	void callback(byte flag) override;
@@ -150,6 +154,9 @@ private:
 	void setStatus(byte flag);
 	void resetStatus(byte flag);
 	void changeStatusMask(byte flag);
+	void loadOperators();
+	void storeOperators();
+	void updateVibrato();
 	void advance();
 
 	inline int genPhaseHighHat();
@@ -161,7 +168,6 @@ private:
 	void set_ksl_tl(unsigned sl, byte v);
 	void set_ar_dr(unsigned sl, byte v);
 	void set_sl_rr(unsigned sl, byte v);
-	bool checkMuteHelper();
 
 	inline bool isExtended(unsigned ch) const;
 	inline Channel& getFirstOfPair(unsigned ch);
@@ -190,10 +196,24 @@ private:
 	IRQHelper irq;
 
 	int chanout[18]; // 18 channels
+	int phase_modulation;  // phase modulation input (SLOT 2)
+	int phase_modulation2; // phase modulation input (SLOT 3
+	                       // in 4 operator channels)
 
 	byte reg[512];
 	Channel channel[18];	// OPL3 chips have 18 channels
 
+	// The phase and envelope generator state that changes on every
+	// sample, in structure-of-arrays form so that several operators can
+	// be advanced at once (see FMOperators). Operator 'i' is slot 'i % 2'
+	// of channel 'i / 2'. Only valid during generateChannels(), outside
+	// of it Slot::Cnt holds the phase counter.
+	static const unsigned NUM_OPS = 18 * 2;
+	int opCnt[NUM_OPS + 4];		// Slot::Cnt
+	int opIncr[NUM_OPS + 4];	// Slot::Incr, including vibrato
+	unsigned opEgMask[NUM_OPS + 4];	// see Slot::getEnvelopeMask()
+	unsigned opLfoPm;		// LFO PM value used in 'opIncr'
+
 	unsigned pan[18 * 4];		// channels output masks 4 per channel
 	                                //    0xffffffff = enable
 	unsigned eg_cnt;		// global envelope generator counter
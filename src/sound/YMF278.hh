@@ -87,13 +87,13 @@ private:
 	};
 
 	// SoundDevice
+	bool isSilent() const override;
 	void generateChannels(int** bufs, unsigned num) override;
 
 	void writeRegDirect(byte reg, byte data, EmuTime::param time);
 	unsigned getRamAddress(unsigned addr) const;
 	int16_t getSample(Slot& op);
 	void advance();
-	bool anyActive();
 	void keyOnHelper(Slot& slot);
 
 	MSXMotherBoard& motherBoard;
@@ -6,6 +6,7 @@ namespace openmsx {
 namespace Thread {
 
 static std::thread::id mainThreadId;
+static thread_local bool backgroundEmulation = false;
 
 void setMainThread()
 {
@@ -19,5 +20,22 @@ bool isMainThread()
 	return mainThreadId == std::this_thread::get_id();
 }
 
+bool isEmulationThread()
+{
+	return backgroundEmulation || isMainThread();
+}
+
+BackgroundEmulation::BackgroundEmulation()
+{
+	assert(!isMainThread());
+	assert(!backgroundEmulation);
+	backgroundEmulation = true;
+}
+
+BackgroundEmulation::~BackgroundEmulation()
+{
+	backgroundEmulation = false;
+}
+
 } // namespace Thread
 } // namespace openmsx
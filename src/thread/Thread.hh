@@ -14,6 +14,27 @@ namespace Thread {
 	  */
 	bool isMainThread();
 
+	/** Returns true when called from the main thread or from a thread
+	  * that currently emulates a machine in the background (see below).
+	  */
+	bool isEmulationThread();
+
+	/** While an object of this class exists, the current (non-main)
+	  * thread may emulate an MSXMotherBoard that is not visible to the
+	  * user (e.g. to regenerate reverse snapshots). Such a machine is not
+	  * allowed to interact with the rest of the application (Tcl, CliComm,
+	  * RTScheduler, ...), code that does so checks isMainThread() and
+	  * skips these interactions.
+	  */
+	class BackgroundEmulation
+	{
+	public:
+		BackgroundEmulation();
+		~BackgroundEmulation();
+		BackgroundEmulation(const BackgroundEmulation&) = delete;
+		BackgroundEmulation& operator=(const BackgroundEmulation&) = delete;
+	};
+
 } // namespace Thread
 } // namespace openmsx
 
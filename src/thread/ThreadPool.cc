@@ -0,0 +1,102 @@
+#include "ThreadPool.hh"
+#include <algorithm>
+#include <atomic>
+
+namespace openmsx {
+
+ThreadPool::ThreadPool(unsigned numThreads)
+	: stopping(false)
+{
+	if (numThreads == 0) {
+		unsigned hw = std::thread::hardware_concurrency();
+		numThreads = (hw > 1) ? (hw - 1) : 1;
+	}
+	workers.reserve(numThreads);
+	for (unsigned i = 0; i < numThreads; ++i) {
+		workers.emplace_back([this]() { run(); });
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (auto& w : workers) {
+		w.join();
+	}
+}
+
+std::shared_future<void> ThreadPool::enqueue(std::function<void()> task)
+{
+	std::packaged_task<void()> pt(std::move(task));
+	std::shared_future<void> result = pt.get_future().share();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(pt));
+	}
+	condition.notify_one();
+	return result;
+}
+
+void ThreadPool::parallelFor(unsigned n, const std::function<void(unsigned)>& func)
+{
+	if (n == 0) return;
+	if (n == 1) {
+		func(0);
+		return;
+	}
+
+	// Indices are handed out dynamically, so a slow worker (or one that
+	// is still busy with an earlier task) doesn't delay the others.
+	std::atomic<unsigned> next(0);
+	auto work = [&]() {
+		unsigned i;
+		while ((i = next++) < n) {
+			func(i);
+		}
+	};
+
+	unsigned numHelpers = std::min(n - 1, getNumThreads());
+	std::vector<std::shared_future<void>> helpers;
+	helpers.reserve(numHelpers);
+	for (unsigned i = 0; i < numHelpers; ++i) {
+		helpers.push_back(enqueue(work));
+	}
+	std::exception_ptr error;
+	try {
+		work();
+	} catch (...) {
+		error = std::current_exception();
+		next = n; // stop handing out new indices
+	}
+	// Always wait for all helpers, they reference local variables.
+	for (auto& h : helpers) {
+		try {
+			h.get();
+		} catch (...) {
+			if (!error) error = std::current_exception();
+		}
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+void ThreadPool::run()
+{
+	while (true) {
+		std::packaged_task<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() {
+				return stopping || !tasks.empty(); });
+			if (tasks.empty()) return; // stopping and no more work
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task(); // exceptions are stored in the future
+	}
+}
+
+} // namespace openmsx
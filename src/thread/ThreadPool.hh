@@ -0,0 +1,63 @@
+#ifndef THREADPOOL_HH
+#define THREADPOOL_HH
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+/** A fixed set of worker threads that execute queued tasks.
+ *
+ * Tasks are started in the order they were enqueued (but with more than one
+ * worker thread they may of course finish in a different order). This
+ * guarantees that a task can safely wait for the completion of a task that
+ * was enqueued earlier: that other task is either finished or already
+ * running on another worker.
+ */
+class ThreadPool
+{
+public:
+	/** Create a pool with the given number of worker threads. When zero,
+	  * use one thread less than the number of hardware threads (so that
+	  * together with the main thread all cores are used), with a minimum
+	  * of one thread.
+	  */
+	explicit ThreadPool(unsigned numThreads = 0);
+
+	/** Finishes all queued tasks and then stops the worker threads. */
+	~ThreadPool();
+
+	unsigned getNumThreads() const { return unsigned(workers.size()); }
+
+	/** Queue a task for execution on one of the worker threads.
+	  * @return A future that becomes ready when the task has finished.
+	  *         If the task threw an exception, get() rethrows it.
+	  */
+	std::shared_future<void> enqueue(std::function<void()> task);
+
+	/** Execute func(0) ... func(n-1) in parallel. The calling thread
+	  * also executes some of these calls. Only returns when all calls
+	  * have finished. An exception thrown by any of the calls is
+	  * rethrown in the calling thread.
+	  * Should not be called from one of the worker threads of this pool.
+	  */
+	void parallelFor(unsigned n, const std::function<void(unsigned)>& func);
+
+private:
+	void run();
+
+	std::vector<std::thread> workers;
+	std::deque<std::packaged_task<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping;
+};
+
+} // namespace openmsx
+
+#endif
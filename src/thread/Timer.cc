@@ -1,4 +1,5 @@
 #include "Timer.hh"
+#include <atomic>
 #include <chrono>
 #include <thread>
 
@@ -7,7 +8,7 @@ namespace Timer {
 
 uint64_t getTime()
 {
-	static uint64_t lastTime = 0;
+	static std::atomic<uint64_t> lastTime(0); // also used from worker threads
 	uint64_t now;
 
 	using namespace std::chrono;
@@ -21,8 +22,9 @@ uint64_t getTime()
 	// clock_gettime(CLOCK_MONOTONIC). Unfortunately in older linux
 	// versions we've seen buggy implementation that once in a while did
 	// return time points slightly in the past.
-	if (now < lastTime) return lastTime;
-	lastTime = now;
+	uint64_t last = lastTime.load(std::memory_order_relaxed);
+	if (now < last) return last;
+	lastTime.store(now, std::memory_order_relaxed);
 	return now;
 }
 
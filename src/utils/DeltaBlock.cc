@@ -1,4 +1,7 @@
 #include "DeltaBlock.hh"
+#include "DirtyPages.hh"
+#include "ThreadPool.hh"
+#include "Timer.hh"
 #include "snappy.hh"
 #include "likely.hh"
 #include <algorithm>
@@ -147,10 +150,10 @@ static std::pair<const uint8_t*, const uint8_t*> scan_match_unguarded(
 // immediately past the end of the buffers are returned. Both buffers must have
 // the same size.
 //
-// Internally this function will place a sentinel in the buffers (and restore
-// it afterwards). So even though this function takes 'const pointers' it does
-// temporarily write to the buffer (and it will crash when you pass pointers to
-// read-only memory).
+// Internally this function will place a sentinel in the first buffer (and
+// restore it afterwards). So even though this function takes 'const pointers'
+// it does temporarily write to that buffer (and it will crash when you pass
+// pointers to read-only memory). The second buffer is only read.
 static std::pair<const uint8_t*, const uint8_t*> scan_mismatch(
 	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end)
 {
@@ -205,6 +208,8 @@ static std::pair<const uint8_t*, const uint8_t*> scan_match(
 //   n2 number of bytes are different, and here are the bytes
 //   n3 number of bytes are equal
 //   ...
+// The sentinels are placed in 'newBuf', 'oldBuf' is only read. So several
+// deltas against the same 'oldBuf' can be calculated concurrently.
 static vector<uint8_t> calcDelta(const uint8_t* oldBuf, const uint8_t* newBuf, size_t size)
 {
 	vector<uint8_t> result;
@@ -216,7 +221,7 @@ static vector<uint8_t> calcDelta(const uint8_t* oldBuf, const uint8_t* newBuf, s
 
 	// scan equal bytes (possibly zero)
 	auto* q1 = q;
-	std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+	std::tie(q, p) = scan_mismatch(q, q_end, p, p_end);
 	auto n1 = q - q1;
 	storeUleb(result, n1);
 
@@ -225,11 +230,11 @@ static vector<uint8_t> calcDelta(const uint8_t* oldBuf, const uint8_t* newBuf, s
 
 		auto* q2 = q;
 	different:
-		std::tie(p, q) = scan_match(p + 1, p_end, q + 1, q_end);
+		std::tie(q, p) = scan_match(q + 1, q_end, p + 1, p_end);
 		auto n2 = q - q2;
 
 		auto* q3 = q;
-		std::tie(p, q) = scan_mismatch(p, p_end, q, q_end);
+		std::tie(q, p) = scan_mismatch(q, q_end, p, p_end);
 		auto n3 = q - q3;
 		if ((q != q_end) && (n3 <= 2)) goto different;
 
@@ -260,25 +265,123 @@ static void applyDeltaInPlace(uint8_t* buf, size_t size, const uint8_t* delta)
 	}
 }
 
-#if STATISTICS
+// A range of bytes that is different from the reference block.
+struct DeltaRange {
+	size_t offset;
+	size_t len;
+	const uint8_t* bytes; // the new values
+};
+
+// Decode a delta (as produced by calcDelta()) into a list of ranges. The
+// ranges point into the given delta.
+static void decodeDelta(const uint8_t* delta, size_t size,
+                        vector<DeltaRange>& result)
+{
+	size_t pos = 0;
+	while (pos != size) {
+		pos += loadUleb(delta);
+		if (pos == size) break;
+
+		auto n2 = loadUleb(delta);
+		result.push_back({pos, n2, delta});
+		pos   += n2;
+		delta += n2;
+	}
+}
+
+// Like calcDelta(), but the result is a list of ranges (that point into
+// 'newBuf'). Offsets are relative to 'offset'.
+static void findRanges(const uint8_t* oldBuf, const uint8_t* newBuf,
+                       size_t size, size_t offset, vector<DeltaRange>& result)
+{
+	auto* p = oldBuf;
+	auto* q = newBuf;
+	auto* p_end = p + size;
+	auto* q_end = q + size;
+
+	std::tie(q, p) = scan_mismatch(q, q_end, p, p_end);
+	while (q != q_end) {
+		auto* q2 = q;
+		std::tie(q, p) = scan_match(q + 1, q_end, p + 1, p_end);
+		result.push_back({offset + (q2 - newBuf), size_t(q - q2), q2});
+		std::tie(q, p) = scan_mismatch(q, q_end, p, p_end);
+	}
+}
+
+// Encode a sorted list of (non-overlapping) ranges in the same format as
+// calcDelta(). Like calcDelta(), ranges that are separated by at most 2 equal
+// bytes are merged, those equal bytes are taken from 'oldBuf'.
+static vector<uint8_t> encodeDelta(const vector<DeltaRange>& ranges,
+                                   const uint8_t* oldBuf, size_t size)
+{
+	vector<uint8_t> result;
+	size_t pos = 0;
+	auto it = begin(ranges);
+	while (it != end(ranges)) {
+		auto first = it;
+		size_t stop = it->offset + it->len;
+		for (++it; (it != end(ranges)) && (it->offset - stop <= 2); ++it) {
+			stop = it->offset + it->len;
+		}
+		storeUleb(result, first->offset - pos);
+		storeUleb(result, stop - first->offset);
+		pos = first->offset;
+		for (auto r = first; r != it; ++r) {
+			result.insert(result.end(), oldBuf + pos, oldBuf + r->offset);
+			result.insert(result.end(), r->bytes, r->bytes + r->len);
+			pos = r->offset + r->len;
+		}
+	}
+	if (pos != size) storeUleb(result, size - pos);
+
+	result.shrink_to_fit();
+	return result;
+}
 
 // class DeltaBlock
 
+bool DeltaBlock::isReady() const
+{
+	return !pending.valid() ||
+	       (pending.wait_for(std::chrono::seconds(0)) ==
+	        std::future_status::ready);
+}
+
+void DeltaBlock::waitReady() const
+{
+	if (pending.valid()) pending.get(); // rethrows e.g. std::bad_alloc
+}
+
+#if STATISTICS
 size_t DeltaBlock::globalAllocSize = 0;
+#endif
 
 DeltaBlock::~DeltaBlock()
 {
+	if (memoryCounter) *memoryCounter -= memoryUsage;
+#if STATISTICS
 	globalAllocSize -= allocSize;
 	std::cout << "stat: ~DeltaBlock " << globalAllocSize
 	          << " (-" << allocSize << ')' << std::endl;
+#endif
 }
 
-#endif
+void DeltaBlock::setMemoryUsage(size_t usage)
+{
+	size_t old = memoryUsage.exchange(usage);
+	if (memoryCounter) {
+		// first add, so that the total never (temporarily) drops
+		// below the real value
+		*memoryCounter += usage;
+		*memoryCounter -= old;
+	}
+}
 
 // class DeltaBlockCopy
 
 DeltaBlockCopy::DeltaBlockCopy(const uint8_t* data, size_t size)
-	: block(size)
+	: DeltaBlock(size)
+	, block(size)
 	, compressedSize(0)
 {
 #ifdef DEBUG
@@ -296,6 +399,9 @@ DeltaBlockCopy::DeltaBlockCopy(const uint8_t* data, size_t size)
 
 void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 {
+	// No need to wait for compress(), till it's done the data is still
+	// uncompressed.
+	std::lock_guard<std::mutex> lock(mutex);
 	if (compressed()) {
 		snappy::uncompress(
 			reinterpret_cast<const char*>(block.data()), compressedSize,
@@ -310,7 +416,10 @@ void DeltaBlockCopy::apply(uint8_t* dst, size_t size) const
 
 void DeltaBlockCopy::compress(size_t size)
 {
-	if (compressed()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (compressed()) return;
+	}
 
 	size_t dstLen = snappy::maxCompressedLength(size);
 	MemBuffer<uint8_t> buf2(dstLen);
@@ -320,13 +429,20 @@ void DeltaBlockCopy::compress(size_t size)
 		// compression isn't beneficial
 		return;
 	}
-	compressedSize = dstLen;
-	block.swap(buf2);
-	block.resize(compressedSize); // shrink to fit
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		compressedSize = dstLen;
+		block.swap(buf2);
+		block.resize(compressedSize); // shrink to fit
+	}
+	setMemoryUsage(compressedSize);
 	assert(compressed());
 #ifdef DEBUG
+	// Don't use apply(), this may run as background work of this block.
 	MemBuffer<uint8_t> buf3(size);
-	apply(buf3.data(), size);
+	snappy::uncompress(
+		reinterpret_cast<const char*>(block.data()), compressedSize,
+		reinterpret_cast<char*>(buf3.data()), size);
 	assert(memcmp(buf3.data(), buf2.data(), size) == 0);
 #endif
 #if STATISTICS
@@ -350,16 +466,97 @@ const uint8_t* DeltaBlockCopy::getData()
 DeltaBlockDiff::DeltaBlockDiff(
 		const std::shared_ptr<DeltaBlockCopy>& prev_,
 		const uint8_t* data, size_t size)
-	: prev(prev_)
-	, delta(calcDelta(prev->getData(), data, size))
+	: DeltaBlock(size)
+	, prev(prev_)
+	, newData(size)
+	, partial(false)
 {
 #ifdef DEBUG
 	sha1 = SHA1::calc(data, size);
+#endif
+	memcpy(newData.data(), data, size);
+}
+
+DeltaBlockDiff::DeltaBlockDiff(
+		const std::shared_ptr<DeltaBlockCopy>& prev_,
+		const std::shared_ptr<DeltaBlockDiff>& base_,
+		const uint8_t* data, size_t size, const DirtyPages& dirty)
+	: DeltaBlock(size)
+	, prev(prev_)
+	, base(base_)
+	, partial(true)
+{
+#ifdef DEBUG
+	sha1 = SHA1::calc(data, size);
+#endif
+	auto numPages = (size + DirtyPages::SIZE - 1) >> DirtyPages::BITS;
+	for (unsigned page = 0; page < numPages; ++page) {
+		if (dirty.isDirty(page)) dirtyPages.push_back(page);
+	}
+	newData.resize(dirtyPages.size() * DirtyPages::SIZE);
+	auto* dst = newData.data();
+	for (auto page : dirtyPages) {
+		size_t start = size_t(page) << DirtyPages::BITS;
+		size_t len = std::min<size_t>(DirtyPages::SIZE, size - start);
+		memcpy(dst, data + start, len);
+		dst += len;
+	}
+	setMemoryUsage(dirtyPages.size() * DirtyPages::SIZE);
+}
+
+// Only the dirty pages are compared against the reference block. For the
+// other pages the differences are taken from the delta of the previous
+// snapshot (or there are none when that was the reference block itself).
+vector<uint8_t> DeltaBlockDiff::calcPartialDelta(size_t size)
+{
+	vector<DeltaRange> baseRanges;
+	if (base) {
+		// Was queued before this block, so it's ready or in progress.
+		base->waitReady();
+		decodeDelta(base->delta.data(), size, baseRanges);
+	}
 
+	auto* ref = prev->getData();
+	auto* src = newData.data();
+	vector<DeltaRange> ranges;
+	auto nextDirty = begin(dirtyPages);
+	auto b = begin(baseRanges);
+	auto numPages = (size + DirtyPages::SIZE - 1) >> DirtyPages::BITS;
+	for (unsigned page = 0; page < numPages; ++page) {
+		size_t start = size_t(page) << DirtyPages::BITS;
+		size_t stop = std::min<size_t>(start + DirtyPages::SIZE, size);
+		if ((nextDirty != end(dirtyPages)) && (*nextDirty == page)) {
+			findRanges(ref + start, src, stop - start, start, ranges);
+			src += stop - start;
+			++nextDirty;
+		} else {
+			while ((b != end(baseRanges)) && (b->offset + b->len <= start)) ++b;
+			for (auto r = b; (r != end(baseRanges)) && (r->offset < stop); ++r) {
+				size_t s = std::max(r->offset, start);
+				size_t e = std::min(r->offset + r->len, stop);
+				ranges.push_back({s, e - s, r->bytes + (s - r->offset)});
+			}
+		}
+	}
+	return encodeDelta(ranges, ref, size);
+}
+
+void DeltaBlockDiff::calcDelta(size_t size)
+{
+	delta = partial
+	      ? calcPartialDelta(size)
+	      : openmsx::calcDelta(prev->getData(), newData.data(), size);
+#ifdef DEBUG
+	// Don't use apply(), that would wait for this calculation to finish.
 	MemBuffer<uint8_t> buf(size);
-	apply(buf.data(), size);
-	assert(memcmp(buf.data(), data, size) == 0);
+	memcpy(buf.data(), prev->getData(), size);
+	applyDeltaInPlace(buf.data(), size, delta.data());
+	assert(SHA1::calc(buf.data(), size) == sha1);
 #endif
+	newData.clear();
+	base.reset();
+	dirtyPages = vector<unsigned>();
+	setMemoryUsage(delta.size());
 #if STATISTICS
 	allocSize = delta.size();
 	globalAllocSize += allocSize;
@@ -370,6 +567,7 @@ DeltaBlockDiff::DeltaBlockDiff(
 
 void DeltaBlockDiff::apply(uint8_t* dst, size_t size) const
 {
+	waitReady();
 	prev->apply(dst, size);
 	applyDeltaInPlace(dst, size, delta.data());
 #ifdef DEBUG
@@ -385,8 +583,90 @@ size_t DeltaBlockDiff::getDeltaSize() const
 
 // class LastDeltaBlocks
 
+std::shared_ptr<const std::atomic<uint64_t>> LastDeltaBlocks::startWorkTimer()
+{
+	workTime = std::make_shared<std::atomic<uint64_t>>(0);
+	return workTime;
+}
+
+void LastDeltaBlocks::track(DeltaBlock& block)
+{
+	// Must be called before the background work of this block is
+	// started, that work changes the memory usage.
+	assert(!block.memoryCounter);
+	if (!memoryCounter) return;
+	block.memoryCounter = memoryCounter;
+	*memoryCounter += block.memoryUsage;
+}
+
+std::function<void()> LastDeltaBlocks::timed(std::function<void()> work) const
+{
+	auto timer = workTime;
+	return [work, timer]() {
+		auto start = Timer::getTime();
+		work();
+		if (timer) *timer += Timer::getTime() - start;
+	};
+}
+
+std::shared_future<void> LastDeltaBlocks::execute(std::function<void()> task)
+{
+	if (pool) {
+		// The returned future (stored in the block) keeps the task
+		// alive and the task keeps the block alive. Break that cycle
+		// once the task has run.
+		return pool->enqueue([task]() mutable {
+			try {
+				task();
+			} catch (...) {
+				task = nullptr;
+				throw;
+			}
+			task = nullptr;
+		});
+	} else {
+		task();
+		return std::shared_future<void>(); // no background work
+	}
+}
+
+void LastDeltaBlocks::updateAccSize(Info& info)
+{
+	// Only diffs that are already calculated are counted, so this
+	// heuristic can lag a bit behind when work is done in the background.
+	// Limit that lag to one block (normally the previous diff was
+	// finished long ago, so this doesn't actually wait).
+	if (info.diffs.size() > 1) {
+		info.diffs[info.diffs.size() - 2]->waitReady();
+	}
+	auto it = std::remove_if(begin(info.diffs), end(info.diffs),
+		[&](const std::shared_ptr<DeltaBlockDiff>& d) {
+			if (!d->isReady()) return false;
+			info.accSize += d->getDeltaSize();
+			return true;
+		});
+	info.diffs.erase(it, end(info.diffs));
+}
+
+void LastDeltaBlocks::compressRef(
+	Info& info, const std::shared_ptr<DeltaBlockCopy>& ref)
+{
+	// The diffs against this reference still need the uncompressed data.
+	// Those tasks were queued earlier, so waiting for them (from within
+	// a worker thread) cannot deadlock.
+	auto diffs = std::move(info.diffs);
+	info.diffs.clear();
+	auto size = info.size;
+	auto work = timed([ref, size]() { ref->compress(size); });
+	ref->pending = execute([diffs, work]() {
+		for (auto& d : diffs) d->waitReady();
+		work();
+	});
+}
+
 std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
-		const void* id, const uint8_t* data, size_t size)
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty)
 {
 	auto it = std::lower_bound(begin(infos), end(infos), std::make_tuple(id, size),
 		[](const Info& info, const std::tuple<const void*, size_t>& info2) {
@@ -398,26 +678,47 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
 	assert(it->id   == id);
 	assert(it->size == size);
 
+	updateAccSize(*it);
 	auto ref = it->ref.lock();
 	if (it->accSize >= size || !ref) {
 		if (ref) {
 			// We will switch to a new DeltaBlockCopy object. So
 			// now is a good time to compress the old one.
-			ref->compress(size);
+			compressRef(*it, ref);
 		}
 		// Heuristic: create a new block when too many small
 		// differences have accumulated.
 		auto b = std::make_shared<DeltaBlockCopy>(data, size);
+		track(*b);
 		it->ref = b;
 		it->last = b;
+		it->lastDiff.reset();
 		it->accSize = 0;
+		it->diffs.clear();
 		return b;
 	} else {
 		// Create diff based on earlier reference block.
 		// Reference remains unchanged.
-		auto b = std::make_shared<DeltaBlockDiff>(ref, data, size);
+		std::shared_ptr<DeltaBlockDiff> b;
+		auto last = it->last.lock();
+		auto lastDiff = it->lastDiff.lock();
+		if (dirty && (last == ref)) {
+			b = std::make_shared<DeltaBlockDiff>(
+				ref, nullptr, data, size, *dirty);
+		} else if (dirty && lastDiff && (last == lastDiff)) {
+			b = std::make_shared<DeltaBlockDiff>(
+				ref, lastDiff, data, size, *dirty);
+		} else {
+			// No dirty information, or 'last' is neither 'ref' nor
+			// a diff against it (e.g. already dropped): compare
+			// all pages.
+			b = std::make_shared<DeltaBlockDiff>(ref, data, size);
+		}
+		track(*b);
+		b->pending = execute(timed([b, size]() { b->calcDelta(size); }));
 		it->last = b;
-		it->accSize += b->getDeltaSize();
+		it->lastDiff = b;
+		it->diffs.push_back(b);
 		return b;
 	}
 }
@@ -437,9 +738,12 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNullDiff(
 	auto last = it->last.lock();
 	if (!last) {
 		auto b = std::make_shared<DeltaBlockCopy>(data, size);
+		track(*b);
 		it->ref = b;
 		it->last = b;
+		it->lastDiff.reset();
 		it->accSize = 0;
+		it->diffs.clear();
 		return b;
 	} else {
 #ifdef DEBUG
@@ -451,9 +755,9 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNullDiff(
 
 void LastDeltaBlocks::clear()
 {
-	for (const Info& info : infos) {
+	for (Info& info : infos) {
 		if (auto ref = info.ref.lock()) {
-			ref->compress(info.size);
+			compressRef(info, ref);
 		}
 	}
 	infos.clear();
@@ -4,8 +4,12 @@
 #define STATISTICS 0
 
 #include "MemBuffer.hh"
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <vector>
 #ifdef DEBUG
 #include "sha1.hh"
@@ -13,18 +17,55 @@
 
 namespace openmsx {
 
+class ThreadPool;
+class DirtyPages;
+
+/** Running total of the memory used by a group of blocks (see
+  * LastDeltaBlocks::setMemoryCounter()) and of other buffers (see
+  * MemoryCharge). It's updated from the background threads as well. */
+using MemoryCounter = std::shared_ptr<std::atomic<size_t>>;
+
 class DeltaBlock
 {
 public:
-#if STATISTICS
 	virtual ~DeltaBlock();
-#else
-	virtual ~DeltaBlock() = default;
-#endif
 	virtual void apply(uint8_t* dst, size_t size) const = 0;
 
+	/** Part of the work to create a block (calculating the delta,
+	  * compressing) can be done in a background thread. This checks
+	  * whether that work has finished.
+	  */
+	bool isReady() const;
+
+	/** Block until the background work (if any) has finished. */
+	void waitReady() const;
+
+	/** Size of the data that is stored in this block (the 'size'
+	  * parameter of apply()). */
+	size_t getDataSize() const { return dataSize; }
+
+	/** Number of bytes of memory used by this block itself (so not
+	  * including the reference block, see getReference()). This value
+	  * shrinks when the background work finishes. */
+	size_t getMemoryUsage() const { return memoryUsage; }
+
+	/** The block this block depends on, or nullptr. */
+	virtual const DeltaBlock* getReference() const { return nullptr; }
+
 protected:
-	DeltaBlock() = default;
+	explicit DeltaBlock(size_t size)
+		: dataSize(size), memoryUsage(size) {}
+
+	/** Also updates the memory counter (if any). */
+	void setMemoryUsage(size_t usage);
+
+	const size_t dataSize;
+	std::atomic<size_t> memoryUsage;
+	MemoryCounter memoryCounter; // set by LastDeltaBlocks
+
+	// Only valid when background work was scheduled for this block.
+	std::shared_future<void> pending;
+	friend class LastDeltaBlocks;
 
 #ifdef DEBUG
 public:
@@ -50,6 +91,9 @@ public:
 private:
 	bool compressed() const { return compressedSize != 0; }
 
+	// apply() may run in a different thread (spilling the reverse history)
+	// while compress() replaces the data.
+	mutable std::mutex mutex;
 	MemBuffer<uint8_t> block;
 	size_t compressedSize;
 };
@@ -58,22 +102,62 @@ private:
 class DeltaBlockDiff final : public DeltaBlock
 {
 public:
+	/** This only makes a copy of 'data', the actual delta is calculated
+	  * by calcDelta() (possibly later and/or in a different thread). */
 	DeltaBlockDiff(const std::shared_ptr<DeltaBlockCopy>& prev_,
 	               const uint8_t* data, size_t size);
+	/** As above, but only the dirty pages are copied (and later compared
+	  * against 'prev'). The clean pages must be equal to 'base', which
+	  * is either a diff against the same 'prev' or nullptr when they are
+	  * equal to 'prev' itself. */
+	DeltaBlockDiff(const std::shared_ptr<DeltaBlockCopy>& prev_,
+	               const std::shared_ptr<DeltaBlockDiff>& base_,
+	               const uint8_t* data, size_t size,
+	               const DirtyPages& dirty);
+	void calcDelta(size_t size);
 	void apply(uint8_t* dst, size_t size) const override;
+	const DeltaBlock* getReference() const override { return prev.get(); }
 	size_t getDeltaSize() const;
 
 private:
+	std::vector<uint8_t> calcPartialDelta(size_t size);
+
 	const std::shared_ptr<DeltaBlockCopy> prev;
-	const std::vector<uint8_t> delta; // TODO could be tweaked to use OutputBuffer
+	std::shared_ptr<DeltaBlockDiff> base; // only used till calcDelta() has run
+	MemBuffer<uint8_t> newData;           // idem
+	std::vector<unsigned> dirtyPages;     // idem, only used when 'partial'
+	std::vector<uint8_t> delta; // TODO could be tweaked to use OutputBuffer
+	bool partial; // only the dirty pages are copied in 'newData'
 };
 
 
 class LastDeltaBlocks
 {
 public:
+	/** When set, calculating deltas and compressing reference blocks is
+	  * done on the worker threads of the given pool instead of in the
+	  * calling thread. Apply() on such a block waits when needed.
+	  */
+	void setThreadPool(ThreadPool* pool_) { pool = pool_; }
+
+	/** The memory used by the blocks that are created from now on is
+	  * added to the given counter (for as long as those blocks live).
+	  */
+	void setMemoryCounter(MemoryCounter counter) {
+		memoryCounter = std::move(counter);
+	}
+
+	/** Time spent (in us) on the background work of blocks that are
+	  * created from now on is accumulated in the returned counter.
+	  */
+	std::shared_ptr<const std::atomic<uint64_t>> startWorkTimer();
+
+	/** Create a new block for the given data. When 'dirty' is given, it
+	  * tells which pages changed since the previous call for this 'id'.
+	  */
 	std::shared_ptr<DeltaBlock> createNew(
-		const void* id, const uint8_t* data, size_t size);
+		const void* id, const uint8_t* data, size_t size,
+		const DirtyPages* dirty = nullptr);
 	std::shared_ptr<DeltaBlock> createNullDiff(
 		const void* id, const uint8_t* data, size_t size);
 	void clear();
@@ -87,10 +171,65 @@ private:
 		size_t size;
 		std::weak_ptr<DeltaBlockCopy> ref;
 		std::weak_ptr<DeltaBlock> last;
+		std::weak_ptr<DeltaBlockDiff> lastDiff; // diff against 'ref'
 		size_t accSize;
+		// Diffs against 'ref' that were not yet included in 'accSize'
+		// (because they might not yet be calculated).
+		std::vector<std::shared_ptr<DeltaBlockDiff>> diffs;
 	};
 
+	void track(DeltaBlock& block);
+	void updateAccSize(Info& info);
+	void compressRef(Info& info, const std::shared_ptr<DeltaBlockCopy>& ref);
+	std::function<void()> timed(std::function<void()> work) const;
+	std::shared_future<void> execute(std::function<void()> task);
+
 	std::vector<Info> infos;
+	ThreadPool* pool = nullptr;
+	std::shared_ptr<std::atomic<uint64_t>> workTime;
+	MemoryCounter memoryCounter;
+};
+
+
+/** Adds a fixed amount to a MemoryCounter for as long as this object lives
+  * (or till reset() is called). Can be moved, e.g. together with the buffer
+  * it accounts for.
+  */
+class MemoryCharge
+{
+public:
+	MemoryCharge() : amount(0) {}
+	MemoryCharge(MemoryCounter counter_, size_t amount_)
+		: counter(std::move(counter_)), amount(amount_)
+	{
+		if (counter) *counter += amount;
+	}
+	MemoryCharge(MemoryCharge&& other) noexcept
+		: counter(std::move(other.counter)), amount(other.amount)
+	{
+		other.counter.reset();
+	}
+	MemoryCharge& operator=(MemoryCharge&& other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			counter = std::move(other.counter);
+			amount = other.amount;
+			other.counter.reset();
+		}
+		return *this;
+	}
+	~MemoryCharge() { reset(); }
+
+	void reset()
+	{
+		if (counter) *counter -= amount;
+		counter.reset();
+	}
+
+private:
+	MemoryCounter counter;
+	size_t amount;
 };
 
 } // namespace openmsx
@@ -0,0 +1,71 @@
+#ifndef DIRTYPAGES_HH
+#define DIRTYPAGES_HH
+
+#include <vector>
+#include <cstddef>
+
+namespace openmsx {
+
+/** Keeps track of which pages of a memory block were (possibly) written
+ * since the last reverse snapshot. Reverse snapshots then only need to
+ * compare the dirty pages against the previous snapshot.
+ *
+ * The page size equals the CPU cache line size, so the owner of the memory
+ * can mark a page dirty when it hands out a write cache line.
+ *
+ * Tracking is only correct when _all_ writes to the memory block are
+ * marked. Therefore it's disabled by default, and then all pages are
+ * always considered dirty.
+ */
+class DirtyPages
+{
+public:
+	static const unsigned BITS = 8;
+	static const unsigned SIZE = 1 << BITS;
+
+	explicit DirtyPages(size_t size)
+		: dirty((size + SIZE - 1) >> BITS, true)
+		, anyDirty(true), tracking(false) {}
+
+	void setTracking(bool enabled) {
+		tracking = enabled;
+		markAll();
+	}
+	bool isTracking() const { return tracking; }
+
+	void mark(size_t addr) {
+		dirty[addr >> BITS] = true;
+		anyDirty = true;
+	}
+	void mark(size_t addr, size_t num) {
+		if (num == 0) return;
+		for (size_t p = addr >> BITS; p <= ((addr + num - 1) >> BITS); ++p) {
+			dirty[p] = true;
+		}
+		anyDirty = true;
+	}
+	void markAll() {
+		dirty.assign(dirty.size(), true);
+		anyDirty = true;
+	}
+
+	/** Should be called right after taking a reverse snapshot. */
+	void clear() {
+		if (!tracking) return;
+		dirty.assign(dirty.size(), false);
+		anyDirty = false;
+	}
+
+	bool any() const { return anyDirty; }
+	bool isDirty(size_t page) const { return dirty[page]; }
+	size_t getNumPages() const { return dirty.size(); }
+
+private:
+	std::vector<bool> dirty;
+	bool anyDirty;
+	bool tracking;
+};
+
+} // namespace openmsx
+
+#endif
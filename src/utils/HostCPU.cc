@@ -0,0 +1,53 @@
+#include "HostCPU.hh"
+#include <cstdlib>
+#if HAVE_AVX2_DISPATCH && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+namespace openmsx {
+namespace HostCPU {
+
+static bool detectAVX2()
+{
+	if (getenv("OPENMSX_NO_AVX2")) return false;
+#if HAVE_AVX2_DISPATCH && defined(__GNUC__)
+	// Also checks whether the OS saves the ymm registers.
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#elif HAVE_AVX2_DISPATCH && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx     = (info[2] & (1 << 28)) != 0;
+	bool fma     = (info[2] & (1 << 12)) != 0;
+	if (!osxsave || !avx || !fma) return false;
+	// xmm and ymm state must be enabled by the OS
+	if ((_xgetbv(0) & 6) != 6) return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+static bool& avx2()
+{
+	static bool result = detectAVX2();
+	return result;
+}
+
+bool hasAVX2()
+{
+	return avx2();
+}
+
+void setAVX2(bool enabled)
+{
+	avx2() = enabled && detectAVX2();
+}
+
+} // namespace HostCPU
+} // namespace openmsx
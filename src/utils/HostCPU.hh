@@ -0,0 +1,43 @@
+#ifndef HOSTCPU_HH
+#define HOSTCPU_HH
+
+#include "build-info.hh"
+
+// SSE2 is selected at compile time (__SSE2__), the instruction sets beyond
+// that are detected at run time. Functions that use AVX2 (or FMA) intrinsics
+// must be marked with TARGET_AVX2 and may only be called when
+// HostCPU::hasAVX2() returns true. Such code should be guarded with
+// '#if HAVE_AVX2_DISPATCH'.
+#if ASM_X86 && defined(__GNUC__)
+	#define HAVE_AVX2_DISPATCH 1
+	#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#elif ASM_X86 && defined(_MSC_VER)
+	// Visual C++ allows intrinsics of any instruction set.
+	#define HAVE_AVX2_DISPATCH 1
+	#define TARGET_AVX2
+#else
+	#define HAVE_AVX2_DISPATCH 0
+	#define TARGET_AVX2
+#endif
+
+namespace openmsx {
+namespace HostCPU {
+
+	/** Does the host CPU (and operating system) support AVX2 and FMA?
+	  * (In practice all CPUs with AVX2 also have FMA.)
+	  * Always false when HAVE_AVX2_DISPATCH is 0. The AVX2 code paths
+	  * can also be disabled by setting the environment variable
+	  * OPENMSX_NO_AVX2.
+	  */
+	bool hasAVX2();
+
+	/** Enable or disable the AVX2 code paths, e.g. to compare them with
+	  * the other code paths in a test. They can't be enabled when the
+	  * host CPU doesn't support AVX2.
+	  */
+	void setAVX2(bool enabled);
+
+} // namespace HostCPU
+} // namespace openmsx
+
+#endif
@@ -198,6 +198,25 @@ inline unsigned countLeadingZeros(unsigned x)
 #endif
 }
 
+/** Count the number of trailing zero-bits in the given word.
+  * The result is undefined when the input is zero (all bits are zero).
+  */
+inline unsigned countTrailingZeros(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_ctzll(x); // undefined when x==0
+#else
+	unsigned tz = 0;
+	if (!(x & 0xffffffff)) { tz += 32; x >>= 32; }
+	if (!(x & 0x0000ffff)) { tz += 16; x >>= 16; }
+	if (!(x & 0x000000ff)) { tz +=  8; x >>=  8; }
+	if (!(x & 0x0000000f)) { tz +=  4; x >>=  4; }
+	if (!(x & 0x00000003)) { tz +=  2; x >>=  2; }
+	tz += unsigned(!(x & 1));
+	return tz;
+#endif
+}
+
 } // namespace Math
 
 #endif // MATH_HH
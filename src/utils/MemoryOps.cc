@@ -10,6 +10,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #include <new> // for std::bad_alloc
 #if ASM_X86 && defined _MSC_VER
 #include <intrin.h>	// for __stosd intrinsic
@@ -218,10 +219,32 @@ static inline void memset_16(uint16_t* dest, size_t num16, uint16_t val16)
 	memset_16_2(dest, num16, val16, val16);
 }
 
+static inline void memset_8_2(
+	uint8_t* dest, size_t num8, uint8_t val0, uint8_t val1)
+{
+	if (unlikely(num8 == 0)) return;
+
+	// Align at 2-byte boundary.
+	if (unlikely(size_t(dest) & 1)) {
+		dest[0] = val1; // start at odd pixel
+		++dest; --num8;
+	}
+
+	uint16_t val16 = OPENMSX_BIGENDIAN ? (uint16_t(val0) << 8) | val1
+	                                   : val0 | (uint16_t(val1) << 8);
+	memset_16(reinterpret_cast<uint16_t*>(dest), num8 / 2, val16);
+
+	if (unlikely(num8 & 1)) {
+		dest[num8 - 1] = val0;
+	}
+}
+
 template<typename Pixel> void MemSet<Pixel>::operator()(
 	Pixel* dest, size_t num, Pixel val) const
 {
-	if (sizeof(Pixel) == 2) {
+	if (sizeof(Pixel) == 1) {
+		memset(dest, val, num);
+	} else if (sizeof(Pixel) == 2) {
 		memset_16(reinterpret_cast<uint16_t*>(dest), num, val);
 	} else if (sizeof(Pixel) == 4) {
 		memset_32(reinterpret_cast<uint32_t*>(dest), num, val);
@@ -233,7 +256,9 @@ template<typename Pixel> void MemSet<Pixel>::operator()(
 template<typename Pixel> void MemSet2<Pixel>::operator()(
 	Pixel* dest, size_t num, Pixel val0, Pixel val1) const
 {
-	if (sizeof(Pixel) == 2) {
+	if (sizeof(Pixel) == 1) {
+		memset_8_2(reinterpret_cast<uint8_t*>(dest), num, val0, val1);
+	} else if (sizeof(Pixel) == 2) {
 		memset_16_2(reinterpret_cast<uint16_t*>(dest), num, val0, val1);
 	} else if (sizeof(Pixel) == 4) {
 		memset_32_2(reinterpret_cast<uint32_t*>(dest), num, val0, val1);
@@ -243,8 +268,10 @@ template<typename Pixel> void MemSet2<Pixel>::operator()(
 }
 
 // Force template instantiation
+template struct MemSet <uint8_t>;
 template struct MemSet <uint16_t>;
 template struct MemSet <uint32_t>;
+template struct MemSet2<uint8_t>;
 template struct MemSet2<uint16_t>;
 template struct MemSet2<uint32_t>;
 
@@ -7,7 +7,7 @@ namespace openmsx {
 
 // class OutputBuffer
 
-size_t OutputBuffer::lastSize = 50000; // initial estimate
+thread_local size_t OutputBuffer::lastSize = 50000; // initial estimate
 
 OutputBuffer::OutputBuffer()
 	: buf(lastSize)
@@ -128,7 +128,8 @@ private:
 	byte* finish;        // points right after the last allocated byte
 	                     // so   finish - buf == capacity
 
-	static size_t lastSize;
+	// Per thread, machines can also be serialized outside the main thread.
+	static thread_local size_t lastSize;
 };
 
 
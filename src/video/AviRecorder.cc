@@ -1,7 +1,13 @@
 #include "AviRecorder.hh"
 #include "AviWriter.hh"
 #include "WavWriter.hh"
+#include "RawVideoFile.hh"
+#include "RawFrame.hh"
+#include "PNG.hh"
 #include "Reactor.hh"
+#include "EventDistributor.hh"
+#include "Event.hh"
+#include "ThreadPool.hh"
 #include "MSXMotherBoard.hh"
 #include "FileContext.hh"
 #include "CommandException.hh"
@@ -12,9 +18,14 @@
 #include "CliComm.hh"
 #include "FileOperations.hh"
 #include "TclObject.hh"
+#include "StringOp.hh"
+#include "unreachable.hh"
 #include "memory.hh"
 #include "outer.hh"
 #include "vla.hh"
+#include "build-info.hh"
+#include "cstdiop.hh" // for snprintf
+#include <chrono>
 #include <cassert>
 
 using std::string;
@@ -29,17 +40,28 @@ AviRecorder::AviRecorder(Reactor& reactor_)
 	, duration(EmuDuration::infinity)
 	, prevTime(EmuTime::infinity)
 	, frameHeight(0)
+	, abortConversions(false)
 {
+	reactor.getEventDistributor().registerEventListener(
+		OPENMSX_RECORD_CONVERT_EVENT, *this);
 }
 
 AviRecorder::~AviRecorder()
 {
 	assert(!aviWriter);
 	assert(!wavWriter);
+	assert(!rawWriter);
+
+	// Stop unfinished conversions, their output is incomplete.
+	abortConversions = true;
+	converter.reset();
+	reactor.getEventDistributor().unregisterEventListener(
+		OPENMSX_RECORD_CONVERT_EVENT, *this);
 }
 
 void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
-                        bool recordStereo, const Filename& filename)
+                        bool recordStereo, bool recordRaw,
+                        const Filename& filename)
 {
 	stop();
 	MSXMotherBoard* motherBoard = reactor.getMotherBoard();
@@ -77,13 +99,21 @@ void AviRecorder::start(bool recordAudio, bool recordVideo, bool recordMono,
 		// any source is fine because they all have the same bpp
 		unsigned bpp = postProcessors.front()->getBpp();
 		warnedFps = false;
+		warnedStall = false;
 		duration = EmuDuration::infinity;
 		prevTime = EmuTime::infinity;
 
 		try {
-			aviWriter = make_unique<AviWriter>(
-				filename, frameWidth, frameHeight, bpp,
-				(recordAudio && stereo) ? 2 : 1, sampleRate);
+			unsigned channels = (recordAudio && stereo) ? 2 : 1;
+			if (recordRaw) {
+				rawWriter = make_unique<RawVideoWriter>(
+					filename, channels, sampleRate);
+			} else {
+				aviWriter = make_unique<AviWriter>(
+					filename, frameWidth, frameHeight, bpp,
+					channels, sampleRate);
+				aviWriter->setNumThreads(0);
+			}
 		} catch (MSXException& e) {
 			throw CommandException("Can't start recording: " +
 			                       e.getMessage());
@@ -113,6 +143,7 @@ void AviRecorder::stop()
 	sampleRate = 0;
 	aviWriter.reset();
 	wavWriter.reset();
+	rawWriter.reset();
 }
 
 void AviRecorder::addWave(unsigned num, int16_t* data)
@@ -128,7 +159,7 @@ void AviRecorder::addWave(unsigned num, int16_t* data)
 		if (wavWriter) {
 			wavWriter->write(data, 2, num);
 		} else {
-			assert(aviWriter);
+			assert(aviWriter || rawWriter);
 			audioBuf.insert(end(audioBuf), data, data + 2 * num);
 		}
 	} else {
@@ -153,13 +184,14 @@ void AviRecorder::addWave(unsigned num, int16_t* data)
 		if (wavWriter) {
 			wavWriter->write(buf, 1, num);
 		} else {
-			assert(aviWriter);
+			assert(aviWriter || rawWriter);
 			audioBuf.insert(end(audioBuf), buf, buf + num);
 		}
 	}
 }
 
-void AviRecorder::addImage(FrameSource* frame, EmuTime::param time)
+void AviRecorder::addImage(FrameSource* frame, RawFramePool::Ref rawFrame,
+                           EmuTime::param time)
 {
 	assert(!wavWriter);
 	if (duration != EmuDuration::infinity) {
@@ -172,15 +204,29 @@ void AviRecorder::addImage(FrameSource* frame, EmuTime::param time)
 		}
 	} else if (prevTime != EmuTime::infinity) {
 		duration = time - prevTime;
-		aviWriter->setFps(1.0 / duration.toDouble());
+		float fps = 1.0 / duration.toDouble();
+		if (aviWriter) aviWriter->setFps(fps);
+		if (rawWriter) rawWriter->setFps(fps);
 	}
 	prevTime = time;
 
 	if (mixer) {
 		mixer->updateStream(time);
 	}
-	aviWriter->addFrame(frame, unsigned(audioBuf.size()), audioBuf.data());
+	unsigned samples = unsigned(audioBuf.size());
+	bool stalled = aviWriter
+		? aviWriter->addFrame(frame, std::move(rawFrame),
+		                      samples, audioBuf.data())
+		: rawWriter->addFrame(frame, std::move(rawFrame),
+		                      samples, audioBuf.data());
 	audioBuf.clear();
+	if (stalled && !warnedStall) {
+		warnedStall = true;
+		reactor.getCliComm().printWarning(
+			"Video encoding can't keep up, the emulation is "
+			"slowed down to record all frames. See 'record "
+			"status' for details.");
+	}
 }
 
 // TODO: Can this be dropped?
@@ -197,6 +243,8 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	bool recordVideo = true;
 	bool recordMono = false;
 	bool recordStereo = false;
+	bool recordRaw = false;
+	bool resize = false;
 	frameWidth = 320;
 	frameHeight = 240;
 
@@ -227,9 +275,13 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 			} else if (token == "-doublesize") {
 				frameWidth = 640;
 				frameHeight = 480;
+				resize = true;
 			} else if (token == "-triplesize") {
 				frameWidth = 960;
 				frameHeight = 720;
+				resize = true;
+			} else if (token == "-raw") {
+				recordRaw = true;
 			} else {
 				throw CommandException("Invalid option: " + token);
 			}
@@ -246,6 +298,14 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	if (!recordAudio && (recordStereo || recordMono)) {
 		throw CommandException("Can't have both -videoonly and -stereo or -mono.");
 	}
+	if (recordRaw && !recordVideo) {
+		throw CommandException("Can't have both -raw and -audioonly.");
+	}
+	if (recordRaw && resize) {
+		throw CommandException(
+			"Raw recordings are not scaled, use -doublesize or "
+			"-triplesize with 'record convert' instead.");
+	}
 	switch (arguments.size()) {
 	case 0:
 		// nothing
@@ -258,15 +318,16 @@ void AviRecorder::processStart(array_ref<TclObject> tokens, TclObject& result)
 	}
 
 	string directory = recordVideo ? "videos" : "soundlogs";
-	string extension = recordVideo ? ".avi"   : ".wav";
+	string extension = recordRaw ? ".omr"
+	                 : recordVideo ? ".avi" : ".wav";
 	filename = FileOperations::parseCommandFileArgument(
 		filename, directory, prefix, extension);
 
-	if (aviWriter || wavWriter) {
+	if (aviWriter || wavWriter || rawWriter) {
 		result.setString("Already recording.");
 	} else {
 		start(recordAudio, recordVideo, recordMono, recordStereo,
-				Filename(filename));
+				recordRaw, Filename(filename));
 		result.setString("Recording to " + filename);
 	}
 }
@@ -281,7 +342,7 @@ void AviRecorder::processStop(array_ref<TclObject> tokens)
 
 void AviRecorder::processToggle(array_ref<TclObject> tokens, TclObject& result)
 {
-	if (aviWriter || wavWriter) {
+	if (aviWriter || wavWriter || rawWriter) {
 		// drop extra tokens
 		processStop(make_array_ref(tokens.data(), 2));
 	} else {
@@ -289,18 +350,212 @@ void AviRecorder::processToggle(array_ref<TclObject> tokens, TclObject& result)
 	}
 }
 
+static unsigned convertToAvi(RawVideoReader& reader, const string& filename,
+                             unsigned width, unsigned height,
+                             const std::atomic<bool>& abort)
+{
+	AviWriter writer(Filename(filename), width, height,
+	                 reader.getPixelFormat().BitsPerPixel,
+	                 reader.getChannels(), reader.getFrequency());
+	writer.setNumThreads(0);
+	// a recording of a single frame doesn't know its frame rate
+	float fps = reader.getFps();
+	writer.setFps((fps != 0.0f) ? fps : 60.0f);
+	unsigned frames = 0;
+	while (!abort && reader.nextFrame()) {
+		auto& audio = reader.getAudio();
+		writer.addFrame(&reader.getFrame(), RawFramePool::Ref(),
+		                unsigned(audio.size()), audio.data());
+		++frames;
+	}
+	return frames;
+}
+
+template<typename Pixel>
+static void savePNG(FrameSource& frame, unsigned width, unsigned height,
+                    const string& filename)
+{
+	std::vector<Pixel> buf(width * height);
+	VLA(const void*, rows, height);
+	for (unsigned y = 0; y < height; ++y) {
+		Pixel* line = &buf[y * width];
+		switch (height) {
+		case 240:
+			rows[y] = frame.getLinePtr320_240(y, line);
+			break;
+		case 480:
+			rows[y] = frame.getLinePtr640_480(y, line);
+			break;
+		case 720:
+			rows[y] = frame.getLinePtr960_720(y, line);
+			break;
+		default:
+			UNREACHABLE;
+		}
+	}
+	PNG::save(width, height, rows, frame.getSDLPixelFormat(), filename);
+}
+
+static unsigned convertToPNG(RawVideoReader& reader, const string& prefix,
+                             unsigned width, unsigned height,
+                             const std::atomic<bool>& abort)
+{
+	unsigned frames = 0;
+	while (!abort && reader.nextFrame()) {
+		char num[16];
+		snprintf(num, sizeof(num), "%05u", frames);
+		string filename = prefix + num + ".png";
+		auto& frame = reader.getFrame();
+		switch (reader.getPixelFormat().BytesPerPixel) {
+#if HAVE_16BPP
+		case 2:
+			savePNG<uint16_t>(frame, width, height, filename);
+			break;
+#endif
+#if HAVE_32BPP
+		case 4:
+			savePNG<uint32_t>(frame, width, height, filename);
+			break;
+#endif
+		default:
+			UNREACHABLE;
+		}
+		++frames;
+	}
+	return frames;
+}
+
+void AviRecorder::processConvert(array_ref<TclObject> tokens, TclObject& result)
+{
+	bool png = false;
+	unsigned width = 320;
+	unsigned height = 240;
+	vector<string> arguments;
+	for (unsigned i = 2; i < tokens.size(); ++i) {
+		string_ref token = tokens[i].getString();
+		if (token == "-png") {
+			png = true;
+		} else if (token == "-doublesize") {
+			width = 640;
+			height = 480;
+		} else if (token == "-triplesize") {
+			width = 960;
+			height = 720;
+		} else if (token.starts_with('-')) {
+			throw CommandException("Invalid option: " + token);
+		} else {
+			arguments.push_back(token.str());
+		}
+	}
+	if (arguments.empty() || (arguments.size() > 2)) {
+		throw SyntaxError();
+	}
+	string input = FileOperations::parseCommandFileArgument(
+		arguments[0], "videos", "", ".omr");
+	string output = (arguments.size() == 2) ? arguments[1] : "";
+	if (png) {
+		// a prefix, the frame number is appended
+		output = output.empty()
+		       ? FileOperations::stripExtension(input).str() + '_'
+		       : FileOperations::parseCommandFileArgument(
+		               output, "videos", "", "");
+	} else {
+		output = output.empty()
+		       ? FileOperations::stripExtension(input).str() + ".avi"
+		       : FileOperations::parseCommandFileArgument(
+		               output, "videos", "", ".avi");
+	}
+
+	// Converting takes a while, don't block the emulation. The result is
+	// reported when it's done, see signalEvent().
+	auto conversion = make_unique<Conversion>();
+	conversion->input = input;
+	conversion->output = output;
+	conversion->width = width;
+	conversion->height = height;
+	conversion->png = png;
+	conversion->frames = 0;
+	if (!converter) converter = make_unique<ThreadPool>(1);
+	auto& c = *conversion;
+	c.done = converter->enqueue([this, &c]() { convert(c); });
+	conversions.push_back(std::move(conversion));
+	result.setString("Converting " + input + " to " + output +
+	                 (png ? "NNNNN.png" : "") + " in the background");
+}
+
+// Runs on the 'converter' thread.
+void AviRecorder::convert(Conversion& c)
+{
+	try {
+		RawVideoReader reader{Filename(c.input)};
+		c.frames = c.png
+		         ? convertToPNG(reader, c.output, c.width, c.height,
+		                        abortConversions)
+		         : convertToAvi(reader, c.output, c.width, c.height,
+		                        abortConversions);
+	} catch (MSXException& e) {
+		c.error = e.getMessage();
+	}
+	reactor.getEventDistributor().distributeEvent(
+		std::make_shared<SimpleEvent>(OPENMSX_RECORD_CONVERT_EVENT));
+}
+
+int AviRecorder::signalEvent(const std::shared_ptr<const Event>& /*event*/)
+{
+	auto& cliComm = reactor.getCliComm();
+	auto it = conversions.begin();
+	while (it != conversions.end()) {
+		auto& c = **it;
+		if (c.done.wait_for(std::chrono::seconds(0)) !=
+		    std::future_status::ready) {
+			++it;
+			continue;
+		}
+		c.done.get(); // rethrows unexpected exceptions
+		if (c.error.empty()) {
+			cliComm.printInfo(
+				"Converted " + StringOp::toString(c.frames) +
+				" frames to " + c.output +
+				(c.png ? "NNNNN.png" : ""));
+		} else {
+			cliComm.printWarning(
+				"Can't convert " + c.input + ": " + c.error);
+		}
+		it = conversions.erase(it);
+	}
+	return 0;
+}
+
+static void addStats(const FrameQueue::Stats& stats, TclObject& result)
+{
+	result.addListElement("frames");
+	result.addListElement(int(stats.queuedFrames));
+	result.addListElement("backlog");
+	result.addListElement(int(stats.queuedFrames - stats.writtenFrames));
+	result.addListElement("encode_fps");
+	result.addListElement((stats.encodeTime > 0.0)
+		? (stats.writtenFrames / stats.encodeTime) : 0.0);
+	result.addListElement("stalls");
+	result.addListElement(int(stats.stalls));
+	result.addListElement("stall_time");
+	result.addListElement(stats.stallTime);
+}
+
 void AviRecorder::status(array_ref<TclObject> tokens, TclObject& result) const
 {
 	if (tokens.size() != 2) {
 		throw SyntaxError();
 	}
 	result.addListElement("status");
-	if (aviWriter || wavWriter) {
+	if (aviWriter || wavWriter || rawWriter) {
 		result.addListElement("recording");
 	} else {
 		result.addListElement("idle");
 	}
-
+	if (aviWriter) addStats(aviWriter->getStats(), result);
+	if (rawWriter) addStats(rawWriter->getStats(), result);
+	result.addListElement("conversions");
+	result.addListElement(int(conversions.size()));
 }
 
 // class AviRecorder::Cmd
@@ -325,6 +580,8 @@ void AviRecorder::Cmd::execute(array_ref<TclObject> tokens, TclObject& result)
 		recorder.processToggle(tokens, result);
 	} else if (subcommand == "status") {
 		recorder.status(tokens, result);
+	} else if (subcommand == "convert") {
+		recorder.processConvert(tokens, result);
 	} else {
 		throw SyntaxError();
 	}
@@ -338,25 +595,39 @@ string AviRecorder::Cmd::help(const vector<string>& /*tokens*/) const
 	       "record start -prefix foo  Record to file 'fooNNNN.avi'\n"
 	       "record stop               Stop recording\n"
 	       "record toggle             Toggle recording (useful as keybinding)\n"
-	       "record status             Query recording state\n"
+	       "record status             Query recording state (and encoder statistics)\n"
+	       "record convert <file>     Convert raw recording 'file.omr' to 'file.avi'\n"
+	       "record convert <file> <output>  Idem, but to the given file\n"
 	       "\n"
 	       "The start subcommand also accepts an optional -audioonly, -videoonly, "
-	       " -mono, -stereo, -doublesize flag.\n"
+	       " -mono, -stereo, -doublesize, -triplesize, -raw flag.\n"
 	       "Videos are recorded in a 320x240 size by default, at 640x480 when the "
-	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.";
+	       "-doublesize flag is used and at 960x720 when the -triplesize flag is used.\n"
+	       "The -raw flag records the unscaled frames (lossless) and the audio to a "
+	       "'.omr' file instead, this is cheaper than encoding a video while the "
+	       "emulation runs. Use the convert subcommand (optionally with "
+	       "-doublesize or -triplesize) to turn it into a video later, or with -png "
+	       "into a sequence of 'file_NNNNN.png' files (the output is then a "
+	       "prefix). Converting happens in the background, a message is shown "
+	       "when it's done.";
 }
 
 void AviRecorder::Cmd::tabCompletion(vector<string>& tokens) const
 {
 	if (tokens.size() == 2) {
 		static const char* const cmds[] = {
-			"start", "stop", "toggle", "status",
+			"start", "stop", "toggle", "status", "convert",
 		};
 		completeString(tokens, cmds);
 	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
 		static const char* const options[] = {
 			"-prefix", "-videoonly", "-audioonly", "-doublesize", "-triplesize",
-			"-mono", "-stereo",
+			"-mono", "-stereo", "-raw",
+		};
+		completeFileName(tokens, userFileContext(), options);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "convert")) {
+		static const char* const options[] = {
+			"-png", "-doublesize", "-triplesize",
 		};
 		completeFileName(tokens, userFileContext(), options);
 	}
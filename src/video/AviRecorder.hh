@@ -2,9 +2,14 @@
 #define AVIRECORDER_HH
 
 #include "Command.hh"
+#include "EventListener.hh"
 #include "EmuTime.hh"
+#include "RawFramePool.hh"
 #include "array_ref.hh"
+#include <atomic>
 #include <cstdint>
+#include <future>
+#include <string>
 #include <vector>
 #include <memory>
 
@@ -13,31 +18,42 @@ namespace openmsx {
 class Reactor;
 class AviWriter;
 class Wav16Writer;
+class RawVideoWriter;
 class Filename;
 class PostProcessor;
 class FrameSource;
 class MSXMixer;
 class TclObject;
+class ThreadPool;
 
-class AviRecorder
+class AviRecorder final : private EventListener
 {
 public:
 	explicit AviRecorder(Reactor& reactor);
 	~AviRecorder();
 
 	void addWave(unsigned num, int16_t* data);
-	void addImage(FrameSource* frame, EmuTime::param time);
+	/** Record a video frame.
+	  * @param frame The frame to record.
+	  * @param rawFrame Optional, see AviWriter::addFrame().
+	  */
+	void addImage(FrameSource* frame, RawFramePool::Ref rawFrame,
+	              EmuTime::param time);
 	void stop();
 	unsigned getFrameHeight() const;
 
 private:
 	void start(bool recordAudio, bool recordVideo, bool recordMono,
-		   bool recordStereo, const Filename& filename);
+		   bool recordStereo, bool recordRaw, const Filename& filename);
 	void status(array_ref<TclObject> tokens, TclObject& result) const;
 
 	void processStart (array_ref<TclObject> tokens, TclObject& result);
 	void processStop  (array_ref<TclObject> tokens);
 	void processToggle(array_ref<TclObject> tokens, TclObject& result);
+	void processConvert(array_ref<TclObject> tokens, TclObject& result);
+
+	// EventListener
+	int signalEvent(const std::shared_ptr<const Event>& event) override;
 
 	Reactor& reactor;
 
@@ -49,8 +65,9 @@ private:
 	} recordCommand;
 
 	std::vector<int16_t> audioBuf;
-	std::unique_ptr<AviWriter>   aviWriter; // can be nullptr
-	std::unique_ptr<Wav16Writer> wavWriter; // can be nullptr
+	std::unique_ptr<AviWriter>      aviWriter; // can be nullptr
+	std::unique_ptr<Wav16Writer>    wavWriter; // can be nullptr
+	std::unique_ptr<RawVideoWriter> rawWriter; // can be nullptr
 	std::vector<PostProcessor*> postProcessors;
 	MSXMixer* mixer;
 	EmuDuration duration;
@@ -59,9 +76,28 @@ private:
 	unsigned frameWidth;
 	unsigned frameHeight;
 	bool warnedFps;
+	bool warnedStall;
 	bool warnedSampleRate;
 	bool warnedStereo;
 	bool stereo;
+
+	/** A 'record convert' job. These run on the 'converter' thread, the
+	  * result is reported when it has finished. */
+	struct Conversion {
+		std::string input;
+		std::string output; // a prefix for PNG files
+		unsigned width;
+		unsigned height;
+		bool png;
+		unsigned frames;
+		std::string error; // empty when successful
+		std::shared_future<void> done;
+	};
+	void convert(Conversion& conversion);
+	std::vector<std::unique_ptr<Conversion>> conversions;
+	std::atomic<bool> abortConversions;
+	// Declared last, so that the thread is stopped first.
+	std::unique_ptr<ThreadPool> converter; // created on first use
 };
 
 } // namespace openmsx
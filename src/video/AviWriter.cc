@@ -2,11 +2,14 @@
 
 #include "AviWriter.hh"
 #include "FileOperations.hh"
+#include "FrameSource.hh"
 #include "MSXException.hh"
+#include "ThreadPool.hh"
 #include "memory.hh"
 #include "build-info.hh"
 #include "Version.hh"
 #include "cstdiop.hh" // for snprintf
+#include <chrono>
 #include <cstring>
 #include <ctime>
 #include <cassert>
@@ -25,20 +28,28 @@ AviWriter::AviWriter(const Filename& filename, unsigned width_,
 	, height(height_)
 	, channels(channels_)
 	, audiorate(freq_)
+	, encoder(make_unique<ThreadPool>(1))
+	, writer (make_unique<ThreadPool>(1))
 {
 	char dummy[AVI_HEADER_SIZE];
 	memset(dummy, 0, sizeof(dummy));
 	file.write(dummy, sizeof(dummy));
 
 	index.resize(2);
+	for (auto& slot : slots) {
+		slot.video.resize(codec.getMaxFrameSize() + 1);
+	}
 
-	frames = 0;
 	written = 0;
 	audiowritten = 0;
 }
 
 AviWriter::~AviWriter()
 {
+	queue.waitAll();
+	encoder.reset();
+	writer.reset();
+
 	if (written == 0) {
 		// no data written yet (a recording less than one video frame)
 		std::string filename = file.getURL();
@@ -76,7 +87,7 @@ AviWriter::~AviWriter()
 	AVIOUTd(0);
 	AVIOUTd(0);                         // PaddingGranularity (whatever that might be)
 	AVIOUTd(0x110);                     // Flags,0x10 has index, 0x100 interleaved
-	AVIOUTd(frames);                    // TotalFrames
+	AVIOUTd(queue.getNumFrames());      // TotalFrames
 	AVIOUTd(0);                         // InitialFrames
 	AVIOUTd(hasAudio? 2 : 1);           // Stream count
 	AVIOUTd(0);                         // SuggestedBufferSize
@@ -102,7 +113,7 @@ AviWriter::~AviWriter()
 	AVIOUTd(1000000);                   // Scale
 	AVIOUTd(unsigned(1000000 * fps));   // Rate: Rate/Scale == samples/second
 	AVIOUTd(0);                         // Start
-	AVIOUTd(frames);                    // Length
+	AVIOUTd(queue.getNumFrames());      // Length
 	AVIOUTd(0);                         // SuggestedBufferSize
 	AVIOUTd(unsigned(~0));              // Quality
 	AVIOUTd(0);                         // SampleSize
@@ -221,7 +232,7 @@ AviWriter::~AviWriter()
 	}
 }
 
-void AviWriter::addAviChunk(const char* tag, unsigned size, void* data, unsigned flags)
+void AviWriter::addAviChunk(const char* tag, unsigned size, const void* data, unsigned flags)
 {
 	struct {
 		char t[4];
@@ -244,31 +255,75 @@ void AviWriter::addAviChunk(const char* tag, unsigned size, void* data, unsigned
 	index[idxSize + 3] = size;
 }
 
-void AviWriter::addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData)
+bool AviWriter::addFrame(FrameSource* frame, RawFramePool::Ref rawFrame,
+                         unsigned samples, int16_t* sampleData)
 {
-	bool keyFrame = (frames++ % 300 == 0);
-	void* buffer;
-	unsigned size;
-	codec.compressFrame(keyFrame, frame, buffer, size);
-	addAviChunk("00dc", size, buffer, keyFrame ? 0x10 : 0x0);
+	bool stalled;
+	unsigned frameNum = queue.startFrame(stalled);
+	auto& slot = slots[frameNum % FrameQueue::SIZE];
 
+	slot.keyFrame = (frameNum % 300 == 0);
+	slot.pixelFormat = &frame->getSDLPixelFormat();
+	if (rawFrame) {
+		slot.rawFrame = std::move(rawFrame);
+	} else {
+		// The frame will change, make a copy now.
+		if (!slot.image.data()) slot.image.resize(codec.getImageSize());
+		codec.captureFrame(frame, slot.image.data());
+	}
 	if (samples) {
 		assert((samples % channels) == 0);
 		assert(audiorate != 0);
+	}
+	slot.audio.assign(sampleData, sampleData + samples);
+
+	slot.encoded = encoder->enqueue([this, &slot]() { encode(slot); });
+	queue.setDone(frameNum,
+	              writer->enqueue([this, &slot]() { write(slot); }));
+	return stalled;
+}
+
+void AviWriter::encode(Slot& slot)
+{
+	auto start = std::chrono::steady_clock::now();
+	void* buffer;
+	unsigned size;
+	if (slot.rawFrame) {
+		codec.compressFrame(slot.keyFrame, slot.rawFrame.get(), buffer, size);
+		slot.rawFrame.reset(); // give it back to the pool
+	} else {
+		codec.compressFrame(slot.keyFrame, slot.image.data(),
+		                    *slot.pixelFormat, buffer, size);
+	}
+	memcpy(slot.video.data(), buffer, size);
+	slot.video[size] = 0; // padding, see addAviChunk()
+	slot.videoSize = size;
+	queue.addEncodeTime(std::chrono::steady_clock::now() - start);
+}
+
+void AviWriter::write(Slot& slot)
+{
+	slot.encoded.get(); // wait for the encoder, possibly rethrows
+
+	addAviChunk("00dc", slot.videoSize, slot.video.data(),
+	            slot.keyFrame ? 0x10 : 0x0);
+
+	if (unsigned samples = unsigned(slot.audio.size())) {
 		if (OPENMSX_BIGENDIAN) {
 			// See comment in WavWriter::write()
 			//VLA(Endian::L16, buf, samples); // doesn't work in clang
 			//std::vector<Endian::L16> buf(sampleData, sampleData + samples); // needs c++11
 			std::vector<Endian::L16> buf(samples);
 			for (unsigned i = 0; i < samples; ++i) {
-				buf[i] = sampleData[i];
+				buf[i] = slot.audio[i];
 			}
 			addAviChunk("01wb", samples * sizeof(int16_t), buf.data(), 0);
 		} else {
-			addAviChunk("01wb", samples * sizeof(int16_t), sampleData, 0);
+			addAviChunk("01wb", samples * sizeof(int16_t), slot.audio.data(), 0);
 		}
 		audiowritten += samples;
 	}
+	queue.frameWritten();
 }
 
 } // namespace openmsx
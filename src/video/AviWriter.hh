@@ -4,9 +4,13 @@
 #define AVIWRITER_HH
 
 #include "ZMBVEncoder.hh"
+#include "FrameQueue.hh"
+#include "RawFramePool.hh"
 #include "File.hh"
+#include "MemBuffer.hh"
 #include "endian.hh"
 #include <cstdint>
+#include <future>
 #include <vector>
 #include <memory>
 
@@ -14,22 +18,65 @@ namespace openmsx {
 
 class Filename;
 class FrameSource;
+class ThreadPool;
 
+/** Writes an .avi file with ZMBV compressed video and 16-bit PCM audio.
+  *
+  * Frames are compressed on an encoder thread and written to the file on a
+  * writer thread, so that the emulation thread only has to queue them (see
+  * FrameQueue). Errors (e.g. disk full) are reported by a later addFrame()
+  * call.
+  */
 class AviWriter
 {
 public:
 	AviWriter(const Filename& filename, unsigned width, unsigned height,
 	          unsigned bpp, unsigned channels, unsigned freq);
+	/** Waits till all queued frames are written. */
 	~AviWriter();
-	void addFrame(FrameSource* frame, unsigned samples, int16_t* sampleData);
+
+	/** Queue a frame and the audio that goes with it.
+	  * @param frame The image, only read during this call.
+	  * @param rawFrame Optional. When set, 'frame' is this RawFrame. Then
+	  *        it's read later on the encoder thread instead of being
+	  *        copied. The frame must not change while this reference
+	  *        is kept.
+	  * @return Whether the emulation thread had to wait because the
+	  *         encoder couldn't keep up.
+	  * @throws MSXException When writing an earlier frame failed.
+	  */
+	bool addFrame(FrameSource* frame, RawFramePool::Ref rawFrame,
+	              unsigned samples, int16_t* sampleData);
 	void setFps(float fps_) { fps = fps_; }
 
+	/** See ZMBVEncoder::setNumThreads(), call before the first frame. */
+	void setNumThreads(unsigned numThreads) { codec.setNumThreads(numThreads); }
+
+	/** Statistics, see 'record status'. */
+	FrameQueue::Stats getStats() const { return queue.getStats(); }
+
 private:
-	void addAviChunk(const char* tag, unsigned size, void* data, unsigned flags);
+	/** A frame on its way through the encoder and writer threads. */
+	struct Slot {
+		RawFramePool::Ref rawFrame; // either this is set,
+		MemBuffer<uint8_t> image;   // or this contains a copy
+		const SDL_PixelFormat* pixelFormat;
+		MemBuffer<uint8_t> video;   // compressed frame
+		unsigned videoSize;
+		std::vector<int16_t> audio;
+		bool keyFrame;
+		std::shared_future<void> encoded;
+	};
+
+	void encode(Slot& slot);
+	void write(Slot& slot);
+	void addAviChunk(const char* tag, unsigned size, const void* data, unsigned flags);
 
 	File file;
 	ZMBVEncoder codec;
 	std::vector<Endian::L32> index;
+	FrameQueue queue;
+	Slot slots[FrameQueue::SIZE];
 
 	float fps;
 	const unsigned width;
@@ -37,9 +84,12 @@ private:
 	const unsigned channels;
 	const unsigned audiorate;
 
-	unsigned frames;
 	unsigned audiowritten;
 	unsigned written;
+
+	// Declared last, so that the threads are stopped first.
+	std::unique_ptr<ThreadPool> encoder;
+	std::unique_ptr<ThreadPool> writer;
 };
 
 } // namespace openmsx
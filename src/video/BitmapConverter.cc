@@ -1,10 +1,18 @@
 #include "BitmapConverter.hh"
+#include "HostCPU.hh"
 #include "Math.hh"
 #include "likely.hh"
 #include "unreachable.hh"
 #include "build-info.hh"
 #include "components.hh"
 #include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -16,6 +24,7 @@ BitmapConverter<Pixel>::BitmapConverter(
 	, palette256(palette256_)
 	, palette32768(palette32768_)
 	, dPaletteValid(false)
+	, useAVX2(HostCPU::hasAVX2())
 {
 }
 
@@ -34,6 +43,341 @@ void BitmapConverter<Pixel>::calcDPalette()
 			dPalette[16 * i + j] = dp;
 		}
 	}
+
+	memset(palettePlanesG5, 0, sizeof(palettePlanesG5));
+	for (unsigned i = 0; i < 16; ++i) {
+		uint8_t bytes16[sizeof(Pixel)];
+		memcpy(bytes16, &palette16[i], sizeof(Pixel));
+		for (unsigned b = 0; b < sizeof(Pixel); ++b) {
+			palettePlanes16[b][i] = bytes16[b];
+		}
+	}
+	for (unsigned i = 0; i < 8; ++i) {
+		// Graphic5: 4 colors for even and 4 colors for odd pixels
+		uint8_t bytesG5[sizeof(Pixel)];
+		memcpy(bytesG5, &palette16[(i & 3) + ((i & 4) ? 16 : 0)],
+		       sizeof(Pixel));
+		for (unsigned b = 0; b < sizeof(Pixel); ++b) {
+			palettePlanesG5[b][i] = bytesG5[b];
+		}
+	}
+}
+
+#if HAVE_AVX2_DISPATCH
+// Look up 32 pixels in a palette of (at most) 16 colors. The palette is split
+// in byte planes, each broadcast to both 128-bit lanes. 'idx' holds the color
+// indices of pixels [0..16) in the low lane and [16..32) in the high lane.
+TARGET_AVX2 static inline void lookup16AVX2(
+	uint8_t* out, __m256i idx, const __m256i* planes)
+{
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(out),
+	                    _mm256_shuffle_epi8(planes[0], idx));
+}
+TARGET_AVX2 static inline void lookup16AVX2(
+	uint16_t* out, __m256i idx, const __m256i* planes)
+{
+	__m256i b0 = _mm256_shuffle_epi8(planes[0], idx);
+	__m256i b1 = _mm256_shuffle_epi8(planes[1], idx);
+	// Unpack works per lane: 'lo' holds pixels [0..8) and [16..24).
+	__m256i lo = _mm256_unpacklo_epi8(b0, b1);
+	__m256i hi = _mm256_unpackhi_epi8(b0, b1);
+	auto o = reinterpret_cast<__m256i*>(out);
+	_mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+TARGET_AVX2 static inline void lookup16AVX2(
+	uint32_t* out, __m256i idx, const __m256i* planes)
+{
+	__m256i b0 = _mm256_shuffle_epi8(planes[0], idx);
+	__m256i b1 = _mm256_shuffle_epi8(planes[1], idx);
+	__m256i b2 = _mm256_shuffle_epi8(planes[2], idx);
+	__m256i b3 = _mm256_shuffle_epi8(planes[3], idx);
+	__m256i lo01 = _mm256_unpacklo_epi8(b0, b1);
+	__m256i hi01 = _mm256_unpackhi_epi8(b0, b1);
+	__m256i lo23 = _mm256_unpacklo_epi8(b2, b3);
+	__m256i hi23 = _mm256_unpackhi_epi8(b2, b3);
+	__m256i d0 = _mm256_unpacklo_epi16(lo01, lo23); // [ 0.. 4) [16..20)
+	__m256i d1 = _mm256_unpackhi_epi16(lo01, lo23); // [ 4.. 8) [20..24)
+	__m256i d2 = _mm256_unpacklo_epi16(hi01, hi23); // [ 8..12) [24..28)
+	__m256i d3 = _mm256_unpackhi_epi16(hi01, hi23); // [12..16) [28..32)
+	auto o = reinterpret_cast<__m256i*>(out);
+	_mm256_storeu_si256(o + 0, _mm256_permute2x128_si256(d0, d1, 0x20));
+	_mm256_storeu_si256(o + 1, _mm256_permute2x128_si256(d2, d3, 0x20));
+	_mm256_storeu_si256(o + 2, _mm256_permute2x128_si256(d0, d1, 0x31));
+	_mm256_storeu_si256(o + 3, _mm256_permute2x128_si256(d2, d3, 0x31));
+}
+
+TARGET_AVX2 static inline __m256i combineLanes(__m128i lo, __m128i hi)
+{
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+template<typename Pixel>
+TARGET_AVX2 static inline void loadPlanes(
+	__m256i* planes, const uint8_t (*palettePlanes)[16])
+{
+	for (unsigned b = 0; b < sizeof(Pixel); ++b) {
+		__m128i p = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(palettePlanes[b]));
+		planes[b] = combineLanes(p, p);
+	}
+}
+
+// Split 16 bytes in 32 nibbles (high nibble first) and look them up.
+template<typename Pixel>
+TARGET_AVX2 static inline void lookupNibblesAVX2(
+	Pixel* out, __m128i data, const __m256i* planes)
+{
+	__m128i mask = _mm_set1_epi8(0x0F);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+	__m128i lo = _mm_and_si128(data, mask);
+	__m256i idx = combineLanes(_mm_unpacklo_epi8(hi, lo),
+	                           _mm_unpackhi_epi8(hi, lo));
+	lookup16AVX2(out, idx, planes);
+}
+
+template<typename Pixel>
+TARGET_AVX2 static void renderGraphic4AVX2(
+	Pixel* out, const byte* vram, const uint8_t (*palettePlanes)[16])
+{
+	__m256i planes[sizeof(Pixel)];
+	loadPlanes<Pixel>(planes, palettePlanes);
+	for (unsigned i = 0; i < 128; i += 16) {
+		__m128i data = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vram + i));
+		lookupNibblesAVX2(out + 2 * i, data, planes);
+	}
+}
+
+template<typename Pixel>
+TARGET_AVX2 static void renderGraphic5AVX2(
+	Pixel* out, const byte* vram, const uint8_t (*palettePlanes)[16])
+{
+	__m256i planes[sizeof(Pixel)];
+	loadPlanes<Pixel>(planes, palettePlanes);
+	__m128i m3   = _mm_set1_epi8(3);
+	__m128i odd  = _mm_set1_epi8(4); // odd pixels use colors 4-7
+	for (unsigned i = 0; i < 128; i += 8) {
+		__m128i data = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vram + i));
+		__m128i p0 = _mm_and_si128(_mm_srli_epi16(data, 6), m3);
+		__m128i p1 = _mm_or_si128(
+			_mm_and_si128(_mm_srli_epi16(data, 4), m3), odd);
+		__m128i p2 = _mm_and_si128(_mm_srli_epi16(data, 2), m3);
+		__m128i p3 = _mm_or_si128(_mm_and_si128(data, m3), odd);
+		__m128i p01 = _mm_unpacklo_epi8(p0, p1);
+		__m128i p23 = _mm_unpacklo_epi8(p2, p3);
+		__m256i idx = combineLanes(_mm_unpacklo_epi16(p01, p23),
+		                           _mm_unpackhi_epi16(p01, p23));
+		lookup16AVX2(out + 4 * i, idx, planes);
+	}
+}
+
+template<typename Pixel>
+TARGET_AVX2 static void renderGraphic6AVX2(
+	Pixel* out, const byte* vram0, const byte* vram1,
+	const uint8_t (*palettePlanes)[16])
+{
+	__m256i planes[sizeof(Pixel)];
+	loadPlanes<Pixel>(planes, palettePlanes);
+	for (unsigned i = 0; i < 128; i += 8) {
+		__m128i data0 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vram0 + i));
+		__m128i data1 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vram1 + i));
+		lookupNibblesAVX2(out + 4 * i, _mm_unpacklo_epi8(data0, data1),
+		                  planes);
+	}
+}
+
+TARGET_AVX2 static void renderGraphic7AVX2(
+	uint32_t* out, const byte* vram0, const byte* vram1,
+	const uint32_t* palette256)
+{
+	auto pal = reinterpret_cast<const int*>(palette256);
+	auto o = reinterpret_cast<__m256i*>(out);
+	for (unsigned i = 0; i < 128; i += 8) {
+		__m128i data0 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vram0 + i));
+		__m128i data1 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vram1 + i));
+		__m128i idx = _mm_unpacklo_epi8(data0, data1);
+		__m256i idx0 = _mm256_cvtepu8_epi32(idx);
+		__m256i idx1 = _mm256_cvtepu8_epi32(_mm_srli_si128(idx, 8));
+		_mm256_storeu_si256(o++, _mm256_i32gather_epi32(pal, idx0, 4));
+		_mm256_storeu_si256(o++, _mm256_i32gather_epi32(pal, idx1, 4));
+	}
+}
+#endif
+
+// YJK: Each group of 4 pixels shares the (signed 6-bit) values K, formed by
+// the low 3 bits of its first two bytes, and J, formed by the low 3 bits of
+// its last two bytes. Each pixel has its own 5-bit Y value in its upper 5
+// bits. The SIMD versions below take the bytes of the pixels in display
+// order and treat them as 16-bit words: word 2n holds K and word 2n+1 holds
+// J of group n.
+// Note: (5 * y - 2 * j - k) is rounded down instead of towards zero when
+// divided by 4, but that only makes a difference for negative values, which
+// are clipped to 0 anyway.
+
+static inline void calcYJKGroup(const byte* vramPtr0, const byte* vramPtr1,
+                                uint16_t* cols, unsigned i)
+{
+	unsigned p[4];
+	p[0] = vramPtr0[2 * i + 0];
+	p[1] = vramPtr1[2 * i + 0];
+	p[2] = vramPtr0[2 * i + 1];
+	p[3] = vramPtr1[2 * i + 1];
+
+	int j = (p[2] & 7) + ((p[3] & 3) << 3) - ((p[3] & 4) << 3);
+	int k = (p[0] & 7) + ((p[1] & 3) << 3) - ((p[1] & 4) << 3);
+
+	for (unsigned n = 0; n < 4; ++n) {
+		int y = p[n] >> 3;
+		int r = Math::clip<0, 31>(y + j);
+		int g = Math::clip<0, 31>(y + k);
+		int b = Math::clip<0, 31>((5 * y - 2 * j - k) / 4);
+		cols[4 * i + n] = (r << 10) + (g << 5) + b;
+	}
+}
+
+#ifdef __SSE2__
+static inline __m128i clip31(__m128i x)
+{
+	return _mm_min_epi16(_mm_max_epi16(x, _mm_setzero_si128()),
+	                     _mm_set1_epi16(31));
+}
+
+static inline __m128i yjkToRGB(__m128i y, __m128i j, __m128i k)
+{
+	__m128i r = clip31(_mm_add_epi16(y, j));
+	__m128i g = clip31(_mm_add_epi16(y, k));
+	__m128i y5 = _mm_add_epi16(y, _mm_slli_epi16(y, 2));
+	__m128i b = clip31(_mm_srai_epi16(
+		_mm_sub_epi16(_mm_sub_epi16(y5, _mm_add_epi16(j, j)), k), 2));
+	return _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 10),
+	                                 _mm_slli_epi16(g, 5)), b);
+}
+
+// Calculate the colors of 16 pixels (4 groups).
+static inline void calcYJKColorsSSE2(__m128i data, uint16_t* cols)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i m7 = _mm_set1_epi16(7);
+	__m128i jk = _mm_or_si128(
+		_mm_and_si128(data, m7),
+		_mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(data, 8), m7), 3));
+	jk = _mm_srai_epi16(_mm_slli_epi16(jk, 10), 10); // sign extend
+	// Repeat K and J of each group 4 times.
+	__m128i k0 = _mm_shufflelo_epi16(jk, _MM_SHUFFLE(2, 2, 0, 0));
+	__m128i j0 = _mm_shufflelo_epi16(jk, _MM_SHUFFLE(3, 3, 1, 1));
+	__m128i k1 = _mm_shufflehi_epi16(jk, _MM_SHUFFLE(2, 2, 0, 0));
+	__m128i j1 = _mm_shufflehi_epi16(jk, _MM_SHUFFLE(3, 3, 1, 1));
+	k0 = _mm_unpacklo_epi32(k0, k0);
+	j0 = _mm_unpacklo_epi32(j0, j0);
+	k1 = _mm_unpackhi_epi32(k1, k1);
+	j1 = _mm_unpackhi_epi32(j1, j1);
+	__m128i y0 = _mm_srli_epi16(_mm_unpacklo_epi8(data, zero), 3);
+	__m128i y1 = _mm_srli_epi16(_mm_unpackhi_epi8(data, zero), 3);
+	auto o = reinterpret_cast<__m128i*>(cols);
+	_mm_storeu_si128(o + 0, yjkToRGB(y0, j0, k0));
+	_mm_storeu_si128(o + 1, yjkToRGB(y1, j1, k1));
+}
+#endif
+
+#if HAVE_AVX2_DISPATCH
+TARGET_AVX2 static inline __m256i clip31(__m256i x)
+{
+	return _mm256_min_epi16(_mm256_max_epi16(x, _mm256_setzero_si256()),
+	                        _mm256_set1_epi16(31));
+}
+
+TARGET_AVX2 static inline __m256i yjkToRGB(__m256i y, __m256i j, __m256i k)
+{
+	__m256i r = clip31(_mm256_add_epi16(y, j));
+	__m256i g = clip31(_mm256_add_epi16(y, k));
+	__m256i y5 = _mm256_add_epi16(y, _mm256_slli_epi16(y, 2));
+	__m256i b = clip31(_mm256_srai_epi16(_mm256_sub_epi16(
+		_mm256_sub_epi16(y5, _mm256_add_epi16(j, j)), k), 2));
+	return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi16(r, 10),
+	                                       _mm256_slli_epi16(g, 5)), b);
+}
+
+// Calculate the colors of 32 pixels (8 groups), the same as the SSE2 version
+// but on both 128-bit lanes.
+TARGET_AVX2 static void calcYJKColorsAVX2(
+	const byte* vramPtr0, const byte* vramPtr1, uint16_t* cols)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i m7 = _mm256_set1_epi16(7);
+	auto o = reinterpret_cast<__m256i*>(cols);
+	for (unsigned i = 0; i < 128; i += 16) {
+		__m128i data0 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i));
+		__m128i data1 = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(vramPtr1 + i));
+		__m256i data = combineLanes(_mm_unpacklo_epi8(data0, data1),
+		                            _mm_unpackhi_epi8(data0, data1));
+		__m256i jk = _mm256_or_si256(
+			_mm256_and_si256(data, m7),
+			_mm256_slli_epi16(_mm256_and_si256(
+				_mm256_srli_epi16(data, 8), m7), 3));
+		jk = _mm256_srai_epi16(_mm256_slli_epi16(jk, 10), 10);
+		__m256i k0 = _mm256_shufflelo_epi16(jk, _MM_SHUFFLE(2, 2, 0, 0));
+		__m256i j0 = _mm256_shufflelo_epi16(jk, _MM_SHUFFLE(3, 3, 1, 1));
+		__m256i k1 = _mm256_shufflehi_epi16(jk, _MM_SHUFFLE(2, 2, 0, 0));
+		__m256i j1 = _mm256_shufflehi_epi16(jk, _MM_SHUFFLE(3, 3, 1, 1));
+		k0 = _mm256_unpacklo_epi32(k0, k0);
+		j0 = _mm256_unpacklo_epi32(j0, j0);
+		k1 = _mm256_unpackhi_epi32(k1, k1);
+		j1 = _mm256_unpackhi_epi32(j1, j1);
+		__m256i y0 = _mm256_srli_epi16(_mm256_unpacklo_epi8(data, zero), 3);
+		__m256i y1 = _mm256_srli_epi16(_mm256_unpackhi_epi8(data, zero), 3);
+		// c0 holds pixels [0..8) and [16..24), c1 [8..16) and [24..32)
+		__m256i c0 = yjkToRGB(y0, j0, k0);
+		__m256i c1 = yjkToRGB(y1, j1, k1);
+		_mm256_storeu_si256(o++, _mm256_permute2x128_si256(c0, c1, 0x20));
+		_mm256_storeu_si256(o++, _mm256_permute2x128_si256(c0, c1, 0x31));
+	}
+}
+
+TARGET_AVX2 static void lookupYJKAVX2(
+	uint32_t* out, const uint16_t* cols, const uint32_t* palette32768)
+{
+	auto pal = reinterpret_cast<const int*>(palette32768);
+	auto o = reinterpret_cast<__m256i*>(out);
+	for (unsigned i = 0; i < 256; i += 8) {
+		__m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(cols + i)));
+		_mm256_storeu_si256(o++, _mm256_i32gather_epi32(pal, idx, 4));
+	}
+}
+#endif
+
+template <class Pixel>
+void BitmapConverter<Pixel>::calcYJKColors(
+	const byte* vramPtr0, const byte* vramPtr1)
+{
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2) {
+		calcYJKColorsAVX2(vramPtr0, vramPtr1, yjkColors);
+		return;
+	}
+#endif
+#ifdef __SSE2__
+	for (unsigned i = 0; i < 128; i += 8) {
+		__m128i data0 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vramPtr0 + i));
+		__m128i data1 = _mm_loadl_epi64(
+			reinterpret_cast<const __m128i*>(vramPtr1 + i));
+		calcYJKColorsSSE2(_mm_unpacklo_epi8(data0, data1),
+		                  yjkColors + 2 * i);
+	}
+#else
+	for (unsigned i = 0; i < 64; ++i) {
+		calcYJKGroup(vramPtr0, vramPtr1, yjkColors, i);
+	}
+#endif
 }
 
 template <class Pixel>
@@ -125,6 +469,13 @@ void BitmapConverter<Pixel>::renderGraphic4(
 		calcDPalette();
 	}
 
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2) {
+		renderGraphic4AVX2(pixelPtr, vramPtr0, palettePlanes16);
+		return;
+	}
+#endif
+
 #ifdef __arm__
 	if ((sizeof(Pixel) == 2) && (((int)pixelPtr & 3) == 0)) {
 		// only 16bpp and only when aligned on 64-bit word boundary
@@ -247,6 +598,15 @@ void BitmapConverter<Pixel>::renderGraphic5(
 	Pixel*      __restrict pixelPtr,
 	const byte* __restrict vramPtr0)
 {
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2) {
+		if (unlikely(!dPaletteValid)) {
+			calcDPalette();
+		}
+		renderGraphic5AVX2(pixelPtr, vramPtr0, palettePlanesG5);
+		return;
+	}
+#endif
 	for (unsigned i = 0; i < 128; ++i) {
 		unsigned data = vramPtr0[i];
 		pixelPtr[4 * i + 0] = palette16[ 0 +  (data >> 6)     ];
@@ -273,6 +633,12 @@ void BitmapConverter<Pixel>::renderGraphic6(
 	if (unlikely(!dPaletteValid)) {
 		calcDPalette();
 	}
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2) {
+		renderGraphic6AVX2(pixelPtr, vramPtr0, vramPtr1, palettePlanes16);
+		return;
+	}
+#endif
 	auto out = reinterpret_cast<DPixel*>(pixelPtr);
 	auto in0 = reinterpret_cast<const unsigned*>(vramPtr0);
 	auto in1 = reinterpret_cast<const unsigned*>(vramPtr1);
@@ -308,6 +674,14 @@ void BitmapConverter<Pixel>::renderGraphic7(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && useAVX2) {
+		renderGraphic7AVX2(reinterpret_cast<uint32_t*>(pixelPtr),
+		                   vramPtr0, vramPtr1,
+		                   reinterpret_cast<const uint32_t*>(palette256));
+		return;
+	}
+#endif
 	for (unsigned i = 0; i < 128; ++i) {
 		pixelPtr[2 * i + 0] = palette256[vramPtr0[i]];
 		pixelPtr[2 * i + 1] = palette256[vramPtr1[i]];
@@ -320,24 +694,16 @@ void BitmapConverter<Pixel>::renderYJK(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
-	for (unsigned i = 0; i < 64; ++i) {
-		unsigned p[4];
-		p[0] = vramPtr0[2 * i + 0];
-		p[1] = vramPtr1[2 * i + 0];
-		p[2] = vramPtr0[2 * i + 1];
-		p[3] = vramPtr1[2 * i + 1];
-
-		int j = (p[2] & 7) + ((p[3] & 3) << 3) - ((p[3] & 4) << 3);
-		int k = (p[0] & 7) + ((p[1] & 3) << 3) - ((p[1] & 4) << 3);
-
-		for (unsigned n = 0; n < 4; ++n) {
-			int y = p[n] >> 3;
-			int r = Math::clip<0, 31>(y + j);
-			int g = Math::clip<0, 31>(y + k);
-			int b = Math::clip<0, 31>((5 * y - 2 * j - k) / 4);
-			int col = (r << 10) + (g << 5) + b;
-			pixelPtr[4 * i + n] = palette32768[col];
-		}
+	calcYJKColors(vramPtr0, vramPtr1);
+#if HAVE_AVX2_DISPATCH
+	if ((sizeof(Pixel) == 4) && useAVX2) {
+		lookupYJKAVX2(reinterpret_cast<uint32_t*>(pixelPtr), yjkColors,
+		              reinterpret_cast<const uint32_t*>(palette32768));
+		return;
+	}
+#endif
+	for (unsigned i = 0; i < 256; ++i) {
+		pixelPtr[i] = palette32768[yjkColors[i]];
 	}
 }
 
@@ -347,31 +713,16 @@ void BitmapConverter<Pixel>::renderYAE(
 	const byte* __restrict vramPtr0,
 	const byte* __restrict vramPtr1)
 {
-	for (unsigned i = 0; i < 64; ++i) {
-		unsigned p[4];
-		p[0] = vramPtr0[2 * i + 0];
-		p[1] = vramPtr1[2 * i + 0];
-		p[2] = vramPtr0[2 * i + 1];
-		p[3] = vramPtr1[2 * i + 1];
-
-		int j = (p[2] & 7) + ((p[3] & 3) << 3) - ((p[3] & 4) << 3);
-		int k = (p[0] & 7) + ((p[1] & 3) << 3) - ((p[1] & 4) << 3);
-
-		for (unsigned n = 0; n < 4; ++n) {
-			Pixel pix;
-			if (p[n] & 0x08) {
-				// YAE
-				pix = palette16[p[n] >> 4];
-			} else {
-				// YJK
-				int y = p[n] >> 3;
-				int r = Math::clip<0, 31>(y + j);
-				int g = Math::clip<0, 31>(y + k);
-				int b = Math::clip<0, 31>((5 * y - 2 * j - k) / 4);
-				pix = palette32768[(r << 10) + (g << 5) + b];
-			}
-			pixelPtr[4 * i + n] = pix;
-		}
+	calcYJKColors(vramPtr0, vramPtr1);
+	for (unsigned i = 0; i < 128; ++i) {
+		unsigned p0 = vramPtr0[i];
+		unsigned p1 = vramPtr1[i];
+		pixelPtr[2 * i + 0] = (p0 & 0x08)
+			? palette16[p0 >> 4]             // YAE
+			: palette32768[yjkColors[2 * i + 0]]; // YJK
+		pixelPtr[2 * i + 1] = (p1 & 0x08)
+			? palette16[p1 >> 4]
+			: palette32768[yjkColors[2 * i + 1]];
 	}
 }
 
@@ -386,6 +737,7 @@ void BitmapConverter<Pixel>::renderBogus(Pixel* pixelPtr)
 }
 
 // Force template instantiation.
+template class BitmapConverter<uint8_t>;
 #if HAVE_16BPP
 template class BitmapConverter<uint16_t>;
 #endif
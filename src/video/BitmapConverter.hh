@@ -8,10 +8,16 @@
 namespace openmsx {
 
 template<int N> struct DoublePixel;
+template<> struct DoublePixel<1> { using type = uint16_t; };
 template<> struct DoublePixel<2> { using type = uint32_t; };
 template<> struct DoublePixel<4> { using type = uint64_t; };
 
 /** Utility class for converting VRAM contents to host pixels.
+  * When Pixel is uint8_t, the "host pixels" are indices in a RawFrame
+  * palette snapshot instead. In that case the YJK modes are not supported.
+  * On x86 the YJK color calculations use SSE2, and when the host CPU
+  * supports AVX2 (see HostCPU) the palette lookups of the bitmap modes are
+  * done with byte shuffles (16 color modes) or gathers (Graphic7, YJK).
   */
 template <class Pixel>
 class BitmapConverter
@@ -36,7 +42,8 @@ public:
 	  *   VDP color index to host pixel mapping.
 	  *   This is kept as a pointer, so any changes to the palette
 	  *   are immediately picked up by convertLine.
-	  *   Used when YJK filter is active.
+	  *   Used when YJK filter is active. Can be nullptr when this
+	  *   converter is never used in YJK modes.
 	  */
 	BitmapConverter(const Pixel* palette16,
 	                const Pixel* palette256,
@@ -75,6 +82,7 @@ public:
 
 private:
 	void calcDPalette();
+	void calcYJKColors(const byte* vramPtr0, const byte* vramPtr1);
 
 	inline void renderGraphic4(Pixel* pixelPtr, const byte* vramPtr0);
 	inline void renderGraphic5(Pixel* pixelPtr, const byte* vramPtr0);
@@ -94,8 +102,20 @@ private:
 
 	using DPixel = typename DoublePixel<sizeof(Pixel)>::type;
 	DPixel dPalette[16 * 16];
+
+	/** The Graphic4/6 palette and the (2x4 color) Graphic5 palette split
+	  * in byte planes: byte 'b' of the pixel for color 'i' is stored in
+	  * palettePlanes[..][b][i]. Valid together with dPalette.
+	  */
+	uint8_t palettePlanes16[sizeof(Pixel)][16];
+	uint8_t palettePlanesG5[sizeof(Pixel)][16];
+
+	/** Index in palette32768 for each pixel of a YJK line. */
+	uint16_t yjkColors[256];
+
 	DisplayMode mode;
 	bool dPaletteValid;
+	const bool useAVX2;
 };
 
 } // namespace openmsx
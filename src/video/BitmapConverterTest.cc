@@ -0,0 +1,185 @@
+// Converts random VRAM contents in each of the V9958 bitmap modes (GRAPHIC4..7,
+// YJK and YJK+YAE) with BitmapConverter, once via the SSE2 and once via the
+// AVX2 path, and compares each line against a per-pixel transcription of the
+// V9938/V9958 pixel formats. The palettes are random too, so a mixed-up
+// palette index (e.g. the two GRAPHIC6 pixels in a byte, or the YJK and RGB
+// halves in YAE mode) doesn't go unnoticed.
+//
+// Usage: BitmapConverterTest
+
+#include "BitmapConverter.hh"
+#include "DisplayMode.hh"
+#include "HostCPU.hh"
+#include "Math.hh"
+#include "build-info.hh"
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+
+template<typename Pixel> struct Palettes
+{
+	explicit Palettes(minstd_rand& random)
+		: palette16(32), palette256(256), palette32768(32768)
+	{
+		for (auto& p : palette16)    p = Pixel(random());
+		for (auto& p : palette256)   p = Pixel(random());
+		for (auto& p : palette32768) p = Pixel(random());
+	}
+	vector<Pixel> palette16;
+	vector<Pixel> palette256;
+	vector<Pixel> palette32768;
+};
+
+static void yjk(const unsigned* p, int& j, int& k)
+{
+	j = (p[2] & 7) + ((p[3] & 3) << 3) - ((p[3] & 4) << 3);
+	k = (p[0] & 7) + ((p[1] & 3) << 3) - ((p[1] & 4) << 3);
+}
+
+static unsigned yjkColor(unsigned p, int j, int k)
+{
+	int y = p >> 3;
+	int r = Math::clip<0, 31>(y + j);
+	int g = Math::clip<0, 31>(y + k);
+	int b = Math::clip<0, 31>((5 * y - 2 * j - k) / 4);
+	return (r << 10) + (g << 5) + b;
+}
+
+// Reference conversion, one pixel at a time.
+template<typename Pixel>
+static vector<Pixel> reference(byte mode, const Palettes<Pixel>& pal,
+                               const byte* vram0, const byte* vram1)
+{
+	vector<Pixel> out(512);
+	switch (mode) {
+	case DisplayMode::GRAPHIC4:
+		for (unsigned i = 0; i < 128; ++i) {
+			out[2 * i + 0] = pal.palette16[vram0[i] >> 4];
+			out[2 * i + 1] = pal.palette16[vram0[i] & 15];
+		}
+		break;
+	case DisplayMode::GRAPHIC5:
+		for (unsigned i = 0; i < 128; ++i) {
+			unsigned data = vram0[i];
+			out[4 * i + 0] = pal.palette16[ 0 +  (data >> 6)     ];
+			out[4 * i + 1] = pal.palette16[16 + ((data >> 4) & 3)];
+			out[4 * i + 2] = pal.palette16[ 0 + ((data >> 2) & 3)];
+			out[4 * i + 3] = pal.palette16[16 + ((data >> 0) & 3)];
+		}
+		break;
+	case DisplayMode::GRAPHIC6:
+		for (unsigned i = 0; i < 128; ++i) {
+			out[4 * i + 0] = pal.palette16[vram0[i] >> 4];
+			out[4 * i + 1] = pal.palette16[vram0[i] & 15];
+			out[4 * i + 2] = pal.palette16[vram1[i] >> 4];
+			out[4 * i + 3] = pal.palette16[vram1[i] & 15];
+		}
+		break;
+	case DisplayMode::GRAPHIC7:
+		for (unsigned i = 0; i < 128; ++i) {
+			out[2 * i + 0] = pal.palette256[vram0[i]];
+			out[2 * i + 1] = pal.palette256[vram1[i]];
+		}
+		break;
+	case DisplayMode::GRAPHIC7 | DisplayMode::YJK:
+	case DisplayMode::GRAPHIC7 | DisplayMode::YJK | DisplayMode::YAE:
+		for (unsigned i = 0; i < 64; ++i) {
+			unsigned p[4] = { vram0[2 * i + 0], vram1[2 * i + 0],
+			                  vram0[2 * i + 1], vram1[2 * i + 1] };
+			int j, k;
+			yjk(p, j, k);
+			for (unsigned n = 0; n < 4; ++n) {
+				out[4 * i + n] =
+					((mode & DisplayMode::YAE) && (p[n] & 0x08))
+					? pal.palette16[p[n] >> 4]
+					: pal.palette32768[yjkColor(p[n], j, k)];
+			}
+		}
+		break;
+	}
+	return out;
+}
+
+template<typename Pixel>
+static vector<Pixel> convert(byte mode, const Palettes<Pixel>& pal,
+                             const byte* vram0, const byte* vram1)
+{
+	// Use an odd start address to also test unaligned output.
+	vector<Pixel> buf(512 + 1);
+	BitmapConverter<Pixel> converter(
+		pal.palette16.data(), pal.palette256.data(),
+		(sizeof(Pixel) == 1) ? nullptr : pal.palette32768.data());
+	DisplayMode displayMode(byte((mode & 0x1C) >> 1), 0,  // M5..M3
+	                        byte((mode >> 2) & 0x18));    // YAE YJK
+	converter.setDisplayMode(displayMode);
+	if (displayMode.isPlanar()) {
+		converter.convertLinePlanar(&buf[1], vram0, vram1);
+	} else {
+		converter.convertLine(&buf[1], vram0);
+	}
+	return vector<Pixel>(buf.begin() + 1, buf.end());
+}
+
+template<typename Pixel>
+static int test(const string& name)
+{
+	struct ModeInfo { const char* name; byte mode; bool yjk; };
+	static const ModeInfo modes[] = {
+		{ "graphic4", DisplayMode::GRAPHIC4, false },
+		{ "graphic5", DisplayMode::GRAPHIC5, false },
+		{ "graphic6", DisplayMode::GRAPHIC6, false },
+		{ "graphic7", DisplayMode::GRAPHIC7, false },
+		{ "yjk",      DisplayMode::GRAPHIC7 | DisplayMode::YJK, true },
+		{ "yae",      DisplayMode::GRAPHIC7 | DisplayMode::YJK |
+		              DisplayMode::YAE, true },
+	};
+
+	int errors = 0;
+	minstd_rand random(42);
+	for (unsigned iter = 0; iter < 100; ++iter) {
+		Palettes<Pixel> pal(random);
+		vector<byte> vram0(128), vram1(128);
+		for (auto& b : vram0) b = byte(random());
+		for (auto& b : vram1) b = byte(random());
+		for (auto& m : modes) {
+			// YJK modes are not supported for palette indices.
+			if (m.yjk && (sizeof(Pixel) == 1)) continue;
+			auto ref = reference(m.mode, pal, vram0.data(), vram1.data());
+			for (bool avx2 : {false, true}) {
+				HostCPU::setAVX2(avx2);
+				if (avx2 && !HostCPU::hasAVX2()) continue;
+				auto out = convert(m.mode, pal, vram0.data(), vram1.data());
+				if (out != ref) {
+					cout << "FAILED: " << name << ' ' << m.name
+					     << (avx2 ? " avx2" : "") << endl;
+					++errors;
+				}
+			}
+		}
+	}
+	return errors;
+}
+
+int main()
+{
+	HostCPU::setAVX2(true);
+	if (!HostCPU::hasAVX2()) {
+		cout << "This CPU doesn't support AVX2, only testing the "
+		        "other code paths." << endl;
+	}
+	int errors = 0;
+	errors += test<uint8_t>("indices");
+#if HAVE_16BPP
+	errors += test<uint16_t>("16bpp");
+#endif
+#if HAVE_32BPP
+	errors += test<uint32_t>("32bpp");
+#endif
+	if (errors == 0) cout << "All tests passed." << endl;
+	return errors ? 1 : 0;
+}
@@ -504,6 +504,7 @@ void CharacterConverter<Pixel>::renderBlank(
 }
 
 // Force template instantiation.
+template class CharacterConverter<uint8_t>;
 #if HAVE_16BPP
 template class CharacterConverter<uint16_t>;
 #endif
@@ -11,6 +11,8 @@ class DisplayMode;
 
 
 /** Utility class for converting VRAM contents to host pixels.
+  * When Pixel is uint8_t, the "host pixels" are indices in a RawFrame
+  * palette snapshot instead.
   */
 template <class Pixel>
 class CharacterConverter
@@ -1,5 +1,4 @@
 #include "Deflicker.hh"
-#include "RawFrame.hh"
 #include "PixelOperations.hh"
 #include "memory.hh"
 #include "unreachable.hh"
@@ -16,7 +15,7 @@ template<typename Pixel> class DeflickerImpl final : public Deflicker
 {
 public:
 	DeflickerImpl(const SDL_PixelFormat& format,
-	              std::unique_ptr<RawFrame>* lastFrames);
+	              RawFramePool::Ref* lastFrames);
 
 private:
 	const void* getLineInfo(
@@ -29,7 +28,7 @@ private:
 
 std::unique_ptr<Deflicker> Deflicker::create(
 	const SDL_PixelFormat& format,
-        std::unique_ptr<RawFrame>* lastFrames)
+        RawFramePool::Ref* lastFrames)
 {
 #if HAVE_16BPP
 	if (format.BitsPerPixel == 15 || format.BitsPerPixel == 16) {
@@ -46,7 +45,7 @@ std::unique_ptr<Deflicker> Deflicker::create(
 
 
 Deflicker::Deflicker(const SDL_PixelFormat& format,
-                     std::unique_ptr<RawFrame>* lastFrames_)
+                     RawFramePool::Ref* lastFrames_)
 	: FrameSource(format)
 	, lastFrames(lastFrames_)
 {
@@ -66,7 +65,7 @@ unsigned Deflicker::getLineWidth(unsigned line) const
 
 template<typename Pixel>
 DeflickerImpl<Pixel>::DeflickerImpl(const SDL_PixelFormat& format,
-                                    std::unique_ptr<RawFrame>* lastFrames_)
+                                    RawFramePool::Ref* lastFrames_)
 	: Deflicker(format, lastFrames_)
 	, pixelOps(format)
 {
@@ -99,16 +98,22 @@ const void* DeflickerImpl<Pixel>::getLineInfo(
 	unsigned width1 = lastFrames[1]->getLineWidthDirect(line);
 	unsigned width2 = lastFrames[2]->getLineWidthDirect(line);
 	unsigned width3 = lastFrames[3]->getLineWidthDirect(line);
-	const Pixel* line0 = lastFrames[0]->template getLinePtrDirect<Pixel>(line);
-	const Pixel* line1 = lastFrames[1]->template getLinePtrDirect<Pixel>(line);
-	const Pixel* line2 = lastFrames[2]->template getLinePtrDirect<Pixel>(line);
-	const Pixel* line3 = lastFrames[3]->template getLinePtrDirect<Pixel>(line);
 	if ((width0 != width3) || (width0 != width2) || (width0 != width1)) {
 		// Not all the same width.
-		width = width0;
-		return line0;
+		const FrameSource& frame0 = *lastFrames[0];
+		return frame0.getLineInfo(line, width, buf_, bufWidth);
 	}
 
+	// Lines of indexed frames are first converted to host pixels.
+	VLA_SSE_ALIGNED(Pixel, tmp0, width0);
+	VLA_SSE_ALIGNED(Pixel, tmp1, width0);
+	VLA_SSE_ALIGNED(Pixel, tmp2, width0);
+	VLA_SSE_ALIGNED(Pixel, tmp3, width0);
+	const Pixel* line0 = lastFrames[0]->getHostLinePtr(line, tmp0);
+	const Pixel* line1 = lastFrames[1]->getHostLinePtr(line, tmp1);
+	const Pixel* line2 = lastFrames[2]->getHostLinePtr(line, tmp2);
+	const Pixel* line3 = lastFrames[3]->getHostLinePtr(line, tmp3);
+
 	// Prefer to write directly to the output buffer, if that's not
 	// possible store the intermediate result in a temp buffer.
 	VLA_SSE_ALIGNED(Pixel, buf2, width0);
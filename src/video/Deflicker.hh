@@ -2,28 +2,27 @@
 #define DEFLICKER_HH
 
 #include "FrameSource.hh"
+#include "RawFramePool.hh"
 #include <memory>
 
 namespace openmsx {
 
-class RawFrame;
-
 class Deflicker : public FrameSource
 {
 public:
 	// Factory method, actually returns a Deflicker subclass.
 	static std::unique_ptr<Deflicker> create(
 		const SDL_PixelFormat& format,
-		std::unique_ptr<RawFrame>* lastFrames);
+		RawFramePool::Ref* lastFrames);
 	void init();
 
 protected:
 	Deflicker(const SDL_PixelFormat& format,
-	          std::unique_ptr<RawFrame>* lastFrames);
+	          RawFramePool::Ref* lastFrames);
 
 	unsigned getLineWidth(unsigned line) const override;
 
-	std::unique_ptr<RawFrame>* lastFrames;
+	RawFramePool::Ref* lastFrames;
 };
 
 } // namespace openmsx
@@ -3,6 +3,7 @@
 #include "Layer.hh"
 #include "VideoSystem.hh"
 #include "VideoLayer.hh"
+#include "PostProcessor.hh"
 #include "EventDistributor.hh"
 #include "FinishFrameEvent.hh"
 #include "FileOperations.hh"
@@ -38,6 +39,7 @@ Display::Display(Reactor& reactor_)
 	: RTSchedulable(reactor_.getRTScheduler())
 	, screenShotCmd(reactor_.getCommandController())
 	, fpsInfo(reactor_.getOpenMSXInfoCommand())
+	, skippedLinesInfo(reactor_.getOpenMSXInfoCommand())
 	, osdGui(reactor_.getCommandController(), *this)
 	, reactor(reactor_)
 	, renderSettings(reactor.getCommandController())
@@ -526,4 +528,28 @@ string Display::FpsInfoTopic::help(const vector<string>& /*tokens*/) const
 	return "Returns the current rendering speed in frames per second.";
 }
 
+
+// SkippedLinesInfoTopic
+
+Display::SkippedLinesInfoTopic::SkippedLinesInfoTopic(InfoCommand& openMSXInfoCommand)
+	: InfoTopic(openMSXInfoCommand, "skipped_lines")
+{
+}
+
+void Display::SkippedLinesInfoTopic::execute(array_ref<TclObject> /*tokens*/,
+                           TclObject& result) const
+{
+	auto& display = OUTER(Display, skippedLinesInfo);
+	auto postProcessor = dynamic_cast<PostProcessor*>(
+		display.findActiveLayer());
+	result.setInt(postProcessor ? postProcessor->getSkippedLines() : 0);
+}
+
+string Display::SkippedLinesInfoTopic::help(const vector<string>& /*tokens*/) const
+{
+	return "Returns the number of lines in the last painted frame that "
+	       "didn't need to be scaled again, because that part of the MSX "
+	       "screen didn't change (SDL renderer only).";
+}
+
 } // namespace openmsx
@@ -114,6 +114,13 @@ private:
 		std::string help(const std::vector<std::string>& tokens) const override;
 	} fpsInfo;
 
+	struct SkippedLinesInfoTopic final : InfoTopic {
+		explicit SkippedLinesInfoTopic(InfoCommand& openMSXInfoCommand);
+		void execute(array_ref<TclObject> tokens,
+			     TclObject& result) const override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+	} skippedLinesInfo;
+
 	OSDGUI osdGui;
 
 	Reactor& reactor;
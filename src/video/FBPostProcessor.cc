@@ -6,6 +6,7 @@
 #include "Scaler.hh"
 #include "ScalerFactory.hh"
 #include "OutputSurface.hh"
+#include "SDLOffScreenSurface.hh"
 #include "IntegerSetting.hh"
 #include "FloatSetting.hh"
 #include "BooleanSetting.hh"
@@ -14,10 +15,12 @@
 #include "aligned.hh"
 #include "random.hh"
 #include "xrange.hh"
+#include "xxhash.hh"
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstddef>
+#include <cstring>
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
@@ -28,6 +31,10 @@ static const unsigned NOISE_SHIFT = 8192;
 static const unsigned NOISE_BUF_SIZE = 2 * NOISE_SHIFT;
 SSE_ALIGNED(static signed char noiseBuf[NOISE_BUF_SIZE]);
 
+// The scalers that can scale a part of the image (see Scaler::canSplit())
+// read at most this many lines above and below that part.
+static const unsigned SCALER_MARGIN = 2;
+
 template <class Pixel>
 void FBPostProcessor<Pixel>::preCalcNoise(float factor)
 {
@@ -220,6 +227,101 @@ void FBPostProcessor<Pixel>::drawNoise(OutputSurface& output)
 	}
 }
 
+static uint64_t hashBytes(const uint8_t* data, size_t size)
+{
+	// two 32-bit hashes, one of them would give too many collisions
+	uint64_t h0 = xxhash_impl<false, 0xFF, 0>(data, size);
+	uint64_t h1 = xxhash_impl<false, 0xFF, PRIME32_1>(data, size);
+	return (h1 << 32) | h0;
+}
+
+template <class Pixel>
+static uint64_t hashLine(const FrameSource& frame, unsigned y)
+{
+	SSE_ALIGNED(Pixel buf[1280]); // large enough for widest line
+	unsigned width;
+	auto* data = static_cast<const uint8_t*>(
+		frame.getLineInfo(y, width, buf, 1280));
+	return hashBytes(data, width * sizeof(Pixel));
+}
+
+template <class Pixel>
+std::vector<bool> FBPostProcessor<Pixel>::findDirtyUnits(
+	OutputSurface& output, unsigned srcStep, unsigned numUnits,
+	unsigned inWidth)
+{
+	std::vector<bool> dirty(numUnits, true);
+	if (superImposeVideoFrame || !currScaler.canSplit()) {
+		// every frame is different or can only be scaled as a whole
+		scaledFrame.reset();
+		return dirty;
+	}
+
+	int scanline = renderSettings.getScanlineFactor();
+	int blur = renderSettings.getBlurFactor();
+	bool valid = scaledFrame &&
+		(scaledFrame->getWidth()  == output.getWidth()) &&
+		(scaledFrame->getHeight() == output.getHeight()) &&
+		(lineHashes.size() == (numUnits * srcStep)) &&
+		(scaledInWidth == inWidth) &&
+		(scaledScanline == scanline) && (scaledBlur == blur);
+	if (!valid) {
+		if (!scaledFrame ||
+		    (scaledFrame->getWidth()  != output.getWidth()) ||
+		    (scaledFrame->getHeight() != output.getHeight())) {
+			scaledFrame = make_unique<SDLOffScreenSurface>(
+				output.getWidth(), output.getHeight(),
+				output.getSDLFormat());
+		}
+		lineHashes.assign(numUnits * srcStep, 0);
+		scaledInWidth = inWidth;
+		scaledScanline = scanline;
+		scaledBlur = blur;
+	}
+
+	// A unit (srcStep source lines that are scaled to dstStep output
+	// lines) is scaled again when a line in or near it changed.
+	std::vector<bool> changed(numUnits, !valid);
+	const RawFrame* indexedFrame =
+		((paintFrame == lastFrames[0].get()) && lastFrames[0]->isIndexed())
+		? lastFrames[0].get() : nullptr;
+	const uint32_t* palette = nullptr;
+	uint64_t paletteHash = 0;
+	for (unsigned y = 0; y < (numUnits * srcStep); ++y) {
+		uint64_t hash;
+		if (indexedFrame) {
+			// Hash the indices (instead of converting them to host
+			// pixels) plus the palette they refer to. Consecutive
+			// lines usually share the palette, so it's only hashed
+			// again when it changes.
+			auto* linePalette = indexedFrame->getLinePaletteColors(y);
+			if (linePalette != palette) {
+				palette = linePalette;
+				paletteHash = hashBytes(
+					reinterpret_cast<const uint8_t*>(palette),
+					256 * sizeof(uint32_t));
+			}
+			hash = paletteHash ^ hashBytes(
+				indexedFrame->getIndexLinePtr(y),
+				indexedFrame->getLineWidthDirect(y));
+		} else {
+			hash = hashLine<Pixel>(*paintFrame, y);
+		}
+		if (hash != lineHashes[y]) {
+			lineHashes[y] = hash;
+			changed[y / srcStep] = true;
+		}
+	}
+	for (unsigned unit = 0; unit < numUnits; ++unit) {
+		unsigned first = unit - std::min(unit, SCALER_MARGIN);
+		unsigned last = std::min(unit + SCALER_MARGIN, numUnits - 1);
+		dirty[unit] = std::find(changed.begin() + first,
+		                        changed.begin() + last + 1,
+		                        true) != (changed.begin() + last + 1);
+	}
+	return dirty;
+}
+
 template <class Pixel>
 void FBPostProcessor<Pixel>::update(const Setting& setting)
 {
@@ -243,6 +345,10 @@ FBPostProcessor<Pixel>::FBPostProcessor(MSXMotherBoard& motherBoard_,
 {
 	scaleAlgorithm = RenderSettings::NO_SCALER;
 	scaleFactor = unsigned(-1);
+	scaleThreads = -1;
+	scaledInWidth = 0;
+	scaledScanline = -1;
+	scaledBlur = -1;
 
 	auto& noiseSetting = renderSettings.getNoiseSetting();
 	noiseSetting.attach(*this);
@@ -272,12 +378,18 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 	// New scaler algorithm selected?
 	auto algo = renderSettings.getScaleAlgorithm();
 	unsigned factor = renderSettings.getScaleFactor();
-	if ((scaleAlgorithm != algo) || (scaleFactor != factor)) {
+	int threads = renderSettings.getScaleThreads();
+	if ((scaleAlgorithm != algo) || (scaleFactor != factor) ||
+	    (scaleThreads != threads)) {
 		scaleAlgorithm = algo;
 		scaleFactor = factor;
-		currScaler = ScalerFactory<Pixel>::createScaler(
-			PixelOperations<Pixel>(output.getSDLFormat()),
-			renderSettings);
+		scaleThreads = threads;
+		scaledFrame.reset();
+		PixelOperations<Pixel> outputOps(output.getSDLFormat());
+		currScaler.setScaler(threads, [&]() {
+			return ScalerFactory<Pixel>::createScaler(
+				outputOps, renderSettings);
+		});
 	}
 
 	// Scale image.
@@ -288,8 +400,15 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 	unsigned srcStep = srcHeight / g;
 	unsigned dstStep = dstHeight / g;
 
+	float horStretch = renderSettings.getHorizontalStretch();
+	unsigned inWidth = unsigned(horStretch + 0.5f);
+	auto dirty = findDirtyUnits(output, srcStep, g, inWidth);
+	OutputSurface& target = scaledFrame ? *scaledFrame : output;
+	target.lock();
+
 	// TODO: Store all MSX lines in RawFrame and only scale the ones that fit
 	//       on the PC screen, as a preparation for resizable output window.
+	skippedLines = 0;
 	unsigned srcStartY = 0;
 	unsigned dstStartY = 0;
 	while (dstStartY < dstHeight) {
@@ -307,33 +426,51 @@ void FBPostProcessor<Pixel>::paint(OutputSurface& output)
 			dstEndY += dstStep;
 		}
 
-		// fill region
+		// fill the changed parts of the region
 		//fprintf(stderr, "post processing lines %d-%d: %d\n",
 		//	srcStartY, srcEndY, lineWidth );
-		output.lock();
-		float horStretch = renderSettings.getHorizontalStretch();
-		unsigned inWidth = unsigned(horStretch + 0.5f);
-		std::unique_ptr<ScalerOutput<Pixel>> dst(
-			StretchScalerOutputFactory<Pixel>::create(
-				output, pixelOps, inWidth));
-		currScaler->scaleImage(
-			*paintFrame, superImposeVideoFrame,
-			srcStartY, srcEndY, lineWidth, // source
-			*dst, dstStartY, dstEndY); // dest
+		unsigned unit    = dstStartY / dstStep;
+		unsigned endUnit = dstEndY   / dstStep;
+		while (unit < endUnit) {
+			if (!dirty[unit]) {
+				skippedLines += dstStep;
+				++unit;
+				continue;
+			}
+			unsigned first = unit;
+			while ((unit < endUnit) && dirty[unit]) ++unit;
+			currScaler.scaleImage(
+				*paintFrame, superImposeVideoFrame,
+				first * srcStep, unit * srcStep, srcStep, lineWidth, // source
+				[&]() { // dest, one per band
+					return StretchScalerOutputFactory<Pixel>::create(
+						target, pixelOps, inWidth);
+				},
+				first * dstStep, unit * dstStep, dstStep);
+		}
 
 		// next region
 		srcStartY = srcEndY;
 		dstStartY = dstEndY;
 	}
 
+	if (scaledFrame) {
+		output.lock();
+		size_t lineSize = output.getWidth() * sizeof(Pixel);
+		for (unsigned y = 0; y < dstHeight; ++y) {
+			memcpy(output.getLinePtrDirect<Pixel>(y),
+			       scaledFrame->getLinePtrDirect<Pixel>(y), lineSize);
+		}
+	}
+
 	drawNoise(output);
 
 	output.flushFrameBuffer(); // for SDLGL-FBxx
 }
 
 template <class Pixel>
-std::unique_ptr<RawFrame> FBPostProcessor<Pixel>::rotateFrames(
-	std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time)
+RawFramePool::Ref FBPostProcessor<Pixel>::rotateFrames(
+	RawFramePool::Ref finishedFrame, EmuTime::param time)
 {
 	auto& generator = global_urng(); // fast (non-cryptographic) random numbers
 	std::uniform_int_distribution<int> distribution(0, NOISE_SHIFT / 16 - 1);
@@ -4,13 +4,16 @@
 #include "PostProcessor.hh"
 #include "RenderSettings.hh"
 #include "PixelOperations.hh"
+#include "ParallelScaler.hh"
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace openmsx {
 
 class MSXMotherBoard;
 class Display;
-template<typename Pixel> class Scaler;
+class SDLOffScreenSurface;
 
 /** Rasterizer using SDL.
   */
@@ -27,21 +30,24 @@ public:
 	// Layer interface:
 	void paint(OutputSurface& output) override;
 
-	std::unique_ptr<RawFrame> rotateFrames(
-		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time) override;
+	RawFramePool::Ref rotateFrames(
+		RawFramePool::Ref finishedFrame, EmuTime::param time) override;
 
 private:
 	void preCalcNoise(float factor);
 	void drawNoise(OutputSurface& output);
 	void drawNoiseLine(Pixel* buf, signed char* noise,
 	                   size_t width);
+	std::vector<bool> findDirtyUnits(
+		OutputSurface& output, unsigned srcStep, unsigned numUnits,
+		unsigned inWidth);
 
 	// Observer<Setting>
 	void update(const Setting& setting) override;
 
-	/** The currently active scaler.
+	/** The currently active scaler (possibly running on several threads).
 	  */
-	std::unique_ptr<Scaler<Pixel>> currScaler;
+	ParallelScaler<Pixel> currScaler;
 
 	/** Currently active scale algorithm, used to detect scaler changes.
 	  */
@@ -51,6 +57,28 @@ private:
 	  */
 	unsigned scaleFactor;
 
+	/** Currently active number of scaler threads (setting value).
+	  */
+	int scaleThreads;
+
+	/** The scaled image of the previous paint(). Only the lines of the
+	  * MSX frame that changed since then are scaled again, the rest is
+	  * copied from here. nullptr when the scaled image isn't kept (e.g.
+	  * for scalers that can't scale a part of the image).
+	  */
+	std::unique_ptr<SDLOffScreenSurface> scaledFrame;
+
+	/** Content hash per line of the MSX frame in 'scaledFrame'.
+	  */
+	std::vector<uint64_t> lineHashes;
+
+	/** Settings that were used for 'scaledFrame' (but that don't cause
+	  * a new scaler to be created).
+	  */
+	unsigned scaledInWidth;
+	int scaledScanline;
+	int scaledBlur;
+
 	/** Remember the noise values to get a stable image when paused.
 	 */
 	std::vector<unsigned> noiseShift;
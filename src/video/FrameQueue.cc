@@ -0,0 +1,75 @@
+#include "FrameQueue.hh"
+#include "MSXException.hh"
+#include <chrono>
+#include <cassert>
+
+namespace openmsx {
+
+FrameQueue::FrameQueue()
+	: frames(0), stalls(0), stallTime(0.0)
+	, writtenFrames(0), encodeMicros(0)
+{
+}
+
+FrameQueue::~FrameQueue()
+{
+	waitAll();
+}
+
+unsigned FrameQueue::startFrame(bool& stalled)
+{
+	auto& future = done[frames % SIZE];
+	stalled = false;
+	if (future.valid()) {
+		if (future.wait_for(std::chrono::seconds(0)) !=
+		    std::future_status::ready) {
+			stalled = true;
+			auto start = std::chrono::steady_clock::now();
+			future.wait();
+			++stalls;
+			stallTime += std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - start).count();
+		}
+		future.get(); // possibly rethrows
+	}
+	return frames++;
+}
+
+void FrameQueue::setDone(unsigned frame, std::shared_future<void> future)
+{
+	assert(frame == (frames - 1));
+	done[frame % SIZE] = std::move(future);
+}
+
+void FrameQueue::addEncodeTime(std::chrono::steady_clock::duration time)
+{
+	encodeMicros += std::chrono::duration_cast<std::chrono::microseconds>(
+		time).count();
+}
+
+FrameQueue::Stats FrameQueue::getStats() const
+{
+	Stats result;
+	result.queuedFrames = frames;
+	result.writtenFrames = writtenFrames;
+	result.stalls = stalls;
+	result.stallTime = stallTime;
+	result.encodeTime = encodeMicros / 1000000.0;
+	return result;
+}
+
+void FrameQueue::waitAll()
+{
+	for (auto& future : done) {
+		if (future.valid()) {
+			try {
+				future.get();
+			} catch (MSXException&) {
+				// already stopping, can't report this anymore
+			}
+			future = std::shared_future<void>();
+		}
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,72 @@
+#ifndef FRAMEQUEUE_HH
+#define FRAMEQUEUE_HH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+
+namespace openmsx {
+
+/** The queue of a video recording (see AviWriter and RawVideoWriter): the
+  * emulation thread queues the frames, other threads compress and write
+  * them. At most SIZE frames can be in the queue, when that's not enough the
+  * emulation thread waits (frames are never dropped). The recorder keeps
+  * the data of each frame in one of SIZE slots.
+  */
+class FrameQueue
+{
+public:
+	static const unsigned SIZE = 8;
+
+	FrameQueue();
+	/** Waits till all queued frames are done. */
+	~FrameQueue();
+
+	/** Start queuing a new frame. Waits till its slot is free, that is
+	  * till the frame of SIZE frames ago is done.
+	  * @param stalled Set when the emulation thread had to wait.
+	  * @return The number of this frame. It uses slot 'frame % SIZE'.
+	  * @throws MSXException When processing that earlier frame failed.
+	  */
+	unsigned startFrame(bool& stalled);
+
+	/** The frame (as returned by startFrame()) is done when this future
+	  * is ready. */
+	void setDone(unsigned frame, std::shared_future<void> done);
+
+	/** Waits till all queued frames are done. Errors are ignored, they
+	  * can't be reported anymore. */
+	void waitAll();
+
+	/** Number of frames queued in total. */
+	unsigned getNumFrames() const { return frames; }
+
+	/** A frame is written, can be called from any thread. */
+	void frameWritten() { ++writtenFrames; }
+	/** Add to the time the encoder (or writer) thread was busy, can be
+	  * called from any thread. */
+	void addEncodeTime(std::chrono::steady_clock::duration time);
+
+	/** Statistics, see 'record status'. */
+	struct Stats {
+		unsigned queuedFrames;  // in total
+		unsigned writtenFrames; // in total
+		unsigned stalls;        // number of times startFrame() had to wait
+		double stallTime;       // total time (in s) startFrame() waited
+		double encodeTime;      // time (in s) the encoder thread was busy
+	};
+	Stats getStats() const;
+
+private:
+	std::shared_future<void> done[SIZE];
+	unsigned frames;
+	unsigned stalls;
+	double stallTime;
+	std::atomic<unsigned> writtenFrames;
+	std::atomic<uint64_t> encodeMicros;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,66 @@
+#include "FrameRotation.hh"
+#include "likely.hh"
+#include <algorithm>
+#include <cassert>
+
+namespace openmsx {
+
+FrameRotation::FrameRotation(RawFramePool& pool_, bool reuseDisplayed_)
+	: pool(pool_)
+	, count(0)
+	, reuseDisplayed(reuseDisplayed_)
+{
+}
+
+bool FrameRotation::insert(RawFramePool::Ref finishedFrame, int numRequired)
+{
+	assert(!recycleFrame);
+
+	// Which frame can be returned (recycled) to caller. Prefer to return
+	// the youngest frame to improve cache locality.
+	int recycleIdx = (count < numRequired)
+		? count++            // store one more
+		: (numRequired - 1); // youngest that's no longer needed
+	assert(recycleIdx < 4);
+	recycleFrame = std::move(frames[recycleIdx]); // might be empty
+
+	// Insert new frame in front of frames[], shift older frames
+	std::move_backward(frames, frames + recycleIdx,
+	                   frames + recycleIdx + 1);
+	frames[0] = std::move(finishedFrame);
+
+	// Are enough frames available?
+	if (count >= numRequired) {
+		// Only the last 'numRequired' are kept up to date.
+		count = numRequired;
+		return true;
+	}
+	// Not enough past frames. This situation can only occur when:
+	// - The very first frame we render needs to be deinterlaced.
+	//   In other case we have at least one valid frame from the
+	//   past plus one new frame passed via the 'finishedFrame'
+	//   parameter.
+	// - Or when (re)enabling the deflicker setting. Typically only
+	//   1 frame in frames[] is kept up-to-date (and we're
+	//   given 1 new frame), so it can take up-to 2 frame after
+	//   enabling deflicker before it actually takes effect.
+	return false;
+}
+
+RawFramePool::Ref FrameRotation::next()
+{
+	auto result = std::move(recycleFrame);
+	if (reuseDisplayed) {
+		// Laserdisc keeps drawing in the displayed frame.
+		return frames[0];
+	}
+	if (unlikely(!result.unique())) {
+		// Not yet available or still in use elsewhere, take another
+		// one from the pool (only allocates during the first few
+		// frames).
+		result = pool.acquire();
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,54 @@
+#ifndef FRAMEROTATION_HH
+#define FRAMEROTATION_HH
+
+#include "RawFramePool.hh"
+
+namespace openmsx {
+
+/** The last 4 fully rendered (unscaled) MSX frames of a PostProcessor.
+  *
+  * Each frame the rasterizer finishes is put in front, the frame that's no
+  * longer needed goes back to the rasterizer to build the next frame in. So
+  * once enough frames are taken from the pool, the same frames go around
+  * and nothing is allocated anymore.
+  */
+class FrameRotation
+{
+public:
+	/** @param pool The frames come from this pool.
+	  * @param reuseDisplayed Laserdisc produces a complete frame at a
+	  *        time and keeps drawing in the displayed frame, so only
+	  *        the first of the last frames is used.
+	  */
+	FrameRotation(RawFramePool& pool, bool reuseDisplayed);
+
+	/** Put a finished frame in front of the last frames.
+	  * @param finishedFrame Frame that has just become available.
+	  * @param numRequired The number of last frames that are needed to
+	  *                    build the displayed frame (1, 2 or 4).
+	  * @return Are that many frames available? When not (e.g. right after
+	  *         enabling deflicker) fall back to 'regular' rendering.
+	  */
+	bool insert(RawFramePool::Ref finishedFrame, int numRequired);
+
+	/** The frame to build the next frame in, call after insert(). When the
+	  * frame that's no longer needed is still in use elsewhere (e.g. by
+	  * the video recorder), another frame is taken from the pool.
+	  */
+	RawFramePool::Ref next();
+
+	RawFramePool::Ref& operator[](unsigned i) { return frames[i]; }
+	const RawFramePool::Ref& operator[](unsigned i) const { return frames[i]; }
+	RawFramePool::Ref* data() { return frames; }
+
+private:
+	RawFramePool& pool;
+	RawFramePool::Ref frames[4];
+	RawFramePool::Ref recycleFrame; // from insert() till next()
+	int count; // How many items in frames[] are up-to-date
+	const bool reuseDisplayed;
+};
+
+} // namespace openmsx
+
+#endif
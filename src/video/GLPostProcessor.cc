@@ -231,10 +231,10 @@ void GLPostProcessor::paint(OutputSurface& /*output*/)
 	}
 }
 
-std::unique_ptr<RawFrame> GLPostProcessor::rotateFrames(
-	std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time)
+RawFramePool::Ref GLPostProcessor::rotateFrames(
+	RawFramePool::Ref finishedFrame, EmuTime::param time)
 {
-	std::unique_ptr<RawFrame> reuseFrame =
+	auto reuseFrame =
 		PostProcessor::rotateFrames(std::move(finishedFrame), time);
 	uploadFrame();
 	++frameCounter;
@@ -28,8 +28,8 @@ public:
 	// Layer interface:
 	void paint(OutputSurface& output) override;
 
-	std::unique_ptr<RawFrame> rotateFrames(
-		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time) override;
+	RawFramePool::Ref rotateFrames(
+		RawFramePool::Ref finishedFrame, EmuTime::param time) override;
 
 protected:
 	// Observer<Setting> interface:
@@ -112,6 +112,7 @@ PixelRenderer::PixelRenderer(VDP& vdp_, Display& display)
 	, videoSourceSetting(vdp.getMotherBoard().getVideoSource())
 	, spriteChecker(vdp.getSpriteChecker())
 	, rasterizer(display.getVideoSystem().createRasterizer(vdp))
+	, frameStartTime(EmuTime::zero)
 {
 	// In case of loadstate we can't yet query any state from the VDP
 	// (because that object is not yet fully deserialized). But
@@ -122,13 +123,32 @@ PixelRenderer::PixelRenderer(VDP& vdp_, Display& display)
 	finishFrameDuration = 0;
 	frameSkipCounter = 999; // force drawing of frame
 	prevRenderFrame = false;
+	renderFrameDuration = 0;
+	renderDuration = 0;
+	frameDeferred = false;
+	frameChanged = true;
+	prevPalTiming = false;
+	prevDisableSprites = false;
+	prevIndexedFrames = false;
 
 	renderSettings.getMaxFrameSkipSetting().attach(*this);
 	renderSettings.getMinFrameSkipSetting().attach(*this);
+	renderSettings.getAdaptiveFrameSkipSetting().attach(*this);
+	renderSettings.getGammaSetting().attach(*this);
+	renderSettings.getBrightnessSetting().attach(*this);
+	renderSettings.getContrastSetting().attach(*this);
+	renderSettings.getColorMatrixSetting().attach(*this);
+	renderSettings.getLimitSpritesSetting().attach(*this);
 }
 
 PixelRenderer::~PixelRenderer()
 {
+	renderSettings.getLimitSpritesSetting().detach(*this);
+	renderSettings.getColorMatrixSetting().detach(*this);
+	renderSettings.getContrastSetting().detach(*this);
+	renderSettings.getBrightnessSetting().detach(*this);
+	renderSettings.getGammaSetting().detach(*this);
+	renderSettings.getAdaptiveFrameSkipSetting().detach(*this);
 	renderSettings.getMinFrameSkipSetting().detach(*this);
 	renderSettings.getMaxFrameSkipSetting().detach(*this);
 }
@@ -144,6 +164,9 @@ void PixelRenderer::reInit()
 	// This for example can happen after a loadstate or after switching
 	// renderer in the middle of a frame.
 	renderFrame = false;
+	frameDeferred = false;
+	prevFrameShown = false;
+	enableEvents.clear();
 
 	rasterizer->reset();
 	displayEnabled = vdp.isDisplayEnabled();
@@ -151,20 +174,63 @@ void PixelRenderer::reInit()
 
 void PixelRenderer::updateDisplayEnabled(bool enabled, EmuTime::param time)
 {
+	// Note: VDPVRAM already synced the command engine.
+	int ticks = vdp.getTicksThisFrame(time);
+	if (frameDeferred) {
+		auto i = enableEvents.size();
+		if ((i >= prevEnableEvents.size()) ||
+		    (prevEnableEvents[i].ticks   != ticks) ||
+		    (prevEnableEvents[i].enabled != enabled)) {
+			// Not the same as in the previous frame.
+			renderDeferredFrame(time);
+		}
+	}
+	enableEvents.emplace_back(time, ticks, enabled);
 	sync(time, true);
 	displayEnabled = enabled;
 }
 
 void PixelRenderer::frameStart(EmuTime::param time)
 {
+	prevEnableEvents.swap(enableEvents);
+	enableEvents.clear();
+	frameDeferred = false;
+	renderDuration = 0;
+
+	bool palTiming      = vdp.isPalTiming();
+	bool disableSprites = renderSettings.getDisableSprites();
+	bool indexedFrames  = renderSettings.getIndexedFrames();
+	bool unchanged = !frameChanged && prevFrameShown &&
+		(palTiming      == prevPalTiming) &&
+		(disableSprites == prevDisableSprites) &&
+		(indexedFrames  == prevIndexedFrames);
+	frameChanged = false;
+	prevPalTiming      = palTiming;
+	prevDisableSprites = disableSprites;
+	prevIndexedFrames  = indexedFrames;
+
 	if (!rasterizer->isActive()) {
 		frameSkipCounter = 999;
 		renderFrame = false;
 		prevRenderFrame = false;
+		prevFrameShown = false;
 		return;
 	}
 	prevRenderFrame = renderFrame;
-	if (vdp.isInterlaced() && renderSettings.getDeinterlace() &&
+	if (renderSettings.getAdaptiveFrameSkip()) {
+		// Never skip a frame that (might) differ from the previous
+		// one. Other frames are only rendered when a change shows up,
+		// see frameChange(). Interlaced and superimposed frames
+		// always differ from the previous frame, each frame must be
+		// recorded and deflicker blends the last four frames.
+		renderFrame = !unchanged ||
+		              vdp.isInterlaced() ||
+		              vdp.isSuperimposing() ||
+		              rasterizer->isRecording() ||
+		              renderSettings.getDeflicker();
+		frameDeferred = !renderFrame;
+		frameSkipCounter = 0;
+	} else if (vdp.isInterlaced() && renderSettings.getDeinterlace() &&
 	    vdp.getEvenOdd() && vdp.isEvenOddEnabled()) {
 		// deinterlaced odd frame, do same as even frame
 	} else {
@@ -187,10 +253,8 @@ void PixelRenderer::frameStart(EmuTime::param time)
 			}
 		}
 	}
-	if (!renderFrame) return;
-
-	rasterizer->frameStart(time);
-
+	frameStartTime = time;
+	frameStartDisplayEnabled = displayEnabled;
 	accuracy = renderSettings.getAccuracy();
 
 	nextX = 0;
@@ -198,12 +262,31 @@ void PixelRenderer::frameStart(EmuTime::param time)
 	// This is not what the real VDP does, but it is good enough
 	// for the "Boring scroll" demo part of ANMA's "Relax" demo.
 	textModeCounter = 0;
+
+	if (renderFrame) rasterizer->frameStart(time);
 }
 
 void PixelRenderer::frameEnd(EmuTime::param time)
 {
+	if (frameDeferred) {
+		// Commands may still change VRAM in this frame.
+		vram.sync(time);
+		if (frameDeferred &&
+		    (enableEvents.size() != prevEnableEvents.size())) {
+			renderDeferredFrame(time);
+		}
+	}
+
+	const float ALPHA = 0.2f;
 	bool skipEvent = !renderFrame;
-	if (renderFrame) {
+	if (frameDeferred) {
+		// Nothing changed, the previous frame is still valid. Only
+		// skip painting it when we're behind realtime.
+		frameDeferred = false;
+		++stats.unchanged;
+		stats.savedTime += uint64_t(renderFrameDuration);
+		skipEvent = !realTime.timeLeft(unsigned(finishFrameDuration), time);
+	} else if (renderFrame) {
 		// Render changes from this last frame.
 		sync(time, true);
 
@@ -212,9 +295,12 @@ void PixelRenderer::frameEnd(EmuTime::param time)
 		rasterizer->frameEnd();
 		auto time2 = Timer::getTime();
 		auto current = time2 - time1;
-		const float ALPHA = 0.2f;
 		finishFrameDuration = finishFrameDuration * (1 - ALPHA) +
 		                      current * ALPHA;
+		renderFrameDuration = renderFrameDuration * (1 - ALPHA) +
+		                      (renderDuration + current) * ALPHA;
+		++stats.rendered;
+		prevFrameShown = true;
 
 		if (vdp.isInterlaced() && vdp.isEvenOddEnabled() &&
 		    renderSettings.getDeinterlace() &&
@@ -223,6 +309,10 @@ void PixelRenderer::frameEnd(EmuTime::param time)
 			// previous frame was not rendered
 			skipEvent = true;
 		}
+	} else if (rasterizer->isActive()) {
+		++stats.throttled;
+		stats.savedTime += uint64_t(renderFrameDuration);
+		prevFrameShown = false;
 	}
 	if (vdp.getMotherBoard().isActive() &&
 	    !vdp.getMotherBoard().isFastForwarding()) {
@@ -237,6 +327,7 @@ void PixelRenderer::frameEnd(EmuTime::param time)
 void PixelRenderer::updateHorizontalScrollLow(
 	byte scroll, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 	rasterizer->setHorizontalScrollLow(scroll);
 }
@@ -244,12 +335,14 @@ void PixelRenderer::updateHorizontalScrollLow(
 void PixelRenderer::updateHorizontalScrollHigh(
 	byte /*scroll*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateBorderMask(
 	bool masked, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 	rasterizer->setBorderMask(masked);
 }
@@ -257,12 +350,14 @@ void PixelRenderer::updateBorderMask(
 void PixelRenderer::updateMultiPage(
 	bool /*multiPage*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateTransparency(
 	bool enabled, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 	rasterizer->setTransparency(enabled);
 }
@@ -270,6 +365,7 @@ void PixelRenderer::updateTransparency(
 void PixelRenderer::updateSuperimposing(
 	const RawFrame* videoSource, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 	rasterizer->setSuperimposeVideoFrame(videoSource);
 }
@@ -277,12 +373,14 @@ void PixelRenderer::updateSuperimposing(
 void PixelRenderer::updateForegroundColor(
 	int /*color*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateBackgroundColor(
 	int color, EmuTime::param time)
 {
+	frameChange(time);
 	sync(time);
 	rasterizer->setBackgroundColor(color);
 }
@@ -290,18 +388,21 @@ void PixelRenderer::updateBackgroundColor(
 void PixelRenderer::updateBlinkForegroundColor(
 	int /*color*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateBlinkBackgroundColor(
 	int /*color*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateBlinkState(
-	bool /*enabled*/, EmuTime::param /*time*/)
+	bool /*enabled*/, EmuTime::param time)
 {
+	frameChange(time);
 	// TODO: When the sync call is enabled, the screen flashes on
 	//       every call to this method.
 	//       I don't know why exactly, but it's probably related to
@@ -312,6 +413,7 @@ void PixelRenderer::updateBlinkState(
 void PixelRenderer::updatePalette(
 	int index, int grb, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) {
 		sync(time);
 	} else {
@@ -334,12 +436,14 @@ void PixelRenderer::updatePalette(
 void PixelRenderer::updateVerticalScroll(
 	int /*scroll*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateHorizontalAdjust(
 	int adjust, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 	rasterizer->setHorizontalAdjust(adjust);
 }
@@ -347,6 +451,7 @@ void PixelRenderer::updateHorizontalAdjust(
 void PixelRenderer::updateDisplayMode(
 	DisplayMode mode, EmuTime::param time)
 {
+	frameChange(time);
 	// Sync if in display area or if border drawing process changes.
 	DisplayMode oldMode = vdp.getDisplayMode();
 	if (displayEnabled
@@ -362,24 +467,28 @@ void PixelRenderer::updateDisplayMode(
 void PixelRenderer::updateNameBase(
 	int /*addr*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updatePatternBase(
 	int /*addr*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateColorBase(
 	int /*addr*/, EmuTime::param time)
 {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
 void PixelRenderer::updateSpritesEnabled(
 	bool /*enabled*/, EmuTime::param time
 ) {
+	frameChange(time);
 	if (displayEnabled) sync(time);
 }
 
@@ -410,7 +519,6 @@ inline bool PixelRenderer::checkSync(int offset, EmuTime::param time)
 	// renderer output, therefore sync is not necessary.
 	// TODO: Have bitmapVisibleWindow disabled in this case.
 	if (!displayEnabled) return false;
-	//if (frameSkipCounter != 0) return false; // TODO
 	if (accuracy == RenderSettings::ACC_SCREEN) return false;
 
 	// Calculate what display lines are scanned between current
@@ -487,8 +595,75 @@ inline bool PixelRenderer::checkSync(int offset, EmuTime::param time)
 	}
 }
 
+bool PixelRenderer::affectsOutput(unsigned offset) const
+{
+	// Unlike checkSync(), this also looks at the lines that are already
+	// rendered and at the sprite tables: the change can still show up in
+	// the next frame.
+	if (vram.spriteAttribTable.isInside(offset) ||
+	    vram.spritePatternTable.isInside(offset)) {
+		return true;
+	}
+	switch (vdp.getDisplayMode().getBase()) {
+	case DisplayMode::GRAPHIC4:
+	case DisplayMode::GRAPHIC5: {
+		// The visible page or the page that alternates with it
+		// (even/odd or blinking pages).
+		int page = offset & 0x18000;
+		int visiblePage = vram.nameTable.getMask() & 0x18000;
+		return (page == visiblePage) ||
+		       (page == (visiblePage & 0x10000));
+	}
+	case DisplayMode::GRAPHIC6:
+	case DisplayMode::GRAPHIC7:
+		return true;
+	default:
+		return vram.nameTable.isInside(offset)
+			|| vram.colorTable.isInside(offset)
+			|| vram.patternTable.isInside(offset);
+	}
+}
+
+void PixelRenderer::frameChange(EmuTime::param time)
+{
+	frameChanged = true;
+	if (frameDeferred) {
+		// Commands may have changed VRAM before this moment, this
+		// can in turn already start rendering via updateVRAM().
+		vram.sync(time);
+		if (frameDeferred) renderDeferredFrame(time);
+	}
+}
+
+void PixelRenderer::renderDeferredFrame(EmuTime::param time)
+{
+	assert(frameDeferred);
+	frameDeferred = false;
+	renderFrame = true;
+	frameSkipCounter = 0;
+
+	rasterizer->frameStart(frameStartTime);
+
+	// Replay the display enable changes seen so far.
+	bool enabled = displayEnabled;
+	displayEnabled = frameStartDisplayEnabled;
+	for (auto& e : enableEvents) {
+		renderUntil(e.time);
+		displayEnabled = e.enabled;
+	}
+	assert(displayEnabled == enabled); (void)enabled;
+	if (enableEvents.empty() || (enableEvents.back().time <= time)) {
+		renderUntil(time);
+	}
+}
+
 void PixelRenderer::updateVRAM(unsigned offset, EmuTime::param time)
 {
+	if (renderSettings.getAdaptiveFrameSkip() && affectsOutput(offset)) {
+		frameChanged = true;
+		// Called from within VDPVRAM, so don't sync it again.
+		if (frameDeferred) renderDeferredFrame(time);
+	}
 	// Note: No need to sync if display is disabled, because then the
 	//       output does not depend on VRAM (only on background color).
 	if (renderFrame && displayEnabled && checkSync(offset, time)) {
@@ -521,7 +696,8 @@ void PixelRenderer::sync(EmuTime::param time, bool force)
 	// the past.
 	// TODO: I wonder if it's possible to enforce this synchronisation
 	//       scheme at a higher level. Probably. But how...
-	//if ((frameSkipCounter == 0) && TODO
+	// Note: skipped (and deferred) frames already returned above, so
+	//       they don't sync VRAM at all.
 	if (accuracy != RenderSettings::ACC_SCREEN || force) {
 		vram.sync(time);
 		renderUntil(time);
@@ -563,6 +739,7 @@ void PixelRenderer::renderUntil(EmuTime::param time)
 	// Also it is a small performance optimisation.
 	if (limitX == nextX && limitY == nextY) return;
 
+	auto time1 = Timer::getTime();
 	if (displayEnabled) {
 		if (vdp.spritesEnabled()) {
 			// Update sprite checking, so that rasterizer can call getSprites.
@@ -595,6 +772,7 @@ void PixelRenderer::renderUntil(EmuTime::param time)
 		subdivide(nextX, nextY, limitX, limitY,
 			0, VDP::TICKS_PER_LINE, DRAW_BORDER);
 	}
+	renderDuration += Timer::getTime() - time1;
 
 	nextX = limitX;
 	nextY = limitY;
@@ -603,9 +781,19 @@ void PixelRenderer::renderUntil(EmuTime::param time)
 void PixelRenderer::update(const Setting& setting)
 {
 	if (&setting == &renderSettings.getMinFrameSkipSetting() ||
-	    &setting == &renderSettings.getMaxFrameSkipSetting()) {
+	    &setting == &renderSettings.getMaxFrameSkipSetting() ||
+	    &setting == &renderSettings.getAdaptiveFrameSkipSetting()) {
 		// Force drawing of frame.
 		frameSkipCounter = 999;
+		frameChanged = true;
+	} else if (&setting == &renderSettings.getGammaSetting() ||
+	           &setting == &renderSettings.getBrightnessSetting() ||
+	           &setting == &renderSettings.getContrastSetting() ||
+	           &setting == &renderSettings.getColorMatrixSetting() ||
+	           &setting == &renderSettings.getLimitSpritesSetting()) {
+		// Rasterizer output changes, don't skip the next frame
+		// because it's unchanged.
+		frameChanged = true;
 	} else {
 		UNREACHABLE;
 	}
@@ -4,8 +4,11 @@
 #include "Renderer.hh"
 #include "Observer.hh"
 #include "RenderSettings.hh"
+#include "EmuTime.hh"
 #include "openmsx.hh"
 #include <memory>
+#include <vector>
+#include <cstdint>
 
 namespace openmsx {
 
@@ -26,9 +29,27 @@ class VideoSourceSetting;
 class PixelRenderer final : public Renderer, private Observer<Setting>
 {
 public:
+	/** Counts how frames were handled, see 'machine_info <vdp>_frame_stats'.
+	  */
+	struct FrameStats {
+		FrameStats() : rendered(0), unchanged(0), throttled(0), savedTime(0) {}
+		/** Number of rasterized frames. */
+		unsigned rendered;
+		/** Number of skipped frames that were identical to the previous
+		  * frame (only with adaptive_frameskip). */
+		unsigned unchanged;
+		/** Number of skipped frames because emulation was behind
+		  * realtime (or because of minframeskip). */
+		unsigned throttled;
+		/** Estimated time not spent rasterizing (in us). */
+		uint64_t savedTime;
+	};
+
 	PixelRenderer(VDP& vdp, Display& display);
 	~PixelRenderer();
 
+	const FrameStats& getFrameStats() const { return stats; }
+
 	// Renderer interface:
 	PostProcessor* getPostProcessor() const override;
 	void reInit() override;
@@ -84,6 +105,23 @@ private:
 
 	inline bool checkSync(int offset, EmuTime::param time);
 
+	/** Can a write to the given VRAM offset change the output of this
+	  * or a later frame? Used to detect unchanged frames.
+	  */
+	bool affectsOutput(unsigned offset) const;
+
+	/** Something that influences the rendered image changes at the given
+	  * time. If rendering of the current frame was deferred, the frame
+	  * is now rendered up to that time.
+	  */
+	void frameChange(EmuTime::param time);
+
+	/** Start rendering a deferred frame and catch up until the given time.
+	  * Until that moment all VDP state (except for the recorded display
+	  * enable changes) was constant since the start of the frame.
+	  */
+	void renderDeferredFrame(EmuTime::param time);
+
 	/** Update renderer state to specified moment in time.
 	  * @param time Moment in emulated time to update to.
 	  * @param force When screen accuracy is used,
@@ -121,6 +159,30 @@ private:
 	float finishFrameDuration;
 	int frameSkipCounter;
 
+	/** Average time needed to rasterize one frame (in us). */
+	float renderFrameDuration;
+	/** Time spent rasterizing the current frame so far (in us). */
+	uint64_t renderDuration;
+
+	FrameStats stats;
+
+	/** A change of the display enable state, see updateDisplayEnabled().
+	  * With adaptive_frameskip these are compared against the previous
+	  * frame, because they happen in every frame.
+	  */
+	struct DisplayEnableEvent {
+		DisplayEnableEvent(EmuTime::param time_, int ticks_, bool enabled_)
+			: time(time_), ticks(ticks_), enabled(enabled_) {}
+		EmuTime time;
+		int ticks;
+		bool enabled;
+	};
+	std::vector<DisplayEnableEvent> enableEvents;
+	std::vector<DisplayEnableEvent> prevEnableEvents;
+
+	/** Start of the current frame. */
+	EmuTime frameStartTime;
+
 	/** Number of the next position within a line to render.
 	  * Expressed in VDP clock ticks since start of line.
 	  */
@@ -148,6 +210,28 @@ private:
 	  */
 	bool renderFrame;
 	bool prevRenderFrame;
+
+	/** Adaptive frameskip only: rendering of the current frame is
+	  * postponed until something changes. If nothing changes, the frame
+	  * is identical to the previous one and it's skipped.
+	  */
+	bool frameDeferred;
+
+	/** Display enable state at the start of the current frame. */
+	bool frameStartDisplayEnabled;
+
+	/** Did anything change since the start of the previous frame? */
+	bool frameChanged;
+
+	/** Does the last rasterized frame still show the previous frame?
+	  * False when the previous frame was skipped because of throttling.
+	  */
+	bool prevFrameShown;
+
+	// Per frame state that isn't signaled via the update methods.
+	bool prevPalTiming;
+	bool prevDisableSprites;
+	bool prevIndexedFrames;
 };
 
 } // namespace openmsx
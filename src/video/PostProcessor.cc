@@ -18,7 +18,6 @@
 #include "MemBuffer.hh"
 #include "vla.hh"
 #include "memory.hh"
-#include "likely.hh"
 #include "build-info.hh"
 #include <algorithm>
 #include <cassert>
@@ -26,6 +25,10 @@
 
 namespace openmsx {
 
+// lastFrames[] plus the frame the rasterizer is working on. More frames are
+// only needed when some of them are still used elsewhere (e.g. recording).
+static const unsigned FRAME_POOL_CAPACITY = 4 + 1;
+
 PostProcessor::PostProcessor(MSXMotherBoard& motherBoard_,
 	Display& display_, OutputSurface& screen_, const std::string& videoSource,
 	unsigned maxWidth_, unsigned height_, bool canDoInterlace_)
@@ -33,14 +36,15 @@ PostProcessor::PostProcessor(MSXMotherBoard& motherBoard_,
 	, Schedulable(motherBoard_.getScheduler())
 	, renderSettings(display_.getRenderSettings())
 	, screen(screen_)
+	, framePool(screen.getSDLFormat(), maxWidth_, height_,
+	            canDoInterlace_ ? FRAME_POOL_CAPACITY : 1)
+	, lastFrames(framePool, !canDoInterlace_)
 	, paintFrame(nullptr)
 	, recorder(nullptr)
 	, superImposeVideoFrame(nullptr)
 	, superImposeVdpFrame(nullptr)
+	, skippedLines(0)
 	, interleaveCount(0)
-	, lastFramesCount(0)
-	, maxWidth(maxWidth_)
-	, height(height_)
 	, display(display_)
 	, canDoInterlace(canDoInterlace_)
 	, lastRotate(motherBoard_.getCurrentTime())
@@ -52,7 +56,7 @@ PostProcessor::PostProcessor(MSXMotherBoard& motherBoard_,
 		interlacedFrame   = make_unique<DoubledFrame>(
 			screen.getSDLFormat());
 		deflicker = Deflicker::create(
-			screen.getSDLFormat(), lastFrames);
+			screen.getSDLFormat(), lastFrames.data());
 		superImposedFrame = SuperImposedFrame::create(
 			screen.getSDLFormat());
 	} else {
@@ -90,8 +94,8 @@ unsigned PostProcessor::getLineWidth(
 	return result;
 }
 
-std::unique_ptr<RawFrame> PostProcessor::rotateFrames(
-	std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time)
+RawFramePool::Ref PostProcessor::rotateFrames(
+	RawFramePool::Ref finishedFrame, EmuTime::param time)
 {
 	if (renderSettings.getInterleaveBlackFrame()) {
 		auto delta = time - lastRotate; // time between last two calls
@@ -121,34 +125,8 @@ std::unique_ptr<RawFrame> PostProcessor::rotateFrames(
 		}
 	}
 
-	// Which frame can be returned (recycled) to caller. Prefer to return
-	// the youngest frame to improve cache locality.
-	int recycleIdx = (lastFramesCount < numRequired)
-		? lastFramesCount++  // store one more
-		: (numRequired - 1); // youngest that's no longer needed
-	assert(recycleIdx < 4);
-	auto recycleFrame = std::move(lastFrames[recycleIdx]); // might be nullptr
-
-	// Insert new frame in front of lastFrames[], shift older frames
-	std::move_backward(lastFrames, lastFrames + recycleIdx,
-	                   lastFrames + recycleIdx + 1);
-	lastFrames[0] = std::move(finishedFrame);
-
-	// Are enough frames available?
-	if (lastFramesCount >= numRequired) {
-		// Only the last 'numRequired' are kept up to date.
-		lastFramesCount = numRequired;
-	} else {
+	if (!lastFrames.insert(std::move(finishedFrame), numRequired)) {
 		// Not enough past frames, fall back to 'regular' rendering.
-		// This situation can only occur when:
-		// - The very first frame we render needs to be deinterlaced.
-		//   In other case we have at least one valid frame from the
-		//   past plus one new frame passed via the 'finishedFrame'
-		//   parameter.
-		// - Or when (re)enabling the deflicker setting. Typically only
-		//   1 frame in lastFrames[] is kept up-to-date (and we're
-		//   given 1 new frame), so it can take up-to 2 frame after
-		//   enabling deflicker before it actually takes effect.
 		doDeinterlace = false;
 		doInterlace   = false;
 		doDeflicker   = false;
@@ -181,7 +159,15 @@ std::unique_ptr<RawFrame> PostProcessor::rotateFrames(
 	// Possibly record this frame
 	if (recorder && needRecord()) {
 		try {
-			recorder->addImage(paintFrame, time);
+			// A frame in lastFrames[] doesn't change while it's
+			// referenced, so the recorder can use it without a
+			// copy (except for laserdisc, which keeps drawing in
+			// the displayed frame).
+			RawFramePool::Ref rawFrame;
+			if (canDoInterlace && (paintFrame == lastFrames[0].get())) {
+				rawFrame = lastFrames[0];
+			}
+			recorder->addImage(paintFrame, std::move(rawFrame), time);
 		} catch (MSXException& e) {
 			getCliComm().printWarning(
 				"Recording stopped with error: " +
@@ -192,15 +178,7 @@ std::unique_ptr<RawFrame> PostProcessor::rotateFrames(
 	}
 
 	// Return recycled frame to the caller
-	if (canDoInterlace) {
-		if (unlikely(!recycleFrame)) {
-			recycleFrame = make_unique<RawFrame>(
-				screen.getSDLFormat(), maxWidth, height);
-		}
-		return recycleFrame;
-	} else {
-		return std::move(lastFrames[0]);
-	}
+	return lastFrames.next();
 }
 
 void PostProcessor::executeUntil(EmuTime::param /*time*/)
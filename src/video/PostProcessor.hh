@@ -2,6 +2,7 @@
 #define POSTPROCESSOR_HH
 
 #include "FrameSource.hh"
+#include "FrameRotation.hh"
 #include "VideoLayer.hh"
 #include "Schedulable.hh"
 #include "EmuTime.hh"
@@ -12,7 +13,6 @@ namespace openmsx {
 
 class Display;
 class RenderSettings;
-class RawFrame;
 class DeinterlacedFrame;
 class DoubledFrame;
 class Deflicker;
@@ -42,8 +42,13 @@ public:
 	  *             PAL/NTSC, frameskip).
 	  * @return RawFrame object that can be used for building the next frame.
 	  */
-	virtual std::unique_ptr<RawFrame> rotateFrames(
-		std::unique_ptr<RawFrame> finishedFrame, EmuTime::param time);
+	virtual RawFramePool::Ref rotateFrames(
+		RawFramePool::Ref finishedFrame, EmuTime::param time);
+
+	/** Get a frame to build the first frame in, the following ones are
+	  * returned by rotateFrames().
+	  */
+	RawFramePool::Ref acquireFrame() { return framePool.acquire(); }
 
 	/** Set the Video frame on which to superimpose the 'normal' output of
 	  * this PostProcessor. Superimpose is done (preferably) after the
@@ -87,6 +92,13 @@ public:
 	  */
 	FrameSource* getPaintFrame() const { return paintFrame; }
 
+	/** The number of output lines in the last painted frame that were
+	  * not scaled again because that part of the MSX frame didn't change
+	  * (only the SDL post processor does this, see 'openmsx_info
+	  * skipped_lines').
+	  */
+	unsigned getSkippedLines() const { return skippedLines; }
+
 	// VideoLayer
 	void takeRawScreenShot(unsigned height, const std::string& filename) override;
 
@@ -109,8 +121,11 @@ protected:
 	/** The surface which is visible to the user. */
 	OutputSurface& screen;
 
+	/** All RawFrame objects are (re)used from this pool. */
+	RawFramePool framePool;
+
 	/** The last 4 fully rendered (unscaled) MSX frames. */
-	std::unique_ptr<RawFrame> lastFrames[4];
+	FrameRotation lastFrames;
 
 	/** Combined the last two frames in a deinterlaced frame. */
 	std::unique_ptr<DeinterlacedFrame> deinterlacedFrame;
@@ -138,10 +153,8 @@ protected:
 	const RawFrame* superImposeVideoFrame;
 	const FrameSource* superImposeVdpFrame;
 
+	unsigned skippedLines; // see getSkippedLines()
 	int interleaveCount; // for interleave-black-frame
-	int lastFramesCount; // How many items in lastFrames[] are up-to-date
-	int maxWidth; // we lazily create RawFrame objects in lastFrames[]
-	int height;   // these two vars remember how big those should be
 
 private:
 	// Schedulable
@@ -1,14 +1,26 @@
 #include "RawFrame.hh"
+#include "aligned.hh"
+#include "unreachable.hh"
+#include <algorithm>
 #include <cstdint>
 #include <SDL.h>
 
 namespace openmsx {
 
+// Used by getLineInfo() for indexed lines that don't fit in the buffer of
+// the caller. This can be called from several (scaler) threads at once.
+ALIGNED(static thread_local uint32_t convertBuffer[1280], 64);
+
+// Palette for lines of an indexed frame that weren't drawn at all.
+static const uint32_t blackPalette[256] = {};
+
 RawFrame::RawFrame(
 		const SDL_PixelFormat& format, unsigned maxWidth_, unsigned height_)
 	: FrameSource(format)
 	, lineWidths(height_)
 	, maxWidth(maxWidth_)
+	, linePalettes(height_)
+	, indexed(false)
 {
 	setHeight(height_);
 	unsigned bytesPerPixel = format.BytesPerPixel;
@@ -32,6 +44,69 @@ RawFrame::RawFrame(
 	}
 }
 
+void RawFrame::setIndexed(bool enabled)
+{
+	indexed = enabled;
+	if (!indexed) return;
+	palettes.clear();
+	std::fill(linePalettes.data(), linePalettes.data() + getHeight(),
+	          uint16_t(NO_PALETTE));
+}
+
+unsigned RawFrame::addPalette(const uint32_t* colors)
+{
+	assert(indexed);
+	unsigned id = numPalettes();
+	if (id == NO_PALETTE) return NO_PALETTE;
+	palettes.insert(palettes.end(), colors, colors + 256);
+	return id;
+}
+
+const uint32_t* RawFrame::getLinePaletteColors(unsigned line) const
+{
+	if (palettes.empty()) return blackPalette;
+	unsigned id = linePalettes[line];
+	if (id == NO_PALETTE) id = 0; // content is undefined anyway
+	return &palettes[256 * id];
+}
+
+template<typename Pixel>
+static void convertIndices(const byte* in, Pixel* out, unsigned width,
+                           const uint32_t* palette)
+{
+	// Back to front, so that this also works in place.
+	for (unsigned i = width; i--; ) {
+		out[i] = Pixel(palette[in[i]]);
+	}
+}
+
+void RawFrame::convertLine(unsigned line, void* out, unsigned width) const
+{
+	auto* in = reinterpret_cast<const byte*>(data.data() + line * pitch);
+	const uint32_t* palette = getLinePaletteColors(line);
+	switch (getSDLPixelFormat().BytesPerPixel) {
+	case 2:
+		convertIndices(in, static_cast<uint16_t*>(out), width, palette);
+		break;
+	case 4:
+		convertIndices(in, static_cast<uint32_t*>(out), width, palette);
+		break;
+	default:
+		UNREACHABLE;
+	}
+}
+
+void RawFrame::convertToHost()
+{
+	if (!indexed) return;
+	// Lines that are still being drawn can already be wider than their
+	// current line width, so convert the full lines.
+	for (unsigned line = 0; line < getHeight(); ++line) {
+		convertLine(line, data.data() + line * pitch, maxWidth);
+	}
+	indexed = false;
+}
+
 unsigned RawFrame::getLineWidth(unsigned line) const
 {
 	assert(line < getHeight());
@@ -40,11 +115,20 @@ unsigned RawFrame::getLineWidth(unsigned line) const
 
 const void* RawFrame::getLineInfo(
 	unsigned line, unsigned& width,
-	void* /*buf*/, unsigned /*bufWidth*/) const
+	void* buf, unsigned bufWidth) const
 {
 	assert(line < getHeight());
 	width = lineWidths[line];
-	return data.data() + line * pitch;
+	if (!indexed) {
+		return data.data() + line * pitch;
+	}
+	if (width > bufWidth) {
+		// The caller scales the line down into its own buffer.
+		assert(width <= 1280);
+		buf = convertBuffer;
+	}
+	convertLine(line, buf, width);
+	return buf;
 }
 
 unsigned RawFrame::getRowLength() const
@@ -54,7 +138,8 @@ unsigned RawFrame::getRowLength() const
 
 bool RawFrame::hasContiguousStorage() const
 {
-	return true;
+	// Indexed lines are converted one at a time.
+	return !indexed;
 }
 
 } // namespace openmsx
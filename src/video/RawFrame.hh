@@ -5,6 +5,8 @@
 #include "MemBuffer.hh"
 #include "openmsx.hh"
 #include <cassert>
+#include <cstdint>
+#include <vector>
 
 namespace openmsx {
 
@@ -21,10 +23,20 @@ struct V9958RasterizerBorderInfo
 
 /** A video frame as output by the VDP scanline conversion unit,
   * before any postprocessing filters are applied.
+  *
+  * Normally a frame stores host pixels. A frame can also be switched to
+  * indexed mode, then each pixel is a byte that indexes a palette of 256
+  * host colors. Each line refers to one of the palette snapshots that
+  * were added to the frame, so the palette can change in between lines.
+  * The indices are only converted to host pixels when the lines are read
+  * via the FrameSource interface.
   */
 class RawFrame final : public FrameSource
 {
 public:
+	/** Line isn't drawn as indices (yet), see getLinePalette(). */
+	static const unsigned NO_PALETTE = 0xFFFF;
+
 	RawFrame(const SDL_PixelFormat& format, unsigned maxWidth, unsigned height);
 
 	template<typename Pixel>
@@ -50,6 +62,66 @@ public:
 		lineWidths[line] = 1;
 	}
 
+	/** Select whether this frame is drawn as palette indices or as host
+	  * pixels. Should be called before drawing a new frame, because the
+	  * content becomes undefined. In indexed mode, this removes all palette
+	  * snapshots and marks all lines as not drawn.
+	  */
+	void setIndexed(bool enabled);
+
+	/** Is this frame (still) drawn as palette indices? */
+	bool isIndexed() const { return indexed; }
+
+	/** Add a snapshot of 256 host colors (as 16 or 32 bit values,
+	  * depending on the pixel format).
+	  * @return The id of the snapshot, or NO_PALETTE when there are
+	  *         already too many snapshots in this frame.
+	  */
+	unsigned addPalette(const uint32_t* colors);
+
+	/** The palette snapshot of the given line, or NO_PALETTE when the
+	  * line wasn't drawn as indices yet in this frame. */
+	unsigned getLinePalette(unsigned line) const {
+		assert(line < getHeight());
+		return linePalettes[line];
+	}
+
+	void setLinePalette(unsigned line, unsigned id) {
+		assert(line < getHeight());
+		assert(id < numPalettes());
+		linePalettes[line] = id;
+	}
+
+	/** The palette indices of the given line of an indexed frame,
+	  * getLineWidthDirect(y) bytes. */
+	const byte* getIndexLinePtr(unsigned y) const {
+		assert(indexed);
+		return reinterpret_cast<const byte*>(data.data() + y * pitch);
+	}
+
+	/** The 256 host colors that the indices of the given line refer to
+	  * (the same pointer for lines with the same palette snapshot). */
+	const uint32_t* getLinePaletteColors(unsigned line) const;
+
+	/** Convert all indices in this frame to host pixels (in place), from
+	  * then on this frame is a regular frame. Used when a frame can't be
+	  * finished as indices, e.g. when switching to a YJK mode.
+	  */
+	void convertToHost();
+
+	/** Like getLinePtrDirect(), but an indexed line is first converted to
+	  * host pixels in the given buffer (which must hold at least
+	  * getLineWidthDirect(y) pixels).
+	  */
+	template<typename Pixel>
+	const Pixel* getHostLinePtr(unsigned y, Pixel* buf) const {
+		if (!indexed) {
+			return reinterpret_cast<const Pixel*>(data.data() + y * pitch);
+		}
+		convertLine(y, buf, lineWidths[y]);
+		return buf;
+	}
+
 	unsigned getRowLength() const override;
 
 	// RawFrame is mostly agnostic of the border info struct. The only
@@ -64,11 +136,21 @@ protected:
 	bool hasContiguousStorage() const override;
 
 private:
+	unsigned numPalettes() const {
+		return unsigned(palettes.size() / 256);
+	}
+	void convertLine(unsigned line, void* out, unsigned width) const;
+
 	MemBuffer<char, 64> data;
 	MemBuffer<unsigned> lineWidths;
 	unsigned maxWidth;
 	unsigned pitch;
 
+	// Only used in indexed mode.
+	std::vector<uint32_t> palettes; // 256 host colors per snapshot
+	MemBuffer<uint16_t> linePalettes;
+	bool indexed;
+
 	V9958RasterizerBorderInfo borderInfo;
 };
 
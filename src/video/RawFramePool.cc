@@ -0,0 +1,57 @@
+#include "RawFramePool.hh"
+#include "memory.hh"
+#include <cassert>
+
+namespace openmsx {
+
+RawFramePool::Entry::Entry(
+		const SDL_PixelFormat& format, unsigned maxWidth, unsigned height)
+	: frame(format, maxWidth, height)
+	, refCount(0)
+{
+}
+
+
+RawFramePool::RawFramePool(const SDL_PixelFormat& format_,
+                           unsigned maxWidth_, unsigned height_,
+                           unsigned capacity)
+	: format(format_)
+	, maxWidth(maxWidth_)
+	, height(height_)
+{
+	entries.reserve(capacity);
+}
+
+RawFramePool::~RawFramePool()
+{
+#ifndef NDEBUG
+	// All Refs must be dropped before the pool is destroyed.
+	for (auto& e : entries) {
+		assert(e->refCount == 0);
+	}
+#endif
+}
+
+RawFramePool::Entry& RawFramePool::allocate()
+{
+	entries.push_back(make_unique<Entry>(format, maxWidth, height));
+	return *entries.back();
+}
+
+RawFramePool::Ref RawFramePool::acquire()
+{
+	// Only this thread can take a frame that's not in use, so a frame
+	// that is seen as free stays free. Other threads can only drop
+	// their references.
+	for (auto& e : entries) {
+		if (e->refCount == 0) {
+			e->refCount = 1;
+			return Ref(e.get());
+		}
+	}
+	auto& e = allocate();
+	e.refCount = 1;
+	return Ref(&e);
+}
+
+} // namespace openmsx
@@ -0,0 +1,112 @@
+#ifndef RAWFRAMEPOOL_HH
+#define RAWFRAMEPOOL_HH
+
+#include "RawFrame.hh"
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace openmsx {
+
+/** A set of RawFrame objects that are reused instead of being allocated
+  * for each emulated frame.
+  *
+  * A frame is handed out as a (reference counted) Ref. Several Refs can
+  * point to the same frame, e.g. the frame that's being displayed can at
+  * the same time be used by the video recorder, without making a copy.
+  * When the last Ref to a frame is dropped, the frame goes back to the
+  * pool and it can be returned by a later acquire() call.
+  *
+  * acquire() may only be called from one thread (the emulation thread),
+  * but Refs may be copied and dropped from any thread.
+  */
+class RawFramePool
+{
+	struct Entry;
+
+public:
+	/** Shared ownership of one frame of the pool. */
+	class Ref
+	{
+	public:
+		Ref() : entry(nullptr) {}
+		Ref(const Ref& other) : entry(other.entry) {
+			if (entry) ++entry->refCount;
+		}
+		Ref(Ref&& other) noexcept : entry(other.entry) {
+			other.entry = nullptr;
+		}
+		Ref& operator=(Ref other) {
+			std::swap(entry, other.entry);
+			return *this;
+		}
+		~Ref() { reset(); }
+
+		/** Drop this reference, afterwards this Ref is empty. */
+		void reset() {
+			if (entry) {
+				--entry->refCount;
+				entry = nullptr;
+			}
+		}
+
+		RawFrame* get() const { return entry ? &entry->frame : nullptr; }
+		RawFrame& operator*() const { return entry->frame; }
+		RawFrame* operator->() const { return &entry->frame; }
+		explicit operator bool() const { return entry != nullptr; }
+
+		/** Is this the only reference to the frame? Only meaningful
+		  * for the thread that owns this Ref. */
+		bool unique() const { return entry && (entry->refCount == 1); }
+
+	private:
+		explicit Ref(Entry* entry_) : entry(entry_) {}
+
+		Entry* entry;
+		friend class RawFramePool;
+	};
+
+	/** Creates a pool for frames of the given format and size.
+	  * Frames are allocated lazily, the first time they're needed.
+	  * @param capacity The maximum number of frames that are normally in
+	  *                 use at the same time. When more frames are
+	  *                 needed anyway, the pool grows.
+	  */
+	RawFramePool(const SDL_PixelFormat& format,
+	             unsigned maxWidth, unsigned height, unsigned capacity);
+	~RawFramePool();
+
+	RawFramePool(const RawFramePool&) = delete;
+	RawFramePool& operator=(const RawFramePool&) = delete;
+
+	/** Get an unused frame from the pool. Only allocates a new frame
+	  * when all frames are in use. The content of the frame is
+	  * undefined. */
+	Ref acquire();
+
+	/** The number of frames in the pool, that is the number of frames
+	  * that were allocated so far (frames are never freed before the
+	  * pool itself). */
+	unsigned getNumFrames() const { return unsigned(entries.size()); }
+
+private:
+	struct Entry {
+		Entry(const SDL_PixelFormat& format, unsigned maxWidth,
+		      unsigned height);
+
+		RawFrame frame;
+		std::atomic<unsigned> refCount;
+	};
+
+	Entry& allocate();
+
+	std::vector<std::unique_ptr<Entry>> entries;
+	const SDL_PixelFormat& format;
+	const unsigned maxWidth;
+	const unsigned height;
+};
+
+} // namespace openmsx
+
+#endif
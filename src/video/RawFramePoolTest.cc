@@ -0,0 +1,169 @@
+// Checks that the frame rotation of the PostProcessor (FrameRotation, with the
+// rasterizer and possibly the video recorder holding on to frames) doesn't
+// allocate new frames once the pool has grown to its steady-state size, and
+// that the frame given back to the rasterizer is not in use elsewhere.
+
+#include "FrameRotation.hh"
+#include "RawFramePool.hh"
+#include "TestFrames.hh"
+#include <SDL.h>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+
+using namespace openmsx;
+using namespace openmsx::testframes;
+
+static const unsigned FRAME_POOL_CAPACITY = 4 + 1; // as in PostProcessor
+
+static int result = 0;
+
+static void check(bool ok, const std::string& test, const char* what)
+{
+	if (!ok) {
+		std::cout << "FAILED: " << test << ": " << what << std::endl;
+		result = 1;
+	}
+}
+
+static void report(const std::string& test, unsigned warmupFrames,
+                   const RawFramePool& pool)
+{
+	std::cout << test << ": " << pool.getNumFrames() << " frames, "
+	          << (pool.getNumFrames() - warmupFrames)
+	          << " allocations in steady state" << std::endl;
+	check(pool.getNumFrames() == warmupFrames, test,
+	      "allocates in steady state");
+}
+
+// Normal rendering, deinterlace and deflicker keep 1, 2 or 4 last frames.
+static void testRotation(const std::string& test, int numRequired)
+{
+	SDL_PixelFormat format = createFormat<uint32_t>();
+	RawFramePool pool(format, 640, 240, FRAME_POOL_CAPACITY);
+	{
+		FrameRotation lastFrames(pool, false);
+		auto work = pool.acquire();
+		unsigned warmup = 0;
+		bool enough = true;
+		bool unique = true;
+		for (int frame = 0; frame < 1000; ++frame) {
+			work->setBlank(0, uint32_t(frame));
+			bool ok = lastFrames.insert(std::move(work), numRequired);
+			if (frame >= (numRequired - 1)) enough &= ok;
+			work = lastFrames.next();
+			unique &= work.unique();
+			if (frame == 10) warmup = pool.getNumFrames();
+		}
+		check(enough, test, "not enough last frames");
+		check(unique, test, "returned frame is still in use");
+		report(test, warmup, pool);
+	}
+	check(pool.getNumFrames() <= unsigned(numRequired + 1), test,
+	      "too many frames");
+}
+
+// Enabling deflicker: it takes up to 2 frames before there are 4 last frames.
+static void testSwitch()
+{
+	const std::string test = "enable deflicker";
+	SDL_PixelFormat format = createFormat<uint32_t>();
+	RawFramePool pool(format, 640, 240, FRAME_POOL_CAPACITY);
+	FrameRotation lastFrames(pool, false);
+	auto work = pool.acquire();
+	unsigned fallbacks = 0;
+	bool unique = true;
+	for (unsigned frame = 0; frame < 300; ++frame) {
+		int numRequired = ((frame / 100) == 1) ? 4 : 1;
+		if (!lastFrames.insert(std::move(work), numRequired)) {
+			++fallbacks;
+		}
+		work = lastFrames.next();
+		unique &= work.unique();
+	}
+	check(fallbacks == 2, test, "wrong number of fallback frames");
+	check(unique, test, "returned frame is still in use");
+	check(pool.getNumFrames() <= FRAME_POOL_CAPACITY, test,
+	      "too many frames");
+}
+
+// The recorder holds on to a few frames, and drops them on another thread.
+// The frames it still holds are not recycled.
+static void testRecording()
+{
+	const std::string test = "recording";
+	SDL_PixelFormat format = createFormat<uint32_t>();
+	RawFramePool pool(format, 640, 240, FRAME_POOL_CAPACITY);
+	FrameRotation lastFrames(pool, false);
+	auto work = pool.acquire();
+	std::deque<RawFramePool::Ref> queue;
+	unsigned warmup = 0;
+	bool unique = true;
+	for (unsigned frame = 0; frame < 1000; ++frame) {
+		work->setBlank(0, uint32_t(frame));
+		lastFrames.insert(std::move(work), 1);
+		queue.push_back(lastFrames[0]);
+		if (queue.size() == 3) {
+			auto ref = std::move(queue.front());
+			queue.pop_front();
+			std::thread([&ref] { ref.reset(); }).join();
+		}
+		work = lastFrames.next();
+		unique &= work.unique();
+		if (frame == 10) warmup = pool.getNumFrames();
+	}
+	check(unique, test, "returned frame is still in use");
+	report(test, warmup, pool);
+}
+
+// Laserdisc keeps drawing in the displayed frame, it needs only one frame.
+static void testLaserdisc()
+{
+	const std::string test = "laserdisc";
+	SDL_PixelFormat format = createFormat<uint32_t>();
+	RawFramePool pool(format, 640, 240, 1);
+	FrameRotation lastFrames(pool, true);
+	auto work = pool.acquire();
+	bool same = true;
+	for (unsigned frame = 0; frame < 100; ++frame) {
+		work->setBlank(0, uint32_t(frame));
+		check(lastFrames.insert(std::move(work), 1), test,
+		      "not enough last frames");
+		work = lastFrames.next();
+		same &= work.get() == lastFrames[0].get();
+	}
+	check(same, test, "doesn't return the displayed frame");
+	check(pool.getNumFrames() == 1, test, "more than one frame");
+}
+
+// Copies share the frame, the frame returns to the pool when the last copy
+// is dropped.
+static void testRefs()
+{
+	const std::string test = "refs";
+	SDL_PixelFormat format = createFormat<uint32_t>();
+	RawFramePool pool(format, 640, 240, 1);
+	auto a = pool.acquire();
+	RawFrame* frame = a.get();
+	auto b = a;
+	check(!a.unique() && !b.unique(), test, "copy is unique");
+	a.reset();
+	check(b.unique(), test, "last copy is not unique");
+	check(pool.acquire().get() != frame, test, "frame in use is reused");
+	b.reset();
+	check(pool.acquire().get() == frame, test, "free frame is not reused");
+	check(pool.getNumFrames() == 2, test, "wrong number of frames");
+}
+
+int main()
+{
+	testRotation("normal", 1);
+	testRotation("deinterlace", 2);
+	testRotation("deflicker", 4);
+	testSwitch();
+	testRecording();
+	testLaserdisc();
+	testRefs();
+	return result;
+}
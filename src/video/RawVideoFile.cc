@@ -0,0 +1,536 @@
+#include "RawVideoFile.hh"
+#include "RawFrame.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "ThreadPool.hh"
+#include "memory.hh"
+#include "unreachable.hh"
+#include "build-info.hh"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cassert>
+
+namespace openmsx {
+
+using namespace RawVideoFile;
+
+static const unsigned VERSION = 1;
+static const unsigned MAX_WIDTH = 1280; // see PostProcessor
+static const unsigned MAX_HEIGHT = 1024;
+
+static inline size_t pad4(size_t size)
+{
+	return (size + 3) & ~3;
+}
+
+static size_t getPartSizes(unsigned height, unsigned numColors,
+                           size_t numPixels, unsigned samples,
+                           unsigned pixelSize)
+{
+	return sizeof(FrameHeader)
+	     + pad4(height * sizeof(uint16_t))
+	     + pad4(numColors * pixelSize)
+	     + pad4(numPixels * (numColors ? 1 : pixelSize))
+	     + pad4(samples * sizeof(int16_t));
+}
+
+// Collects the (at most 256) different colors of a frame in a palette.
+template<typename Pixel> class PaletteBuilder
+{
+public:
+	explicit PaletteBuilder(Pixel* palette_)
+		: palette(palette_), numColors(0)
+	{
+		std::fill_n(table, TABLE_SIZE, -1);
+	}
+
+	/** The index of the given color in the palette, the color is added
+	  * when it's new. Returns -1 when there are already 256 colors. */
+	int getIndex(Pixel p)
+	{
+		unsigned h = (uint32_t(p) * 0x9E3779B1u) >> (32 - HASH_BITS);
+		while (true) {
+			int16_t idx = table[h];
+			if (idx == -1) {
+				if (numColors == 256) return -1;
+				palette[numColors] = p;
+				table[h] = idx = numColors++;
+			}
+			if (palette[idx] == p) return idx;
+			h = (h + 1) & (TABLE_SIZE - 1);
+		}
+	}
+
+	unsigned getNumColors() const { return numColors; }
+
+private:
+	static const unsigned HASH_BITS = 10;
+	static const unsigned TABLE_SIZE = 1 << HASH_BITS;
+	int16_t table[TABLE_SIZE];
+	Pixel* palette;
+	unsigned numColors;
+};
+
+// Finds the (at most 256) different colors in the given pixels.
+// Returns the number of colors, or 0 when there are too many.
+template<typename Pixel>
+static unsigned createPalette(const Pixel* pixels, size_t num,
+                              Pixel* palette, uint8_t* indices)
+{
+	PaletteBuilder<Pixel> builder(palette);
+	Pixel prev = 0;
+	uint8_t prevIdx = 0;
+	for (size_t i = 0; i < num; ++i) {
+		Pixel p = pixels[i];
+		if ((p == prev) && (i != 0)) {
+			// most neighbouring pixels have the same color
+			indices[i] = prevIdx;
+			continue;
+		}
+		int idx = builder.getIndex(p);
+		if (idx == -1) return 0;
+		prev = p;
+		prevIdx = uint8_t(idx);
+		indices[i] = prevIdx;
+	}
+	return builder.getNumColors();
+}
+
+
+// class RawVideoWriter
+
+RawVideoWriter::RawVideoWriter(const Filename& filename, unsigned channels_,
+                               unsigned freq)
+	: file(filename, "wb")
+	, format(nullptr)
+	, fps(0.0f) // will be filled in later
+	, channels(channels_)
+	, frequency(freq)
+	, writer(make_unique<ThreadPool>(1))
+{
+	// Filled in when the recording stops.
+	Header header;
+	memset(&header, 0, sizeof(header));
+	file.write(&header, sizeof(header));
+}
+
+RawVideoWriter::~RawVideoWriter()
+{
+	queue.waitAll();
+	writer.reset();
+
+	if (queue.getNumFrames() == 0) {
+		// no data written yet (a recording less than one video frame)
+		std::string filename = file.getURL();
+		file.close(); // close file (needed for windows?)
+		FileOperations::unlink(filename);
+		return;
+	}
+	try {
+		writeHeader();
+	} catch (MSXException&) {
+		// can't throw from destructor
+	}
+}
+
+void RawVideoWriter::writeHeader()
+{
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "OMRV", 4);
+	header.version = VERSION;
+	header.bpp = format->BitsPerPixel;
+	header.rmask = format->Rmask;
+	header.gmask = format->Gmask;
+	header.bmask = format->Bmask;
+	header.amask = format->Amask;
+	header.rshift = format->Rshift;
+	header.gshift = format->Gshift;
+	header.bshift = format->Bshift;
+	header.ashift = format->Ashift;
+	header.rloss = format->Rloss;
+	header.gloss = format->Gloss;
+	header.bloss = format->Bloss;
+	header.aloss = format->Aloss;
+	header.channels = channels;
+	header.frequency = frequency;
+	header.frames = queue.getNumFrames();
+	header.fps = unsigned(fps * 1000000);
+	file.seek(0);
+	file.write(&header, sizeof(header));
+}
+
+bool RawVideoWriter::addFrame(FrameSource* frame, RawFramePool::Ref rawFrame,
+                              unsigned samples, int16_t* sampleData)
+{
+	bool stalled;
+	unsigned frameNum = queue.startFrame(stalled);
+	auto& slot = slots[frameNum % FrameQueue::SIZE];
+
+	if (!format) format = &frame->getSDLPixelFormat();
+	assert(frame->getSDLPixelFormat().BytesPerPixel == format->BytesPerPixel);
+	if (rawFrame) {
+		// Pool frames don't change anymore, copy them on the writer
+		// thread.
+		slot.rawFrame = std::move(rawFrame);
+	} else {
+		switch (format->BytesPerPixel) {
+#if HAVE_16BPP
+		case 2:
+			capture<uint16_t>(*frame, slot);
+			break;
+#endif
+#if HAVE_32BPP
+		case 4:
+			capture<uint32_t>(*frame, slot);
+			break;
+#endif
+		default:
+			UNREACHABLE;
+		}
+	}
+	if (samples) {
+		assert((samples % channels) == 0);
+		assert(frequency != 0);
+	}
+	slot.audio.assign(sampleData, sampleData + samples);
+
+	queue.setDone(frameNum,
+	              writer->enqueue([this, &slot]() { write(slot); }));
+	return stalled;
+}
+
+template<typename Pixel>
+void RawVideoWriter::capture(FrameSource& frame, Slot& slot)
+{
+	unsigned height = frame.getHeight();
+	slot.field = frame.getField();
+	slot.widths.resize(height);
+	size_t numPixels = 0;
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned width = frame.getLineWidth(y);
+		slot.widths[y] = width;
+		numPixels += width;
+	}
+	slot.lines.resize(numPixels * sizeof(Pixel));
+	auto* dst = reinterpret_cast<Pixel*>(slot.lines.data());
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned width = slot.widths[y];
+		// only uses 'dst' as buffer when the line isn't stored in the
+		// requested width
+		const Pixel* src = frame.getLinePtr(y, width, dst);
+		if (src != dst) memcpy(dst, src, width * sizeof(Pixel));
+		dst += width;
+	}
+}
+
+template<typename Pixel>
+unsigned RawVideoWriter::captureIndexed(const RawFrame& frame, Slot& slot,
+                                        Pixel* palette)
+{
+	unsigned height = frame.getHeight();
+	slot.field = frame.getField();
+	slot.widths.resize(height);
+	size_t numPixels = 0;
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned width = frame.getLineWidthDirect(y);
+		slot.widths[y] = width;
+		numPixels += width;
+	}
+	indices.resize(numPixels);
+
+	// Lines can refer to different palette snapshots, map the indices of
+	// each snapshot to the one palette of the recorded frame.
+	PaletteBuilder<Pixel> builder(palette);
+	const uint32_t* colors = nullptr;
+	int remap[256];
+	uint8_t* dst = indices.data();
+	for (unsigned y = 0; y < height; ++y) {
+		auto* lineColors = frame.getLinePaletteColors(y);
+		if (lineColors != colors) {
+			colors = lineColors;
+			std::fill_n(remap, 256, -1);
+		}
+		const byte* src = frame.getIndexLinePtr(y);
+		unsigned width = slot.widths[y];
+		for (unsigned x = 0; x < width; ++x) {
+			byte idx = src[x];
+			if (remap[idx] == -1) {
+				remap[idx] = builder.getIndex(Pixel(colors[idx]));
+				if (remap[idx] == -1) return 0;
+			}
+			dst[x] = uint8_t(remap[idx]);
+		}
+		dst += width;
+	}
+	return builder.getNumColors();
+}
+
+void RawVideoWriter::write(Slot& slot)
+{
+	auto start = std::chrono::steady_clock::now();
+	switch (format->BytesPerPixel) {
+#if HAVE_16BPP
+	case 2:
+		write<uint16_t>(slot);
+		break;
+#endif
+#if HAVE_32BPP
+	case 4:
+		write<uint32_t>(slot);
+		break;
+#endif
+	default:
+		UNREACHABLE;
+	}
+	queue.addEncodeTime(std::chrono::steady_clock::now() - start);
+	queue.frameWritten();
+}
+
+template<typename Pixel>
+void RawVideoWriter::write(Slot& slot)
+{
+	using LE_P = typename Endian::Little<Pixel>::type;
+
+	Pixel palette[256];
+	unsigned numColors = 0;
+	if (slot.rawFrame && slot.rawFrame->isIndexed()) {
+		// Use the indices as drawn by the rasterizer, only falls back
+		// to host pixels for frames with more than 256 colors.
+		numColors = captureIndexed(*slot.rawFrame, slot, palette);
+	}
+	size_t numPixels;
+	const Pixel* pixels = nullptr;
+	if (numColors) {
+		numPixels = indices.size();
+	} else {
+		if (slot.rawFrame) capture<Pixel>(*slot.rawFrame, slot);
+		numPixels = slot.lines.size() / sizeof(Pixel);
+		pixels = reinterpret_cast<const Pixel*>(slot.lines.data());
+		indices.resize(numPixels);
+		numColors = createPalette(pixels, numPixels, palette,
+		                          indices.data());
+	}
+	slot.rawFrame.reset(); // give it back to the pool
+	unsigned height = unsigned(slot.widths.size());
+	unsigned samples = unsigned(slot.audio.size());
+
+	size_t size = getPartSizes(height, numColors, numPixels, samples,
+	                           sizeof(Pixel));
+	chunk.assign(size, 0);
+	uint8_t* p = chunk.data();
+
+	auto& header = *reinterpret_cast<FrameHeader*>(p);
+	memcpy(header.tag, "FRAM", 4);
+	header.size = unsigned(size - 8);
+	header.height = height;
+	header.numColors = numColors;
+	header.field = slot.field;
+	header.samples = samples;
+	p += sizeof(FrameHeader);
+
+	auto* widths = reinterpret_cast<Endian::L16*>(p);
+	for (unsigned y = 0; y < height; ++y) {
+		widths[y] = slot.widths[y];
+	}
+	p += pad4(height * sizeof(uint16_t));
+
+	if (numColors) {
+		auto* pal = reinterpret_cast<LE_P*>(p);
+		for (unsigned i = 0; i < numColors; ++i) {
+			pal[i] = palette[i];
+		}
+		p += pad4(numColors * sizeof(Pixel));
+		memcpy(p, indices.data(), numPixels);
+		p += pad4(numPixels);
+	} else {
+		auto* dst = reinterpret_cast<LE_P*>(p);
+		for (size_t i = 0; i < numPixels; ++i) {
+			dst[i] = pixels[i];
+		}
+		p += pad4(numPixels * sizeof(Pixel));
+	}
+
+	auto* audio = reinterpret_cast<Endian::L16*>(p);
+	for (unsigned i = 0; i < samples; ++i) {
+		audio[i] = slot.audio[i];
+	}
+
+	file.write(chunk.data(), chunk.size());
+}
+
+
+// class RawVideoReader
+
+RawVideoReader::RawVideoReader(const Filename& filename)
+	: file(filename)
+{
+	data = file.mmap(size);
+	if (size < sizeof(Header)) {
+		throw MSXException("Not a raw video file.");
+	}
+	auto& header = *reinterpret_cast<const Header*>(data);
+	if (memcmp(header.magic, "OMRV", 4) != 0) {
+		throw MSXException("Not a raw video file.");
+	}
+	if (header.version != VERSION) {
+		throw MSXException("Unsupported raw video file version.");
+	}
+	unsigned bpp = header.bpp;
+	unsigned pixelSize = (bpp + 7) / 8;
+	bool supported = false;
+#if HAVE_16BPP
+	supported |= (pixelSize == 2);
+#endif
+#if HAVE_32BPP
+	supported |= (pixelSize == 4);
+#endif
+	if ((bpp != 15) && (bpp != 16) && (bpp != 32)) supported = false;
+	if (!supported) {
+		throw MSXException("Unsupported pixel format in raw video file.");
+	}
+
+	memset(&format, 0, sizeof(format));
+	format.BitsPerPixel = bpp;
+	format.BytesPerPixel = pixelSize;
+	format.Rmask = header.rmask;
+	format.Gmask = header.gmask;
+	format.Bmask = header.bmask;
+	format.Amask = header.amask;
+	format.Rshift = header.rshift;
+	format.Gshift = header.gshift;
+	format.Bshift = header.bshift;
+	format.Ashift = header.ashift;
+	format.Rloss = header.rloss;
+	format.Gloss = header.gloss;
+	format.Bloss = header.bloss;
+	format.Aloss = header.aloss;
+
+	channels = header.channels;
+	frequency = header.frequency;
+	numFrames = header.frames;
+	fps = header.fps / 1000000.0f;
+	if ((channels != 1) && (channels != 2)) {
+		throw MSXException("Corrupt raw video file.");
+	}
+	pos = sizeof(Header);
+}
+
+RawVideoReader::~RawVideoReader() = default;
+
+bool RawVideoReader::nextFrame()
+{
+	if (pos == size) return false;
+	size_t remaining = size - pos;
+	const uint8_t* p = data + pos;
+	auto& header = *reinterpret_cast<const FrameHeader*>(p);
+	if ((remaining < sizeof(FrameHeader)) ||
+	    (memcmp(header.tag, "FRAM", 4) != 0) ||
+	    ((size_t(header.size) + 8) > remaining)) {
+		throw MSXException("Corrupt raw video file.");
+	}
+	unsigned height = header.height;
+	unsigned numColors = header.numColors;
+	unsigned samples = header.samples;
+	if ((height == 0) || (height > MAX_HEIGHT) || (numColors > 256) ||
+	    (header.field > FrameSource::FIELD_ODD) ||
+	    (samples % channels)) {
+		throw MSXException("Corrupt raw video file.");
+	}
+	size_t chunkSize = size_t(header.size) + 8;
+	p += sizeof(FrameHeader);
+
+	auto* widths = reinterpret_cast<const Endian::L16*>(p);
+	if ((sizeof(FrameHeader) + height * sizeof(uint16_t)) > chunkSize) {
+		throw MSXException("Corrupt raw video file.");
+	}
+	size_t numPixels = 0;
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned width = widths[y];
+		if ((width == 0) || (width > MAX_WIDTH)) {
+			throw MSXException("Corrupt raw video file.");
+		}
+		numPixels += width;
+	}
+	unsigned pixelSize = format.BytesPerPixel;
+	if (getPartSizes(height, numColors, numPixels, samples, pixelSize) !=
+	    chunkSize) {
+		throw MSXException("Corrupt raw video file.");
+	}
+
+	if (!frame || (frame->getHeight() != height)) {
+		frame = make_unique<RawFrame>(format, MAX_WIDTH, height);
+	}
+	switch (pixelSize) {
+#if HAVE_16BPP
+	case 2:
+		readLines<uint16_t>(p, height, numColors);
+		break;
+#endif
+#if HAVE_32BPP
+	case 4:
+		readLines<uint32_t>(p, height, numColors);
+		break;
+#endif
+	default:
+		UNREACHABLE;
+	}
+	frame->init(FrameSource::FieldType(header.field));
+
+	p += pad4(height * sizeof(uint16_t))
+	   + pad4(numColors * pixelSize)
+	   + pad4(numPixels * (numColors ? 1 : pixelSize));
+	auto* audioData = reinterpret_cast<const Endian::L16*>(p);
+	audio.resize(samples);
+	for (unsigned i = 0; i < samples; ++i) {
+		audio[i] = audioData[i];
+	}
+
+	pos += chunkSize;
+	return true;
+}
+
+template<typename Pixel>
+void RawVideoReader::readLines(const uint8_t* p, unsigned height,
+                               unsigned numColors)
+{
+	using LE_P = typename Endian::Little<Pixel>::type;
+
+	auto* widths = reinterpret_cast<const Endian::L16*>(p);
+	p += pad4(height * sizeof(uint16_t));
+	if (numColors) {
+		auto* pal = reinterpret_cast<const LE_P*>(p);
+		Pixel palette[256];
+		for (unsigned i = 0; i < numColors; ++i) {
+			palette[i] = pal[i];
+		}
+		p += pad4(numColors * sizeof(Pixel));
+		for (unsigned y = 0; y < height; ++y) {
+			unsigned width = widths[y];
+			Pixel* dst = frame->getLinePtrDirect<Pixel>(y);
+			for (unsigned x = 0; x < width; ++x) {
+				uint8_t idx = p[x];
+				if (idx >= numColors) {
+					throw MSXException("Corrupt raw video file.");
+				}
+				dst[x] = palette[idx];
+			}
+			frame->setLineWidth(y, width);
+			p += width;
+		}
+	} else {
+		auto* src = reinterpret_cast<const LE_P*>(p);
+		for (unsigned y = 0; y < height; ++y) {
+			unsigned width = widths[y];
+			Pixel* dst = frame->getLinePtrDirect<Pixel>(y);
+			for (unsigned x = 0; x < width; ++x) {
+				dst[x] = src[x];
+			}
+			frame->setLineWidth(y, width);
+			src += width;
+		}
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,157 @@
+#ifndef RAWVIDEOFILE_HH
+#define RAWVIDEOFILE_HH
+
+#include "FrameQueue.hh"
+#include "RawFramePool.hh"
+#include "File.hh"
+#include "endian.hh"
+#include <SDL.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace openmsx {
+
+class Filename;
+class FrameSource;
+class ThreadPool;
+
+/** A lossless recording of the unscaled frames as produced by the
+  * rasterizer, plus the audio, see 'record start -raw'. Writing such a file
+  * is a lot cheaper than compressing the frames to ZMBV on the fly, it can
+  * be converted to AVI or PNG files afterwards ('record convert').
+  *
+  * File format (all numbers are little endian):
+  * - Header (see below).
+  * - One 'FRAM' chunk per frame:
+  *   - FrameHeader (see below)
+  *   - the width of each line: 16-bit, 'height' values
+  *   - when numColors != 0: the palette, numColors pixels
+  *   - the pixels of each line: 'width' pixels (when numColors == 0) or
+  *     'width' 8-bit palette indices (when numColors != 0)
+  *   - the audio: 'samples' 16-bit values (interleaved when stereo),
+  *     that belong to this frame
+  *   Each of these parts is padded to a multiple of 4 bytes.
+  * Frames that use at most 256 different colors (true for almost all MSX
+  * frames) are stored with a palette.
+  */
+namespace RawVideoFile {
+	struct Header {
+		char magic[4]; // "OMRV"
+		Endian::L32 version;
+		Endian::L32 bpp; // 15, 16 or 32
+		Endian::L32 rmask, gmask, bmask, amask;
+		uint8_t rshift, gshift, bshift, ashift;
+		uint8_t rloss, gloss, bloss, aloss;
+		Endian::L32 channels;
+		Endian::L32 frequency;
+		Endian::L32 frames;
+		Endian::L32 fps; // in 1/1000000 frames per second
+	};
+	struct FrameHeader {
+		char tag[4]; // "FRAM"
+		Endian::L32 size; // of the chunk, excluding 'tag' and 'size'
+		Endian::L16 height;
+		Endian::L16 numColors;
+		uint8_t field; // FrameSource::FieldType
+		uint8_t padding[3];
+		Endian::L32 samples;
+	};
+}
+
+/** Writes a raw video file. Like AviWriter, the frames are written on a
+  * separate thread, see FrameQueue.
+  */
+class RawVideoWriter
+{
+public:
+	RawVideoWriter(const Filename& filename, unsigned channels, unsigned freq);
+	/** Waits till all queued frames are written. */
+	~RawVideoWriter();
+
+	/** See AviWriter::addFrame(). */
+	bool addFrame(FrameSource* frame, RawFramePool::Ref rawFrame,
+	              unsigned samples, int16_t* sampleData);
+	void setFps(float fps_) { fps = fps_; }
+
+	/** See AviWriter::getStats(), here 'encodeTime' is the time the
+	  * writer thread was busy. */
+	FrameQueue::Stats getStats() const { return queue.getStats(); }
+
+private:
+	struct Slot {
+		RawFramePool::Ref rawFrame; // not yet copied to 'lines'
+		std::vector<uint16_t> widths;
+		std::vector<uint8_t> lines; // pixels of all lines
+		std::vector<int16_t> audio;
+		uint8_t field;
+	};
+
+	template<typename Pixel> void capture(FrameSource& frame, Slot& slot);
+	template<typename Pixel> unsigned captureIndexed(
+		const RawFrame& frame, Slot& slot, Pixel* palette);
+	template<typename Pixel> void write(Slot& slot);
+	void write(Slot& slot);
+	void writeHeader();
+
+	File file;
+	const SDL_PixelFormat* format; // of the first frame
+	std::vector<uint8_t> chunk;   // only used on the writer thread
+	std::vector<uint8_t> indices; // idem
+	FrameQueue queue;
+	Slot slots[FrameQueue::SIZE];
+
+	float fps;
+	const unsigned channels;
+	const unsigned frequency;
+
+	// Declared last, so that the thread is stopped first.
+	std::unique_ptr<ThreadPool> writer;
+};
+
+/** Reads a raw video file, frame by frame. */
+class RawVideoReader
+{
+public:
+	/** @throws MSXException When it's not a (supported) raw video file. */
+	explicit RawVideoReader(const Filename& filename);
+	~RawVideoReader();
+
+	const SDL_PixelFormat& getPixelFormat() const { return format; }
+	unsigned getChannels() const { return channels; }
+	unsigned getFrequency() const { return frequency; }
+	unsigned getNumFrames() const { return numFrames; }
+	/** 0 when unknown (a recording of less than two frames). */
+	float getFps() const { return fps; }
+
+	/** Go to the next frame.
+	  * @return False at the end of the file.
+	  * @throws MSXException When the file is corrupt.
+	  */
+	bool nextFrame();
+
+	/** The current frame, only valid till the next nextFrame() call. */
+	RawFrame& getFrame() { return *frame; }
+	/** The audio of the current frame. */
+	std::vector<int16_t>& getAudio() { return audio; }
+
+private:
+	template<typename Pixel> void readLines(
+		const uint8_t* p, unsigned height, unsigned numColors);
+
+	File file;
+	const uint8_t* data;
+	size_t size;
+	size_t pos;
+	SDL_PixelFormat format;
+	std::unique_ptr<RawFrame> frame;
+	std::vector<int16_t> audio;
+	unsigned channels;
+	unsigned frequency;
+	unsigned numFrames;
+	float fps;
+};
+
+} // namespace openmsx
+
+#endif
@@ -70,12 +70,21 @@ RenderSettings::RenderSettings(CommandController& commandController)
 	, deflickerSetting(commandController,
 		"deflicker", "deflicker on/off", false)
 
+	, indexedFramesSetting(commandController,
+		"indexed_frames", "render MSX frames as 8-bit palette indices "
+		"when possible, they're converted to host pixels while "
+		"scaling (SDL renderer only)", false)
+
 	, maxFrameSkipSetting(commandController,
 		"maxframeskip", "set the max amount of frameskip", 3, 0, 100)
 
 	, minFrameSkipSetting(commandController,
 		"minframeskip", "set the min amount of frameskip", 0, 0, 100)
 
+	, adaptiveFrameSkipSetting(commandController,
+		"adaptive_frameskip", "only skip MSX frames that are identical "
+		"to the previous frame, don't rasterize those at all", false)
+
 	, fullScreenSetting(commandController,
 		"fullscreen", "full screen display on/off", false)
 
@@ -126,6 +135,11 @@ RenderSettings::RenderSettings(CommandController& commandController)
 		"scale_factor", "scale factor",
 		std::min(2, MAX_SCALE_FACTOR), MIN_SCALE_FACTOR, MAX_SCALE_FACTOR)
 
+	, scaleThreadsSetting(commandController,
+		"scale_threads", "number of threads used by the software "
+		"scalers (SDL renderer only), 0 = automatic",
+		0, 0, 16)
+
 	, scanlineAlphaSetting(commandController,
 		"scanline", "amount of scanline effect: 0 = none, 100 = full",
 		20, 0, 100)
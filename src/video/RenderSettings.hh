@@ -56,6 +56,10 @@ public:
 	/** Deflicker [on, off]. */
 	bool getDeflicker() const { return deflickerSetting.getBoolean(); }
 
+	/** Render MSX frames as 8-bit palette indices when possible (SDL
+	  * rasterizer only). */
+	bool getIndexedFrames() const { return indexedFramesSetting.getBoolean(); }
+
 	/** The current max frameskip. */
 	IntegerSetting& getMaxFrameSkipSetting() { return maxFrameSkipSetting; }
 	int getMaxFrameSkip() const { return maxFrameSkipSetting.getInt(); }
@@ -64,6 +68,11 @@ public:
 	IntegerSetting& getMinFrameSkipSetting() { return minFrameSkipSetting; }
 	int getMinFrameSkip() const { return minFrameSkipSetting.getInt(); }
 
+	/** Skip frames that are identical to the previous one, instead of
+	  * using the min/max frameskip policy. */
+	BooleanSetting& getAdaptiveFrameSkipSetting() { return adaptiveFrameSkipSetting; }
+	bool getAdaptiveFrameSkip() const { return adaptiveFrameSkipSetting.getBoolean(); }
+
 	/** Full screen [on, off]. */
 	BooleanSetting& getFullScreenSetting() { return fullScreenSetting; }
 	bool getFullScreen() const { return fullScreenSetting.getBoolean(); }
@@ -120,6 +129,10 @@ public:
 	IntegerSetting& getScaleFactorSetting() { return scaleFactorSetting; }
 	int getScaleFactor() const { return scaleFactorSetting.getInt(); }
 
+	/** The number of threads used by the software scalers (0 means
+	  * automatic). */
+	int getScaleThreads() const { return scaleThreadsSetting.getInt(); }
+
 	/** Limit number of sprites per line?
 	  * If true, limit number of sprites per line as real VDP does.
 	  * If false, display all sprites.
@@ -203,8 +216,10 @@ private:
 	EnumSetting<Accuracy> accuracySetting;
 	BooleanSetting deinterlaceSetting;
 	BooleanSetting deflickerSetting;
+	BooleanSetting indexedFramesSetting;
 	IntegerSetting maxFrameSkipSetting;
 	IntegerSetting minFrameSkipSetting;
+	BooleanSetting adaptiveFrameSkipSetting;
 	BooleanSetting fullScreenSetting;
 	FloatSetting gammaSetting;
 	FloatSetting brightnessSetting;
@@ -216,6 +231,7 @@ private:
 	IntegerSetting horizontalBlurSetting;
 	EnumSetting<ScaleAlgorithm> scaleAlgorithmSetting;
 	IntegerSetting scaleFactorSetting;
+	IntegerSetting scaleThreadsSetting;
 	IntegerSetting scanlineAlphaSetting;
 	BooleanSetting limitSpritesSetting;
 	BooleanSetting disableSpritesSetting;
@@ -5,6 +5,12 @@
 namespace openmsx {
 
 SDLOffScreenSurface::SDLOffScreenSurface(const SDL_Surface& proto)
+	: SDLOffScreenSurface(proto.w, proto.h, *proto.format)
+{
+}
+
+SDLOffScreenSurface::SDLOffScreenSurface(
+	unsigned width, unsigned height, const SDL_PixelFormat& format)
 {
 	// SDL_CreateRGBSurface() allocates an internal buffer, on 32-bit
 	// systems this buffer is only 8-bytes aligned. For some scalers (with
@@ -14,16 +20,16 @@ SDLOffScreenSurface::SDLOffScreenSurface(const SDL_Surface& proto)
 	// Of course it would be better to get rid of SDL_Surface in the
 	// OutputSurface interface.
 
-	setSDLFormat(*proto.format);
+	setSDLFormat(format);
 	const SDL_PixelFormat& frmt = getSDLFormat();
 
-	unsigned pitch2 = proto.w * frmt.BitsPerPixel / 8;
+	unsigned pitch2 = width * frmt.BitsPerPixel / 8;
 	assert((pitch2 % 16) == 0);
-	unsigned size = pitch2 * proto.h;
+	unsigned size = pitch2 * height;
 	buffer.resize(size);
 	memset(buffer.data(), 0, size);
 	surface.reset(SDL_CreateRGBSurfaceFrom(
-		buffer.data(), proto.w, proto.h, frmt.BitsPerPixel, pitch2,
+		buffer.data(), width, height, frmt.BitsPerPixel, pitch2,
 		frmt.Rmask, frmt.Gmask, frmt.Bmask, frmt.Amask));
 
 	setSDLSurface(surface.get());
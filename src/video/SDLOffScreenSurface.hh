@@ -11,6 +11,8 @@ class SDLOffScreenSurface final : public OutputSurface
 {
 public:
 	explicit SDLOffScreenSurface(const SDL_Surface& prototype);
+	SDLOffScreenSurface(unsigned width, unsigned height,
+	                    const SDL_PixelFormat& format);
 
 private:
 	// OutputSurface
@@ -55,18 +55,45 @@ static inline int translateX(int absoluteX, bool narrow)
 }
 
 template <class Pixel>
-inline void SDLRasterizer<Pixel>::renderBitmapLine(Pixel* buf, unsigned vramLine)
+template <typename T>
+SDLRasterizer<Pixel>::Output<T>::Output(VDP& vdp, const T* palette32768)
+	: characterConverter(vdp, palFg, palBg)
+	, bitmapConverter(palFg, palette256, palette32768)
+	, spriteConverter(vdp.getSpriteChecker())
+{
+}
+
+template <class Pixel>
+typename SDLRasterizer<Pixel>::IndexSpace
+SDLRasterizer<Pixel>::getIndexSpace(DisplayMode mode)
+{
+	if (mode.getByte() == DisplayMode::GRAPHIC7) {
+		return GRAPHIC7;
+	} else if ((mode.getBase() == DisplayMode::GRAPHIC7) ||
+	           (mode.getByte() & DisplayMode::YJK)) {
+		// YJK colors don't fit in a palette snapshot. And Graphic7
+		// with YAE uses the regular palette for sprites.
+		return NO_INDICES;
+	} else {
+		return PALETTE16;
+	}
+}
+
+template <class Pixel>
+template <typename T>
+inline void SDLRasterizer<Pixel>::renderBitmapLine(
+	Output<T>& out, T* buf, unsigned vramLine)
 {
 	if (vdp.getDisplayMode().isPlanar()) {
 		const byte* vramPtr0;
 		const byte* vramPtr1;
 		vram.bitmapCacheWindow.getReadAreaPlanar(
 			vramLine * 256, 256, vramPtr0, vramPtr1);
-		bitmapConverter.convertLinePlanar(buf, vramPtr0, vramPtr1);
+		out.bitmapConverter.convertLinePlanar(buf, vramPtr0, vramPtr1);
 	} else {
 		const byte* vramPtr =
 			vram.bitmapCacheWindow.getReadArea(vramLine * 128, 128);
-		bitmapConverter.convertLine(buf, vramPtr);
+		out.bitmapConverter.convertLine(buf, vramPtr);
 	}
 }
 
@@ -77,19 +104,22 @@ SDLRasterizer<Pixel>::SDLRasterizer(
 	: vdp(vdp_), vram(vdp.getVRAM())
 	, screen(screen_)
 	, postProcessor(std::move(postProcessor_))
-	, workFrame(make_unique<RawFrame>(screen.getSDLFormat(), 640, 240))
+	, workFrame(postProcessor->acquireFrame())
 	, renderSettings(display.getRenderSettings())
-	, characterConverter(vdp, palFg, palBg)
-	, bitmapConverter(palFg, PALETTE256, V9958_COLORS)
-	, spriteConverter(vdp.getSpriteChecker())
+	, host(vdp, V9958_COLORS)
+	, indices(vdp, nullptr)
+	, indexSpace(NO_INDICES)
+	, paletteSnapshot(RawFrame::NO_PALETTE)
 {
 	// Init the palette.
+	host.keyColor = screen.getKeyColor<Pixel>();
 	precalcPalette();
+	precalcIndices();
 
 	// Initialize palette (avoid UMR)
 	if (!vdp.isMSX1VDP()) {
 		for (int i = 0; i < 16; ++i) {
-			palFg[i] = palFg[i + 16] = palBg[i] =
+			host.palFg[i] = host.palFg[i + 16] = host.palBg[i] =
 				V9938_COLORS[0][0][0];
 		}
 	}
@@ -128,7 +158,8 @@ void SDLRasterizer<Pixel>::reset()
 {
 	// Init renderer state.
 	setDisplayMode(vdp.getDisplayMode());
-	spriteConverter.setTransparency(vdp.getTransparency());
+	host   .spriteConverter.setTransparency(vdp.getTransparency());
+	indices.spriteConverter.setTransparency(vdp.getTransparency());
 
 	resetPalette();
 }
@@ -160,6 +191,9 @@ void SDLRasterizer<Pixel>::frameStart(EmuTime::param time)
 	    vdp.isInterlaced() ? (vdp.getEvenOdd() ? FrameSource::FIELD_ODD
 	                                           : FrameSource::FIELD_EVEN)
 	                       : FrameSource::FIELD_NONINTERLACED);
+	workFrame->setIndexed(renderSettings.getIndexedFrames() &&
+	                      (indexSpace != NO_INDICES));
+	paletteSnapshot = RawFrame::NO_PALETTE;
 
 	// Calculate line to render at top of screen.
 	// Make sure the display area is centered.
@@ -171,12 +205,15 @@ void SDLRasterizer<Pixel>::frameStart(EmuTime::param time)
 
 	// We haven't drawn any left/right borders yet this frame, thus so far
 	// all is still consistent (same settings for all left/right borders).
-	mixedLeftRightBorders = false;
+	// Except for an indexed frame: when it's reused, its pixels can be
+	// indices in another palette, so don't use it for border skipping.
+	mixedLeftRightBorders = workFrame->isIndexed();
 
 	auto& borderInfo = workFrame->getBorderInfo();
 	Pixel color0, color1;
-	getBorderColors(color0, color1);
+	getBorderColors(host, color0, color1);
 	canSkipLeftRightBorders =
+		!workFrame->isIndexed() &&
 		(borderInfo.mode   == vdp.getDisplayMode().getByte()) &&
 		(borderInfo.color0 == color0)                         &&
 		(borderInfo.color1 == color1)                         &&
@@ -199,7 +236,7 @@ void SDLRasterizer<Pixel>::frameEnd()
 		// the same settings). If in a later frame the border-related
 		// settings are still the same, we can skip drawing borders.
 		Pixel color0, color1;
-		getBorderColors(color0, color1);
+		getBorderColors(host, color0, color1);
 		borderInfo.mode   = vdp.getDisplayMode().getByte();
 		borderInfo.color0 = color0;
 		borderInfo.color1 = color1;
@@ -224,15 +261,27 @@ template <class Pixel>
 void SDLRasterizer<Pixel>::setDisplayMode(DisplayMode mode)
 {
 	if (mode.isBitmapMode()) {
-		bitmapConverter.setDisplayMode(mode);
+		host   .bitmapConverter.setDisplayMode(mode);
+		indices.bitmapConverter.setDisplayMode(mode);
 	} else {
-		characterConverter.setDisplayMode(mode);
+		host   .characterConverter.setDisplayMode(mode);
+		indices.characterConverter.setDisplayMode(mode);
 	}
 	precalcColorIndex0(mode, vdp.getTransparency(),
 	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
-	spriteConverter.setDisplayMode(mode);
-	spriteConverter.setPalette(mode.getByte() == DisplayMode::GRAPHIC7
-	                           ? palGraphic7Sprites : palBg);
+	bool graphic7 = mode.getByte() == DisplayMode::GRAPHIC7;
+	host.spriteConverter.setDisplayMode(mode);
+	host.spriteConverter.setPalette(
+		graphic7 ? host.palGraphic7Sprites : host.palBg);
+	indices.spriteConverter.setDisplayMode(mode);
+	indices.spriteConverter.setPalette(
+		graphic7 ? indices.palGraphic7Sprites : indices.palBg);
+
+	IndexSpace newSpace = getIndexSpace(mode);
+	if (newSpace != indexSpace) {
+		indexSpace = newSpace;
+		paletteSnapshot = RawFrame::NO_PALETTE;
+	}
 
 	borderSettingChanged();
 }
@@ -242,10 +291,11 @@ void SDLRasterizer<Pixel>::setPalette(int index, int grb)
 {
 	// Update SDL colors in palette.
 	Pixel newColor = V9938_COLORS[(grb >> 4) & 7][grb >> 8][grb & 7];
-	palFg[index     ] = newColor;
-	palFg[index + 16] = newColor;
-	palBg[index     ] = newColor;
-	bitmapConverter.palette16Changed();
+	host.palFg[index     ] = newColor;
+	host.palFg[index + 16] = newColor;
+	host.palBg[index     ] = newColor;
+	host.bitmapConverter.palette16Changed();
+	paletteSnapshot = RawFrame::NO_PALETTE;
 
 	precalcColorIndex0(vdp.getDisplayMode(), vdp.getTransparency(),
 	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
@@ -283,7 +333,8 @@ void SDLRasterizer<Pixel>::setBorderMask(bool /*masked*/)
 template <class Pixel>
 void SDLRasterizer<Pixel>::setTransparency(bool enabled)
 {
-	spriteConverter.setTransparency(enabled);
+	host   .spriteConverter.setTransparency(enabled);
+	indices.spriteConverter.setTransparency(enabled);
 	precalcColorIndex0(vdp.getDisplayMode(), enabled,
 	                   vdp.isSuperimposing(), vdp.getBackgroundColor());
 }
@@ -296,7 +347,7 @@ void SDLRasterizer<Pixel>::precalcPalette()
 		const auto palette = vdp.getMSX1Palette();
 		for (int i = 0; i < 16; ++i) {
 			const auto rgb = palette[i];
-			palFg[i] = palFg[i + 16] = palBg[i] =
+			host.palFg[i] = host.palFg[i + 16] = host.palBg[i] =
 				screen.mapKeyedRGB<Pixel>(
 					renderSettings.transformRGB(
 						vec3(rgb[0], rgb[1], rgb[2]) / 255.0f));
@@ -378,7 +429,7 @@ void SDLRasterizer<Pixel>::precalcPalette()
 		}
 		// Precalculate Graphic 7 bitmap palette.
 		for (int i = 0; i < 256; ++i) {
-			PALETTE256[i] = V9938_COLORS
+			host.palette256[i] = V9938_COLORS
 				[(i & 0x1C) >> 2]
 				[(i & 0xE0) >> 5]
 				[(i & 0x03) == 3 ? 7 : (i & 0x03) * 2];
@@ -386,15 +437,49 @@ void SDLRasterizer<Pixel>::precalcPalette()
 		// Precalculate Graphic 7 sprite palette.
 		for (int i = 0; i < 16; ++i) {
 			uint16_t grb = Renderer::GRAPHIC7_SPRITE_PALETTE[i];
-			palGraphic7Sprites[i] =
+			host.palGraphic7Sprites[i] =
 				V9938_COLORS[(grb >> 4) & 7][grb >> 8][grb & 7];
 		}
 	}
+	paletteSnapshot = RawFrame::NO_PALETTE;
+}
+
+template <class Pixel>
+void SDLRasterizer<Pixel>::precalcIndices()
+{
+	// See IndexSpace for the layout of the palette snapshots.
+	for (int i = 0; i < 16; ++i) {
+		indices.palFg[i] = indices.palFg[i + 16] = indices.palBg[i] = i;
+	}
+	for (int i = 0; i < 256; ++i) {
+		indices.palette256[i] = i;
+	}
+	// The Graphic 7 sprite colors are also Graphic 7 bitmap colors.
+	for (int i = 0; i < 16; ++i) {
+		uint16_t grb = Renderer::GRAPHIC7_SPRITE_PALETTE[i];
+		int g = grb >> 8, r = (grb >> 4) & 7, b = grb & 7;
+		assert(((b & 1) == 0) || (b == 7));
+		indices.palGraphic7Sprites[i] =
+			(g << 5) | (r << 2) | ((b == 7) ? 3 : (b / 2));
+	}
+	indices.keyColor = KEY_INDEX;
 }
 
 template <class Pixel>
 void SDLRasterizer<Pixel>::precalcColorIndex0(DisplayMode mode,
 		bool transparency, const RawFrame* superimposing, byte bgcolorIndex)
+{
+	precalcColorIndex0(host,    mode, transparency, superimposing,
+	                   bgcolorIndex);
+	precalcColorIndex0(indices, mode, transparency, superimposing,
+	                   bgcolorIndex);
+}
+
+template <class Pixel>
+template <typename T>
+void SDLRasterizer<Pixel>::precalcColorIndex0(Output<T>& out,
+		DisplayMode mode, bool transparency,
+		const RawFrame* superimposing, byte bgcolorIndex)
 {
 	// Graphic7 mode doesn't use transparency.
 	if (mode.getByte() == DisplayMode::GRAPHIC7) {
@@ -403,55 +488,122 @@ void SDLRasterizer<Pixel>::precalcColorIndex0(DisplayMode mode,
 
 	int tpIndex = transparency ? bgcolorIndex : 0;
 	if (mode.getBase() != DisplayMode::GRAPHIC5) {
-		Pixel c = (superimposing && (bgcolorIndex == 0))
-		        ? screen.getKeyColor<Pixel>()
-		        : palBg[tpIndex];
+		T c = (superimposing && (bgcolorIndex == 0))
+		    ? out.keyColor
+		    : out.palBg[tpIndex];
 
-		if (palFg[0] != c) {
-			palFg[0] = c;
-			bitmapConverter.palette16Changed();
+		if (out.palFg[0] != c) {
+			out.palFg[0] = c;
+			out.bitmapConverter.palette16Changed();
 		}
 	} else {
 		// TODO: superimposing
-		if ((palFg[ 0] != palBg[tpIndex >> 2]) ||
-		    (palFg[16] != palBg[tpIndex &  3])) {
-			palFg[ 0] = palBg[tpIndex >> 2];
-			palFg[16] = palBg[tpIndex &  3];
-			bitmapConverter.palette16Changed();
+		if ((out.palFg[ 0] != out.palBg[tpIndex >> 2]) ||
+		    (out.palFg[16] != out.palBg[tpIndex &  3])) {
+			out.palFg[ 0] = out.palBg[tpIndex >> 2];
+			out.palFg[16] = out.palBg[tpIndex &  3];
+			out.bitmapConverter.palette16Changed();
 		}
 	}
 }
 
 template <class Pixel>
-void SDLRasterizer<Pixel>::getBorderColors(Pixel& border0, Pixel& border1)
+template <typename T>
+void SDLRasterizer<Pixel>::getBorderColors(
+	const Output<T>& out, T& border0, T& border1)
 {
 	DisplayMode mode = vdp.getDisplayMode();
 	int bgColor = vdp.getBackgroundColor();
 	if (mode.getBase() == DisplayMode::GRAPHIC5) {
 		// border in SCREEN6 has separate color for even and odd pixels.
 		// TODO odd/even swapped?
-		border0 = palBg[(bgColor & 0x0C) >> 2];
-		border1 = palBg[(bgColor & 0x03) >> 0];
+		border0 = out.palBg[(bgColor & 0x0C) >> 2];
+		border1 = out.palBg[(bgColor & 0x03) >> 0];
 	} else if (mode.getByte() == DisplayMode::GRAPHIC7) {
-		border0 = border1 = PALETTE256[bgColor];
+		border0 = border1 = out.palette256[bgColor];
 	} else {
 		if (!bgColor && vdp.isSuperimposing()) {
-			border0 = border1 = screen.getKeyColor<Pixel>();
+			border0 = border1 = out.keyColor;
 		} else {
-			border0 = border1 = palBg[bgColor];
+			border0 = border1 = out.palBg[bgColor];
+		}
+	}
+}
+
+template <class Pixel>
+unsigned SDLRasterizer<Pixel>::addPaletteSnapshot()
+{
+	uint32_t colors[256];
+	if (indexSpace == GRAPHIC7) {
+		for (int i = 0; i < 256; ++i) {
+			colors[i] = host.palette256[i];
 		}
+	} else {
+		assert(indexSpace == PALETTE16);
+		for (int i = 0; i < 16; ++i) {
+			colors[i] = host.palBg[i];
+		}
+		colors[KEY_INDEX] = host.keyColor;
+		std::fill(colors + KEY_INDEX + 1, colors + 256, 0);
 	}
+	return workFrame->addPalette(colors);
+}
+
+template <class Pixel>
+bool SDLRasterizer<Pixel>::useIndices(int startY, int endY)
+{
+	if (!workFrame->isIndexed()) return false;
+
+	if (paletteSnapshot == RawFrame::NO_PALETTE) {
+		if (indexSpace != NO_INDICES) {
+			paletteSnapshot = addPaletteSnapshot();
+		}
+		if (paletteSnapshot == RawFrame::NO_PALETTE) {
+			workFrame->convertToHost();
+			return false;
+		}
+	}
+	for (int y = startY; y < endY; ++y) {
+		unsigned linePalette = workFrame->getLinePalette(y);
+		if (linePalette == RawFrame::NO_PALETTE) {
+			workFrame->setLinePalette(y, paletteSnapshot);
+		} else if (linePalette != paletteSnapshot) {
+			// Part of this line was already drawn with another
+			// palette (e.g. a palette change halfway a line).
+			workFrame->convertToHost();
+			return false;
+		}
+	}
+	return true;
 }
 
 template <class Pixel>
 void SDLRasterizer<Pixel>::drawBorder(
 	int fromX, int fromY, int limitX, int limitY)
 {
-	Pixel border0, border1;
-	getBorderColors(border0, border1);
-
 	int startY = std::max(fromY - lineRenderTop, 0);
 	int endY = std::min(limitY - lineRenderTop, 240);
+	if (startY >= endY) return;
+
+	// Only claim the lines for the current palette snapshot when pixels
+	// are actually drawn (not e.g. for the invisible start of a line).
+	bool narrow = vdp.getDisplayMode().getLineWidth() == 512;
+	bool noPixels = translateX(fromX, narrow) == translateX(limitX, narrow);
+	if (workFrame->isIndexed() && (noPixels || useIndices(startY, endY))) {
+		drawBorder(indices, fromX, limitX, startY, endY);
+	} else {
+		drawBorder(host, fromX, limitX, startY, endY);
+	}
+}
+
+template <class Pixel>
+template <typename T>
+void SDLRasterizer<Pixel>::drawBorder(
+	Output<T>& out, int fromX, int limitX, int startY, int endY)
+{
+	T border0, border1;
+	getBorderColors(out, border0, border1);
+
 	if ((fromX == 0) && (limitX == VDP::TICKS_PER_LINE) &&
 	    (border0 == border1)) {
 		// complete lines, non striped
@@ -466,13 +618,13 @@ void SDLRasterizer<Pixel>::drawBorder(
 		unsigned x = translateX(fromX, (lineWidth == 512));
 		unsigned num = translateX(limitX, (lineWidth == 512)) - x;
 		unsigned width = (lineWidth == 512) ? 640 : 320;
-		MemoryOps::MemSet2<Pixel> memset;
+		MemoryOps::MemSet2<T> memset;
 		for (int y = startY; y < endY; ++y) {
 			// workFrame->linewidth != 1 means the line has
 			// left/right borders.
 			if (canSkipLeftRightBorders &&
 			    (workFrame->getLineWidthDirect(y) != 1)) continue;
-			memset(workFrame->getLinePtrDirect<Pixel>(y) + x,
+			memset(workFrame->getLinePtrDirect<T>(y) + x,
 			       num, border0, border1);
 			if (limitX == VDP::TICKS_PER_LINE) {
 				// Only set line width at the end (right
@@ -516,6 +668,24 @@ void SDLRasterizer<Pixel>::drawDisplay(
 	displayHeight = screenLimitY - screenY;
 	if (displayHeight <= 0) return;
 
+	if (useIndices(screenY, screenLimitY)) {
+		drawDisplay(indices, screenY, screenLimitY,
+		            displayX, displayY, displayWidth);
+	} else {
+		drawDisplay(host, screenY, screenLimitY,
+		            displayX, displayY, displayWidth);
+	}
+}
+
+template <class Pixel>
+template <typename T>
+void SDLRasterizer<Pixel>::drawDisplay(
+	Output<T>& out, int screenY, int screenLimitY,
+	int displayX, int displayY, int displayWidth)
+{
+	DisplayMode mode = vdp.getDisplayMode();
+	unsigned lineWidth = mode.getLineWidth();
+
 	int leftBackground =
 		translateX(vdp.getLeftBackground(), lineWidth == 512);
 	// TODO: Find out why this causes 1-pixel jitter:
@@ -560,32 +730,32 @@ void SDLRasterizer<Pixel>::drawDisplay(
 				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | displayY)
 			};
 
-			Pixel buf[512];
+			T buf[512];
 			int lineInBuf = -1; // buffer data not valid
-			Pixel* dst = workFrame->getLinePtrDirect<Pixel>(y)
-			           + leftBackground + displayX;
+			T* dst = workFrame->getLinePtrDirect<T>(y)
+			       + leftBackground + displayX;
 			int firstPageWidth = pageBorder - displayX;
 			if (firstPageWidth > 0) {
 				if ((displayX + hScroll) == 0) {
-					renderBitmapLine(dst, vramLine[scrollPage1]);
+					renderBitmapLine(out, dst, vramLine[scrollPage1]);
 				} else {
 					lineInBuf = vramLine[scrollPage1];
-					renderBitmapLine(buf, vramLine[scrollPage1]);
-					const Pixel* src = buf + displayX + hScroll;
-					memcpy(dst, src, firstPageWidth * sizeof(Pixel));
+					renderBitmapLine(out, buf, vramLine[scrollPage1]);
+					const T* src = buf + displayX + hScroll;
+					memcpy(dst, src, firstPageWidth * sizeof(T));
 				}
 			} else {
 				firstPageWidth = 0;
 			}
 			if (firstPageWidth < displayWidth) {
 				if (lineInBuf != vramLine[scrollPage2]) {
-					renderBitmapLine(buf, vramLine[scrollPage2]);
+					renderBitmapLine(out, buf, vramLine[scrollPage2]);
 				}
 				unsigned x = displayX < pageBorder
 					   ? 0 : displayX + hScroll - lineWidth;
 				memcpy(dst + firstPageWidth,
 				       buf + x,
-				       (displayWidth - firstPageWidth) * sizeof(Pixel));
+				       (displayWidth - firstPageWidth) * sizeof(T));
 			}
 
 			displayY = (displayY + 1) & 255;
@@ -595,15 +765,15 @@ void SDLRasterizer<Pixel>::drawDisplay(
 		for (int y = screenY; y < screenLimitY; y++) {
 			assert(!vdp.isMSX1VDP() || displayY < 192);
 
-			Pixel* dst = workFrame->getLinePtrDirect<Pixel>(y)
-			           + leftBackground + displayX;
+			T* dst = workFrame->getLinePtrDirect<T>(y)
+			       + leftBackground + displayX;
 			if (displayX == 0) {
-				characterConverter.convertLine(dst, displayY);
+				out.characterConverter.convertLine(dst, displayY);
 			} else {
-				Pixel buf[512];
-				characterConverter.convertLine(buf, displayY);
-				const Pixel* src = buf + displayX;
-				memcpy(dst, src, displayWidth * sizeof(Pixel));
+				T buf[512];
+				out.characterConverter.convertLine(buf, displayY);
+				const T* src = buf + displayX;
+				memcpy(dst, src, displayWidth * sizeof(T));
 			}
 
 			displayY = (displayY + 1) & 255;
@@ -631,37 +801,53 @@ void SDLRasterizer<Pixel>::drawSprites(
 	displayHeight = screenLimitY - screenY;
 	if (displayHeight <= 0) return;
 
+	int limitY = fromY + displayHeight;
+	if (useIndices(screenY, screenLimitY)) {
+		drawSprites(indices, fromY, limitY, screenY,
+		            displayX, displayWidth);
+	} else {
+		drawSprites(host, fromY, limitY, screenY,
+		            displayX, displayWidth);
+	}
+}
+
+template <class Pixel>
+template <typename T>
+void SDLRasterizer<Pixel>::drawSprites(
+	Output<T>& out, int fromY, int limitY, int screenY,
+	int displayX, int displayWidth)
+{
 	// Render sprites.
 	// TODO: Call different SpriteConverter methods depending on narrow/wide
 	//       pixels in this display mode?
+	auto& spriteConverter = out.spriteConverter;
 	int spriteMode = vdp.getDisplayMode().getSpriteMode(vdp.isMSX1VDP());
 	int displayLimitX = displayX + displayWidth;
-	int limitY = fromY + displayHeight;
 	int screenX = translateX(
 		vdp.getLeftSprites(),
 		vdp.getDisplayMode().getLineWidth() == 512);
 	if (spriteMode == 1) {
 		for (int y = fromY; y < limitY; y++, screenY++) {
-			Pixel* pixelPtr = workFrame->getLinePtrDirect<Pixel>(screenY) + screenX;
+			T* pixelPtr = workFrame->getLinePtrDirect<T>(screenY) + screenX;
 			spriteConverter.drawMode1(y, displayX, displayLimitX, pixelPtr);
 		}
 	} else {
 		byte mode = vdp.getDisplayMode().getByte();
 		if (mode == DisplayMode::GRAPHIC5) {
 			for (int y = fromY; y < limitY; y++, screenY++) {
-				Pixel* pixelPtr = workFrame->getLinePtrDirect<Pixel>(screenY) + screenX;
+				T* pixelPtr = workFrame->getLinePtrDirect<T>(screenY) + screenX;
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC5>(
 					y, displayX, displayLimitX, pixelPtr);
 			}
 		} else if (mode == DisplayMode::GRAPHIC6) {
 			for (int y = fromY; y < limitY; y++, screenY++) {
-				Pixel* pixelPtr = workFrame->getLinePtrDirect<Pixel>(screenY) + screenX;
+				T* pixelPtr = workFrame->getLinePtrDirect<T>(screenY) + screenX;
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC6>(
 					y, displayX, displayLimitX, pixelPtr);
 			}
 		} else {
 			for (int y = fromY; y < limitY; y++, screenY++) {
-				Pixel* pixelPtr = workFrame->getLinePtrDirect<Pixel>(screenY) + screenX;
+				T* pixelPtr = workFrame->getLinePtrDirect<T>(screenY) + screenX;
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC4>(
 					y, displayX, displayLimitX, pixelPtr);
 			}
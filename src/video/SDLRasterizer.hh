@@ -5,8 +5,10 @@
 #include "BitmapConverter.hh"
 #include "CharacterConverter.hh"
 #include "SpriteConverter.hh"
+#include "RawFramePool.hh"
 #include "Observer.hh"
 #include "openmsx.hh"
+#include <cstdint>
 #include <memory>
 
 namespace openmsx {
@@ -16,7 +18,6 @@ class VDP;
 class VDPVRAM;
 class OutputSurface;
 class VisibleSurface;
-class RawFrame;
 class RenderSettings;
 class Setting;
 class PostProcessor;
@@ -63,7 +64,85 @@ public:
 	bool isRecording() const override;
 
 private:
-	inline void renderBitmapLine(Pixel* buf, unsigned vramLine);
+	/** Palette lookup tables and VRAM to pixels converters for one type
+	  * of output: either host pixels or (uint8_t) indices in the current
+	  * palette snapshot of an indexed RawFrame.
+	  */
+	template <typename T> struct Output
+	{
+		Output(VDP& vdp, const T* palette32768);
+
+		/** Colors corresponding to each VDP palette entry.
+		  * palFg has entry 0 set to the current background color.
+		  *       The 16 first entries are for even pixels, the next 16
+		  *       are for odd pixels. Second part is only needed (and
+		  *       guaranteed to be up-to-date) in Graphics5 mode.
+		  * palBg has entry 0 set to black.
+		  */
+		T palFg[16 * 2], palBg[16];
+
+		/** Colors corresponding to each Graphic 7 sprite color.
+		  */
+		T palGraphic7Sprites[16];
+
+		/** Colors corresponding to the 256 color palette of Graphic7.
+		  * Used by BitmapConverter.
+		  */
+		T palette256[256];
+
+		/** Color of the pixels where the superimposed video shows.
+		  */
+		T keyColor;
+
+		/** VRAM to pixels converter for character display modes.
+		  */
+		CharacterConverter<T> characterConverter;
+
+		/** VRAM to pixels converter for bitmap display modes.
+		  */
+		BitmapConverter<T> bitmapConverter;
+
+		/** VRAM to pixels converter for sprites.
+		  */
+		SpriteConverter<T> spriteConverter;
+	};
+
+	/** The colors a palette snapshot contains depend on the display mode.
+	  * PALETTE16: Index 0-15 are the VDP palette, KEY_INDEX is the
+	  *            superimpose key color.
+	  * GRAPHIC7:  The 256 fixed Graphic7 colors.
+	  * NO_INDICES: This mode can't be drawn as indices (YJK).
+	  */
+	enum IndexSpace { PALETTE16, GRAPHIC7, NO_INDICES };
+	static const uint8_t KEY_INDEX = 16;
+	static IndexSpace getIndexSpace(DisplayMode mode);
+
+	template <typename T>
+	inline void renderBitmapLine(Output<T>& out, T* buf, unsigned vramLine);
+
+	template <typename T>
+	void drawBorder(Output<T>& out, int fromX, int limitX,
+	                int startY, int endY);
+	template <typename T>
+	void drawDisplay(Output<T>& out, int screenY, int screenLimitY,
+	                 int displayX, int displayY, int displayWidth);
+	template <typename T>
+	void drawSprites(Output<T>& out, int fromY, int limitY, int screenY,
+	                 int displayX, int displayWidth);
+
+	/** Can lines [startY, endY) of the work frame be drawn as indices?
+	  * If so, these lines now refer to the current palette snapshot.
+	  * If not, the work frame is converted to host pixels (if it wasn't
+	  * already).
+	  */
+	bool useIndices(int startY, int endY);
+
+	/** Add a palette snapshot with the current host colors to the work
+	  * frame.
+	  * @return The snapshot id, or RawFrame::NO_PALETTE if that's not
+	  *         possible.
+	  */
+	unsigned addPaletteSnapshot();
 
 	/** Reload entire palette from VDP.
 	  */
@@ -75,18 +154,27 @@ private:
 	  */
 	void precalcPalette();
 
+	/** Precalc the index tables, these don't depend on the palette.
+	  */
+	void precalcIndices();
+
 	/** Precalc foreground color index 0 (palFg[0]).
 	  * @param mode Current display mode.
 	  * @param transparency True iff transparency is enabled.
 	  */
 	void precalcColorIndex0(DisplayMode mode, bool transparency,
 	                        const RawFrame* superimposing, byte bgcolorIndex);
+	template <typename T>
+	void precalcColorIndex0(Output<T>& out, DisplayMode mode,
+	                        bool transparency, const RawFrame* superimposing,
+	                        byte bgcolorIndex);
 
 	// Some of the border-related settings changed.
 	void borderSettingChanged();
 
-	// Get the border color(s). These are 16bpp or 32bpp host pixels.
-	void getBorderColors(Pixel& border0, Pixel& border1);
+	// Get the border color(s). These are host pixels or indices.
+	template <typename T>
+	void getBorderColors(const Output<T>& out, T& border0, T& border1);
 
 	// Observer<Setting>
 	void update(const Setting& setting) override;
@@ -110,55 +198,43 @@ private:
 
 	/** The next frame as it is delivered by the VDP, work in progress.
 	  */
-	std::unique_ptr<RawFrame> workFrame;
+	RawFramePool::Ref workFrame;
 
 	/** The current renderer settings (gamma, brightness, contrast)
 	  */
 	RenderSettings& renderSettings;
 
-	/** VRAM to pixels converter for character display modes.
+	/** Host colors corresponding to each possible V9958 color.
+	  */
+	Pixel V9958_COLORS[32768];
+
+	/** Precalculated host colors corresponding to each possible V9938 color.
+	  * Used by updatePalette to adjust palFg and palBg.
 	  */
-	CharacterConverter<Pixel> characterConverter;
+	Pixel V9938_COLORS[8][8][8];
 
-	/** VRAM to pixels converter for bitmap display modes.
+	/** Tables and converters for drawing host pixels.
 	  */
-	BitmapConverter<Pixel> bitmapConverter;
+	Output<Pixel> host;
 
-	/** VRAM to pixels converter for sprites.
+	/** Tables and converters for drawing palette indices.
 	  */
-	SpriteConverter<Pixel> spriteConverter;
+	Output<uint8_t> indices;
 
 	/** Line to render at top of display.
 	  * After all, our screen is 240 lines while display is 262 or 313.
 	  */
 	int lineRenderTop;
 
-	/** Host colors corresponding to each VDP palette entry.
-	  * palFg has entry 0 set to the current background color.
-	  *       The 16 first entries are for even pixels, the next 16 are for
-	  *       odd pixels. Second part is only needed (and guaranteed to be
-	  *       up-to-date) in Graphics5 mode.
-	  * palBg has entry 0 set to black.
-	  */
-	Pixel palFg[16 * 2], palBg[16];
-
-	/** Host colors corresponding to each Graphic 7 sprite color.
-	  */
-	Pixel palGraphic7Sprites[16];
-
-	/** Precalculated host colors corresponding to each possible V9938 color.
-	  * Used by updatePalette to adjust palFg and palBg.
-	  */
-	Pixel V9938_COLORS[8][8][8];
-
-	/** Host colors corresponding to the 256 color palette of Graphic7.
-	  * Used by BitmapConverter.
+	/** The palette snapshot the indices refer to in the current display
+	  * mode.
 	  */
-	Pixel PALETTE256[256];
+	IndexSpace indexSpace;
 
-	/** Host colors corresponding to each possible V9958 color.
+	/** The snapshot in workFrame for the current palette, or
+	  * RawFrame::NO_PALETTE when a new one is needed.
 	  */
-	Pixel V9958_COLORS[32768];
+	unsigned paletteSnapshot;
 
 	// True iff left/right border optimization can (still) be applied
 	// this frame.
@@ -0,0 +1,114 @@
+#ifndef TESTFRAMES_HH
+#define TESTFRAMES_HH
+
+// Helpers shared by the video tests (ScalerSpeedTest, ScalerAVX2Test,
+// ZMBVSpeedTest, RawFramePoolTest). Not used by openMSX itself.
+
+#include "ScalerOutput.hh"
+#include <SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace openmsx {
+namespace testframes {
+
+/** The pixel format of the 16bpp (RGB565) or 32bpp (ARGB8888) output. */
+template<typename Pixel> SDL_PixelFormat createFormat()
+{
+	SDL_PixelFormat format;
+	format.palette = nullptr;
+	format.colorkey = 0;
+	format.alpha = 0;
+	format.BitsPerPixel = 8 * sizeof(Pixel);
+	format.BytesPerPixel = sizeof(Pixel);
+	format.Aloss = 0;
+	if (sizeof(Pixel) == 4) {
+		format.Rloss = format.Gloss = format.Bloss = 0;
+		format.Rshift = 16; format.Rmask = 0x00FF0000;
+		format.Gshift =  8; format.Gmask = 0x0000FF00;
+		format.Bshift =  0; format.Bmask = 0x000000FF;
+		format.Ashift = 24; format.Amask = 0xFF000000;
+	} else {
+		format.Rloss = 3; format.Gloss = 2; format.Bloss = 3;
+		format.Rshift = 11; format.Rmask = 0xF800;
+		format.Gshift =  5; format.Gmask = 0x07E0;
+		format.Bshift =  0; format.Bmask = 0x001F;
+		format.Ashift =  0; format.Amask = 0;
+	}
+	return format;
+}
+
+/** Converts a 0xRRGGBB color to the format of createFormat<Pixel>(). */
+template<typename Pixel> Pixel toPixel(uint32_t rgb)
+{
+	if (sizeof(Pixel) == 4) return Pixel(rgb);
+	return Pixel(((rgb >> 8) & 0xF800) |
+	             ((rgb >> 5) & 0x07E0) |
+	             ((rgb >> 3) & 0x001F));
+}
+
+/** Stores the output of a scaler in memory instead of on the screen. */
+template<typename Pixel>
+class MemoryScalerOutput final : public ScalerOutput<Pixel>
+{
+public:
+	MemoryScalerOutput(std::vector<Pixel>& buffer_,
+	                   unsigned width_, unsigned height_)
+		: buffer(buffer_), width(width_), height(height_) {}
+
+	unsigned getWidth()  const override { return width; }
+	unsigned getHeight() const override { return height; }
+	Pixel* acquireLine(unsigned y) override { return &buffer[y * width]; }
+	void releaseLine(unsigned /*y*/, Pixel* /*buf*/) override {}
+	void fillLine(unsigned y, Pixel color) override {
+		std::fill_n(&buffer[y * width], width, color);
+	}
+
+private:
+	std::vector<Pixel>& buffer;
+	const unsigned width;
+	const unsigned height;
+};
+
+/** Something that looks a bit like MSX graphics: a 512x64 pixel (repeating)
+  * background of 8x8 tiles with two out of 8 colors each, so lots of edges
+  * and long runs of equal pixels.
+  */
+class MSXTiles
+{
+public:
+	explicit MSXTiles(unsigned seed = 12345)
+		: tiles(64 * 8)
+	{
+		std::minstd_rand random(seed);
+		for (auto& t : tiles) t = random() & 0xFF;
+	}
+
+	/** One of the 8 colors, as 0xRRGGBB. */
+	static uint32_t getPaletteColor(unsigned i)
+	{
+		static const uint32_t palette[8] = {
+			0x000000, 0x20C020, 0x60E060, 0x2020E0,
+			0xE02020, 0x40C0E0, 0xE0E020, 0xFFFFFF,
+		};
+		return palette[i & 7];
+	}
+
+	/** The color (as 0xRRGGBB) of the pixel at MSX coordinates (x, y). */
+	uint32_t getColor(unsigned x, unsigned y) const
+	{
+		uint8_t tile = tiles[((y / 8) % 8) * 64 + (x / 8) % 64];
+		bool set = (tile >> (x & 7)) & ((y & 4) ? 1 : 2);
+		return getPaletteColor(set ? (tile & 7) : ((tile >> 3) & 7));
+	}
+
+private:
+	std::vector<uint8_t> tiles;
+};
+
+} // namespace testframes
+} // namespace openmsx
+
+#endif
@@ -25,6 +25,7 @@ TODO:
 #include "HardwareConfig.hh"
 #include "RendererFactory.hh"
 #include "Renderer.hh"
+#include "PixelRenderer.hh"
 #include "RenderSettings.hh"
 #include "EnumSetting.hh"
 #include "TclObject.hh"
@@ -85,6 +86,7 @@ VDP::VDP(const DeviceConfig& config)
 	, msxYPosInfo      (*this)
 	, msxX256PosInfo   (*this)
 	, msxX512PosInfo   (*this)
+	, frameStatsInfo   (*this)
 	, frameStartTime(getCurrentTime())
 	, irqVertical  (getMotherBoard(), getName() + ".IRQvertical",   config)
 	, irqHorizontal(getMotherBoard(), getName() + ".IRQhorizontal", config)
@@ -1738,6 +1740,42 @@ int VDP::MsxX512PosInfo::calc(const EmuTime& time) const
 }
 
 
+// class FrameStatsInfo
+
+VDP::FrameStatsInfo::FrameStatsInfo(VDP& vdp_)
+	: InfoTopic(vdp_.getMotherBoard().getMachineInfoCommand(),
+		    vdp_.getName() + "_frame_stats")
+	, vdp(vdp_)
+{
+}
+
+void VDP::FrameStatsInfo::execute(array_ref<TclObject> /*tokens*/,
+                                  TclObject& result) const
+{
+	PixelRenderer::FrameStats stats;
+	if (auto* pixelRenderer = dynamic_cast<PixelRenderer*>(vdp.renderer.get())) {
+		stats = pixelRenderer->getFrameStats();
+	}
+	result.addListElement("rendered");
+	result.addListElement(int(stats.rendered));
+	result.addListElement("unchanged");
+	result.addListElement(int(stats.unchanged));
+	result.addListElement("throttled");
+	result.addListElement(int(stats.throttled));
+	result.addListElement("saved_ms");
+	result.addListElement(double(stats.savedTime) / 1000.0);
+}
+
+string VDP::FrameStatsInfo::help(const vector<string>& /*tokens*/) const
+{
+	return "Returns a dict with the number of rendered frames, of frames "
+	       "that were skipped because they were identical to the previous "
+	       "frame ('unchanged', only with adaptive_frameskip) or because "
+	       "emulation was behind realtime ('throttled'), and an estimate "
+	       "of the rasterization time this saved (in ms).";
+}
+
+
 // version 1: initial version
 // version 2: added frameCount
 // version 3: removed verticalAdjust
@@ -889,6 +889,14 @@ private:
 		int calc(const EmuTime& time) const override;
 	} msxX512PosInfo;
 
+	struct FrameStatsInfo final : InfoTopic {
+		explicit FrameStatsInfo(VDP& vdp);
+		void execute(array_ref<TclObject> tokens,
+		             TclObject& result) const override;
+		std::string help(const std::vector<std::string>& tokens) const override;
+		VDP& vdp;
+	} frameStatsInfo;
+
 	/** Renderer that converts this VDP's state into an image.
 	  */
 	std::unique_ptr<Renderer> renderer;
@@ -128,6 +128,9 @@ VDPVRAM::VDPVRAM(VDP& vdp_, unsigned size, EmuTime::param time)
 {
 	(void)time;
 
+	// All writes go via writeCommon() or mark the whole VRAM dirty.
+	data.setDirtyTracking(true);
+
 	vrMode = vdp.getVRMode();
 	setSizeMask(time);
 
@@ -211,6 +214,7 @@ void VDPVRAM::updateVRMode(bool newVRmode, EmuTime::param time)
 	}
 	vrMode = newVRmode;
 	setSizeMask(time);
+	data.markAllDirty();
 
 	if (vrMode) {
 		// switch from VR=0 to VR=1
@@ -305,6 +309,7 @@ void VDPVRAM::change4k8kMapping(bool mapping8k)
 		}
 	}
 	memcpy(&data[0], tmp, sizeof(tmp));
+	data.markAllDirty();
 }
 
 
@@ -329,7 +334,9 @@ void VDPVRAM::serialize(Archive& ar, unsigned /*version*/)
 		setSizeMask(static_cast<MSXDevice&>(vdp).getCurrentTime());
 	}
 
-	ar.serialize_blob("data", &data[0], actualSize);
+	auto& dirty = data.getDirtyPages();
+	ar.serialize_blob("data", &data[0], actualSize, dirty);
+	if (ar.isReverseSnapshot()) dirty.clear();
 	ar.serialize("cmdReadWindow",       cmdReadWindow);
 	ar.serialize("cmdWriteWindow",      cmdWriteWindow);
 	ar.serialize("nameTable",           nameTable);
@@ -555,6 +555,7 @@ private:
 		spriteAttribTable.notify(address, time);
 		spritePatternTable.notify(address, time);
 
+		data.markDirty(address);
 		data[address] = value;
 		#ifdef DEBUG
 		vramTime = time;
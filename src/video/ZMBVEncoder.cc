@@ -3,6 +3,9 @@
 #include "ZMBVEncoder.hh"
 #include "FrameSource.hh"
 #include "PixelOperations.hh"
+#include "ThreadPool.hh"
+#include "HostCPU.hh"
+#include "memory.hh"
 #include "unreachable.hh"
 #include "endian.hh"
 #include <algorithm>
@@ -11,6 +14,13 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -120,6 +130,7 @@ static void createVectorTable()
 ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_, unsigned bpp)
 	: width(width_)
 	, height(height_)
+	, useAVX2(false)
 {
 	setupBuffers(bpp);
 	createVectorTable();
@@ -145,6 +156,19 @@ ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_, unsigned bpp)
 	// Level 6 seems a good compromise between size/speed for THIS test.
 }
 
+ZMBVEncoder::~ZMBVEncoder() = default;
+
+void ZMBVEncoder::setNumThreads(unsigned numThreads)
+{
+	if (numThreads == 0) {
+		// the search is limited by memory bandwidth
+		numThreads = std::min(std::max(1u, std::thread::hardware_concurrency()), 4u);
+	}
+	// the compressing thread also searches a band
+	pool = (numThreads > 1) ? make_unique<ThreadPool>(numThreads - 1)
+	                        : nullptr;
+}
+
 void ZMBVEncoder::setupBuffers(unsigned bpp)
 {
 	switch (bpp) {
@@ -181,6 +205,7 @@ void ZMBVEncoder::setupBuffers(unsigned bpp)
 	unsigned xblocks = width / BLOCK_WIDTH;
 	unsigned yblocks = height / BLOCK_HEIGHT;
 	blockOffsets.resize(xblocks * yblocks);
+	blockVectors.resize(xblocks * yblocks);
 	for (unsigned y = 0; y < yblocks; ++y) {
 		for (unsigned x = 0; x < xblocks; ++x) {
 			blockOffsets[y * xblocks + x] =
@@ -197,12 +222,105 @@ unsigned ZMBVEncoder::neededSize()
 	return f + f / 1000;
 }
 
+#ifdef __SSE2__
+// Horizontal sum of the 32-bit or 16-bit lanes.
+static inline unsigned sumLanes(__m128i acc, uint32_t /*dummy*/)
+{
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+	return _mm_cvtsi128_si32(acc);
+}
+static inline unsigned sumLanes(__m128i acc, uint16_t /*dummy*/)
+{
+	return sumLanes(_mm_madd_epi16(acc, _mm_set1_epi16(1)), uint32_t());
+}
+
+// Adds one to the counters of the equal lanes.
+static inline __m128i countEq(__m128i acc, __m128i x, __m128i y, __m128i mask, uint32_t /*dummy*/)
+{
+	return _mm_sub_epi32(acc, _mm_and_si128(_mm_cmpeq_epi32(x, y), mask));
+}
+static inline __m128i countEq(__m128i acc, __m128i x, __m128i y, __m128i mask, uint16_t /*dummy*/)
+{
+	return _mm_sub_epi16(acc, _mm_and_si128(_mm_cmpeq_epi16(x, y), mask));
+}
+
+// Counts the equal pixels in every 'step'-th row of a block, only the
+// pixels selected by 'mask' (repeated for every 16 bytes) are counted.
+template<class P>
+static inline unsigned countEqualSSE2(const P* pold, const P* pnew,
+                                      unsigned pitch, unsigned step, __m128i mask)
+{
+	const unsigned N = sizeof(__m128i) / sizeof(P);
+	__m128i acc = _mm_setzero_si128();
+	for (unsigned y = 0; y < BLOCK_HEIGHT; y += step) {
+		for (unsigned x = 0; x < BLOCK_WIDTH; x += N) {
+			auto o = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pold + x));
+			auto n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pnew + x));
+			acc = countEq(acc, o, n, mask, P());
+		}
+		pold += pitch * step;
+		pnew += pitch * step;
+	}
+	return sumLanes(acc, P()); // 16-bit counters are at most 2 * 16
+}
+#endif
+
+#if HAVE_AVX2_DISPATCH
+TARGET_AVX2 static inline __m256i countEqAVX2(__m256i acc, __m256i x, __m256i y, uint32_t /*dummy*/)
+{
+	return _mm256_sub_epi32(acc, _mm256_cmpeq_epi32(x, y));
+}
+TARGET_AVX2 static inline __m256i countEqAVX2(__m256i acc, __m256i x, __m256i y, uint16_t /*dummy*/)
+{
+	return _mm256_sub_epi16(acc, _mm256_cmpeq_epi16(x, y));
+}
+
+// Same as countEqualSSE2() for all pixels of the block.
+template<class P>
+TARGET_AVX2 static unsigned countEqualAVX2(const P* pold, const P* pnew, unsigned pitch)
+{
+	const unsigned N = sizeof(__m256i) / sizeof(P);
+	__m256i acc = _mm256_setzero_si256();
+	for (unsigned y = 0; y < BLOCK_HEIGHT; ++y) {
+		for (unsigned x = 0; x < BLOCK_WIDTH; x += N) {
+			auto o = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pold + x));
+			auto n = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pnew + x));
+			acc = countEqAVX2(acc, o, n, P());
+		}
+		pold += pitch;
+		pnew += pitch;
+	}
+	__m128i lo = _mm256_castsi256_si128(acc);
+	__m128i hi = _mm256_extracti128_si256(acc, 1);
+	__m128i sum;
+	if (sizeof(P) == 2) {
+		// 16-bit counters, at most 16 per lane
+		sum = _mm_madd_epi16(_mm_add_epi16(lo, hi), _mm_set1_epi16(1));
+	} else {
+		sum = _mm_add_epi32(lo, hi);
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+	return _mm_cvtsi128_si32(sum);
+}
+#endif
+
+// Number of different pixels between the new block and the old block at
+// the given offset, only looking at one pixel per 4x4 area.
 template<class P>
-unsigned ZMBVEncoder::possibleBlock(int vx, int vy, unsigned offset)
+unsigned ZMBVEncoder::possibleBlock(int vx, int vy, unsigned offset) const
 {
+	auto* pold = &(reinterpret_cast<const P*>(oldframe.data()))[offset + (vy * pitch) + vx];
+	auto* pnew = &(reinterpret_cast<const P*>(newframe.data()))[offset];
+#ifdef __SSE2__
+	// first pixel of every group of 4
+	auto mask = (sizeof(P) == 2) ? _mm_set_epi16(0, 0, 0, -1, 0, 0, 0, -1)
+	                             : _mm_set_epi32(0, 0, 0, -1);
+	unsigned samples = (BLOCK_WIDTH / 4) * (BLOCK_HEIGHT / 4);
+	return samples - countEqualSSE2(pold, pnew, pitch, 4, mask);
+#else
 	int ret = 0;
-	auto* pold = &(reinterpret_cast<P*>(oldframe.data()))[offset + (vy * pitch) + vx];
-	auto* pnew = &(reinterpret_cast<P*>(newframe.data()))[offset];
 	for (unsigned y = 0; y < BLOCK_HEIGHT; y += 4) {
 		for (unsigned x = 0; x < BLOCK_WIDTH; x += 4) {
 			if (pold[x] != pnew[x]) ++ret;
@@ -211,14 +329,27 @@ unsigned ZMBVEncoder::possibleBlock(int vx, int vy, unsigned offset)
 		pnew += pitch * 4;
 	}
 	return ret;
+#endif
 }
 
+// Number of different pixels between the new block and the old block at
+// the given offset.
 template<class P>
-unsigned ZMBVEncoder::compareBlock(int vx, int vy, unsigned offset)
+unsigned ZMBVEncoder::compareBlock(int vx, int vy, unsigned offset) const
 {
+	auto* pold = &(reinterpret_cast<const P*>(oldframe.data()))[offset + (vy * pitch) + vx];
+	auto* pnew = &(reinterpret_cast<const P*>(newframe.data()))[offset];
+	const unsigned pixels = BLOCK_WIDTH * BLOCK_HEIGHT;
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2) {
+		return pixels - countEqualAVX2(pold, pnew, pitch);
+	}
+#endif
+#ifdef __SSE2__
+	return pixels - countEqualSSE2(pold, pnew, pitch, 1, _mm_set1_epi32(-1));
+#else
+	(void)pixels;
 	int ret = 0;
-	auto* pold = &(reinterpret_cast<P*>(oldframe.data()))[offset + (vy * pitch) + vx];
-	auto* pnew = &(reinterpret_cast<P*>(newframe.data()))[offset];
 	for (unsigned y = 0; y < BLOCK_HEIGHT; ++y) {
 		for (unsigned x = 0; x < BLOCK_WIDTH; ++x) {
 			if (pold[x] != pnew[x]) ++ret;
@@ -227,6 +358,80 @@ unsigned ZMBVEncoder::compareBlock(int vx, int vy, unsigned offset)
 		pnew += pitch;
 	}
 	return ret;
+#endif
+}
+
+// Find a good motion vector for block 'b'. Starts from (and on return
+// contains) the best vector of the previous block. Returns the number of
+// different pixels for that vector.
+template<class P>
+unsigned ZMBVEncoder::searchBlock(unsigned b, int& vx, int& vy) const
+{
+	unsigned offset = blockOffsets[b];
+	// first try best vector of previous block
+	unsigned bestchange = compareBlock<P>(vx, vy, offset);
+	if (bestchange >= 4) {
+		int possibles = 64;
+		for (auto& v : vectorTable) {
+			if (possibleBlock<P>(v.x, v.y, offset) < 4) {
+				unsigned testchange = compareBlock<P>(v.x, v.y, offset);
+				if (testchange < bestchange) {
+					bestchange = testchange;
+					vx = v.x;
+					vy = v.y;
+					if (bestchange < 4) break;
+				}
+				--possibles;
+				if (possibles == 0) break;
+			}
+		}
+	}
+	return bestchange;
+}
+
+template<class P>
+void ZMBVEncoder::searchBlocks(unsigned first, unsigned last, int vx, int vy)
+{
+	for (unsigned b = first; b < last; ++b) {
+		unsigned change = searchBlock<P>(b, vx, vy);
+		blockVectors[b] = BlockVector{vx, vy, change};
+	}
+}
+
+template<class P>
+void ZMBVEncoder::searchVectors(unsigned xblocks, unsigned yblocks)
+{
+	useAVX2 = HostCPU::hasAVX2();
+	unsigned numBands = pool ? std::min(pool->getNumThreads() + 1, yblocks) : 1;
+	if (numBands <= 1) {
+		searchBlocks<P>(0, xblocks * yblocks, 0, 0);
+		return;
+	}
+
+	// Bands of whole rows of blocks. The search of a block starts from
+	// the vector of the previous block, for the first block of a band
+	// that's not yet known, so guess (0, 0).
+	auto bandStart = [&](unsigned band) {
+		return ((yblocks * band) / numBands) * xblocks;
+	};
+	pool->parallelFor(numBands, [&](unsigned band) {
+		searchBlocks<P>(bandStart(band), bandStart(band + 1), 0, 0);
+	});
+	// Redo the start of each band with the actual vector of the previous
+	// block, till we find the same vector as before. From there on the
+	// band was already searched with the correct start vector.
+	for (unsigned band = 1; band < numBands; ++band) {
+		unsigned first = bandStart(band);
+		unsigned last  = bandStart(band + 1);
+		int vx = blockVectors[first - 1].x;
+		int vy = blockVectors[first - 1].y;
+		for (unsigned b = first; b < last; ++b) {
+			auto guess = blockVectors[b];
+			unsigned change = searchBlock<P>(b, vx, vy);
+			blockVectors[b] = BlockVector{vx, vy, change};
+			if ((vx == guess.x) && (vy == guess.y)) break;
+		}
+	}
 }
 
 template<class P>
@@ -261,33 +466,14 @@ void ZMBVEncoder::addXorFrame(const SDL_PixelFormat& pixelFormat, unsigned& work
 	// Align the following xor data on 4 byte boundary
 	workUsed = (workUsed + blockcount * 2 + 3) & ~3;
 
-	int bestvx = 0;
-	int bestvy = 0;
+	searchVectors<P>(xblocks, yblocks);
 	for (unsigned b = 0; b < blockcount; ++b) {
-		unsigned offset = blockOffsets[b];
-		// first try best vector of previous block
-		unsigned bestchange = compareBlock<P>(bestvx, bestvy, offset);
-		if (bestchange >= 4) {
-			int possibles = 64;
-			for (auto& v : vectorTable) {
-				if (possibleBlock<P>(v.x, v.y, offset) < 4) {
-					unsigned testchange = compareBlock<P>(v.x, v.y, offset);
-					if (testchange < bestchange) {
-						bestchange = testchange;
-						bestvx = v.x;
-						bestvy = v.y;
-						if (bestchange < 4) break;
-					}
-					--possibles;
-					if (possibles == 0) break;
-				}
-			}
-		}
-		vectors[b * 2 + 0] = (bestvx << 1);
-		vectors[b * 2 + 1] = (bestvy << 1);
-		if (bestchange) {
+		auto& v = blockVectors[b];
+		vectors[b * 2 + 0] = (v.x << 1);
+		vectors[b * 2 + 1] = (v.y << 1);
+		if (v.change) {
 			vectors[b * 2 + 0] |= 1;
-			addXorBlock<P>(pixelOps, bestvx, bestvy, offset, workUsed);
+			addXorBlock<P>(pixelOps, v.x, v.y, blockOffsets[b], workUsed);
 		}
 	}
 }
@@ -311,7 +497,7 @@ void ZMBVEncoder::addFullFrame(const SDL_PixelFormat& pixelFormat, unsigned& wor
 	}
 }
 
-const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf_)
+const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf_) const
 {
 #if HAVE_32BPP
 	if (pixelSize == 4) { // 32bpp
@@ -347,14 +533,11 @@ const void* ZMBVEncoder::getScaledLine(FrameSource* frame, unsigned y, void* buf
 	return nullptr; // avoid warning
 }
 
-void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
-                                void*& buffer, unsigned& written)
+uint8_t* ZMBVEncoder::startFrame(bool keyFrame, unsigned& writeDone)
 {
 	std::swap(newframe, oldframe); // replace oldframe with newframe
 
-	// Reset the work buffer
-	unsigned workUsed = 0;
-	unsigned writeDone = 1;
+	writeDone = 1;
 	uint8_t* writeBuf = output.data();
 
 	output[0] = 0; // first byte contains info about this frame
@@ -372,29 +555,76 @@ void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
 		deflateReset(&zstream); // restart deflate
 	}
 
+	// the new frame is copied in here (with a black border)
+	return &newframe[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
+}
+
+void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
+                                void*& buffer, unsigned& written)
+{
+	unsigned writeDone;
+	uint8_t* dest = startFrame(keyFrame, writeDone);
+
 	// copy lines (to add black border)
 	unsigned linePitch = pitch * pixelSize;
 	unsigned lineWidth = width * pixelSize;
-	uint8_t* dest =
-		&newframe[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
 	for (unsigned i = 0; i < height; ++i) {
 		auto* scaled = getScaledLine(frame, i, dest);
 		if (scaled != dest) memcpy(dest, scaled, lineWidth);
 		dest += linePitch;
 	}
 
+	finishFrame(keyFrame, frame->getSDLPixelFormat(), writeDone,
+	            buffer, written);
+}
+
+void ZMBVEncoder::compressFrame(bool keyFrame, const void* image,
+                                const SDL_PixelFormat& pixelFormat,
+                                void*& buffer, unsigned& written)
+{
+	unsigned writeDone;
+	uint8_t* dest = startFrame(keyFrame, writeDone);
+
+	// copy lines (to add black border)
+	unsigned linePitch = pitch * pixelSize;
+	unsigned lineWidth = width * pixelSize;
+	auto* src = static_cast<const uint8_t*>(image);
+	for (unsigned i = 0; i < height; ++i) {
+		memcpy(dest, src, lineWidth);
+		dest += linePitch;
+		src += lineWidth;
+	}
+
+	finishFrame(keyFrame, pixelFormat, writeDone, buffer, written);
+}
+
+void ZMBVEncoder::captureFrame(FrameSource* frame, void* image) const
+{
+	unsigned lineWidth = width * pixelSize;
+	auto* dest = static_cast<uint8_t*>(image);
+	for (unsigned i = 0; i < height; ++i) {
+		auto* scaled = getScaledLine(frame, i, dest);
+		if (scaled != dest) memcpy(dest, scaled, lineWidth);
+		dest += lineWidth;
+	}
+}
+
+void ZMBVEncoder::finishFrame(bool keyFrame, const SDL_PixelFormat& pixelFormat,
+                              unsigned writeDone, void*& buffer, unsigned& written)
+{
 	// Add the frame data.
+	unsigned workUsed = 0;
 	if (keyFrame) {
 		// Key frame: full frame data.
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addFullFrame<uint16_t>(frame->getSDLPixelFormat(), workUsed);
+			addFullFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addFullFrame<uint32_t>(frame->getSDLPixelFormat(), workUsed);
+			addFullFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
@@ -405,12 +635,12 @@ void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
 		switch (pixelSize) {
 #if HAVE_16BPP
 		case 2:
-			addXorFrame<uint16_t>(frame->getSDLPixelFormat(), workUsed);
+			addXorFrame<uint16_t>(pixelFormat, workUsed);
 			break;
 #endif
 #if HAVE_32BPP
 		case 4:
-			addXorFrame<uint32_t>(frame->getSDLPixelFormat(), workUsed);
+			addXorFrame<uint32_t>(pixelFormat, workUsed);
 			break;
 #endif
 		default:
@@ -422,7 +652,7 @@ void ZMBVEncoder::compressFrame(bool keyFrame, FrameSource* frame,
 	zstream.avail_in = workUsed;
 	zstream.total_in = 0;
 
-	zstream.next_out = static_cast<Bytef*>(writeBuf + writeDone);
+	zstream.next_out = static_cast<Bytef*>(output.data() + writeDone);
 	zstream.avail_out = outputSize - writeDone;
 	zstream.total_out = 0;
 	deflate(&zstream, Z_SYNC_FLUSH);
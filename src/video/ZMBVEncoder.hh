@@ -5,6 +5,8 @@
 
 #include "MemBuffer.hh"
 #include <cstdint>
+#include <memory>
+#include <vector>
 #include <zlib.h>
 
 struct SDL_PixelFormat;
@@ -12,6 +14,7 @@ struct SDL_PixelFormat;
 namespace openmsx {
 
 class FrameSource;
+class ThreadPool;
 template<class P> class PixelOperations;
 
 class ZMBVEncoder
@@ -20,10 +23,38 @@ public:
 	static const char* CODEC_4CC;
 
 	ZMBVEncoder(unsigned width, unsigned height, unsigned bpp);
+	~ZMBVEncoder();
+
+	/** Search the motion vectors of (bands of) blocks on this number of
+	  * threads, including the thread that compresses the frame. These
+	  * threads are owned by the encoder, so the search never waits for
+	  * unrelated work. The result is the same as when searching on a
+	  * single thread (the default).
+	  * @param numThreads 0 means one per hardware thread (max 4).
+	  */
+	void setNumThreads(unsigned numThreads);
 
 	void compressFrame(bool keyFrame, FrameSource* frame,
 	                   void*& buffer, unsigned& written);
 
+	/** Like above, but for an image that was earlier stored with
+	  * captureFrame(). */
+	void compressFrame(bool keyFrame, const void* image,
+	                   const SDL_PixelFormat& pixelFormat,
+	                   void*& buffer, unsigned& written);
+
+	/** Stores a (scaled) copy of the given frame, so that it can be
+	  * compressed later, when the frame itself may have changed. Only
+	  * reads the encoder's (fixed) settings, so this can be called while
+	  * another thread is compressing.
+	  * @param image Buffer of getImageSize() bytes.
+	  */
+	void captureFrame(FrameSource* frame, void* image) const;
+	unsigned getImageSize() const { return width * height * pixelSize; }
+
+	/** Upper bound for the size of a compressed frame. */
+	unsigned getMaxFrameSize() const { return outputSize; }
+
 private:
 	enum Format {
 		ZMBV_FORMAT_16BPP = 6,
@@ -34,27 +65,42 @@ private:
 	unsigned neededSize();
 	template<class P> void addFullFrame(const SDL_PixelFormat& pixelFormat, unsigned& workUsed);
 	template<class P> void addXorFrame (const SDL_PixelFormat& pixelFormat, unsigned& workUsed);
-	template<class P> unsigned possibleBlock(int vx, int vy, unsigned offset);
-	template<class P> unsigned compareBlock(int vx, int vy, unsigned offset);
+	struct BlockVector {
+		int x;
+		int y;
+		unsigned change; // number of different pixels
+	};
+
+	template<class P> unsigned possibleBlock(int vx, int vy, unsigned offset) const;
+	template<class P> unsigned compareBlock(int vx, int vy, unsigned offset) const;
+	template<class P> unsigned searchBlock(unsigned b, int& vx, int& vy) const;
+	template<class P> void searchBlocks(unsigned first, unsigned last, int vx, int vy);
+	template<class P> void searchVectors(unsigned xblocks, unsigned yblocks);
 	template<class P> void addXorBlock(
 		const PixelOperations<P>& pixelOps, int vx, int vy,
 		unsigned offset, unsigned& workUsed);
-	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf);
+	const void* getScaledLine(FrameSource* frame, unsigned y, void* workBuf) const;
+	uint8_t* startFrame(bool keyFrame, unsigned& writeDone);
+	void finishFrame(bool keyFrame, const SDL_PixelFormat& pixelFormat,
+	                 unsigned writeDone, void*& buffer, unsigned& written);
 
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> oldframe;
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> newframe;
 	MemBuffer<uint8_t, SSE2_ALIGNMENT> work;
 	MemBuffer<uint8_t> output;
 	MemBuffer<unsigned> blockOffsets;
+	std::vector<BlockVector> blockVectors;
 	unsigned outputSize;
 
 	z_stream zstream;
+	std::unique_ptr<ThreadPool> pool; // nullptr when single threaded
 
 	const unsigned width;
 	const unsigned height;
 	unsigned pitch;
 	unsigned pixelSize;
 	Format format;
+	bool useAVX2;
 };
 
 } // namespace openmsx
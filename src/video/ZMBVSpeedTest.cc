@@ -0,0 +1,112 @@
+// Measures the speed of the ZMBV encoder (as used for 'record') for the
+// different recording sizes, with the motion vector search on 1..N threads
+// and with/without AVX2. Also checks that all variants produce exactly the
+// same output.
+//
+// Usage: ZMBVSpeedTest [<max-threads> [<frames>]]
+//
+// The frames look a bit like a recorded MSX game: a scrolling tile
+// background with some moving sprites, scaled to the recording size.
+
+#include "ZMBVEncoder.hh"
+#include "HostCPU.hh"
+#include "TestFrames.hh"
+#include <SDL.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+using namespace openmsx::testframes;
+
+template<typename Pixel>
+static vector<Pixel> createFrame(unsigned width, unsigned height, unsigned n,
+                                 const MSXTiles& tiles)
+{
+	vector<Pixel> frame(width * height);
+	unsigned scale = width / 320;
+	unsigned scroll = n / 2; // scrolls one MSX pixel every 2 frames
+	for (unsigned y = 0; y < height; ++y) {
+		unsigned my = y / scale;
+		for (unsigned x = 0; x < width; ++x) {
+			unsigned mx = x / scale;
+			uint32_t color = tiles.getColor(mx + scroll, my);
+			// a few 16x16 sprites moving in different directions
+			for (unsigned s = 0; s < 4; ++s) {
+				unsigned sx = (40 + 70 * s + n * (s + 1)) % 320;
+				unsigned sy = (30 + 50 * s + n * (3 - s)) % 240;
+				if (((mx - sx) < 16) && ((my - sy) < 16)) color = MSXTiles::getPaletteColor(7 - s);
+			}
+			frame[y * width + x] = toPixel<Pixel>(color);
+		}
+	}
+	return frame;
+}
+
+template<typename Pixel>
+static void test(unsigned maxThreads, unsigned numFrames, int& result)
+{
+	unsigned bpp = 8 * sizeof(Pixel);
+	SDL_PixelFormat format = createFormat<Pixel>();
+	MSXTiles tiles;
+
+	for (unsigned height : {240, 480, 720}) {
+		unsigned width = height * 4 / 3;
+		vector<vector<Pixel>> frames;
+		for (unsigned n = 0; n < numFrames; ++n) {
+			frames.push_back(createFrame<Pixel>(width, height, n, tiles));
+		}
+
+		vector<uint8_t> reference;
+		for (bool avx2 : {false, true}) {
+			HostCPU::setAVX2(avx2);
+			if (avx2 && !HostCPU::hasAVX2()) continue;
+			cout << setw(2) << bpp << "bpp " << setw(3) << height
+			     << (avx2 ? " AVX2 " : "      ") << right;
+			for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+				ZMBVEncoder encoder(width, height, bpp);
+				encoder.setNumThreads(threads);
+
+				vector<uint8_t> output;
+				auto start = chrono::steady_clock::now();
+				for (unsigned n = 0; n < numFrames; ++n) {
+					void* buffer;
+					unsigned size;
+					encoder.compressFrame((n % 300) == 0, frames[n].data(),
+					                      format, buffer, size);
+					auto* p = static_cast<uint8_t*>(buffer);
+					output.insert(output.end(), p, p + size);
+				}
+				double elapsed = chrono::duration<double>(
+					chrono::steady_clock::now() - start).count();
+				cout << setw(9) << fixed << setprecision(1) << (numFrames / elapsed);
+
+				if (reference.empty()) {
+					reference = output;
+				} else if (output != reference) {
+					cout << " (DIFFERENT OUTPUT)";
+					result = 1;
+				}
+			}
+			cout << endl;
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned maxThreads = (argc > 1) ? atoi(argv[1])
+	                                 : max(1u, thread::hardware_concurrency());
+	unsigned numFrames = (argc > 2) ? atoi(argv[2]) : 200;
+
+	int result = 0;
+	cout << "frames/sec at 1.." << maxThreads << " threads" << endl;
+	test<uint32_t>(maxThreads, numFrames, result);
+	test<uint16_t>(maxThreads, numFrames, result);
+	return result;
+}
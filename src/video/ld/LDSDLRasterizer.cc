@@ -14,7 +14,7 @@ LDSDLRasterizer<Pixel>::LDSDLRasterizer(
 		VisibleSurface& screen,
 		std::unique_ptr<PostProcessor> postProcessor_)
 	: postProcessor(std::move(postProcessor_))
-	, workFrame(make_unique<RawFrame>(screen.getSDLFormat(), 640, 480))
+	, workFrame(postProcessor->acquireFrame())
 	, pixelFormat(screen.getSDLFormat())
 {
 }
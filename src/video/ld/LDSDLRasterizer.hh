@@ -2,13 +2,13 @@
 #define LDSDLRASTERIZER_HH
 
 #include "LDRasterizer.hh"
+#include "RawFramePool.hh"
 #include <SDL.h>
 #include <memory>
 
 namespace openmsx {
 
 class VisibleSurface;
-class RawFrame;
 class PostProcessor;
 
 /** Rasterizer using a frame buffer approach: it writes pixels to a single
@@ -37,7 +37,7 @@ private:
 
 	/** The next frame as it is delivered by the VDP, work in progress.
 	  */
-	std::unique_ptr<RawFrame> workFrame;
+	RawFramePool::Ref workFrame;
 
 	const SDL_PixelFormat pixelFormat;
 };
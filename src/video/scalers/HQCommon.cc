@@ -0,0 +1,127 @@
+#include "HQCommon.hh"
+
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+
+namespace openmsx {
+
+// 8 pixels at once, same result as readPixel().
+TARGET_AVX2 static inline __m256i readPixels(const uint32_t* p)
+{
+	__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+	return _mm256_and_si256(v, _mm256_set1_epi32(0xF8F8F8F8));
+}
+TARGET_AVX2 static inline __m256i readPixels(const uint16_t* p)
+{
+	__m256i v = _mm256_cvtepu16_epi32(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+	__m256i r = _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xF800)), 8);
+	__m256i g = _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0x07C0)), 5);
+	__m256i b = _mm256_slli_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0x001F)), 3);
+	return _mm256_or_si256(_mm256_or_si256(r, g), b);
+}
+
+// Same as EdgeHQ::operator(), but for 8 pairs of pixels. Returns all ones
+// in the lanes with an edge.
+class EdgeHQ_AVX2
+{
+public:
+	TARGET_AVX2 explicit EdgeHQ_AVX2(EdgeHQ edgeOp)
+		: shiftR(_mm_cvtsi32_si128(edgeOp.getShiftR()))
+		, shiftG(_mm_cvtsi32_si128(edgeOp.getShiftG()))
+		, shiftB(_mm_cvtsi32_si128(edgeOp.getShiftB()))
+	{
+	}
+
+	TARGET_AVX2 inline __m256i operator()(__m256i c1, __m256i c2) const
+	{
+		// Equal colors always give zero differences, so (unlike the
+		// scalar version) there's no need for an explicit test.
+		__m256i mask = _mm256_set1_epi32(0xFF);
+		__m256i dr = _mm256_sub_epi32(
+			_mm256_and_si256(_mm256_srl_epi32(c1, shiftR), mask),
+			_mm256_and_si256(_mm256_srl_epi32(c2, shiftR), mask));
+		__m256i dg = _mm256_sub_epi32(
+			_mm256_and_si256(_mm256_srl_epi32(c1, shiftG), mask),
+			_mm256_and_si256(_mm256_srl_epi32(c2, shiftG), mask));
+		__m256i db = _mm256_sub_epi32(
+			_mm256_and_si256(_mm256_srl_epi32(c1, shiftB), mask),
+			_mm256_and_si256(_mm256_srl_epi32(c2, shiftB), mask));
+
+		__m256i dy = _mm256_add_epi32(_mm256_add_epi32(dr, dg), db);
+		__m256i du = _mm256_sub_epi32(dr, db);
+		__m256i dv = _mm256_sub_epi32(
+			_mm256_add_epi32(_mm256_add_epi32(dg, dg), dg), dy);
+
+		__m256i ey = _mm256_cmpgt_epi32(_mm256_abs_epi32(dy), _mm256_set1_epi32(0xC0));
+		__m256i eu = _mm256_cmpgt_epi32(_mm256_abs_epi32(du), _mm256_set1_epi32(0x1C));
+		__m256i ev = _mm256_cmpgt_epi32(_mm256_abs_epi32(dv), _mm256_set1_epi32(0x30));
+		return _mm256_or_si256(_mm256_or_si256(ey, eu), ev);
+	}
+
+private:
+	const __m128i shiftR;
+	const __m128i shiftG;
+	const __m128i shiftB;
+};
+
+template <typename Pixel>
+TARGET_AVX2 void calcEdgesHQ_AVX2(
+	const Pixel* __restrict in1, const Pixel* __restrict in2,
+	unsigned srcWidth, unsigned* __restrict edges, EdgeHQ edgeOp)
+{
+	EdgeHQ_AVX2 edgeOp8(edgeOp);
+	__m256i bitB  = _mm256_set1_epi32(1 << 5);
+	__m256i bitBR = _mm256_set1_epi32(1 << 6);
+	__m256i bitRB = _mm256_set1_epi32(1 << 7);
+	__m256i bitR  = _mm256_set1_epi32(1 << 8);
+
+	// The pixels on the right must exist, the last few pixels (at least
+	// one) are handled below.
+	unsigned x = 0;
+	for (/**/; (x + 8) < srcWidth; x += 8) {
+		__m256i c5 = readPixels(in1 + x);
+		__m256i c6 = readPixels(in1 + x + 1);
+		__m256i c8 = readPixels(in2 + x);
+		__m256i c9 = readPixels(in2 + x + 1);
+		__m256i pattern = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_and_si256(edgeOp8(c5, c8), bitB),
+				_mm256_and_si256(edgeOp8(c5, c9), bitBR)),
+			_mm256_or_si256(
+				_mm256_and_si256(edgeOp8(c6, c8), bitRB),
+				_mm256_and_si256(edgeOp8(c5, c6), bitR)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(edges + x), pattern);
+	}
+
+	uint32_t c6 = readPixel(in1[x]);
+	uint32_t c9 = readPixel(in2[x]);
+	for (/**/; x < srcWidth; ++x) {
+		uint32_t c5 = c6;
+		uint32_t c8 = c9;
+		if (x != srcWidth - 1) {
+			c6 = readPixel(in1[x + 1]);
+			c9 = readPixel(in2[x + 1]);
+		}
+		unsigned pattern = 0;
+		if (edgeOp(c5, c8)) pattern |= 1 << 5;
+		if (edgeOp(c5, c9)) pattern |= 1 << 6;
+		if (edgeOp(c6, c8)) pattern |= 1 << 7;
+		if (edgeOp(c5, c6)) pattern |= 1 << 8;
+		edges[x] = pattern;
+	}
+}
+
+// Force template instantiation.
+#if HAVE_16BPP
+template void calcEdgesHQ_AVX2<uint16_t>(
+	const uint16_t*, const uint16_t*, unsigned, unsigned*, EdgeHQ);
+#endif
+#if HAVE_32BPP
+template void calcEdgesHQ_AVX2<uint32_t>(
+	const uint32_t*, const uint32_t*, unsigned, unsigned*, EdgeHQ);
+#endif
+
+} // namespace openmsx
+
+#endif // HAVE_AVX2_DISPATCH
@@ -6,6 +6,7 @@
 #include "LineScalers.hh"
 #include "PixelOperations.hh"
 #include "vla.hh"
+#include "HostCPU.hh"
 #include "build-info.hh"
 #include <algorithm>
 #include <cassert>
@@ -74,6 +75,11 @@ public:
 
 		return false;
 	}
+
+	unsigned getShiftR() const { return shiftR; }
+	unsigned getShiftG() const { return shiftG; }
+	unsigned getShiftB() const { return shiftB; }
+
 private:
 	const unsigned shiftR;
 	const unsigned shiftG;
@@ -92,6 +98,48 @@ EdgeHQ createEdgeHQ(const PixelOperations<Pixel>& pixelOps)
 	}
 }
 
+#if HAVE_AVX2_DISPATCH
+// Implemented in HQCommon.cc, same result as calcEdgesHQ().
+template <typename Pixel>
+TARGET_AVX2 void calcEdgesHQ_AVX2(const Pixel* in1, const Pixel* in2, unsigned srcWidth,
+                      unsigned* edges, EdgeHQ edgeOp);
+#endif
+
+/** Calculates the bits of the hq pattern that don't overlap with the
+  * pattern of the pixel on the left or above (see HQ2xScaler):
+  *   bit 5: c5-c8, bit 6: c5-c9, bit 7: c6-c8, bit 8: c5-c6
+  * for all pixels of the line 'in1' (c5) at once. 'in2' is the line below,
+  * the last pixel of both lines is repeated on the right.
+  */
+template <typename Pixel>
+static void calcEdgesHQ(
+	const Pixel* __restrict in1, const Pixel* __restrict in2,
+	unsigned srcWidth, unsigned* __restrict edges, EdgeHQ edgeOp)
+{
+#if HAVE_AVX2_DISPATCH
+	if (HostCPU::hasAVX2()) {
+		calcEdgesHQ_AVX2(in1, in2, srcWidth, edges, edgeOp);
+		return;
+	}
+#endif
+	uint32_t c6 = readPixel(in1[0]);
+	uint32_t c9 = readPixel(in2[0]);
+	for (unsigned x = 0; x < srcWidth; ++x) {
+		uint32_t c5 = c6;
+		uint32_t c8 = c9;
+		if (x != srcWidth - 1) {
+			c6 = readPixel(in1[x + 1]);
+			c9 = readPixel(in2[x + 1]);
+		}
+		unsigned pattern = 0;
+		if (edgeOp(c5, c8)) pattern |= 1 << 5; // B
+		if (edgeOp(c5, c9)) pattern |= 1 << 6; // BR
+		if (edgeOp(c6, c8)) pattern |= 1 << 7; // BR
+		if (edgeOp(c5, c6)) pattern |= 1 << 8; // R
+		edges[x] = pattern;
+	}
+}
+
 struct EdgeHQLite
 {
 	inline bool operator()(uint32_t c1, uint32_t c2) const
@@ -24,6 +24,8 @@ public:
 	void scaleImage(FrameSource& src, const RawFrame* superImpose,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) override;
+	// Edges are followed over the whole area.
+	bool canSplit() const override { return false; }
 
 private:
 	const PixelOperations<Pixel> pixelOps;
@@ -0,0 +1,97 @@
+#include "ParallelScaler.hh"
+#include "Scaler.hh"
+#include "ScalerOutput.hh"
+#include "ThreadPool.hh"
+#include "memory.hh"
+#include "build-info.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+
+namespace openmsx {
+
+// Scaling is mostly limited by memory bandwidth, more threads don't help.
+static const unsigned MAX_AUTO_THREADS = 4;
+
+// Don't split small areas, the overhead of starting a band is larger than
+// the gain.
+static const unsigned MIN_BAND_LINES = 16;
+
+template<typename Pixel>
+ParallelScaler<Pixel>::ParallelScaler() = default;
+
+template<typename Pixel>
+ParallelScaler<Pixel>::~ParallelScaler() = default;
+
+template<typename Pixel>
+void ParallelScaler<Pixel>::setScaler(
+	unsigned numThreads, const CreateScaler& create)
+{
+	scalers.clear();
+	scalers.push_back(create());
+	if (!scalers.front()->canSplit()) {
+		numThreads = 1;
+	} else if (numThreads == 0) {
+		numThreads = std::min(std::max(1u, std::thread::hardware_concurrency()),
+		                      MAX_AUTO_THREADS);
+	}
+	if ((numThreads > 1) != bool(pool) ||
+	    (pool && (pool->getNumThreads() != (numThreads - 1)))) {
+		// the calling thread also scales a band
+		pool = (numThreads > 1) ? make_unique<ThreadPool>(numThreads - 1)
+		                        : nullptr;
+	}
+	for (unsigned i = 1; i < numThreads; ++i) {
+		scalers.push_back(create());
+	}
+}
+
+template<typename Pixel>
+bool ParallelScaler<Pixel>::canSplit() const
+{
+	assert(!scalers.empty());
+	return scalers.front()->canSplit();
+}
+
+template<typename Pixel>
+void ParallelScaler<Pixel>::scaleImage(
+	FrameSource& src, const RawFrame* superImpose,
+	unsigned srcStartY, unsigned srcEndY, unsigned srcStep,
+	unsigned srcWidth, const CreateOutput& createOutput,
+	unsigned dstStartY, unsigned dstEndY, unsigned dstStep)
+{
+	assert(!scalers.empty());
+	assert(((srcEndY - srcStartY) % srcStep) == 0);
+	unsigned units = (srcEndY - srcStartY) / srcStep;
+	assert((dstEndY - dstStartY) == units * dstStep); (void)dstEndY;
+
+	unsigned maxBands = std::max(1u, (units * dstStep) / MIN_BAND_LINES);
+	unsigned numBands = std::min({getNumThreads(), units, maxBands});
+	auto scaleBand = [&](unsigned band) {
+		unsigned first = (units * (band + 0)) / numBands;
+		unsigned last  = (units * (band + 1)) / numBands;
+		auto dst = createOutput();
+		scalers[band]->scaleImage(
+			src, superImpose,
+			srcStartY + first * srcStep, srcStartY + last * srcStep,
+			srcWidth,
+			*dst, dstStartY + first * dstStep, dstStartY + last * dstStep);
+	};
+	if (numBands == 1) {
+		scaleBand(0);
+	} else {
+		pool->parallelFor(numBands, scaleBand);
+	}
+}
+
+
+// Force template instantiation.
+#if HAVE_16BPP
+template class ParallelScaler<uint16_t>;
+#endif
+#if HAVE_32BPP
+template class ParallelScaler<uint32_t>;
+#endif
+
+} // namespace openmsx
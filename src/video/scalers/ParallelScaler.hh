@@ -0,0 +1,65 @@
+#ifndef PARALLELSCALER_HH
+#define PARALLELSCALER_HH
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace openmsx {
+
+class FrameSource;
+class RawFrame;
+class ThreadPool;
+template<typename Pixel> class Scaler;
+template<typename Pixel> class ScalerOutput;
+
+/** Runs a (software) scaler on several threads by splitting the image in
+  * horizontal bands.
+  *
+  * Each band is scaled by its own Scaler object (some scalers lazily update
+  * lookup tables while scaling) and writes to its own ScalerOutput, so the
+  * bands don't share any mutable state and write disjoint destination lines.
+  * The neighbourhood-based scalers (hq, SaI, ...) read the one or two source
+  * lines just outside their band directly from the (read-only) source frame,
+  * so the result is identical to scaling the whole area at once.
+  */
+template<typename Pixel> class ParallelScaler
+{
+public:
+	using CreateScaler = std::function<std::unique_ptr<Scaler<Pixel>>()>;
+	using CreateOutput = std::function<std::unique_ptr<ScalerOutput<Pixel>>()>;
+
+	ParallelScaler();
+	~ParallelScaler();
+
+	/** (Re)creates the scaler objects and the worker threads.
+	  * @param numThreads Number of threads, including the calling thread.
+	  *                   0 means one per hardware thread (max 4).
+	  *                   Always 1 for scalers that can't be split.
+	  * @param create Creates a new Scaler object, called once per thread.
+	  */
+	void setScaler(unsigned numThreads, const CreateScaler& create);
+
+	unsigned getNumThreads() const { return unsigned(scalers.size()); }
+
+	/** See Scaler::canSplit(). */
+	bool canSplit() const;
+
+	/** Like Scaler::scaleImage(). The area consists of units of 'srcStep'
+	  * source lines that map to 'dstStep' destination lines, bands are
+	  * always a multiple of these units.
+	  * @param createOutput Creates a new destination object, one per band.
+	  */
+	void scaleImage(FrameSource& src, const RawFrame* superImpose,
+		unsigned srcStartY, unsigned srcEndY, unsigned srcStep,
+		unsigned srcWidth, const CreateOutput& createOutput,
+		unsigned dstStartY, unsigned dstEndY, unsigned dstStep);
+
+private:
+	std::vector<std::unique_ptr<Scaler<Pixel>>> scalers;
+	std::unique_ptr<ThreadPool> pool; // nullptr when single threaded
+};
+
+} // namespace openmsx
+
+#endif
@@ -15,16 +15,21 @@ Visit the Scale2x site for info:
 #include "ScalerOutput.hh"
 #include "unreachable.hh"
 #include "vla.hh"
+#include "HostCPU.hh"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #ifdef __SSE2__
 #include "emmintrin.h" // SSE2
 #ifdef __SSSE3__
 #include "tmmintrin.h" // SSSE3  (supplemental SSE3)
 #endif
 #endif
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
@@ -206,6 +211,116 @@ template<bool DOUBLE_X, typename Pixel> static inline void scaleSSE(
 #endif
 
 
+#if HAVE_AVX2_DISPATCH
+
+// Same as select() above, but 32 bytes at once.
+TARGET_AVX2 static inline __m256i select256(__m256i a0, __m256i a1, __m256i mask)
+{
+	return _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(a0, a1), mask), a0);
+}
+
+template<typename Pixel> TARGET_AVX2 static inline __m256i isEqual256(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_cmpeq_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_cmpeq_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+// Note: like all AVX2 unpack instructions these work per 128-bit lane.
+template<typename Pixel> TARGET_AVX2 static inline __m256i unpacklo256(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_unpacklo_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_unpacklo_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+template<typename Pixel> TARGET_AVX2 static inline __m256i unpackhi256(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_unpackhi_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_unpackhi_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+
+// AVX2 version of scaleSSE(), same result. Unlike the SSE version the lines
+// don't need to be aligned. The width (in bytes) must be a multiple of 32.
+template<bool DOUBLE_X, typename Pixel> TARGET_AVX2 static void scaleAVX2(
+	      Pixel* __restrict out0,  // top output line
+	      Pixel* __restrict out1,  // bottom output line
+	const Pixel* __restrict in0,   // top input line
+	const Pixel* __restrict in1,   // middle input line
+	const Pixel* __restrict in2,   // bottom input line
+	size_t width)
+{
+	static const size_t N = sizeof(__m256i) / sizeof(Pixel);
+	assert(width && ((width % N) == 0));
+
+	// Middle line with the first and last pixel repeated, so that the
+	// left and right neighbours are simply unaligned loads.
+	VLA(Pixel, ext, width + 2);
+	ext[0] = in1[0];
+	memcpy(ext + 1, in1, width * sizeof(Pixel));
+	ext[width + 1] = in1[width - 1];
+
+	for (size_t x = 0; x < width; x += N) {
+		__m256i top    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in0 + x));
+		__m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in2 + x));
+		__m256i left   = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ext + x + 0));
+		__m256i mid    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ext + x + 1));
+		__m256i right  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ext + x + 2));
+
+		__m256i teqb = isEqual256<Pixel>(top, bottom);
+		__m256i leqt = isEqual256<Pixel>(left, top);
+		__m256i reqt = isEqual256<Pixel>(right, top);
+		__m256i leqb = isEqual256<Pixel>(left, bottom);
+		__m256i reqb = isEqual256<Pixel>(right, bottom);
+
+		__m256i cnda = _mm256_andnot_si256(_mm256_or_si256(teqb, reqt), leqt);
+		__m256i cndb = _mm256_andnot_si256(_mm256_or_si256(teqb, leqt), reqt);
+		__m256i cndc = _mm256_andnot_si256(_mm256_or_si256(teqb, reqb), leqb);
+		__m256i cndd = _mm256_andnot_si256(_mm256_or_si256(teqb, leqb), reqb);
+
+		__m256i a = select256(mid, top,    cnda);
+		__m256i b = select256(mid, top,    cndb);
+		__m256i c = select256(mid, bottom, cndc);
+		__m256i d = select256(mid, bottom, cndd);
+
+		if (DOUBLE_X) {
+			auto* o0 = reinterpret_cast<__m256i*>(out0 + 2 * x);
+			auto* o1 = reinterpret_cast<__m256i*>(out1 + 2 * x);
+			__m256i ablo = unpacklo256<Pixel>(a, b);
+			__m256i abhi = unpackhi256<Pixel>(a, b);
+			__m256i cdlo = unpacklo256<Pixel>(c, d);
+			__m256i cdhi = unpackhi256<Pixel>(c, d);
+			_mm256_storeu_si256(o0 + 0, _mm256_permute2x128_si256(ablo, abhi, 0x20));
+			_mm256_storeu_si256(o0 + 1, _mm256_permute2x128_si256(ablo, abhi, 0x31));
+			_mm256_storeu_si256(o1 + 0, _mm256_permute2x128_si256(cdlo, cdhi, 0x20));
+			_mm256_storeu_si256(o1 + 1, _mm256_permute2x128_si256(cdlo, cdhi, 0x31));
+		} else {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out0 + x), a);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out1 + x), c);
+		}
+	}
+}
+
+template<typename Pixel> static inline bool useAVX2(size_t width)
+{
+	return HostCPU::hasAVX2() &&
+	       (((width * sizeof(Pixel)) % sizeof(__m256i)) == 0);
+}
+
+#endif // HAVE_AVX2_DISPATCH
+
+
 template <class Pixel>
 Scale2xScaler<Pixel>::Scale2xScaler(const PixelOperations<Pixel>& pixelOps_)
 	: Scaler2<Pixel>(pixelOps_)
@@ -223,6 +338,12 @@ inline void Scale2xScaler<Pixel>::scaleLine_1on2(
 	// though a single loop only has to fetch the inputs once and can
 	// eliminate some common sub-expressions). For the asm version the
 	// situation is reversed.
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2<Pixel>(srcWidth)) {
+		scaleAVX2<true>(dst0, dst1, src0, src1, src2, srcWidth);
+		return;
+	}
+#endif
 #ifdef __SSE2__
 	scaleSSE<true>(dst0, dst1, src0, src1, src2, srcWidth);
 #else
@@ -275,6 +396,12 @@ inline void Scale2xScaler<Pixel>::scaleLine_1on1(
 	const Pixel* __restrict src0, const Pixel* __restrict src1,
 	const Pixel* __restrict src2, size_t srcWidth) __restrict
 {
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2<Pixel>(srcWidth)) {
+		scaleAVX2<false>(dst0, dst1, src0, src1, src2, srcWidth);
+		return;
+	}
+#endif
 #ifdef __SSE2__
 	scaleSSE<false>(dst0, dst1, src0, src1, src2, srcWidth);
 #else
@@ -14,11 +14,185 @@ Visit the Scale2x site for info:
 #include "FrameSource.hh"
 #include "ScalerOutput.hh"
 #include "vla.hh"
+#include "HostCPU.hh"
+#include "unreachable.hh"
 #include "build-info.hh"
+#include <cassert>
 #include <cstdint>
+#include <cstring>
+#if HAVE_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
 
 namespace openmsx {
 
+#if HAVE_AVX2_DISPATCH
+
+// The AVX2 versions below give the same result as scaleLine1on3Half() and
+// scaleLine1on3Mid(). They work on copies of the input lines with the first
+// and last pixel repeated: with those extra pixels the formulas for the
+// central pixels also give the (special cased) results for the first and
+// last pixel. The width (in bytes) must be a multiple of 32.
+
+template<typename Pixel> static inline void extendLine(
+	Pixel* __restrict ext, const Pixel* __restrict line, size_t width)
+{
+	ext[0] = line[0];
+	memcpy(ext + 1, line, width * sizeof(Pixel));
+	ext[width + 1] = line[width - 1];
+}
+
+template<typename Pixel> TARGET_AVX2 static inline __m256i load256(const Pixel* p)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+template<typename Pixel> TARGET_AVX2 static inline __m256i isEqual256(__m256i x, __m256i y)
+{
+	if (sizeof(Pixel) == 4) {
+		return _mm256_cmpeq_epi32(x, y);
+	} else if (sizeof(Pixel) == 2) {
+		return _mm256_cmpeq_epi16(x, y);
+	} else {
+		UNREACHABLE;
+	}
+}
+
+// Returns 'a1' where 'mask' is set, 'a0' elsewhere.
+TARGET_AVX2 static inline __m256i select256(__m256i a0, __m256i a1, __m256i mask)
+{
+	return _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(a0, a1), mask), a0);
+}
+
+// Stores a0[0] a1[0] a2[0] a0[1] a1[1] a2[1] ... (3 * 32 bytes).
+TARGET_AVX2 static inline void store3(
+	uint32_t* dst, __m256i a0, __m256i a1, __m256i a2)
+{
+	// Output vector 'j' takes element 'k / 3' of input vector 'k % 3',
+	// with k = 8 * j + i.
+	static const int idx[3][8] = {
+		{ 0, 0, 0, 1, 1, 1, 2, 2 },
+		{ 2, 3, 3, 3, 4, 4, 4, 5 },
+		{ 5, 5, 6, 6, 6, 7, 7, 7 },
+	};
+	auto* out = reinterpret_cast<__m256i*>(dst);
+	__m256i i0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx[0]));
+	__m256i i1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx[1]));
+	__m256i i2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx[2]));
+	_mm256_storeu_si256(out + 0, _mm256_blend_epi32(_mm256_blend_epi32(
+		_mm256_permutevar8x32_epi32(a0, i0),
+		_mm256_permutevar8x32_epi32(a1, i0), 0x92),
+		_mm256_permutevar8x32_epi32(a2, i0), 0x24));
+	_mm256_storeu_si256(out + 1, _mm256_blend_epi32(_mm256_blend_epi32(
+		_mm256_permutevar8x32_epi32(a0, i1),
+		_mm256_permutevar8x32_epi32(a1, i1), 0x24),
+		_mm256_permutevar8x32_epi32(a2, i1), 0x49));
+	_mm256_storeu_si256(out + 2, _mm256_blend_epi32(_mm256_blend_epi32(
+		_mm256_permutevar8x32_epi32(a0, i2),
+		_mm256_permutevar8x32_epi32(a1, i2), 0x49),
+		_mm256_permutevar8x32_epi32(a2, i2), 0x92));
+}
+// AVX2 has no 16-bit permute across lanes, interleave via memory.
+TARGET_AVX2 static inline void store3(
+	uint16_t* dst, __m256i a0, __m256i a1, __m256i a2)
+{
+	uint16_t tmp[3][16];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp[0]), a0);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp[1]), a1);
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(tmp[2]), a2);
+	for (unsigned i = 0; i < 16; ++i) {
+		dst[3 * i + 0] = tmp[0][i];
+		dst[3 * i + 1] = tmp[1][i];
+		dst[3 * i + 2] = tmp[2][i];
+	}
+}
+
+template<typename Pixel> TARGET_AVX2 static void scaleLine1on3HalfAVX2(
+	Pixel* __restrict dst, const Pixel* __restrict src0,
+	const Pixel* __restrict src1, const Pixel* __restrict src2,
+	size_t srcWidth)
+{
+	static const size_t N = sizeof(__m256i) / sizeof(Pixel);
+	assert(srcWidth && ((srcWidth % N) == 0));
+
+	VLA(Pixel, ext0, srcWidth + 2); extendLine(ext0, src0, srcWidth);
+	VLA(Pixel, ext1, srcWidth + 2); extendLine(ext1, src1, srcWidth);
+
+	for (size_t x = 0; x < srcWidth; x += N) {
+		__m256i topLeft  = load256(ext0 + x + 0);
+		__m256i top      = load256(ext0 + x + 1);
+		__m256i topRight = load256(ext0 + x + 2);
+		__m256i left     = load256(ext1 + x + 0);
+		__m256i mid      = load256(ext1 + x + 1);
+		__m256i right    = load256(ext1 + x + 2);
+		__m256i bot      = load256(src2 + x);
+
+		__m256i skip = _mm256_or_si256(isEqual256<Pixel>(left, right),
+		                               isEqual256<Pixel>(top,  bot));
+		__m256i teql = isEqual256<Pixel>(top, left);
+		__m256i teqr = isEqual256<Pixel>(top, right);
+		__m256i c0 = _mm256_andnot_si256(skip, teql);
+		__m256i c1 = _mm256_andnot_si256(skip, _mm256_or_si256(
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, topRight), teql),
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, topLeft),  teqr)));
+		__m256i c2 = _mm256_andnot_si256(skip, teqr);
+
+		store3(dst + 3 * x, select256(mid, top, c0),
+		                    select256(mid, top, c1),
+		                    select256(mid, top, c2));
+	}
+}
+
+template<typename Pixel> TARGET_AVX2 static void scaleLine1on3MidAVX2(
+	Pixel* __restrict dst, const Pixel* __restrict src0,
+	const Pixel* __restrict src1, const Pixel* __restrict src2,
+	size_t srcWidth)
+{
+	static const size_t N = sizeof(__m256i) / sizeof(Pixel);
+	assert(srcWidth && ((srcWidth % N) == 0));
+
+	VLA(Pixel, ext0, srcWidth + 2); extendLine(ext0, src0, srcWidth);
+	VLA(Pixel, ext1, srcWidth + 2); extendLine(ext1, src1, srcWidth);
+	VLA(Pixel, ext2, srcWidth + 2); extendLine(ext2, src2, srcWidth);
+
+	for (size_t x = 0; x < srcWidth; x += N) {
+		__m256i topLeft  = load256(ext0 + x + 0);
+		__m256i top      = load256(ext0 + x + 1);
+		__m256i topRight = load256(ext0 + x + 2);
+		__m256i left     = load256(ext1 + x + 0);
+		__m256i mid      = load256(ext1 + x + 1);
+		__m256i right    = load256(ext1 + x + 2);
+		__m256i botLeft  = load256(ext2 + x + 0);
+		__m256i bot      = load256(ext2 + x + 1);
+		__m256i botRight = load256(ext2 + x + 2);
+
+		__m256i skip = _mm256_or_si256(isEqual256<Pixel>(left, right),
+		                               isEqual256<Pixel>(top,  bot));
+		__m256i c0 = _mm256_andnot_si256(skip, _mm256_or_si256(
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, botLeft),
+			                    isEqual256<Pixel>(left, top)),
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, topLeft),
+			                    isEqual256<Pixel>(left, bot))));
+		__m256i c2 = _mm256_andnot_si256(skip, _mm256_or_si256(
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, botRight),
+			                    isEqual256<Pixel>(right, top)),
+			_mm256_andnot_si256(isEqual256<Pixel>(mid, topRight),
+			                    isEqual256<Pixel>(right, bot))));
+
+		store3(dst + 3 * x, select256(mid, left,  c0),
+		                    mid,
+		                    select256(mid, right, c2));
+	}
+}
+
+template<typename Pixel> static inline bool useAVX2(unsigned width)
+{
+	return HostCPU::hasAVX2() &&
+	       (((width * sizeof(Pixel)) % sizeof(__m256i)) == 0);
+}
+
+#endif // HAVE_AVX2_DISPATCH
+
 template <class Pixel>
 Scale3xScaler<Pixel>::Scale3xScaler(const PixelOperations<Pixel>& pixelOps_)
 	: Scaler3<Pixel>(pixelOps_)
@@ -31,6 +205,12 @@ void Scale3xScaler<Pixel>::scaleLine1on3Half(
 	const Pixel* __restrict src1, const Pixel* __restrict src2,
 	unsigned srcWidth) __restrict
 {
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2<Pixel>(srcWidth)) {
+		scaleLine1on3HalfAVX2(dst, src0, src1, src2, srcWidth);
+		return;
+	}
+#endif
 	/* A B C
 	 * D E F
 	 * G H I
@@ -94,6 +274,12 @@ void Scale3xScaler<Pixel>::scaleLine1on3Mid(
 	const Pixel* __restrict src1, const Pixel* __restrict src2,
 	unsigned srcWidth) __restrict
 {
+#if HAVE_AVX2_DISPATCH
+	if (useAVX2<Pixel>(srcWidth)) {
+		scaleLine1on3MidAVX2(dst, src0, src1, src2, srcWidth);
+		return;
+	}
+#endif
 	/*
 	 * A B C
 	 * D E F
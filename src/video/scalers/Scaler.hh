@@ -30,6 +30,14 @@ public:
 	virtual void scaleImage(FrameSource& src, const RawFrame* superImpose,
 		unsigned srcStartY, unsigned srcEndY, unsigned srcWidth,
 		ScalerOutput<Pixel>& dst, unsigned dstStartY, unsigned dstEndY) = 0;
+
+	/** Can an area be split in parts that are scaled independently (e.g.
+	  * on different threads), without changing the result? This is the
+	  * case for scalers that only look at a small neighbourhood of each
+	  * pixel (they read the lines just outside the given area directly
+	  * from the source frame).
+	  */
+	virtual bool canSplit() const { return true; }
 };
 
 } // namespace openmsx
@@ -0,0 +1,177 @@
+// Compares the AVX2 edge detection of the hq scalers (calcEdgesHQ()) for all
+// line widths up to 70 pixels, and the complete output of hq2x, hq3x,
+// scale2x and scale3x, with the output without AVX2. The frames use colors
+// that lie close to each other (on both sides of the EdgeHQ thresholds):
+// random pixels, flat tiles, tiles with lines of 320 and 640 pixels mixed,
+// and MSX-like tiles with only a few colors.
+//
+// Usage: ScalerAVX2Test
+
+#include "RawFrame.hh"
+#include "TestFrames.hh"
+#include "HQCommon.hh"
+#include "HQ2xScaler.hh"
+#include "HQ3xScaler.hh"
+#include "Scale2xScaler.hh"
+#include "Scale3xScaler.hh"
+#include "PixelOperations.hh"
+#include "HostCPU.hh"
+#include "memory.hh"
+#include <SDL.h>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+using namespace openmsx::testframes;
+
+static const unsigned SRC_HEIGHT = 240;
+
+// Colors that are close to each other, so that both sides of the thresholds
+// in EdgeHQ are exercised.
+template<typename Pixel> static Pixel randomColor(minstd_rand& random)
+{
+	static const unsigned bases[4] = { 0x102030, 0x808080, 0xE0C040, 0x30F0A0 };
+	unsigned base = bases[random() % 4];
+	unsigned rgb = 0;
+	for (int shift = 0; shift < 24; shift += 8) {
+		int c = int((base >> shift) & 0xFF) + int(random() % 97) - 48;
+		rgb |= unsigned(std::min(std::max(c, 0), 255)) << shift;
+	}
+	return toPixel<Pixel>(rgb);
+}
+
+// 0: random colors, 1: tiles (long runs of equal pixels), 2: tiles with
+// lines of different widths, 3: MSXTiles (the few colors give the equal
+// neighbours that the Scale2x/3x rules look for).
+template<typename Pixel> static unique_ptr<RawFrame> createFrame(
+	const SDL_PixelFormat& format, unsigned width, int type, unsigned seed)
+{
+	auto frame = make_unique<RawFrame>(format, 640, SRC_HEIGHT);
+	minstd_rand random(seed);
+	vector<Pixel> tileColors(64);
+	for (auto& c : tileColors) c = randomColor<Pixel>(random);
+	MSXTiles msxTiles(seed);
+	for (unsigned y = 0; y < SRC_HEIGHT; ++y) {
+		if (y < 4) {
+			frame->setBlank(y, tileColors[y]);
+			continue;
+		}
+		unsigned w = ((type == 2) && ((y / 16) & 1)) ? (2 * width) : width;
+		Pixel* line = frame->getLinePtrDirect<Pixel>(y);
+		for (unsigned x = 0; x < w; ++x) {
+			line[x] = (type == 0) ? randomColor<Pixel>(random)
+			        : (type == 3) ? toPixel<Pixel>(msxTiles.getColor(x * 320 / w, y))
+			        : tileColors[((y / 8) * 7 + (x * 320 / w) / 8) % 64];
+		}
+		frame->setLineWidth(y, w);
+	}
+	return frame;
+}
+
+template<typename Pixel> static vector<Pixel> scaleFrame(
+	Scaler<Pixel>& scaler, RawFrame& frame, unsigned factor)
+{
+	unsigned dstWidth  = 320 * factor;
+	unsigned dstHeight = SRC_HEIGHT * factor;
+	vector<Pixel> buffer(dstWidth * dstHeight);
+	MemoryScalerOutput<Pixel> dst(buffer, dstWidth, dstHeight);
+	// same region splitting as FBPostProcessor::paint()
+	unsigned srcStartY = 0;
+	while (srcStartY < SRC_HEIGHT) {
+		unsigned lineWidth = frame.getLineWidthDirect(srcStartY);
+		unsigned srcEndY = srcStartY + 1;
+		while ((srcEndY < SRC_HEIGHT) &&
+		       (frame.getLineWidthDirect(srcEndY) == lineWidth)) {
+			++srcEndY;
+		}
+		scaler.scaleImage(frame, nullptr, srcStartY, srcEndY, lineWidth,
+		                  dst, srcStartY * factor, srcEndY * factor);
+		srcStartY = srcEndY;
+	}
+	return buffer;
+}
+
+template<typename Pixel> static vector<Pixel> calcEdges(
+	const vector<Pixel>& in1, const vector<Pixel>& in2, EdgeHQ edgeOp)
+{
+	vector<unsigned> edges(in1.size());
+	calcEdgesHQ(in1.data(), in2.data(), unsigned(in1.size()), edges.data(), edgeOp);
+	return vector<Pixel>(edges.begin(), edges.end());
+}
+
+template<typename Pixel> static int test(const char* bpp)
+{
+	SDL_PixelFormat format = createFormat<Pixel>();
+	PixelOperations<Pixel> pixelOps(format);
+	int errors = 0;
+	auto check = [&](const string& name, const vector<Pixel>& ref,
+	                 const vector<Pixel>& avx2) {
+		if (ref != avx2) {
+			cout << "FAILED: " << name << ' ' << bpp << endl;
+			++errors;
+		}
+	};
+
+	// All line widths, also the ones that are not a multiple of 8.
+	minstd_rand random(42);
+	EdgeHQ edgeOp = createEdgeHQ(pixelOps);
+	for (unsigned width = 1; width <= 70; ++width) {
+		vector<Pixel> in1(width), in2(width);
+		for (auto& p : in1) p = randomColor<Pixel>(random);
+		for (auto& p : in2) p = randomColor<Pixel>(random);
+		HostCPU::setAVX2(false);
+		auto ref = calcEdges(in1, in2, edgeOp);
+		HostCPU::setAVX2(true);
+		check("edges width=" + to_string(width), ref, calcEdges(in1, in2, edgeOp));
+	}
+
+	struct ScalerInfo {
+		const char* name;
+		unsigned factor;
+		function<unique_ptr<Scaler<Pixel>>()> create;
+	};
+	ScalerInfo scalers[] = {
+		{"hq2x",    2, [&]() { return make_unique<HQ2xScaler   <Pixel>>(pixelOps); }},
+		{"hq3x",    3, [&]() { return make_unique<HQ3xScaler   <Pixel>>(pixelOps); }},
+		{"scale2x", 2, [&]() { return make_unique<Scale2xScaler<Pixel>>(pixelOps); }},
+		{"scale3x", 3, [&]() { return make_unique<Scale3xScaler<Pixel>>(pixelOps); }},
+	};
+	for (auto& s : scalers) {
+		for (int type = 0; type < 4; ++type) {
+			for (unsigned width : {320u, 640u}) {
+				if ((type == 2) && (width == 640)) continue;
+				auto frame = createFrame<Pixel>(format, width, type, type + width);
+				HostCPU::setAVX2(false);
+				auto ref = scaleFrame(*s.create(), *frame, s.factor);
+				HostCPU::setAVX2(true);
+				auto avx2 = scaleFrame(*s.create(), *frame, s.factor);
+				check(string(s.name) + " type=" + to_string(type) +
+				      " width=" + to_string(width), ref, avx2);
+			}
+		}
+	}
+	return errors;
+}
+
+int main()
+{
+	HostCPU::setAVX2(true);
+	if (!HostCPU::hasAVX2()) {
+		cout << "This CPU doesn't support AVX2, nothing to test." << endl;
+		return 0;
+	}
+	int errors = 0;
+#if HAVE_16BPP
+	errors += test<uint16_t>("16bpp");
+#endif
+#if HAVE_32BPP
+	errors += test<uint32_t>("32bpp");
+#endif
+	if (errors == 0) cout << "All tests passed." << endl;
+	return errors ? 1 : 0;
+}
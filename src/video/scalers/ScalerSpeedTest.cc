@@ -0,0 +1,159 @@
+// Measures the speed of the software scalers when they run on 1..N threads
+// (see ParallelScaler). Also checks that the multi-threaded result is
+// identical to the single-threaded result.
+//
+// Usage: ScalerSpeedTest [<max-threads> [<seconds-per-measurement>]]
+//
+// The scalers that depend on RenderSettings (simple, RGBtriplet, TV) are not
+// included, they need a full openMSX environment.
+
+#include "ParallelScaler.hh"
+#include "RawFrame.hh"
+#include "TestFrames.hh"
+#include "HQ2xScaler.hh"
+#include "HQ3xScaler.hh"
+#include "HQ2xLiteScaler.hh"
+#include "HQ3xLiteScaler.hh"
+#include "SaI2xScaler.hh"
+#include "SaI3xScaler.hh"
+#include "Scale2xScaler.hh"
+#include "Scale3xScaler.hh"
+#include "MLAAScaler.hh"
+#include "PixelOperations.hh"
+#include "memory.hh"
+#include <SDL.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace openmsx;
+using namespace openmsx::testframes;
+
+using Pixel = uint32_t;
+
+static const unsigned SRC_HEIGHT = 240;
+
+
+// MSXTiles (lots of edges for the hq and SaI scalers), some blank border
+// lines and optionally lines of different widths.
+static unique_ptr<RawFrame> createFrame(
+	const SDL_PixelFormat& format, unsigned width, bool mixed)
+{
+	auto frame = make_unique<RawFrame>(format, 640, SRC_HEIGHT);
+	MSXTiles tiles;
+	for (unsigned y = 0; y < SRC_HEIGHT; ++y) {
+		if ((y < 8) || (y >= (SRC_HEIGHT - 8))) {
+			frame->setBlank(y, Pixel(MSXTiles::getPaletteColor(4)));
+			continue;
+		}
+		unsigned w = (mixed && ((y / 40) & 1)) ? (2 * width) : width;
+		Pixel* line = frame->getLinePtrDirect<Pixel>(y);
+		for (unsigned x = 0; x < w; ++x) {
+			line[x] = tiles.getColor(x * 320 / w, y);
+		}
+		frame->setLineWidth(y, w);
+	}
+	return frame;
+}
+
+// Same region splitting as FBPostProcessor::paint().
+static void scaleFrame(ParallelScaler<Pixel>& scaler, RawFrame& frame,
+                       vector<Pixel>& buffer, unsigned dstWidth, unsigned factor)
+{
+	unsigned dstHeight = SRC_HEIGHT * factor;
+	unsigned srcStartY = 0;
+	while (srcStartY < SRC_HEIGHT) {
+		unsigned lineWidth = frame.getLineWidthDirect(srcStartY);
+		unsigned srcEndY = srcStartY + 1;
+		while ((srcEndY < SRC_HEIGHT) &&
+		       (frame.getLineWidthDirect(srcEndY) == lineWidth)) {
+			++srcEndY;
+		}
+		scaler.scaleImage(
+			frame, nullptr, srcStartY, srcEndY, 1, lineWidth,
+			[&]() {
+				return make_unique<MemoryScalerOutput<Pixel>>(
+					buffer, dstWidth, dstHeight);
+			},
+			srcStartY * factor, srcEndY * factor, factor);
+		srcStartY = srcEndY;
+	}
+}
+
+struct ScalerInfo {
+	const char* name;
+	unsigned factor;
+	function<unique_ptr<Scaler<Pixel>>(const PixelOperations<Pixel>&)> create;
+};
+
+int main(int argc, char** argv)
+{
+	unsigned maxThreads = (argc > 1) ? atoi(argv[1])
+	                                 : max(1u, thread::hardware_concurrency());
+	double duration = (argc > 2) ? atof(argv[2]) : 1.0;
+
+	SDL_PixelFormat format = createFormat<Pixel>();
+	PixelOperations<Pixel> pixelOps(format);
+
+	vector<ScalerInfo> scalers = {
+		{"hq2x",     2, [](const PixelOperations<Pixel>& p) { return make_unique<HQ2xScaler    <Pixel>>(p); }},
+		{"hq3x",     3, [](const PixelOperations<Pixel>& p) { return make_unique<HQ3xScaler    <Pixel>>(p); }},
+		{"hqlite2x", 2, [](const PixelOperations<Pixel>& p) { return make_unique<HQ2xLiteScaler<Pixel>>(p); }},
+		{"hqlite3x", 3, [](const PixelOperations<Pixel>& p) { return make_unique<HQ3xLiteScaler<Pixel>>(p); }},
+		{"sai2x",    2, [](const PixelOperations<Pixel>& p) { return make_unique<SaI2xScaler   <Pixel>>(p); }},
+		{"sai3x",    3, [](const PixelOperations<Pixel>& p) { return make_unique<SaI3xScaler   <Pixel>>(p); }},
+		{"scale2x",  2, [](const PixelOperations<Pixel>& p) { return make_unique<Scale2xScaler <Pixel>>(p); }},
+		{"scale3x",  3, [](const PixelOperations<Pixel>& p) { return make_unique<Scale3xScaler <Pixel>>(p); }},
+		{"mlaa2x",   2, [](const PixelOperations<Pixel>& p) { return make_unique<MLAAScaler    <Pixel>>(640, p); }},
+		{"mlaa3x",   3, [](const PixelOperations<Pixel>& p) { return make_unique<MLAAScaler    <Pixel>>(960, p); }},
+	};
+	struct FrameInfo { const char* name; unique_ptr<RawFrame> frame; };
+	FrameInfo frames[] = {
+		{"320", createFrame(format, 320, false)},
+		{"640", createFrame(format, 640, false)},
+		{"mixed", createFrame(format, 320, true)},
+	};
+
+	int result = 0;
+	cout << "frames/sec at 1.." << maxThreads << " threads" << endl;
+	for (auto& s : scalers) {
+		unsigned dstWidth  = 320 * s.factor;
+		unsigned dstHeight = SRC_HEIGHT * s.factor;
+		for (auto& f : frames) {
+			cout << setw(9) << left << s.name << setw(6) << f.name << right;
+			vector<Pixel> reference;
+			for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+				ParallelScaler<Pixel> scaler;
+				scaler.setScaler(threads, [&]() { return s.create(pixelOps); });
+				vector<Pixel> buffer(dstWidth * dstHeight);
+
+				unsigned count = 0;
+				auto start = chrono::steady_clock::now();
+				double elapsed;
+				do {
+					scaleFrame(scaler, *f.frame, buffer, dstWidth, s.factor);
+					++count;
+					elapsed = chrono::duration<double>(
+						chrono::steady_clock::now() - start).count();
+				} while (elapsed < duration);
+				cout << setw(9) << fixed << setprecision(1) << (count / elapsed);
+
+				if (threads == 1) {
+					reference = buffer;
+				} else if (buffer != reference) {
+					cout << " (DIFFERENT OUTPUT)";
+					result = 1;
+				}
+			}
+			cout << endl;
+		}
+	}
+	return result;
+}
@@ -5,6 +5,7 @@
 #include "V9990BitmapConverter.hh"
 #include "V9990P1Converter.hh"
 #include "V9990P2Converter.hh"
+#include "RawFramePool.hh"
 #include "Observer.hh"
 #include <memory>
 
@@ -13,7 +14,6 @@ namespace openmsx {
 class Display;
 class V9990;
 class V9990VRAM;
-class RawFrame;
 class OutputSurface;
 class VisibleSurface;
 class RenderSettings;
@@ -69,10 +69,6 @@ private:
 	  */
 	OutputSurface& screen;
 
-	/** The next frame as it is delivered by the VDP, work in progress.
-	  */
-	std::unique_ptr<RawFrame> workFrame;
-
 	/** The current renderer settings (gamma, brightness, contrast)
 	  */
 	RenderSettings& renderSettings;
@@ -111,6 +107,10 @@ private:
 	  */
 	const std::unique_ptr<PostProcessor> postProcessor;
 
+	/** The next frame as it is delivered by the VDP, work in progress.
+	  */
+	RawFramePool::Ref workFrame;
+
 	V9990BitmapConverter<Pixel> bitmapConverter;
 	V9990P1Converter<Pixel> p1Converter;
 	V9990P2Converter<Pixel> p2Converter;